@@ -26472,6 +26472,132 @@ static void test_sample_attached_rendertarget(void)
     DestroyWindow(window);
 }
 
+static void draw_with_shaders(IDirect3DDevice9 *device, unsigned int index)
+{
+    IDirect3DVertexShader9 *vs;
+    IDirect3DPixelShader9 *ps;
+    D3DCOLOR color;
+    HRESULT hr;
+
+    static const DWORD vs_code[] =
+    {
+        0xfffe0101,                                 /* vs_1_1           */
+        0x0000001f, 0x80000000, 0x900f0000,         /* dcl_position v0  */
+        0x0000001f, 0x8000000a, 0x900f0001,         /* dcl_color v1     */
+        0x00000001, 0xc00f0000, 0x90e40000,         /* mov oPos, v0     */
+        0x00000001, 0xd00f0000, 0x90e40001,         /* mov oD0, v1      */
+        0x0000ffff
+    };
+    static const DWORD ps_code[] =
+    {
+        0xffff0101,                                 /* ps_1_1           */
+        0x00000001, 0x800f0000, 0x90e40000,         /* mov r0, v0       */
+        0x0000ffff                                  /* end              */
+    };
+    static const struct
+    {
+        struct vec3 position;
+        DWORD diffuse;
+    }
+    quad[] =
+    {
+        {{-1.0f, -1.0f, 0.1f}, 0xff00ff00},
+        {{-1.0f,  1.0f, 0.1f}, 0xff00ff00},
+        {{ 1.0f, -1.0f, 0.1f}, 0xff00ff00},
+        {{ 1.0f,  1.0f, 0.1f}, 0xff00ff00},
+    };
+
+    hr = IDirect3DDevice9_CreateVertexShader(device, vs_code, &vs);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    hr = IDirect3DDevice9_CreatePixelShader(device, ps_code, &ps);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    hr = IDirect3DDevice9_SetVertexShader(device, vs);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    hr = IDirect3DDevice9_SetPixelShader(device, ps);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    hr = IDirect3DDevice9_SetFVF(device, D3DFVF_XYZ | D3DFVF_DIFFUSE);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+
+    hr = IDirect3DDevice9_Clear(device, 0, NULL, D3DCLEAR_TARGET, 0xff0000ff, 0.0f, 0);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    hr = IDirect3DDevice9_BeginScene(device);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    hr = IDirect3DDevice9_DrawPrimitiveUP(device, D3DPT_TRIANGLESTRIP, 2, quad, sizeof(*quad));
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    hr = IDirect3DDevice9_EndScene(device);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+
+    color = getPixelColor(device, 320, 240);
+    ok(color_match(color, 0x0000ff00, 1), "Got unexpected color 0x%08x, device %u.\n", color, index);
+
+    IDirect3DDevice9_SetVertexShader(device, NULL);
+    IDirect3DDevice9_SetPixelShader(device, NULL);
+    IDirect3DVertexShader9_Release(vs);
+    IDirect3DPixelShader9_Release(ps);
+}
+
+/* Programs linked by one device may be reused by the devices created after it,
+ * including when another device is still alive. */
+static void test_shader_reuse_across_devices(void)
+{
+    IDirect3DDevice9 *device, *device2;
+    HWND window, window2;
+    IDirect3D9 *d3d;
+    ULONG refcount;
+    D3DCAPS9 caps;
+    HRESULT hr;
+
+    window = create_window();
+    window2 = create_window();
+    d3d = Direct3DCreate9(D3D_SDK_VERSION);
+    ok(!!d3d, "Failed to create a D3D object.\n");
+    if (!(device = create_device(d3d, window, window, TRUE)))
+    {
+        skip("Failed to create a D3D device, skipping tests.\n");
+        goto done;
+    }
+
+    hr = IDirect3DDevice9_GetDeviceCaps(device, &caps);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    if (caps.VertexShaderVersion < D3DVS_VERSION(1, 1) || caps.PixelShaderVersion < D3DPS_VERSION(1, 1))
+    {
+        skip("No shader model 1.1 support, skipping tests.\n");
+        IDirect3DDevice9_Release(device);
+        goto done;
+    }
+
+    draw_with_shaders(device, 0);
+    if (!(device2 = create_device(d3d, window2, window2, TRUE)))
+    {
+        skip("Failed to create a second D3D device, skipping tests.\n");
+        IDirect3DDevice9_Release(device);
+        goto done;
+    }
+    draw_with_shaders(device2, 1);
+    refcount = IDirect3DDevice9_Release(device);
+    ok(!refcount, "Device has %u references left.\n", refcount);
+
+    device = create_device(d3d, window, window, TRUE);
+    ok(!!device, "Failed to create a D3D device.\n");
+    draw_with_shaders(device, 2);
+    draw_with_shaders(device2, 3);
+    refcount = IDirect3DDevice9_Release(device2);
+    ok(!refcount, "Device has %u references left.\n", refcount);
+    refcount = IDirect3DDevice9_Release(device);
+    ok(!refcount, "Device has %u references left.\n", refcount);
+
+    device = create_device(d3d, window, window, TRUE);
+    ok(!!device, "Failed to create a D3D device.\n");
+    draw_with_shaders(device, 4);
+    refcount = IDirect3DDevice9_Release(device);
+    ok(!refcount, "Device has %u references left.\n", refcount);
+
+done:
+    IDirect3D9_Release(d3d);
+    DestroyWindow(window2);
+    DestroyWindow(window);
+}
+
 START_TEST(visual)
 {
     D3DADAPTER_IDENTIFIER9 identifier;
@@ -26618,4 +26744,5 @@ START_TEST(visual)
     test_mismatched_sample_types();
     test_draw_mapped_buffer();
     test_sample_attached_rendertarget();
+    test_shader_reuse_across_devices();
 }
@@ -179,6 +179,8 @@ static HRESULT DirectSoundDevice_Create(DirectSoundDevice ** ppDevice)
     InitializeCriticalSection(&(device->mixlock));
     device->mixlock.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": DirectSoundDevice.mixlock");
 
+    list_init(&device->fir_banks);
+
     InitializeSRWLock(&device->buffer_list_lock);
 
    *ppDevice = device;
@@ -236,6 +238,7 @@ static ULONG DirectSoundDevice_Release(DirectSoundDevice * device)
         HeapFree(GetProcessHeap(), 0, device->tmp_buffer);
         HeapFree(GetProcessHeap(), 0, device->cp_buffer);
         HeapFree(GetProcessHeap(), 0, device->buffer);
+        DSOUND_FreeFirBanks(device);
         device->mixlock.DebugInfo->Spare[0] = 0;
         DeleteCriticalSection(&device->mixlock);
         HeapFree(GetProcessHeap(),0,device);
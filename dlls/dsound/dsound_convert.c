@@ -100,6 +100,55 @@ static float getieee32(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD chann
 
 const bitsgetfunc getbpp[5] = {get8, get16, get24, get32, getieee32};
 
+static void get8_planar(const BYTE *src, UINT stride, float *dst, UINT count)
+{
+    while (count--)
+    {
+        *dst++ = (src[0] - 0x80) / (float)0x80;
+        src += stride;
+    }
+}
+
+static void get16_planar(const BYTE *src, UINT stride, float *dst, UINT count)
+{
+    while (count--)
+    {
+        *dst++ = (SHORT)le16(*(const SHORT *)src) / (float)0x8000;
+        src += stride;
+    }
+}
+
+static void get24_planar(const BYTE *src, UINT stride, float *dst, UINT count)
+{
+    while (count--)
+    {
+        LONG sample = (src[0] << 8) | (src[1] << 16) | (src[2] << 24);
+        *dst++ = sample / (float)0x80000000U;
+        src += stride;
+    }
+}
+
+static void get32_planar(const BYTE *src, UINT stride, float *dst, UINT count)
+{
+    while (count--)
+    {
+        *dst++ = (LONG)le32(*(const LONG *)src) / (float)0x80000000U;
+        src += stride;
+    }
+}
+
+static void getieee32_planar(const BYTE *src, UINT stride, float *dst, UINT count)
+{
+    while (count--)
+    {
+        *dst++ = *(const float *)src;
+        src += stride;
+    }
+}
+
+/* Convert one channel of count frames starting at src to planar floats. */
+const bitsgetplanarfunc getbpp_planar[5] = {get8_planar, get16_planar, get24_planar, get32_planar, getieee32_planar};
+
 float get_mono(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel)
 {
     DWORD channels = dsb->pwfx->nChannels;
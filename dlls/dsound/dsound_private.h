@@ -33,6 +33,7 @@
 #include "wine/list.h"
 
 #define DS_MAX_CHANNELS 6
+#define DS_MAX_MIX_CHANNELS 8
 
 extern int ds_hel_buflen DECLSPEC_HIDDEN;
 
@@ -45,7 +46,9 @@ typedef struct DirectSoundDevice             DirectSoundDevice;
 /* dsound_convert.h */
 typedef float (*bitsgetfunc)(const IDirectSoundBufferImpl *, DWORD, DWORD);
 typedef void (*bitsputfunc)(const IDirectSoundBufferImpl *, DWORD, DWORD, float);
+typedef void (*bitsgetplanarfunc)(const BYTE *, UINT, float *, UINT);
 extern const bitsgetfunc getbpp[5] DECLSPEC_HIDDEN;
+extern const bitsgetplanarfunc getbpp_planar[5] DECLSPEC_HIDDEN;
 void putieee32(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value) DECLSPEC_HIDDEN;
 void putieee32_sum(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value) DECLSPEC_HIDDEN;
 void mixieee32(float *src, float *dst, unsigned samples) DECLSPEC_HIDDEN;
@@ -90,6 +93,8 @@ struct DirectSoundDevice
     int                         lfe_channel;
     float *tmp_buffer, *cp_buffer;
     DWORD                       tmp_buffer_len, cp_buffer_len;
+    struct list                 fir_banks;
+    int                         nrofbanks;
 
     DSVOLUMEPAN                 volpan;
 
@@ -165,6 +170,10 @@ struct IDirectSoundBufferImpl
     int                         mix_channels;
     bitsgetfunc get, get_aux;
     bitsputfunc put, put_aux;
+    bitsgetplanarfunc get_planar;
+    /* output channel gains per mixed channel, equivalent to put */
+    float                       mix_matrix[DS_MAX_CHANNELS][DS_MAX_MIX_CHANNELS];
+    BOOL                        mix_direct;
     int                         num_filters;
     DSFilter*                   filters;
 
@@ -225,6 +234,8 @@ void DSOUND_CheckEvent(const IDirectSoundBufferImpl *dsb, DWORD playpos, int len
 void DSOUND_RecalcVolPan(PDSVOLUMEPAN volpan) DECLSPEC_HIDDEN;
 void DSOUND_AmpFactorToVolPan(PDSVOLUMEPAN volpan) DECLSPEC_HIDDEN;
 void DSOUND_RecalcFormat(IDirectSoundBufferImpl *dsb) DECLSPEC_HIDDEN;
+void DSOUND_FreeFirBanks(DirectSoundDevice *device) DECLSPEC_HIDDEN;
+void DSOUND_InitMixer(void) DECLSPEC_HIDDEN;
 DWORD DSOUND_secpos_to_bufpos(const IDirectSoundBufferImpl *dsb, DWORD secpos, DWORD secmixpos, float *overshot) DECLSPEC_HIDDEN;
 
 DWORD CALLBACK DSOUND_mixthread(void *ptr) DECLSPEC_HIDDEN;
@@ -86,6 +86,56 @@ void DSOUND_AmpFactorToVolPan(PDSVOLUMEPAN volpan)
     TRACE("Vol=%d Pan=%d\n", volpan->lVolume, volpan->lPan);
 }
 
+/**
+ * Describe the channel mapping done by dsb->put as a matrix of gains, so
+ * that the resampled channels can be mixed into the device buffer directly.
+ */
+static void DSOUND_RecalcMixMatrix(IDirectSoundBufferImpl *dsb)
+{
+	DWORD ochannels = dsb->device->pwfx->nChannels;
+	float (*m)[DS_MAX_MIX_CHANNELS] = dsb->mix_matrix;
+	int i;
+
+	memset(dsb->mix_matrix, 0, sizeof(dsb->mix_matrix));
+	dsb->mix_direct = ochannels <= DS_MAX_CHANNELS && dsb->mix_channels <= DS_MAX_MIX_CHANNELS;
+	if (!dsb->mix_direct)
+		return;
+
+	if (dsb->put == put_mono2stereo || dsb->put == put_mono2quad || dsb->put == put_mono2surround51)
+	{
+		for (i = 0; i < ochannels; i++)
+			m[i][0] = 1.0f;
+	}
+	else if (dsb->put == put_stereo2quad)
+	{
+		m[0][0] = m[2][0] = 1.0f;
+		m[1][1] = m[3][1] = 1.0f;
+	}
+	else if (dsb->put == put_stereo2surround51)
+	{
+		m[0][0] = m[4][0] = 1.0f;
+		m[1][1] = m[5][1] = 1.0f;
+	}
+	else if (dsb->put == put_surround512stereo || dsb->put == put_surround712stereo)
+	{
+		m[0][0] = m[1][1] = 1.0f;
+		m[0][2] = m[1][2] = 0.7f;
+		m[0][4] = m[1][5] = 0.24f;
+		if (dsb->put == put_surround712stereo)
+			m[0][6] = m[1][7] = 0.24f;
+	}
+	else if (dsb->put == put_quad2stereo)
+	{
+		m[0][0] = m[1][1] = 0.9f;
+		m[0][2] = m[1][3] = 0.1f;
+	}
+	else
+	{
+		for (i = 0; i < dsb->mix_channels && i < ochannels; i++)
+			m[i][i] = 1.0f;
+	}
+}
+
 /**
  * Recalculate the size for temporary buffer, and new writelead
  * Should be called when one of the following things occur:
@@ -133,6 +183,7 @@ void DSOUND_RecalcFormat(IDirectSoundBufferImpl *dsb)
 	dsb->freqAccNum = 0;
 
 	dsb->get_aux = ieee ? getbpp[4] : getbpp[dsb->pwfx->wBitsPerSample/8 - 1];
+	dsb->get_planar = ieee ? getbpp_planar[4] : getbpp_planar[dsb->pwfx->wBitsPerSample/8 - 1];
 	dsb->put_aux = putieee32;
 
 	dsb->get = dsb->get_aux;
@@ -196,6 +247,8 @@ void DSOUND_RecalcFormat(IDirectSoundBufferImpl *dsb)
 			FIXME("Conversion from %u to %u channels is not implemented, falling back to stereo\n", ichannels, ochannels);
 		dsb->mix_channels = 2;
 	}
+
+	DSOUND_RecalcMixMatrix(dsb);
 }
 
 /**
@@ -275,31 +328,296 @@ void DSOUND_CheckEvent(const IDirectSoundBufferImpl *dsb, DWORD playpos, int len
     }
 }
 
-static inline float get_current_sample(const IDirectSoundBufferImpl *dsb,
-        DWORD mixpos, DWORD channel)
+/* Precomputed polyphase filter bank for one FIR step: for each phase, the
+ * taps and the differences to the next taps for the linear interpolation. */
+struct fir_bank
+{
+    struct list entry;
+    DWORD firstep;
+    UINT taps;
+    float coefs[1];
+};
+
+#define DS_MAX_FIR_BANKS 8
+
+static struct fir_bank *DSOUND_GetFirBank(DirectSoundDevice *device, DWORD firstep)
 {
-    if (mixpos >= dsb->buflen && !(dsb->playflags & DSBPLAY_LOOPING))
-        return 0.0f;
-    return dsb->get(dsb, mixpos % dsb->buflen, channel);
+    struct fir_bank *bank;
+    UINT taps, phase, idx, j;
+
+    LIST_FOR_EACH_ENTRY(bank, &device->fir_banks, struct fir_bank, entry)
+    {
+        if (bank->firstep == firstep)
+        {
+            list_remove(&bank->entry);
+            list_add_head(&device->fir_banks, &bank->entry);
+            return bank;
+        }
+    }
+
+    /* pad the taps so that they can be processed eight at a time */
+    taps = ((fir_len + firstep - 2) / firstep + 7) & ~7;
+    bank = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY,
+            FIELD_OFFSET(struct fir_bank, coefs[2 * taps * firstep]));
+    if (!bank)
+        return NULL;
+    bank->firstep = firstep;
+    bank->taps = taps;
+
+    for (phase = 0; phase < firstep; phase++) {
+        float *coefs = bank->coefs + 2 * taps * phase, *diffs = coefs + taps;
+        for (idx = phase, j = 0; idx < fir_len - 1; idx += firstep, j++) {
+            coefs[j] = fir[idx];
+            diffs[j] = fir[idx + 1] - fir[idx];
+        }
+    }
+
+    TRACE("created %u phases of %u taps for step %u\n", firstep, taps, firstep);
+
+    if (device->nrofbanks == DS_MAX_FIR_BANKS) {
+        struct fir_bank *old = LIST_ENTRY(list_tail(&device->fir_banks), struct fir_bank, entry);
+        list_remove(&old->entry);
+        HeapFree(GetProcessHeap(), 0, old);
+    } else
+        device->nrofbanks++;
+    list_add_head(&device->fir_banks, &bank->entry);
+    return bank;
 }
 
-static UINT cp_fields_noresample(IDirectSoundBufferImpl *dsb, UINT count)
+void DSOUND_FreeFirBanks(DirectSoundDevice *device)
+{
+    struct fir_bank *bank, *next;
+
+    LIST_FOR_EACH_ENTRY_SAFE(bank, next, &device->fir_banks, struct fir_bank, entry)
+        HeapFree(GetProcessHeap(), 0, bank);
+    list_init(&device->fir_banks);
+    device->nrofbanks = 0;
+}
+
+static float *DSOUND_GetCpBuffer(DirectSoundDevice *device, DWORD len)
+{
+    float *buffer;
+
+    if (device->cp_buffer && len <= device->cp_buffer_len)
+        return device->cp_buffer;
+
+    if (!device->cp_buffer)
+        buffer = HeapAlloc(GetProcessHeap(), 0, len);
+    else
+        buffer = HeapReAlloc(GetProcessHeap(), 0, device->cp_buffer, len);
+    if (!buffer) {
+        WARN("out of memory\n");
+        return NULL;
+    }
+    device->cp_buffer = buffer;
+    device->cp_buffer_len = len;
+    return buffer;
+}
+
+/**
+ * Convert count frames of one channel, starting at the byte offset mixpos,
+ * to floats. Frames beyond the end of a non-looping buffer are silent.
+ */
+static void get_planar_channel(const IDirectSoundBufferImpl *dsb, DWORD mixpos,
+        DWORD channel, float *dst, UINT count)
 {
     UINT istride = dsb->pwfx->nBlockAlign;
-    UINT ostride = dsb->device->pwfx->nChannels * sizeof(float);
-    DWORD channel, i;
+    const BYTE *src = dsb->buffer->memory + channel * (dsb->pwfx->wBitsPerSample / 8);
+    UINT n;
+
+    while (count) {
+        if (mixpos >= dsb->buflen) {
+            if (!(dsb->playflags & DSBPLAY_LOOPING)) {
+                memset(dst, 0, count * sizeof(float));
+                return;
+            }
+            mixpos %= dsb->buflen;
+        }
+        n = min(count, (dsb->buflen - mixpos + istride - 1) / istride);
+        dsb->get_planar(src + mixpos, istride, dst, n);
+        mixpos += n * istride;
+        dst += n;
+        count -= n;
+    }
+}
+
+static void get_planar(const IDirectSoundBufferImpl *dsb, DWORD mixpos,
+        DWORD channel, float *dst, UINT count)
+{
+    UINT istride = dsb->pwfx->nBlockAlign;
+    DWORD channels = dsb->pwfx->nChannels, c;
+    float tmp[256];
+    UINT i, j, n;
+
+    if (dsb->get != get_mono) {
+        get_planar_channel(dsb, mixpos, channel, dst, count);
+        return;
+    }
+
+    /* see get_mono */
+    get_planar_channel(dsb, mixpos, 0, dst, count);
+    for (c = 1; c < channels; c++) {
+        for (i = 0; i < count; i += n) {
+            n = min(count - i, ARRAY_SIZE(tmp));
+            get_planar_channel(dsb, mixpos + i * istride, c, tmp, n);
+            for (j = 0; j < n; j++)
+                dst[i + j] += tmp[j];
+        }
+    }
     for (i = 0; i < count; i++)
-        for (channel = 0; channel < dsb->mix_channels; channel++)
-            dsb->put(dsb, i * ostride, channel, get_current_sample(dsb,
-                    dsb->sec_mixpos + i * istride, channel));
+        dst[i] /= channels;
+}
+
+/* Compute the dot products of x with the taps and with their differences,
+ * taps must be a multiple of eight. */
+static void fir_dot_c(const float *coefs, const float *diffs, const float *x, UINT taps,
+        float *sum, float *diff_sum)
+{
+    float s[4] = {0}, d[4] = {0};
+    UINT j, k;
+
+    for (j = 0; j < taps; j += 4) {
+        for (k = 0; k < 4; k++) {
+            s[k] += coefs[j + k] * x[j + k];
+            d[k] += diffs[j + k] * x[j + k];
+        }
+    }
+    *sum = (s[0] + s[2]) + (s[1] + s[3]);
+    *diff_sum = (d[0] + d[2]) + (d[1] + d[3]);
+}
+
+/* Add the stereo downmix of planar frames to the device buffer, using the
+ * rows l and r of the gain matrix. Returns the number of frames mixed. */
+static UINT mix_stereo_c(const float *planar, UINT ichannels, const float *l, const float *r,
+        float *mix_buffer, DWORD frames)
+{
+    return 0;
+}
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__)) \
+    && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9) || defined(__clang__))
+
+/* msvcrt builds can't use the intrinsics headers, use the compiler vector types instead */
+typedef float v4sf __attribute__((vector_size(16)));
+typedef float v4sf_unaligned __attribute__((vector_size(16), aligned(4)));
+typedef float v8sf __attribute__((vector_size(32)));
+typedef float v8sf_unaligned __attribute__((vector_size(32), aligned(4)));
+
+static void __attribute__((target("sse"))) fir_dot_sse(const float *coefs, const float *diffs,
+        const float *x, UINT taps, float *sum, float *diff_sum)
+{
+    v4sf s = {0}, d = {0};
+    UINT j;
+
+    for (j = 0; j < taps; j += 4) {
+        v4sf v = *(const v4sf_unaligned *)(x + j);
+        s += *(const v4sf_unaligned *)(coefs + j) * v;
+        d += *(const v4sf_unaligned *)(diffs + j) * v;
+    }
+    *sum = (s[0] + s[2]) + (s[1] + s[3]);
+    *diff_sum = (d[0] + d[2]) + (d[1] + d[3]);
+}
+
+static void __attribute__((target("avx"))) fir_dot_avx(const float *coefs, const float *diffs,
+        const float *x, UINT taps, float *sum, float *diff_sum)
+{
+    v8sf s = {0}, d = {0};
+    UINT j;
+
+    for (j = 0; j < taps; j += 8) {
+        v8sf v = *(const v8sf_unaligned *)(x + j);
+        s += *(const v8sf_unaligned *)(coefs + j) * v;
+        d += *(const v8sf_unaligned *)(diffs + j) * v;
+    }
+    *sum = ((s[0] + s[4]) + (s[2] + s[6])) + ((s[1] + s[5]) + (s[3] + s[7]));
+    *diff_sum = ((d[0] + d[4]) + (d[2] + d[6])) + ((d[1] + d[5]) + (d[3] + d[7]));
+}
+
+static UINT __attribute__((target("sse"))) mix_stereo_sse(const float *planar, UINT ichannels,
+        const float *l, const float *r, float *mix_buffer, DWORD frames)
+{
+    UINT i, c;
+
+    for (i = 0; i + 4 <= frames; i += 4) {
+        v4sf sl = {0}, sr = {0};
+        for (c = 0; c < ichannels; c++) {
+            v4sf v = *(const v4sf_unaligned *)(planar + c * frames + i);
+            sl += v * l[c];
+            sr += v * r[c];
+        }
+        for (c = 0; c < 4; c++) {
+            mix_buffer[2 * (i + c)] += sl[c];
+            mix_buffer[2 * (i + c) + 1] += sr[c];
+        }
+    }
+    return i;
+}
+
+static UINT __attribute__((target("avx"))) mix_stereo_avx(const float *planar, UINT ichannels,
+        const float *l, const float *r, float *mix_buffer, DWORD frames)
+{
+    UINT i, c;
+
+    for (i = 0; i + 8 <= frames; i += 8) {
+        v8sf sl = {0}, sr = {0};
+        for (c = 0; c < ichannels; c++) {
+            v8sf v = *(const v8sf_unaligned *)(planar + c * frames + i);
+            sl += v * l[c];
+            sr += v * r[c];
+        }
+        for (c = 0; c < 8; c++) {
+            mix_buffer[2 * (i + c)] += sl[c];
+            mix_buffer[2 * (i + c) + 1] += sr[c];
+        }
+    }
+    return i;
+}
+
+#define HAVE_X86_SIMD_FUNCS
+#endif
+
+static void (*fir_dot)(const float *coefs, const float *diffs, const float *x, UINT taps,
+        float *sum, float *diff_sum) = fir_dot_c;
+static UINT (*mix_stereo)(const float *planar, UINT ichannels, const float *l, const float *r,
+        float *mix_buffer, DWORD frames) = mix_stereo_c;
+
+/* Select the vector code paths supported by the processor. */
+void DSOUND_InitMixer(void)
+{
+#ifdef HAVE_X86_SIMD_FUNCS
+    /* there is no processor feature flag for AVX, which also needs OS support */
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx"))
+    {
+        TRACE("using AVX\n");
+        fir_dot = fir_dot_avx;
+        mix_stereo = mix_stereo_avx;
+    }
+    else if (IsProcessorFeaturePresent(PF_XMMI_INSTRUCTIONS_AVAILABLE))
+    {
+        TRACE("using SSE\n");
+        fir_dot = fir_dot_sse;
+        mix_stereo = mix_stereo_sse;
+    }
+#endif
+}
+
+/* Convert count frames to planar floats in output, one channel after the other. */
+static UINT cp_fields_noresample(IDirectSoundBufferImpl *dsb, UINT count, float **output)
+{
+    UINT channels = dsb->mix_channels;
+    DWORD channel;
+    float *out;
+
+    if ((out = *output = DSOUND_GetCpBuffer(dsb->device, count * channels * sizeof(float))))
+        for (channel = 0; channel < channels; channel++)
+            get_planar(dsb, dsb->sec_mixpos, channel, out + channel * count, count);
     return count;
 }
 
-static UINT cp_fields_resample(IDirectSoundBufferImpl *dsb, UINT count, LONG64 *freqAccNum)
+static UINT cp_fields_resample(IDirectSoundBufferImpl *dsb, UINT count, LONG64 *freqAccNum, float **output)
 {
     UINT i, channel;
-    UINT istride = dsb->pwfx->nBlockAlign;
-    UINT ostride = dsb->device->pwfx->nChannels * sizeof(float);
 
     LONG64 freqAcc_start = *freqAccNum;
     LONG64 freqAcc_end = freqAcc_start + count * dsb->freqAdjustNum;
@@ -309,33 +627,31 @@ static UINT cp_fields_resample(IDirectSoundBufferImpl *dsb, UINT count, LONG64 *
 
     UINT fir_cachesize = (fir_len + dsbfirstep - 2) / dsbfirstep;
     UINT required_input = max_ipos + fir_cachesize;
-    float *intermediate, *fir_copy, *itmp;
-
-    DWORD len = required_input * channels;
-    len += fir_cachesize;
-    len *= sizeof(float);
-
-    if (!dsb->device->cp_buffer) {
-        dsb->device->cp_buffer = HeapAlloc(GetProcessHeap(), 0, len);
-        dsb->device->cp_buffer_len = len;
-    } else if (len > dsb->device->cp_buffer_len) {
-        dsb->device->cp_buffer = HeapReAlloc(GetProcessHeap(), 0, dsb->device->cp_buffer, len);
-        dsb->device->cp_buffer_len = len;
-    }
+    struct fir_bank *bank;
+    UINT input_len, taps;
+    float *intermediate, *out;
 
-    fir_copy = dsb->device->cp_buffer;
-    intermediate = fir_copy + fir_cachesize;
+    *freqAccNum = freqAcc_end % dsb->freqAdjustDen;
 
+    /* the taps are padded, leave room for the samples they touch */
+    input_len = required_input + 7;
+    out = *output = DSOUND_GetCpBuffer(dsb->device, (count + input_len) * channels * sizeof(float));
+    if (!out || !(bank = DSOUND_GetFirBank(dsb->device, dsbfirstep))) {
+        *output = NULL;
+        return max_ipos;
+    }
+    taps = bank->taps;
+    intermediate = out + count * channels;
 
     /* Important: this buffer MUST be non-interleaved
      * if you want -msse3 to have any effect.
      * This is good for CPU cache effects, too.
      */
-    itmp = intermediate;
-    for (channel = 0; channel < channels; channel++)
-        for (i = 0; i < required_input; i++)
-            *(itmp++) = get_current_sample(dsb,
-                    dsb->sec_mixpos + i * istride, channel);
+    for (channel = 0; channel < channels; channel++) {
+        float *itmp = intermediate + channel * input_len;
+        get_planar(dsb, dsb->sec_mixpos, channel, itmp, required_input);
+        memset(itmp + required_input, 0, (input_len - required_input) * sizeof(float));
+    }
 
     for(i = 0; i < count; ++i) {
         UINT int_fir_steps = (freqAcc_start + i * dsb->freqAdjustNum) * dsbfirstep / dsb->freqAdjustDen;
@@ -344,39 +660,32 @@ static UINT cp_fields_resample(IDirectSoundBufferImpl *dsb, UINT count, LONG64 *
 
         UINT idx = (ipos + 1) * dsbfirstep - int_fir_steps - 1;
         float rem = int_fir_steps + 1.0 - total_fir_steps;
+        const float *coefs = bank->coefs + 2 * taps * idx;
 
-        int fir_used = 0;
-        while (idx < fir_len - 1) {
-            fir_copy[fir_used++] = fir[idx] * (1.0 - rem) + fir[idx + 1] * rem;
-            idx += dsb->firstep;
-        }
+        assert(idx < dsbfirstep);
+        assert(ipos + taps <= input_len);
 
-        assert(fir_used <= fir_cachesize);
-        assert(ipos + fir_used <= required_input);
-
-        for (channel = 0; channel < dsb->mix_channels; channel++) {
-            int j;
-            float sum = 0.0;
-            float* cache = &intermediate[channel * required_input + ipos];
-            for (j = 0; j < fir_used; j++)
-                sum += fir_copy[j] * cache[j];
-            dsb->put(dsb, i * ostride, channel, sum * dsb->firgain);
+        /* sum of (fir[idx] * (1 - rem) + fir[idx + 1] * rem) * x over the phase */
+        for (channel = 0; channel < channels; channel++) {
+            float sum, diff_sum;
+            fir_dot(coefs, coefs + taps, &intermediate[channel * input_len + ipos], taps, &sum, &diff_sum);
+            out[channel * count + i] = (sum + rem * diff_sum) * dsb->firgain;
         }
     }
 
-    *freqAccNum = freqAcc_end % dsb->freqAdjustDen;
-
     return max_ipos;
 }
 
-static void cp_fields(IDirectSoundBufferImpl *dsb, UINT count, LONG64 *freqAccNum)
+/* Returns the planar converted frames, or NULL if they could not be produced. */
+static float *cp_fields(IDirectSoundBufferImpl *dsb, UINT count, LONG64 *freqAccNum)
 {
     DWORD ipos, adv;
+    float *output;
 
     if (dsb->freqAdjustNum == dsb->freqAdjustDen)
-        adv = cp_fields_noresample(dsb, count); /* *freqAccNum is unmodified */
+        adv = cp_fields_noresample(dsb, count, &output); /* *freqAccNum is unmodified */
     else
-        adv = cp_fields_resample(dsb, count, freqAccNum);
+        adv = cp_fields_resample(dsb, count, freqAccNum, &output);
 
     ipos = dsb->sec_mixpos + adv * dsb->pwfx->nBlockAlign;
     if (ipos >= dsb->buflen) {
@@ -389,6 +698,7 @@ static void cp_fields(IDirectSoundBufferImpl *dsb, UINT count, LONG64 *freqAccNu
     }
 
     dsb->sec_mixpos = ipos;
+    return output;
 }
 
 /**
@@ -419,9 +729,11 @@ static inline DWORD DSOUND_BufPtrDiff(DWORD buflen, DWORD ptr1, DWORD ptr2)
  *
  * NOTE: writepos + len <= buflen. When called by mixer, MixOne makes sure of this.
  */
-static void DSOUND_MixToTemporary(IDirectSoundBufferImpl *dsb, DWORD frames)
+static void DSOUND_MixToTemporary(IDirectSoundBufferImpl *dsb, const float *planar, DWORD frames)
 {
 	UINT size_bytes = frames * sizeof(float) * dsb->device->pwfx->nChannels;
+	UINT ostride = dsb->device->pwfx->nChannels * sizeof(float);
+	DWORD channel;
 	HRESULT hr;
 	int i;
 
@@ -433,10 +745,14 @@ static void DSOUND_MixToTemporary(IDirectSoundBufferImpl *dsb, DWORD frames)
 		else
 			dsb->device->tmp_buffer = HeapAlloc(GetProcessHeap(), 0, size_bytes);
 	}
-	if(dsb->put_aux == putieee32_sum)
+	if(dsb->put_aux == putieee32_sum || !planar)
 		memset(dsb->device->tmp_buffer, 0, dsb->device->tmp_buffer_len);
 
-	cp_fields(dsb, frames, &dsb->freqAccNum);
+	if (planar) {
+		for (i = 0; i < frames; i++)
+			for (channel = 0; channel < dsb->mix_channels; channel++)
+				dsb->put(dsb, i * ostride, channel, planar[channel * frames + i]);
+	}
 
 	if (size_bytes > 0) {
 		for (i = 0; i < dsb->num_filters; i++) {
@@ -451,29 +767,39 @@ static void DSOUND_MixToTemporary(IDirectSoundBufferImpl *dsb, DWORD frames)
 	}
 }
 
-static void DSOUND_MixerVol(const IDirectSoundBufferImpl *dsb, INT frames)
+static BOOL DSOUND_GetMixerVol(const IDirectSoundBufferImpl *dsb, float *vols)
 {
-	INT	i;
-	float vols[DS_MAX_CHANNELS];
-	UINT channels = dsb->device->pwfx->nChannels, chan;
+	UINT channels = dsb->device->pwfx->nChannels, i;
 
-	TRACE("(%p,%d)\n",dsb,frames);
 	TRACE("left = %x, right = %x\n", dsb->volpan.dwTotalAmpFactor[0],
 		dsb->volpan.dwTotalAmpFactor[1]);
 
 	if ((!(dsb->dsbd.dwFlags & DSBCAPS_CTRLPAN) || (dsb->volpan.lPan == 0)) &&
 	    (!(dsb->dsbd.dwFlags & DSBCAPS_CTRLVOLUME) || (dsb->volpan.lVolume == 0)) &&
 	     !(dsb->dsbd.dwFlags & DSBCAPS_CTRL3D))
-		return; /* Nothing to do */
+		return FALSE; /* Nothing to do */
 
 	if (channels > DS_MAX_CHANNELS)
 	{
 		FIXME("There is no support for %u channels\n", channels);
-		return;
+		return FALSE;
 	}
 
 	for (i = 0; i < channels; ++i)
 		vols[i] = dsb->volpan.dwTotalAmpFactor[i] / ((float)0xFFFF);
+	return TRUE;
+}
+
+static void DSOUND_MixerVol(const IDirectSoundBufferImpl *dsb, INT frames)
+{
+	INT	i;
+	float vols[DS_MAX_CHANNELS];
+	UINT channels = dsb->device->pwfx->nChannels, chan;
+
+	TRACE("(%p,%d)\n",dsb,frames);
+
+	if (!DSOUND_GetMixerVol(dsb, vols))
+		return;
 
 	for(i = 0; i < frames; ++i){
 		for(chan = 0; chan < channels; ++chan){
@@ -482,6 +808,39 @@ static void DSOUND_MixerVol(const IDirectSoundBufferImpl *dsb, INT frames)
 	}
 }
 
+/**
+ * Apply the channel mapping and the volume to the planar converted frames
+ * and add them to the device buffer in one pass.
+ */
+static void DSOUND_MixDirect(const IDirectSoundBufferImpl *dsb, const float *planar,
+		float *mix_buffer, DWORD frames)
+{
+	UINT ochannels = dsb->device->pwfx->nChannels, ichannels = dsb->mix_channels;
+	float vols[DS_MAX_CHANNELS], m[DS_MAX_CHANNELS][DS_MAX_MIX_CHANNELS];
+	UINT chan, c, i = 0;
+
+	TRACE("(%p,%p,%d)\n", dsb, mix_buffer, frames);
+
+	if (!DSOUND_GetMixerVol(dsb, vols))
+		for (chan = 0; chan < ochannels; chan++)
+			vols[chan] = 1.0f;
+	for (chan = 0; chan < ochannels; chan++)
+		for (c = 0; c < ichannels; c++)
+			m[chan][c] = dsb->mix_matrix[chan][c] * vols[chan];
+
+	if (ochannels == 2)
+		i = mix_stereo(planar, ichannels, m[0], m[1], mix_buffer, frames);
+
+	for (; i < frames; i++) {
+		for (chan = 0; chan < ochannels; chan++) {
+			float sum = 0.0f;
+			for (c = 0; c < ichannels; c++)
+				sum += m[chan][c] * planar[c * frames + i];
+			mix_buffer[i * ochannels + chan] += sum;
+		}
+	}
+}
+
 /**
  * Mix (at most) the given number of bytes into the given position of the
  * device buffer, from the secondary buffer "dsb" (starting at the current
@@ -496,21 +855,29 @@ static void DSOUND_MixerVol(const IDirectSoundBufferImpl *dsb, INT frames)
  */
 static DWORD DSOUND_MixInBuffer(IDirectSoundBufferImpl *dsb, float *mix_buffer, DWORD frames)
 {
-	float *ibuf;
+	float *ibuf, *planar;
 	DWORD oldpos;
 
 	TRACE("sec_mixpos=%d/%d\n", dsb->sec_mixpos, dsb->buflen);
 	TRACE("(%p, frames=%d)\n",dsb,frames);
 
-	/* Resample buffer to temporary buffer specifically allocated for this purpose, if needed */
+	/* Resample buffer to planar floats */
 	oldpos = dsb->sec_mixpos;
-	DSOUND_MixToTemporary(dsb, frames);
-	ibuf = dsb->device->tmp_buffer;
+	planar = cp_fields(dsb, frames, &dsb->freqAccNum);
 
-	/* Apply volume if needed */
-	DSOUND_MixerVol(dsb, frames);
+	if (dsb->mix_direct && !dsb->num_filters) {
+		if (planar)
+			DSOUND_MixDirect(dsb, planar, mix_buffer, frames);
+	} else {
+		/* Filters work on the buffer's own output, mix through the temporary buffer */
+		DSOUND_MixToTemporary(dsb, planar, frames);
+		ibuf = dsb->device->tmp_buffer;
+
+		/* Apply volume if needed */
+		DSOUND_MixerVol(dsb, frames);
 
-	mixieee32(ibuf, mix_buffer, frames * dsb->device->pwfx->nChannels);
+		mixieee32(ibuf, mix_buffer, frames * dsb->device->pwfx->nChannels);
+	}
 
 	/* check for notification positions */
 	if (dsb->dsbd.dwFlags & DSBCAPS_CTRLPOSITIONNOTIFY &&
@@ -656,9 +1023,12 @@ static void DSOUND_WaveQueue(DirectSoundDevice *device, LPBYTE pos, DWORD bytes)
  * The mixing procedure goes:
  *
  * secondary->buffer (secondary format)
- *   =[Resample]=> device->tmp_buffer (float format)
- *   =[Volume]=> device->tmp_buffer (float format)
+ *   =[Resample]=> device->cp_buffer (planar float format)
+ *   =[Channel map, Volume, Mix]=> device->buffer (float format)
  *   =[Reformat]=> device->buffer (device format, skipped on float)
+ *
+ * Buffers with effects go through device->tmp_buffer (float format) between
+ * the resampler and the volume, so that the filters can process them.
  */
 static void DSOUND_PerformMix(DirectSoundDevice *device)
 {
@@ -20,6 +20,13 @@
 
 #include <assert.h>
 
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__)) \
+    && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9) || defined(__clang__))
+#include <immintrin.h>
+#define HAVE_X86_SIMD_ROWS
+#define TARGET(x) __attribute__((target(x)))
+#endif
+
 #include "gdi_private.h"
 #include "dibdrv.h"
 
@@ -264,6 +271,59 @@ static inline void memset_16( WORD *start, WORD val, DWORD size )
 #endif
 }
 
+/* Row helpers using vector instructions, selected at run time by init_primitives_simd.
+ * They return the number of pixels processed, the remaining ones being left to the C code. */
+
+static int rop_row_32_c( DWORD *ptr, int len, DWORD and, DWORD xor )
+{
+    return 0;
+}
+
+static int blend_argb_row_c( DWORD *dst, const DWORD *src, int len, DWORD alpha )
+{
+    return 0;
+}
+
+static int blend_argb_constant_alpha_row_c( DWORD *dst, const DWORD *src, int len, DWORD alpha, BOOL src_alpha )
+{
+    return 0;
+}
+
+static int (*rop_row_32)( DWORD *ptr, int len, DWORD and, DWORD xor ) = rop_row_32_c;
+static int (*blend_argb_row)( DWORD *dst, const DWORD *src, int len, DWORD alpha ) = blend_argb_row_c;
+static int (*blend_argb_constant_alpha_row)( DWORD *dst, const DWORD *src, int len, DWORD alpha,
+                                             BOOL src_alpha ) = blend_argb_constant_alpha_row_c;
+
+#ifdef HAVE_X86_SIMD_ROWS
+
+static int TARGET("sse2") rop_row_32_sse2( DWORD *ptr, int len, DWORD and, DWORD xor )
+{
+    const __m128i and_vec = _mm_set1_epi32( and ), xor_vec = _mm_set1_epi32( xor );
+    int x;
+
+    for (x = 0; x + 4 <= len; x += 4, ptr += 4)
+    {
+        __m128i val = _mm_loadu_si128( (__m128i *)ptr );
+        _mm_storeu_si128( (__m128i *)ptr, _mm_xor_si128( _mm_and_si128( val, and_vec ), xor_vec ));
+    }
+    return x;
+}
+
+static int TARGET("avx2") rop_row_32_avx2( DWORD *ptr, int len, DWORD and, DWORD xor )
+{
+    const __m256i and_vec = _mm256_set1_epi32( and ), xor_vec = _mm256_set1_epi32( xor );
+    int x;
+
+    for (x = 0; x + 8 <= len; x += 8, ptr += 8)
+    {
+        __m256i val = _mm256_loadu_si256( (__m256i *)ptr );
+        _mm256_storeu_si256( (__m256i *)ptr, _mm256_xor_si256( _mm256_and_si256( val, and_vec ), xor_vec ));
+    }
+    return x;
+}
+
+#endif  /* HAVE_X86_SIMD_ROWS */
+
 static void solid_rects_32(const dib_info *dib, int num, const RECT *rc, DWORD and, DWORD xor)
 {
     DWORD *ptr, *start;
@@ -276,8 +336,11 @@ static void solid_rects_32(const dib_info *dib, int num, const RECT *rc, DWORD a
         start = get_pixel_ptr_32(dib, rc->left, rc->top);
         if (and)
             for(y = rc->top; y < rc->bottom; y++, start += dib->stride / 4)
-                for(x = rc->left, ptr = start; x < rc->right; x++)
+            {
+                x = rop_row_32( start, rc->right - rc->left, and, xor );
+                for(ptr = start + x, x += rc->left; x < rc->right; x++)
                     do_rop_32(ptr++, and, xor);
+            }
         else
             for(y = rc->top; y < rc->bottom; y++, start += dib->stride / 4)
                 memset_32( start, xor, rc->right - rc->left );
@@ -4633,6 +4696,193 @@ static inline DWORD blend_argb_alpha( DWORD dst, DWORD src, DWORD alpha )
             (alpha + ((BYTE)(dst >> 24) * (255 - alpha) + 127) / 255) << 24);
 }
 
+#ifdef HAVE_X86_SIMD_ROWS
+
+/* SSE2 and AVX2 versions of the blend functions above, operating on 16-bit channels of two
+ * and four pixels at a time. They give the same results as the C versions and return the number of pixels
+ * processed, the remaining ones being left to the C versions. */
+
+/* (x + 127) / 255 for x <= 255 * 255 */
+static inline __m128i TARGET("sse2") div255_sse2( __m128i x )
+{
+    x = _mm_add_epi16( x, _mm_set1_epi16( 128 ));
+    return _mm_srli_epi16( _mm_add_epi16( x, _mm_srli_epi16( x, 8 )), 8 );
+}
+
+/* combine channels that may exceed 255 the same way as the C versions do with shifts and ors */
+static inline __m128i TARGET("sse2") pack_channels_sse2( __m128i lo, __m128i hi )
+{
+    const __m128i mask = _mm_set1_epi16( 0xff );
+    lo = _mm_or_si128( _mm_and_si128( lo, mask ), _mm_slli_epi64( _mm_srli_epi16( lo, 8 ), 16 ));
+    hi = _mm_or_si128( _mm_and_si128( hi, mask ), _mm_slli_epi64( _mm_srli_epi16( hi, 8 ), 16 ));
+    return _mm_packus_epi16( lo, hi );
+}
+
+static inline __m128i TARGET("sse2") broadcast_alpha_sse2( __m128i x )
+{
+    x = _mm_shufflelo_epi16( x, _MM_SHUFFLE( 3, 3, 3, 3 ));
+    return _mm_shufflehi_epi16( x, _MM_SHUFFLE( 3, 3, 3, 3 ));
+}
+
+static inline __m128i TARGET("sse2") blend_argb_sse2( __m128i dst, __m128i src )
+{
+    __m128i inv_alpha = _mm_sub_epi16( _mm_set1_epi16( 255 ), broadcast_alpha_sse2( src ));
+    return _mm_add_epi16( src, div255_sse2( _mm_mullo_epi16( dst, inv_alpha )));
+}
+
+static inline __m128i TARGET("sse2") blend_constant_alpha_sse2( __m128i dst, __m128i src, __m128i alpha )
+{
+    __m128i inv_alpha = _mm_sub_epi16( _mm_set1_epi16( 255 ), alpha );
+    return div255_sse2( _mm_add_epi16( _mm_mullo_epi16( src, alpha ), _mm_mullo_epi16( dst, inv_alpha )));
+}
+
+static int TARGET("sse2") blend_argb_row_sse2( DWORD *dst, const DWORD *src, int len, DWORD alpha )
+{
+    const __m128i zero = _mm_setzero_si128(), alpha_vec = _mm_set1_epi16( alpha );
+    int x;
+
+    for (x = 0; x + 4 <= len; x += 4)
+    {
+        __m128i s = _mm_loadu_si128( (const __m128i *)(src + x) );
+        __m128i d = _mm_loadu_si128( (const __m128i *)(dst + x) );
+        __m128i s_lo = _mm_unpacklo_epi8( s, zero ), s_hi = _mm_unpackhi_epi8( s, zero );
+
+        if (alpha != 255)
+        {
+            s_lo = div255_sse2( _mm_mullo_epi16( s_lo, alpha_vec ));
+            s_hi = div255_sse2( _mm_mullo_epi16( s_hi, alpha_vec ));
+        }
+        s_lo = blend_argb_sse2( _mm_unpacklo_epi8( d, zero ), s_lo );
+        s_hi = blend_argb_sse2( _mm_unpackhi_epi8( d, zero ), s_hi );
+        _mm_storeu_si128( (__m128i *)(dst + x), pack_channels_sse2( s_lo, s_hi ));
+    }
+    return x;
+}
+
+static int TARGET("sse2") blend_argb_constant_alpha_row_sse2( DWORD *dst, const DWORD *src, int len, DWORD alpha,
+                                                              BOOL src_alpha )
+{
+    const __m128i zero = _mm_setzero_si128(), alpha_vec = _mm_set1_epi16( alpha );
+    const __m128i opaque = _mm_set1_epi32( 0xff000000 );
+    int x;
+
+    for (x = 0; x + 4 <= len; x += 4)
+    {
+        __m128i s = _mm_loadu_si128( (const __m128i *)(src + x) );
+        __m128i d = _mm_loadu_si128( (const __m128i *)(dst + x) );
+        __m128i lo, hi;
+
+        if (!src_alpha) s = _mm_or_si128( s, opaque );
+        lo = blend_constant_alpha_sse2( _mm_unpacklo_epi8( d, zero ), _mm_unpacklo_epi8( s, zero ), alpha_vec );
+        hi = blend_constant_alpha_sse2( _mm_unpackhi_epi8( d, zero ), _mm_unpackhi_epi8( s, zero ), alpha_vec );
+        _mm_storeu_si128( (__m128i *)(dst + x), _mm_packus_epi16( lo, hi ));
+    }
+    return x;
+}
+
+/* (x + 127) / 255 for x <= 255 * 255 */
+static inline __m256i TARGET("avx2") div255_avx2( __m256i x )
+{
+    x = _mm256_add_epi16( x, _mm256_set1_epi16( 128 ));
+    return _mm256_srli_epi16( _mm256_add_epi16( x, _mm256_srli_epi16( x, 8 )), 8 );
+}
+
+static inline __m256i TARGET("avx2") pack_channels_avx2( __m256i lo, __m256i hi )
+{
+    const __m256i mask = _mm256_set1_epi16( 0xff );
+    lo = _mm256_or_si256( _mm256_and_si256( lo, mask ), _mm256_slli_epi64( _mm256_srli_epi16( lo, 8 ), 16 ));
+    hi = _mm256_or_si256( _mm256_and_si256( hi, mask ), _mm256_slli_epi64( _mm256_srli_epi16( hi, 8 ), 16 ));
+    return _mm256_packus_epi16( lo, hi );
+}
+
+static inline __m256i TARGET("avx2") broadcast_alpha_avx2( __m256i x )
+{
+    x = _mm256_shufflelo_epi16( x, _MM_SHUFFLE( 3, 3, 3, 3 ));
+    return _mm256_shufflehi_epi16( x, _MM_SHUFFLE( 3, 3, 3, 3 ));
+}
+
+static inline __m256i TARGET("avx2") blend_argb_avx2( __m256i dst, __m256i src )
+{
+    __m256i inv_alpha = _mm256_sub_epi16( _mm256_set1_epi16( 255 ), broadcast_alpha_avx2( src ));
+    return _mm256_add_epi16( src, div255_avx2( _mm256_mullo_epi16( dst, inv_alpha )));
+}
+
+static inline __m256i TARGET("avx2") blend_constant_alpha_avx2( __m256i dst, __m256i src, __m256i alpha )
+{
+    __m256i inv_alpha = _mm256_sub_epi16( _mm256_set1_epi16( 255 ), alpha );
+    return div255_avx2( _mm256_add_epi16( _mm256_mullo_epi16( src, alpha ), _mm256_mullo_epi16( dst, inv_alpha )));
+}
+
+/* the unpack and pack instructions work within each 128-bit lane, so the pixels stay in order */
+static int TARGET("avx2") blend_argb_row_avx2( DWORD *dst, const DWORD *src, int len, DWORD alpha )
+{
+    const __m256i zero = _mm256_setzero_si256(), alpha_vec = _mm256_set1_epi16( alpha );
+    int x;
+
+    for (x = 0; x + 8 <= len; x += 8)
+    {
+        __m256i s = _mm256_loadu_si256( (const __m256i *)(src + x) );
+        __m256i d = _mm256_loadu_si256( (const __m256i *)(dst + x) );
+        __m256i s_lo = _mm256_unpacklo_epi8( s, zero ), s_hi = _mm256_unpackhi_epi8( s, zero );
+
+        if (alpha != 255)
+        {
+            s_lo = div255_avx2( _mm256_mullo_epi16( s_lo, alpha_vec ));
+            s_hi = div255_avx2( _mm256_mullo_epi16( s_hi, alpha_vec ));
+        }
+        s_lo = blend_argb_avx2( _mm256_unpacklo_epi8( d, zero ), s_lo );
+        s_hi = blend_argb_avx2( _mm256_unpackhi_epi8( d, zero ), s_hi );
+        _mm256_storeu_si256( (__m256i *)(dst + x), pack_channels_avx2( s_lo, s_hi ));
+    }
+    return x;
+}
+
+static int TARGET("avx2") blend_argb_constant_alpha_row_avx2( DWORD *dst, const DWORD *src, int len, DWORD alpha,
+                                                              BOOL src_alpha )
+{
+    const __m256i zero = _mm256_setzero_si256(), alpha_vec = _mm256_set1_epi16( alpha );
+    const __m256i opaque = _mm256_set1_epi32( 0xff000000 );
+    int x;
+
+    for (x = 0; x + 8 <= len; x += 8)
+    {
+        __m256i s = _mm256_loadu_si256( (const __m256i *)(src + x) );
+        __m256i d = _mm256_loadu_si256( (const __m256i *)(dst + x) );
+        __m256i lo, hi;
+
+        if (!src_alpha) s = _mm256_or_si256( s, opaque );
+        lo = blend_constant_alpha_avx2( _mm256_unpacklo_epi8( d, zero ), _mm256_unpacklo_epi8( s, zero ), alpha_vec );
+        hi = blend_constant_alpha_avx2( _mm256_unpackhi_epi8( d, zero ), _mm256_unpackhi_epi8( s, zero ), alpha_vec );
+        _mm256_storeu_si256( (__m256i *)(dst + x), _mm256_packus_epi16( lo, hi ));
+    }
+    return x;
+}
+
+#endif  /* HAVE_X86_SIMD_ROWS */
+
+/* select the row helpers supported by the processor */
+void init_primitives_simd(void)
+{
+#ifdef HAVE_X86_SIMD_ROWS
+    /* there is no processor feature flag for AVX2, which also needs OS support */
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports( "avx2" ))
+    {
+        TRACE( "using AVX2\n" );
+        rop_row_32 = rop_row_32_avx2;
+        blend_argb_row = blend_argb_row_avx2;
+        blend_argb_constant_alpha_row = blend_argb_constant_alpha_row_avx2;
+    }
+    else if (IsProcessorFeaturePresent( PF_XMMI64_INSTRUCTIONS_AVAILABLE ))
+    {
+        TRACE( "using SSE2\n" );
+        rop_row_32 = rop_row_32_sse2;
+        blend_argb_row = blend_argb_row_sse2;
+        blend_argb_constant_alpha_row = blend_argb_constant_alpha_row_sse2;
+    }
+#endif
+}
+
 static inline DWORD blend_rgb( BYTE dst_r, BYTE dst_g, BYTE dst_b, DWORD src, BLENDFUNCTION blend )
 {
     if (blend.AlphaFormat & AC_SRC_ALPHA)
@@ -4656,26 +4906,28 @@ static void blend_rect_8888(const dib_info *dst, const RECT *rc,
 {
     DWORD *src_ptr = get_pixel_ptr_32( src, origin->x, origin->y );
     DWORD *dst_ptr = get_pixel_ptr_32( dst, rc->left, rc->top );
-    int x, y;
+    int x, y, width = rc->right - rc->left;
 
     if (blend.AlphaFormat & AC_SRC_ALPHA)
     {
 	if (blend.SourceConstantAlpha == 255)
 	    for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-		for (x = 0; x < rc->right - rc->left; x++)
+		for (x = blend_argb_row( dst_ptr, src_ptr, width, 255 ); x < width; x++)
 		    dst_ptr[x] = blend_argb( dst_ptr[x], src_ptr[x] );
         else
 	    for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-		for (x = 0; x < rc->right - rc->left; x++)
+		for (x = blend_argb_row( dst_ptr, src_ptr, width, blend.SourceConstantAlpha ); x < width; x++)
 		    dst_ptr[x] = blend_argb_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
     }
     else if (src->compression == BI_RGB)
 	for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-	    for (x = 0; x < rc->right - rc->left; x++)
+	    for (x = blend_argb_constant_alpha_row( dst_ptr, src_ptr, width, blend.SourceConstantAlpha, TRUE );
+                 x < width; x++)
 		dst_ptr[x] = blend_argb_constant_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
     else
 	for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-	    for (x = 0; x < rc->right - rc->left; x++)
+	    for (x = blend_argb_constant_alpha_row( dst_ptr, src_ptr, width, blend.SourceConstantAlpha, FALSE );
+                 x < width; x++)
 		dst_ptr[x] = blend_argb_no_src_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
 }
 
@@ -690,6 +690,7 @@ BOOL WINAPI DllMain( HINSTANCE inst, DWORD reason, LPVOID reserved )
 
     gdi32_module = inst;
     DisableThreadLibraryCalls( inst );
+    init_primitives_simd();
     WineEngInit();
 
     /* create stock objects */
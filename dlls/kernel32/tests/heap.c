@@ -24,6 +24,8 @@
 #include <stdlib.h>
 #include <stdio.h>
 
+#include "ntstatus.h"
+#define WIN32_NO_STATUS
 #include "windef.h"
 #include "winbase.h"
 #include "winreg.h"
@@ -41,6 +43,7 @@
 static BOOL (WINAPI *pHeapQueryInformation)(HANDLE, HEAP_INFORMATION_CLASS, PVOID, SIZE_T, PSIZE_T);
 static BOOL (WINAPI *pGetPhysicallyInstalledSystemMemory)(ULONGLONG *);
 static ULONG (WINAPI *pRtlGetNtGlobalFlags)(void);
+static NTSTATUS (WINAPI *pRtlQueryHeapInformation)(HANDLE, HEAP_INFORMATION_CLASS, void *, SIZE_T, SIZE_T *);
 
 struct heap_layout
 {
@@ -892,6 +895,198 @@ static void test_HeapQueryInformation(void)
     ok(info == 0 || info == 1 || info == 2, "expected 0, 1 or 2, got %u\n", info);
 }
 
+static void test_heap_lfh(void)
+{
+    static const SIZE_T sizes[] = { 0, 1, 15, 16, 17, 100, 255, 256, 257, 1000, 4096, 0x3ff0, 0x4000, 0x5000 };
+    BYTE *ptrs[ARRAY_SIZE(sizes)], *ptr;
+    HANDLE heap;
+    SIZE_T i, j;
+    ULONG info;
+    BOOL ret;
+
+    if (!pHeapQueryInformation)
+    {
+        win_skip("HeapQueryInformation is not available\n");
+        return;
+    }
+
+    heap = HeapCreate( HEAP_NO_SERIALIZE, 0, 0 );
+    ok( heap != NULL, "HeapCreate failed\n" );
+    info = 2;
+    ret = HeapSetInformation( heap, HeapCompatibilityInformation, &info, sizeof(info) );
+    ok( !ret, "HeapSetInformation succeeded for a HEAP_NO_SERIALIZE heap\n" );
+    HeapDestroy( heap );
+
+    heap = HeapCreate( 0, 0x10000, 0x10000 );
+    ok( heap != NULL, "HeapCreate failed\n" );
+    info = 2;
+    ret = HeapSetInformation( heap, HeapCompatibilityInformation, &info, sizeof(info) );
+    ok( !ret, "HeapSetInformation succeeded for a fixed-size heap\n" );
+    HeapDestroy( heap );
+
+    heap = HeapCreate( 0, 0, 0 );
+    ok( heap != NULL, "HeapCreate failed\n" );
+    info = 2;
+    SetLastError( 0xdeadbeef );
+    ret = HeapSetInformation( heap, HeapCompatibilityInformation, &info, sizeof(info) );
+    ok( ret, "HeapSetInformation error %u\n", GetLastError() );
+    info = 0xdeadbeef;
+    ret = pHeapQueryInformation( heap, HeapCompatibilityInformation, &info, sizeof(info), NULL );
+    ok( ret, "HeapQueryInformation error %u\n", GetLastError() );
+    ok( info == 2, "expected 2, got %u\n", info );
+
+    for (i = 0; i < ARRAY_SIZE(sizes); i++)
+    {
+        ptrs[i] = HeapAlloc( heap, HEAP_ZERO_MEMORY, sizes[i] );
+        ok( ptrs[i] != NULL, "%lu: HeapAlloc failed\n", sizes[i] );
+        ok( !((ULONG_PTR)ptrs[i] % (2 * sizeof(void *))), "%lu: unaligned block %p\n", sizes[i], ptrs[i] );
+        ok( HeapSize( heap, 0, ptrs[i] ) == sizes[i], "%lu: got size %lu\n",
+            sizes[i], HeapSize( heap, 0, ptrs[i] ) );
+        ok( HeapValidate( heap, 0, ptrs[i] ), "%lu: HeapValidate failed\n", sizes[i] );
+        for (j = 0; j < sizes[i]; j++) if (ptrs[i][j]) break;
+        ok( j == sizes[i], "%lu: memory not zeroed at %lu\n", sizes[i], j );
+        memset( ptrs[i], 0xcc, sizes[i] );
+    }
+
+    for (i = 0; i < ARRAY_SIZE(sizes); i++)
+    {
+        ptr = HeapReAlloc( heap, HEAP_ZERO_MEMORY, ptrs[i], sizes[i] + 300 );
+        ok( ptr != NULL, "%lu: HeapReAlloc failed\n", sizes[i] );
+        ok( HeapSize( heap, 0, ptr ) == sizes[i] + 300, "%lu: got size %lu\n",
+            sizes[i], HeapSize( heap, 0, ptr ) );
+        for (j = 0; j < sizes[i]; j++) if (ptr[j] != 0xcc) break;
+        ok( j == sizes[i], "%lu: contents not preserved at %lu\n", sizes[i], j );
+        for (; j < sizes[i] + 300; j++) if (ptr[j]) break;
+        ok( j == sizes[i] + 300, "%lu: memory not zeroed at %lu\n", sizes[i], j );
+        ptrs[i] = ptr;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(sizes); i++)
+    {
+        ret = HeapFree( heap, 0, ptrs[i] );
+        ok( ret, "%lu: HeapFree failed\n", sizes[i] );
+    }
+
+    /* allocate enough blocks to use several groups */
+    for (i = 0; i < 3; i++)
+    {
+        BYTE *blocks[1000];
+
+        for (j = 0; j < ARRAY_SIZE(blocks); j++)
+        {
+            blocks[j] = HeapAlloc( heap, 0, 24 + i * 100 );
+            ok( blocks[j] != NULL, "HeapAlloc failed\n" );
+            memset( blocks[j], j, 24 + i * 100 );
+        }
+        for (j = 0; j < ARRAY_SIZE(blocks); j++)
+        {
+            ok( blocks[j][23] == (BYTE)j, "%lu: block overwritten\n", j );
+            ret = HeapFree( heap, 0, blocks[j] );
+            ok( ret, "HeapFree failed\n" );
+        }
+    }
+
+    ret = HeapDestroy( heap );
+    ok( ret, "HeapDestroy failed\n" );
+}
+
+static void test_heap_statistics(void)
+{
+    WINE_HEAP_STATISTICS stats, stats2;
+    HANDLE heap;
+    NTSTATUS status;
+    void *ptr, *large;
+    SIZE_T size;
+    ULONG info;
+    BOOL ret;
+
+    if (!pRtlQueryHeapInformation)
+    {
+        win_skip("RtlQueryHeapInformation is not available\n");
+        return;
+    }
+
+    heap = HeapCreate( 0, 0, 0 );
+    ok( heap != NULL, "HeapCreate failed\n" );
+
+    status = pRtlQueryHeapInformation( heap, HeapWineStatisticsInformation, &stats, sizeof(stats), &size );
+    if (status == STATUS_INVALID_INFO_CLASS)
+    {
+        win_skip("heap statistics not supported\n");
+        HeapDestroy( heap );
+        return;
+    }
+    ok( !status, "got status %08x\n", status );
+    ok( size == sizeof(stats), "got size %lu\n", size );
+    ok( !stats.AllocCount, "got %s allocations\n", wine_dbgstr_longlong(stats.AllocCount) );
+    ok( stats.CommittedBytes > 0, "got no committed bytes\n" );
+
+    status = pRtlQueryHeapInformation( heap, HeapWineStatisticsInformation, &stats, sizeof(stats) - 1, &size );
+    ok( status == STATUS_BUFFER_TOO_SMALL, "got status %08x\n", status );
+
+    ptr = HeapAlloc( heap, 0, 100 );
+    large = HeapAlloc( heap, 0, 1 << 20 );
+    status = pRtlQueryHeapInformation( heap, HeapWineStatisticsInformation, &stats, sizeof(stats), NULL );
+    ok( !status, "got status %08x\n", status );
+    ok( stats.AllocCount == 2, "got %s allocations\n", wine_dbgstr_longlong(stats.AllocCount) );
+    ok( stats.LargeBlockCount == 1, "got %lu large blocks\n", stats.LargeBlockCount );
+    ok( stats.LargeAllocCount == 1, "got %s large allocations\n", wine_dbgstr_longlong(stats.LargeAllocCount) );
+    ok( stats.UsedBytes >= 100 + (1 << 20), "got %lu used bytes\n", stats.UsedBytes );
+    ok( stats.SizeHistogram[3] == 1, "got %s allocations of size < 128\n", wine_dbgstr_longlong(stats.SizeHistogram[3]) );
+    ok( stats.FreeListHits + stats.FreeTreeSearches >= 1, "no free block lookup recorded\n" );
+
+    HeapFree( heap, 0, ptr );
+    HeapFree( heap, 0, large );
+    status = pRtlQueryHeapInformation( heap, HeapWineStatisticsInformation, &stats2, sizeof(stats2), NULL );
+    ok( !status, "got status %08x\n", status );
+    ok( stats2.FreeCount == 2, "got %s frees\n", wine_dbgstr_longlong(stats2.FreeCount) );
+    ok( !stats2.LargeBlockCount, "got %lu large blocks\n", stats2.LargeBlockCount );
+    ok( !stats2.UsedBytes, "got %lu used bytes\n", stats2.UsedBytes );
+    ok( stats2.PeakUsedBytes == stats.UsedBytes, "got peak %lu, expected %lu\n",
+        stats2.PeakUsedBytes, stats.UsedBytes );
+
+    ptr = HeapAlloc( heap, 0, 100 );
+    ptr = HeapReAlloc( heap, 0, ptr, 1000 );
+    ok( ptr != NULL, "HeapReAlloc failed\n" );
+    status = pRtlQueryHeapInformation( heap, HeapWineStatisticsInformation, &stats, sizeof(stats), NULL );
+    ok( !status, "got status %08x\n", status );
+    ok( stats.AllocCount == 3, "got %s allocations\n", wine_dbgstr_longlong(stats.AllocCount) );
+    ok( stats.ReAllocCount == 1, "got %s reallocations\n", wine_dbgstr_longlong(stats.ReAllocCount) );
+    HeapFree( heap, 0, ptr );
+    HeapDestroy( heap );
+
+    /* failed allocations are not counted */
+    heap = HeapCreate( 0, 0x10000, 0x10000 );
+    ok( heap != NULL, "HeapCreate failed\n" );
+    ptr = HeapAlloc( heap, 0, 0x20000 );
+    ok( !ptr, "HeapAlloc succeeded\n" );
+    status = pRtlQueryHeapInformation( heap, HeapWineStatisticsInformation, &stats, sizeof(stats), NULL );
+    ok( !status, "got status %08x\n", status );
+    ok( !stats.AllocCount, "got %s allocations\n", wine_dbgstr_longlong(stats.AllocCount) );
+    ok( !stats.SizeHistogram[WINE_HEAP_STATS_BUCKETS - 1], "got %s allocations in the last bucket\n",
+        wine_dbgstr_longlong(stats.SizeHistogram[WINE_HEAP_STATS_BUCKETS - 1]) );
+    HeapDestroy( heap );
+
+    /* reallocations of LFH blocks */
+    heap = HeapCreate( 0, 0, 0 );
+    ok( heap != NULL, "HeapCreate failed\n" );
+    info = 2;
+    ret = HeapSetInformation( heap, HeapCompatibilityInformation, &info, sizeof(info) );
+    ok( ret, "HeapSetInformation error %u\n", GetLastError() );
+    ptr = HeapAlloc( heap, 0, 20 );
+    ok( ptr != NULL, "HeapAlloc failed\n" );
+    ptr = HeapReAlloc( heap, 0, ptr, 24 );
+    ok( ptr != NULL, "HeapReAlloc failed\n" );
+    ptr = HeapReAlloc( heap, 0, ptr, 300 );
+    ok( ptr != NULL, "HeapReAlloc failed\n" );
+    status = pRtlQueryHeapInformation( heap, HeapWineStatisticsInformation, &stats, sizeof(stats), NULL );
+    ok( !status, "got status %08x\n", status );
+    ok( stats.ReAllocCount == 2, "got %s reallocations\n", wine_dbgstr_longlong(stats.ReAllocCount) );
+    ok( stats.LfhAllocCount == 2, "got %s LFH allocations\n", wine_dbgstr_longlong(stats.LfhAllocCount) );
+    ok( stats.LfhFreeCount == 1, "got %s LFH frees\n", wine_dbgstr_longlong(stats.LfhFreeCount) );
+    HeapDestroy( heap );
+}
+
 static void test_heap_checks( DWORD flags )
 {
     BYTE old, *p, *p2;
@@ -1222,6 +1417,7 @@ START_TEST(heap)
     char **argv;
 
     pRtlGetNtGlobalFlags = (void *)GetProcAddress( GetModuleHandleA("ntdll.dll"), "RtlGetNtGlobalFlags" );
+    pRtlQueryHeapInformation = (void *)GetProcAddress( GetModuleHandleA("ntdll.dll"), "RtlQueryHeapInformation" );
 
     argc = winetest_get_mainargs( &argv );
     if (argc >= 3)
@@ -1245,6 +1441,8 @@ START_TEST(heap)
     test_sized_HeapReAlloc((1 << 20), 1);
 
     test_HeapQueryInformation();
+    test_heap_lfh();
+    test_heap_statistics();
     test_GetPhysicallyInstalledSystemMemory();
 
     if (pRtlGetNtGlobalFlags)
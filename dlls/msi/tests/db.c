@@ -3650,6 +3650,43 @@ static void test_join(void)
     MsiViewClose(hview);
     MsiCloseHandle(hview);
 
+    /* join on integer columns, executed twice with different parameters */
+    query = "INSERT INTO `Two` (`C`, `D`) VALUES (7, 14)";
+    r = run_query( hdb, 0, query);
+    ok(r == ERROR_SUCCESS, "cannot insert into table: %d\n", r );
+
+    query = "SELECT `A`, `D`, `F` FROM `One`, `Two`, `Three` "
+            "WHERE `Two`.`C` = `Three`.`E` AND `One`.`A` = ?";
+    r = MsiDatabaseOpenViewA(hdb, query, &hview);
+    ok( r == ERROR_SUCCESS, "failed to open view: %d\n", r );
+
+    hrec = MsiCreateRecord(1);
+    MsiRecordSetInteger(hrec, 1, 1);
+    r = MsiViewExecute(hview, hrec);
+    ok( r == ERROR_SUCCESS, "failed to execute view: %d\n", r );
+    MsiCloseHandle(hrec);
+
+    r = MsiViewFetch(hview, &hrec);
+    ok( r == ERROR_SUCCESS, "failed to fetch view: %d\n", r );
+    check_record(hrec, 3, "1", "14", "8");
+    MsiCloseHandle(hrec);
+
+    r = MsiViewFetch(hview, &hrec);
+    ok(r == ERROR_NO_MORE_ITEMS, "Expected ERROR_NO_MORE_ITEMS, got %d\n", r);
+    MsiViewClose(hview);
+
+    hrec = MsiCreateRecord(1);
+    MsiRecordSetInteger(hrec, 1, 2);
+    r = MsiViewExecute(hview, hrec);
+    ok( r == ERROR_SUCCESS, "failed to execute view: %d\n", r );
+    MsiCloseHandle(hrec);
+
+    r = MsiViewFetch(hview, &hrec);
+    ok(r == ERROR_NO_MORE_ITEMS, "Expected ERROR_NO_MORE_ITEMS, got %d\n", r);
+
+    MsiViewClose(hview);
+    MsiCloseHandle(hview);
+
     query = "SELECT * FROM `Nonexistent`, `One`";
     r = MsiDatabaseOpenViewA(hdb, query, &hview);
     ok( r == ERROR_BAD_QUERY_SYNTAX,
@@ -36,6 +36,7 @@
 #include "query.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(msidb);
+WINE_DECLARE_DEBUG_CHANNEL(msiquery);
 
 /* below is the query interface to a table */
 typedef struct tagMSIROWENTRY
@@ -51,6 +52,12 @@ typedef struct tagJOINTABLE
     UINT col_count;
     UINT row_count;
     UINT table_index;
+    const union ext_column *join_column; /* column of this table used for a hash join */
+    const union ext_column *join_outer;  /* column of an earlier table it must equal */
+    UINT *hash_buckets;                  /* first row of each bucket */
+    UINT *hash_next;                     /* next row in the same bucket */
+    UINT *hash_values;                   /* value of join_column in each row */
+    UINT hash_mask;
 } JOINTABLE;
 
 typedef struct tagMSIORDERINFO
@@ -73,6 +80,7 @@ typedef struct tagMSIWHEREVIEW
     struct expr   *cond;
     UINT           rec_index;
     MSIORDERINFO  *order_info;
+    JOINTABLE    **ordered_tables; /* join order, computed on first execute */
 } MSIWHEREVIEW;
 
 static UINT WHERE_evaluate( MSIWHEREVIEW *wv, const UINT rows[],
@@ -646,15 +654,54 @@ static UINT WHERE_evaluate( MSIWHEREVIEW *wv, const UINT rows[],
     return ERROR_SUCCESS;
 }
 
+static inline UINT join_hash( UINT value )
+{
+    return value * 0x9e3779b1;
+}
+
+/* returns the first row of the table that may satisfy the condition; with a
+ * hash join only the rows whose join column matches the key are visited */
+static UINT join_first_row( const JOINTABLE *table, UINT key )
+{
+    UINT row;
+
+    if (!table->hash_buckets)
+        return 0;
+
+    row = table->hash_buckets[join_hash( key ) & table->hash_mask];
+    while (row != INVALID_ROW_INDEX && table->hash_values[row] != key)
+        row = table->hash_next[row];
+    return row;
+}
+
+static UINT join_next_row( const JOINTABLE *table, UINT row, UINT key )
+{
+    if (!table->hash_buckets)
+        return row + 1;
+
+    do row = table->hash_next[row];
+    while (row != INVALID_ROW_INDEX && table->hash_values[row] != key);
+    return row;
+}
+
 static UINT check_condition( MSIWHEREVIEW *wv, MSIRECORD *record, JOINTABLE **tables,
                              UINT table_rows[] )
 {
-    UINT r = ERROR_FUNCTION_FAILED;
+    JOINTABLE *table = *tables;
+    UINT r = ERROR_SUCCESS, key = 0;
     INT val;
 
-    for (table_rows[(*tables)->table_index] = 0;
-         table_rows[(*tables)->table_index] < (*tables)->row_count;
-         table_rows[(*tables)->table_index]++)
+    if (table->hash_buckets)
+    {
+        r = expr_fetch_value( table->join_outer, table_rows, &key );
+        if (r != ERROR_SUCCESS)
+            return r;
+    }
+
+    /* INVALID_ROW_INDEX terminates both iterations */
+    for (table_rows[table->table_index] = join_first_row( table, key );
+         table_rows[table->table_index] < table->row_count;
+         table_rows[table->table_index] = join_next_row( table, table_rows[table->table_index], key ))
     {
         val = 0;
         wv->rec_index = 0;
@@ -677,7 +724,7 @@ static UINT check_condition( MSIWHEREVIEW *wv, MSIRECORD *record, JOINTABLE **ta
             }
         }
     }
-    table_rows[(*tables)->table_index] = INVALID_ROW_INDEX;
+    table_rows[table->table_index] = INVALID_ROW_INDEX;
     return r;
 }
 
@@ -810,17 +857,151 @@ static JOINTABLE **ordertables( MSIWHEREVIEW *wv )
     return tables;
 }
 
+static BOOL is_bound( JOINTABLE **tables, UINT count, const JOINTABLE *table )
+{
+    UINT i;
+
+    for (i = 0; i < count; i++)
+        if (tables[i] == table) return TRUE;
+    return FALSE;
+}
+
+/* looks for an equality between a column of the table and a column of one of
+ * the tables joined before it, among the terms ANDed together in the condition */
+static BOOL find_join_columns( const struct expr *cond, JOINTABLE **bound, UINT count,
+                               JOINTABLE *table )
+{
+    const union ext_column *left, *right;
+
+    if (cond->type != EXPR_COMPLEX && cond->type != EXPR_STRCMP)
+        return FALSE;
+
+    if (cond->type == EXPR_COMPLEX && cond->u.expr.op == OP_AND)
+        return find_join_columns( cond->u.expr.left, bound, count, table ) ||
+               find_join_columns( cond->u.expr.right, bound, count, table );
+
+    if (cond->u.expr.op != OP_EQ || cond->u.expr.left->type != cond->u.expr.right->type)
+        return FALSE;
+
+    /* columns of the same type compare equal exactly when their stored values
+     * do, strings being unique in the string table */
+    switch (cond->u.expr.left->type)
+    {
+    case EXPR_COL_NUMBER:
+    case EXPR_COL_NUMBER32:
+    case EXPR_COL_NUMBER_STRING:
+        break;
+    default:
+        return FALSE;
+    }
+
+    left = &cond->u.expr.left->u.column;
+    right = &cond->u.expr.right->u.column;
+    if (left->parsed.table == table && is_bound( bound, count, right->parsed.table ))
+    {
+        table->join_column = left;
+        table->join_outer = right;
+        return TRUE;
+    }
+    if (right->parsed.table == table && is_bound( bound, count, left->parsed.table ))
+    {
+        table->join_column = right;
+        table->join_outer = left;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/* computes the join order and the hash joins to use, once per view */
+static UINT plan_joins( MSIWHEREVIEW *wv )
+{
+    UINT i;
+
+    if (wv->ordered_tables)
+        return ERROR_SUCCESS;
+
+    if (!(wv->ordered_tables = ordertables( wv )))
+        return ERROR_OUTOFMEMORY;
+
+    for (i = 1; wv->cond && i < wv->table_count; i++)
+    {
+        JOINTABLE *table = wv->ordered_tables[i];
+
+        if (!find_join_columns( wv->cond, wv->ordered_tables, i, table ))
+            continue;
+
+        TRACE_(msiquery)("%p: hash join on column %u of table %u with column %u of table %u\n", wv,
+                         table->join_column->parsed.column, table->table_index,
+                         table->join_outer->parsed.column, table->join_outer->parsed.table->table_index);
+    }
+    return ERROR_SUCCESS;
+}
+
+static void free_join_index( JOINTABLE *table )
+{
+    msi_free( table->hash_buckets );
+    msi_free( table->hash_next );
+    msi_free( table->hash_values );
+    table->hash_buckets = table->hash_next = table->hash_values = NULL;
+}
+
+/* indexes the rows of the table by the value of its join column */
+static void build_join_index( JOINTABLE *table )
+{
+    UINT size, row, value;
+
+    free_join_index( table );
+    if (!table->join_column)
+        return;
+
+    for (size = 16; size < table->row_count; size *= 2)
+        ;
+
+    table->hash_buckets = msi_alloc( size * sizeof(UINT) );
+    table->hash_next = msi_alloc( table->row_count * sizeof(UINT) );
+    table->hash_values = msi_alloc( table->row_count * sizeof(UINT) );
+    if (!table->hash_buckets || !table->hash_next || !table->hash_values)
+        goto fail;
+
+    table->hash_mask = size - 1;
+    memset( table->hash_buckets, 0xff, size * sizeof(UINT) );
+
+    /* insert backwards so that each bucket lists its rows in table order */
+    for (row = table->row_count; row--;)
+    {
+        UINT *bucket;
+
+        if (table->view->ops->fetch_int( table->view, row, table->join_column->parsed.column,
+                                         &value ) != ERROR_SUCCESS)
+            goto fail;
+
+        bucket = &table->hash_buckets[join_hash( value ) & table->hash_mask];
+        table->hash_values[row] = value;
+        table->hash_next[row] = *bucket;
+        *bucket = row;
+    }
+    return;
+
+fail:
+    /* fall back to scanning the table */
+    WARN("failed to index table %u\n", table->table_index);
+    free_join_index( table );
+}
+
 static UINT WHERE_execute( struct tagMSIVIEW *view, MSIRECORD *record )
 {
     MSIWHEREVIEW *wv = (MSIWHEREVIEW*)view;
     UINT r;
     JOINTABLE *table = wv->tables;
     UINT *rows;
-    JOINTABLE **ordered_tables;
     UINT i = 0;
+    LARGE_INTEGER start, end, freq;
 
     TRACE("%p %p\n", wv, record);
 
+    if (TRACE_ON(msiquery))
+        QueryPerformanceCounter( &start );
+
     if( !table )
          return ERROR_FUNCTION_FAILED;
 
@@ -845,13 +1026,21 @@ static UINT WHERE_execute( struct tagMSIVIEW *view, MSIRECORD *record )
     }
     while ((table = table->next));
 
-    ordered_tables = ordertables( wv );
+    r = plan_joins( wv );
+    if (r != ERROR_SUCCESS)
+        return r;
+
+    for (table = wv->tables; table; table = table->next)
+        build_join_index( table );
 
     rows = msi_alloc( wv->table_count * sizeof(*rows) );
     for (i = 0; i < wv->table_count; i++)
         rows[i] = INVALID_ROW_INDEX;
 
-    r =  check_condition(wv, record, ordered_tables, rows);
+    r =  check_condition(wv, record, wv->ordered_tables, rows);
+
+    for (table = wv->tables; table; table = table->next)
+        free_join_index( table );
 
     if (wv->order_info)
         wv->order_info->error = ERROR_SUCCESS;
@@ -862,7 +1051,14 @@ static UINT WHERE_execute( struct tagMSIVIEW *view, MSIRECORD *record )
         r = wv->order_info->error;
 
     msi_free( rows );
-    msi_free( ordered_tables );
+
+    if (TRACE_ON(msiquery))
+    {
+        QueryPerformanceCounter( &end );
+        QueryPerformanceFrequency( &freq );
+        TRACE_(msiquery)("%p: %u tables, %u rows in %u us\n", wv, wv->table_count, wv->row_count,
+                         (UINT)((end.QuadPart - start.QuadPart) * 1000000 / freq.QuadPart));
+    }
     return r;
 }
 
@@ -1056,6 +1252,9 @@ static UINT WHERE_delete( struct tagMSIVIEW *view )
     msi_free(wv->order_info);
     wv->order_info = NULL;
 
+    msi_free(wv->ordered_tables);
+    wv->ordered_tables = NULL;
+
     msiobj_release( &wv->db->hdr );
     msi_free( wv );
 
@@ -1249,7 +1448,7 @@ UINT WHERE_CreateView( MSIDATABASE *db, MSIVIEW **view, LPWSTR tables,
         if ((ptr = wcschr(tables, ' ')))
             *ptr = '\0';
 
-        table = msi_alloc(sizeof(JOINTABLE));
+        table = msi_alloc_zero(sizeof(JOINTABLE));
         if (!table)
         {
             r = ERROR_OUTOFMEMORY;
@@ -230,6 +230,7 @@ static Scheduler* (__cdecl *p_Scheduler_Create)(SchedulerPolicy*);
 static Scheduler* (__cdecl *p_CurrentScheduler_Get)(void);
 static void (__cdecl *p_CurrentScheduler_Detach)(void);
 static unsigned int (__cdecl *p_CurrentScheduler_Id)(void);
+static void (__cdecl *p_CurrentScheduler_ScheduleTask)(void (__cdecl*)(void*), void*);
 
 static int (__cdecl *p__memicmp)(const char*, const char*, size_t);
 static int (__cdecl *p__memicmp_l)(const char*, const char*, size_t,_locale_t);
@@ -318,6 +319,7 @@ static BOOL init(void)
         SET(p_SchedulerPolicy_dtor, "??1SchedulerPolicy@Concurrency@@QEAA@XZ");
         SET(p_Scheduler_Create, "?Create@Scheduler@Concurrency@@SAPEAV12@AEBVSchedulerPolicy@2@@Z");
         SET(p_CurrentScheduler_Get, "?Get@CurrentScheduler@Concurrency@@SAPEAVScheduler@2@XZ");
+        SET(p_CurrentScheduler_ScheduleTask, "?ScheduleTask@CurrentScheduler@Concurrency@@SAXP6AXPEAX@Z0@Z");
     } else {
         SET(pSpinWait_ctor_yield, "??0?$_SpinWait@$00@details@Concurrency@@QAE@P6AXXZ@Z");
         SET(pSpinWait_dtor, "??_F?$_SpinWait@$00@details@Concurrency@@QAEXXZ");
@@ -359,6 +361,7 @@ static BOOL init(void)
         SET(p_SchedulerPolicy_dtor, "??1SchedulerPolicy@Concurrency@@QAE@XZ");
         SET(p_Scheduler_Create, "?Create@Scheduler@Concurrency@@SAPAV12@ABVSchedulerPolicy@2@@Z");
         SET(p_CurrentScheduler_Get, "?Get@CurrentScheduler@Concurrency@@SAPAVScheduler@2@XZ");
+        SET(p_CurrentScheduler_ScheduleTask, "?ScheduleTask@CurrentScheduler@Concurrency@@SAXP6AXPAX@Z0@Z");
     }
 
     init_thiscall_thunk();
@@ -989,6 +992,49 @@ static void test_Scheduler(void)
     call_func1(p_SchedulerPolicy_dtor, &policy);
 }
 
+static LONG scheduled_tasks;
+static HANDLE scheduled_tasks_done;
+
+static void __cdecl scheduled_task(void *data)
+{
+    if (InterlockedIncrement(&scheduled_tasks) == PtrToUlong(data))
+        SetEvent(scheduled_tasks_done);
+}
+
+static void test_ScheduleTask(void)
+{
+    Scheduler *scheduler;
+    SchedulerPolicy policy;
+    DWORD ret;
+    int i;
+
+    scheduled_tasks_done = CreateEventW(NULL, FALSE, FALSE, NULL);
+
+    for (i = 0; i < 100; i++)
+        p_CurrentScheduler_ScheduleTask(scheduled_task, ULongToPtr(100));
+    ret = WaitForSingleObject(scheduled_tasks_done, 5000);
+    ok(ret == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", ret);
+    ok(scheduled_tasks == 100, "scheduled_tasks = %d\n", scheduled_tasks);
+
+    call_func1(p_SchedulerPolicy_ctor, &policy);
+    call_func3(p_SchedulerPolicy_SetConcurrencyLimits, &policy, 2, 2);
+    scheduler = p_Scheduler_Create(&policy);
+    ok(scheduler != NULL, "Scheduler::Create() = NULL\n");
+    call_func1(scheduler->vtable->Attach, scheduler);
+
+    scheduled_tasks = 0;
+    for (i = 0; i < 100; i++)
+        p_CurrentScheduler_ScheduleTask(scheduled_task, ULongToPtr(100));
+    ret = WaitForSingleObject(scheduled_tasks_done, 5000);
+    ok(ret == WAIT_OBJECT_0, "WaitForSingleObject returned %u\n", ret);
+    ok(scheduled_tasks == 100, "scheduled_tasks = %d\n", scheduled_tasks);
+
+    p_CurrentScheduler_Detach();
+    call_func1(scheduler->vtable->Release, scheduler);
+    call_func1(p_SchedulerPolicy_dtor, &policy);
+    CloseHandle(scheduled_tasks_done);
+}
+
 static void test__memicmp(void)
 {
     static const char *s1 = "abc";
@@ -1113,6 +1159,7 @@ START_TEST(msvcr100)
 
     test_ExternalContextBase();
     test_Scheduler();
+    test_ScheduleTask();
     test_wmemcpy_s();
     test_wmemmove_s();
     test_fread_s();
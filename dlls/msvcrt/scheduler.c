@@ -25,6 +25,7 @@
 #include "windef.h"
 #include "winternl.h"
 #include "wine/debug.h"
+#include "wine/list.h"
 #include "msvcrt.h"
 #include "cppexcept.h"
 #include "cxx.h"
@@ -84,11 +85,16 @@ struct scheduler_list {
     struct scheduler_list *next;
 };
 
+struct scheduler_worker;
+
 typedef struct {
     Context context;
     struct scheduler_list scheduler;
     unsigned int id;
     union allocator_cache_entry *allocator_cache[8];
+    struct scheduler_worker *worker;
+    HANDLE block_event;
+    LONG blocked;
 } ExternalContextBase;
 extern const vtable_ptr MSVCRT_ExternalContextBase_vtable;
 static void ExternalContextBase_ctor(ExternalContextBase*);
@@ -120,7 +126,43 @@ typedef struct Scheduler {
         void, (Scheduler*,void (__cdecl*)(void*),void*), (this,proc,data))
 #endif
 
-typedef struct {
+struct scheduled_task {
+    struct list entry;
+    void (__cdecl *proc)(void*);
+    void *data;
+};
+
+struct scheduler_worker {
+    struct ThreadScheduler *scheduler;
+    struct scheduler_pool *pool;
+    unsigned int id;
+    HANDLE thread;
+    DWORD thread_id;
+    HMODULE module;
+    CRITICAL_SECTION cs;
+    /* the worker pushes and pops tasks at the tail, other workers steal them from the head */
+    struct list tasks;
+};
+
+/* The workers are kept apart from the scheduler and freed by whoever of the
+ * scheduler and its worker threads lets go of them last, so that destroying
+ * the scheduler doesn't have to wait for the threads to exit; it can happen
+ * under the loader lock, on thread detach. */
+struct scheduler_pool {
+    LONG ref;
+    CRITICAL_SECTION cs;
+    /* signaled when a task is queued or the scheduler shuts down */
+    CONDITION_VARIABLE task_cv;
+    /* queued tasks that no worker has claimed yet, protected by cs */
+    LONG task_count;
+    /* workers waiting for a task, protected by cs */
+    LONG idle_count;
+    BOOL shutdown;
+    LONG worker_count;
+    struct scheduler_worker workers[1];
+};
+
+typedef struct ThreadScheduler {
     Scheduler scheduler;
     LONG ref;
     unsigned int id;
@@ -130,6 +172,10 @@ typedef struct {
     int shutdown_size;
     HANDLE *shutdown_events;
     CRITICAL_SECTION cs;
+    struct scheduler_pool *pool;
+    unsigned int max_workers;
+    LONG blocked_count;
+    LONG next_worker;
 } ThreadScheduler;
 extern const vtable_ptr MSVCRT_ThreadScheduler_vtable;
 
@@ -155,6 +201,8 @@ static SchedulerPolicy default_scheduler_policy;
 static ThreadScheduler *default_scheduler;
 
 static void create_default_scheduler(void);
+static BOOL scheduler_worker_run_pending_task(struct scheduler_worker*);
+static void ThreadScheduler_spawn_workers(ThreadScheduler*);
 
 static Context* try_get_current_context(void)
 {
@@ -230,17 +278,58 @@ unsigned int __cdecl Context_Id(void)
     return ctx ? call_Context_GetId(ctx) : -1;
 }
 
+static HANDLE get_block_event(ExternalContextBase *context)
+{
+    HANDLE event;
+
+    if(context->block_event)
+        return context->block_event;
+
+    event = CreateEventW(NULL, FALSE, FALSE, NULL);
+    if(InterlockedCompareExchangePointer(&context->block_event, event, NULL))
+        CloseHandle(event);
+    return context->block_event;
+}
+
 /* ?Block@Context@Concurrency@@SAXXZ */
 void __cdecl Context_Block(void)
 {
-    FIXME("()\n");
+    ExternalContextBase *context = (ExternalContextBase*)get_current_context();
+
+    TRACE("()\n");
+
+    if(context->context.vtable != &MSVCRT_ExternalContextBase_vtable) {
+        ERR("unknown context set\n");
+        return;
+    }
+
+    /* let another worker take over the virtual processor while blocked */
+    if(context->worker) {
+        InterlockedIncrement(&context->worker->scheduler->blocked_count);
+        ThreadScheduler_spawn_workers(context->worker->scheduler);
+    }
+
+    context->blocked = TRUE;
+    WaitForSingleObject(get_block_event(context), INFINITE);
+    context->blocked = FALSE;
+
+    if(context->worker)
+        InterlockedDecrement(&context->worker->scheduler->blocked_count);
 }
 
 /* ?Yield@Context@Concurrency@@SAXXZ */
 /* ?_Yield@_Context@details@Concurrency@@SAXXZ */
 void __cdecl Context_Yield(void)
 {
-    FIXME("()\n");
+    ExternalContextBase *context = (ExternalContextBase*)try_get_current_context();
+
+    TRACE("()\n");
+
+    /* workers run a pending task instead of giving up their virtual processor */
+    if(context && context->context.vtable == &MSVCRT_ExternalContextBase_vtable &&
+            context->worker && scheduler_worker_run_pending_task(context->worker))
+        return;
+    SwitchToThread();
 }
 
 /* ?_SpinYield@Context@Concurrency@@SAXXZ */
@@ -288,8 +377,8 @@ unsigned int __thiscall ExternalContextBase_GetId(const ExternalContextBase *thi
 DEFINE_THISCALL_WRAPPER(ExternalContextBase_GetVirtualProcessorId, 4)
 unsigned int __thiscall ExternalContextBase_GetVirtualProcessorId(const ExternalContextBase *this)
 {
-    FIXME("(%p)->() stub\n", this);
-    return -1;
+    TRACE("(%p)->()\n", this);
+    return this->worker ? this->worker->id : -1;
 }
 
 DEFINE_THISCALL_WRAPPER(ExternalContextBase_GetScheduleGroupId, 4)
@@ -302,14 +391,15 @@ unsigned int __thiscall ExternalContextBase_GetScheduleGroupId(const ExternalCon
 DEFINE_THISCALL_WRAPPER(ExternalContextBase_Unblock, 4)
 void __thiscall ExternalContextBase_Unblock(ExternalContextBase *this)
 {
-    FIXME("(%p)->() stub\n", this);
+    TRACE("(%p)->()\n", this);
+    SetEvent(get_block_event(this));
 }
 
 DEFINE_THISCALL_WRAPPER(ExternalContextBase_IsSynchronouslyBlocked, 4)
 MSVCRT_bool __thiscall ExternalContextBase_IsSynchronouslyBlocked(const ExternalContextBase *this)
 {
-    FIXME("(%p)->() stub\n", this);
-    return FALSE;
+    TRACE("(%p)->()\n", this);
+    return this->blocked;
 }
 
 static void ExternalContextBase_dtor(ExternalContextBase *this)
@@ -326,6 +416,9 @@ static void ExternalContextBase_dtor(ExternalContextBase *this)
         }
     }
 
+    if (this->block_event)
+        CloseHandle(this->block_event);
+
     if (this->scheduler.scheduler) {
         call_Scheduler_Release(this->scheduler.scheduler);
 
@@ -598,11 +691,259 @@ void __thiscall SchedulerPolicy_dtor(SchedulerPolicy *this)
     MSVCRT_operator_delete(this->policy_container);
 }
 
+static struct scheduled_task* scheduler_worker_get_task(struct scheduler_worker *worker)
+{
+    struct scheduler_pool *pool = worker->pool;
+    struct scheduled_task *task = NULL;
+    struct list *entry;
+    LONG i, count = pool->worker_count;
+
+    EnterCriticalSection(&worker->cs);
+    if((entry = list_tail(&worker->tasks))) {
+        list_remove(entry);
+        task = LIST_ENTRY(entry, struct scheduled_task, entry);
+    }
+    LeaveCriticalSection(&worker->cs);
+    if(task) return task;
+
+    /* steal the oldest task of another worker */
+    for(i=1; i<count && !task; i++) {
+        struct scheduler_worker *victim = &pool->workers[(worker->id+i) % count];
+
+        EnterCriticalSection(&victim->cs);
+        if((entry = list_head(&victim->tasks))) {
+            list_remove(entry);
+            task = LIST_ENTRY(entry, struct scheduled_task, entry);
+        }
+        LeaveCriticalSection(&victim->cs);
+    }
+    return task;
+}
+
+/* take a task claimed from the pool */
+static struct scheduled_task* scheduler_worker_take_task(struct scheduler_worker *worker)
+{
+    struct scheduled_task *task;
+
+    /* there is a queued task for each claim, but a scan can miss it if other
+     * workers take the one it was heading for while a new one is queued behind
+     * it, so this only loops while tasks are being scheduled and run */
+    while(!(task = scheduler_worker_get_task(worker)));
+    return task;
+}
+
+/* returns FALSE if the scheduler was destroyed while running the task */
+static BOOL scheduler_worker_run_task(ThreadScheduler *scheduler, struct scheduled_task *task)
+{
+    void (__cdecl *proc)(void*) = task->proc;
+    void *data = task->data;
+
+    Concurrency_Free(task);
+    TRACE("running %p(%p)\n", proc, data);
+    proc(data);
+    return call_Scheduler_Release(&scheduler->scheduler) != 0;
+}
+
+/* run a pending task on the current worker, used when it yields */
+static BOOL scheduler_worker_run_pending_task(struct scheduler_worker *worker)
+{
+    struct scheduler_pool *pool = worker->pool;
+
+    EnterCriticalSection(&pool->cs);
+    if(!pool->task_count || pool->shutdown) {
+        LeaveCriticalSection(&pool->cs);
+        return FALSE;
+    }
+    pool->task_count--;
+    LeaveCriticalSection(&pool->cs);
+
+    /* the caller still holds a reference to the scheduler */
+    scheduler_worker_run_task(worker->scheduler, scheduler_worker_take_task(worker));
+    return TRUE;
+}
+
+static void scheduler_pool_release(struct scheduler_pool *pool)
+{
+    struct scheduled_task *task, *next;
+    LONG i;
+
+    if(InterlockedDecrement(&pool->ref))
+        return;
+
+    for(i=0; i<pool->worker_count; i++) {
+        struct scheduler_worker *worker = &pool->workers[i];
+
+        LIST_FOR_EACH_ENTRY_SAFE(task, next, &worker->tasks, struct scheduled_task, entry) {
+            list_remove(&task->entry);
+            Concurrency_Free(task);
+        }
+        worker->cs.DebugInfo->Spare[0] = 0;
+        DeleteCriticalSection(&worker->cs);
+    }
+    pool->cs.DebugInfo->Spare[0] = 0;
+    DeleteCriticalSection(&pool->cs);
+    MSVCRT_operator_delete(pool);
+}
+
+static DWORD WINAPI scheduler_worker_proc(void *arg)
+{
+    struct scheduler_worker *worker = arg;
+    struct scheduler_pool *pool = worker->pool;
+    ThreadScheduler *scheduler = worker->scheduler;
+    ExternalContextBase *context = (ExternalContextBase*)get_current_context();
+    Scheduler *prev = context->scheduler.scheduler;
+    HMODULE module = worker->module;
+
+    TRACE("(%p) starting worker %u of scheduler %p\n", worker, worker->id, scheduler);
+
+    /* tasks scheduled from the worker go to its own queue, the worker holds no reference
+     * to the scheduler since it is stopped when the scheduler is destroyed */
+    context->scheduler.scheduler = &scheduler->scheduler;
+    context->worker = worker;
+
+    while(1) {
+        EnterCriticalSection(&pool->cs);
+        pool->idle_count++;
+        while(!pool->task_count && !pool->shutdown)
+            SleepConditionVariableCS(&pool->task_cv, &pool->cs, INFINITE);
+        pool->idle_count--;
+        if(pool->shutdown) {
+            LeaveCriticalSection(&pool->cs);
+            break;
+        }
+        pool->task_count--;
+        LeaveCriticalSection(&pool->cs);
+
+        if(!scheduler_worker_run_task(scheduler, scheduler_worker_take_task(worker)))
+            break;
+    }
+
+    context->scheduler.scheduler = prev;
+    context->worker = NULL;
+    scheduler_pool_release(pool);
+    FreeLibraryAndExitThread(module, 0);
+}
+
+/* the scheduler critical section must be held */
+static void ThreadScheduler_add_worker(ThreadScheduler *this)
+{
+    struct scheduler_pool *pool = this->pool;
+    struct scheduler_worker *worker = &pool->workers[pool->worker_count];
+
+    worker->scheduler = this;
+    worker->pool = pool;
+    worker->id = pool->worker_count;
+    list_init(&worker->tasks);
+
+    /* keep the module loaded while the worker is running */
+    if(!GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS,
+                (const WCHAR*)scheduler_worker_proc, &worker->module)) {
+        ERR("failed to get module handle: %u\n", GetLastError());
+        return;
+    }
+
+    InitializeCriticalSection(&worker->cs);
+    worker->cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": scheduler_worker");
+    InterlockedIncrement(&pool->ref);
+    worker->thread = CreateThread(NULL, 0, scheduler_worker_proc, worker, 0, &worker->thread_id);
+    if(!worker->thread) {
+        ERR("failed to create worker thread: %u\n", GetLastError());
+        InterlockedDecrement(&pool->ref);
+        worker->cs.DebugInfo->Spare[0] = 0;
+        DeleteCriticalSection(&worker->cs);
+        FreeLibrary(worker->module);
+        return;
+    }
+    InterlockedIncrement(&pool->worker_count);
+}
+
+/* start the MinConcurrency workers on first use, then add workers while none is idle */
+static void ThreadScheduler_spawn_workers(ThreadScheduler *this)
+{
+    struct scheduler_pool *pool = this->pool;
+    unsigned int limit, min_workers;
+
+    if(pool->worker_count && pool->idle_count)
+        return;
+
+    EnterCriticalSection(&this->cs);
+    limit = min(this->virt_proc_no + this->blocked_count, this->max_workers);
+    if(!pool->worker_count) {
+        min_workers = SchedulerPolicy_GetPolicyValue(&this->policy, MinConcurrency);
+        min_workers = max(1, min(min_workers, limit));
+        while(pool->worker_count < min_workers) {
+            LONG count = pool->worker_count;
+            ThreadScheduler_add_worker(this);
+            if(count == pool->worker_count) break;
+        }
+    }else if(!pool->idle_count && pool->worker_count < limit) {
+        ThreadScheduler_add_worker(this);
+    }
+    LeaveCriticalSection(&this->cs);
+}
+
+static void ThreadScheduler_schedule_task(ThreadScheduler *this,
+        void (__cdecl *proc)(void*), void *data)
+{
+    ExternalContextBase *context = (ExternalContextBase*)get_current_context();
+    struct scheduler_pool *pool = this->pool;
+    struct scheduler_worker *worker;
+    struct scheduled_task *task;
+
+    ThreadScheduler_spawn_workers(this);
+    if(!pool->worker_count) {
+        throw_exception(EXCEPTION_SCHEDULER_RESOURCE_ALLOCATION_ERROR,
+                HRESULT_FROM_WIN32(GetLastError()), NULL);
+        return;
+    }
+
+    task = Concurrency_Alloc(sizeof(*task));
+    task->proc = proc;
+    task->data = data;
+    /* released once the task has run */
+    call_Scheduler_Reference(&this->scheduler);
+
+    if(context->context.vtable == &MSVCRT_ExternalContextBase_vtable &&
+            context->worker && context->worker->scheduler == this)
+        worker = context->worker;
+    else
+        worker = &pool->workers[(ULONG)InterlockedIncrement(&this->next_worker) % pool->worker_count];
+
+    EnterCriticalSection(&worker->cs);
+    list_add_tail(&worker->tasks, &task->entry);
+    LeaveCriticalSection(&worker->cs);
+
+    EnterCriticalSection(&pool->cs);
+    pool->task_count++;
+    if(pool->idle_count) WakeConditionVariable(&pool->task_cv);
+    LeaveCriticalSection(&pool->cs);
+}
+
+/* Every queued task holds a reference to the scheduler, so when it is destroyed
+ * the workers are idle, or one of them is running the task that destroyed it.
+ * They are told to exit, but not waited for. */
+static void ThreadScheduler_stop_workers(ThreadScheduler *this)
+{
+    struct scheduler_pool *pool = this->pool;
+    LONG i;
+
+    EnterCriticalSection(&pool->cs);
+    pool->shutdown = TRUE;
+    WakeAllConditionVariable(&pool->task_cv);
+    LeaveCriticalSection(&pool->cs);
+
+    for(i=0; i<pool->worker_count; i++)
+        CloseHandle(pool->workers[i].thread);
+    scheduler_pool_release(pool);
+    this->pool = NULL;
+}
+
 static void ThreadScheduler_dtor(ThreadScheduler *this)
 {
     int i;
 
     if(this->ref != 0) WARN("ref = %d\n", this->ref);
+    ThreadScheduler_stop_workers(this);
     SchedulerPolicy_dtor(&this->policy);
 
     for(i=0; i<this->shutdown_count; i++)
@@ -721,14 +1062,16 @@ DEFINE_THISCALL_WRAPPER(ThreadScheduler_ScheduleTask_loc, 16)
 void __thiscall ThreadScheduler_ScheduleTask_loc(ThreadScheduler *this,
         void (__cdecl *proc)(void*), void* data, /*location*/void *placement)
 {
-    FIXME("(%p %p %p %p) stub\n", this, proc, data, placement);
+    FIXME("(%p %p %p %p) placement ignored\n", this, proc, data, placement);
+    ThreadScheduler_schedule_task(this, proc, data);
 }
 
 DEFINE_THISCALL_WRAPPER(ThreadScheduler_ScheduleTask, 12)
 void __thiscall ThreadScheduler_ScheduleTask(ThreadScheduler *this,
         void (__cdecl *proc)(void*), void* data)
 {
-    FIXME("(%p %p %p) stub\n", this, proc, data);
+    TRACE("(%p %p %p)\n", this, proc, data);
+    ThreadScheduler_schedule_task(this, proc, data);
 }
 
 DEFINE_THISCALL_WRAPPER(ThreadScheduler_IsAvailableLocation, 8)
@@ -779,6 +1122,19 @@ static ThreadScheduler* ThreadScheduler_ctor(ThreadScheduler *this,
     this->shutdown_count = this->shutdown_size = 0;
     this->shutdown_events = NULL;
 
+    /* leave room for the workers added while others are blocked */
+    this->max_workers = this->virt_proc_no * 2;
+    this->pool = MSVCRT_operator_new(FIELD_OFFSET(struct scheduler_pool, workers[this->max_workers]));
+    this->pool->ref = 1;
+    InitializeCriticalSection(&this->pool->cs);
+    this->pool->cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": scheduler_pool");
+    InitializeConditionVariable(&this->pool->task_cv);
+    this->pool->task_count = this->pool->idle_count = 0;
+    this->pool->shutdown = FALSE;
+    this->pool->worker_count = 0;
+    this->blocked_count = 0;
+    this->next_worker = 0;
+
     InitializeCriticalSection(&this->cs);
     this->cs.DebugInfo->Spare[0] = (DWORD_PTR)(__FILE__ ": ThreadScheduler");
     return this;
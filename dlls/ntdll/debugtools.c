@@ -22,14 +22,28 @@
 #include "wine/port.h"
 
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+#ifdef HAVE_POLL_H
+#include <poll.h>
+#endif
+#ifdef HAVE_SYS_POLL_H
+#include <sys/poll.h>
+#endif
+#ifdef HAVE_SYS_MMAN_H
+# include <sys/mman.h>
+#endif
 #ifdef HAVE_UNISTD_H
 # include <unistd.h>
 #endif
 
 #include "wine/debug.h"
+#include "wine/library.h"
 #include "ntdll_misc.h"
 
 WINE_DECLARE_DEBUG_CHANNEL(pid);
@@ -44,6 +58,16 @@ static struct __wine_debug_channel *debug_options;
 
 static const char * const debug_classes[] = { "fixme", "err", "warn", "trace" };
 
+#define RING_SIZE (4 << 20)  /* size of the trace ring buffer, must be a power of two */
+
+static char *ring;                      /* trace ring buffer, NULL when writing text to stderr */
+static struct debug_ring_control *ring_ctl;  /* control block preceding the ring buffer */
+static char *ring_filename;             /* file backing the ring buffer */
+static int ring_fd = -1;                /* trace file */
+static int ring_error;                  /* set once writing to the trace file failed */
+static int ring_wake[2] = { -1, -1 };   /* pipe to wake up the writer thread */
+static pthread_mutex_t ring_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 /* get the debug info pointer for the current thread */
 static inline struct debug_info *get_info(void)
 {
@@ -65,6 +89,247 @@ static int append_output( struct debug_info *info, const char *str, size_t len )
     return len;
 }
 
+/* reserve space in the trace ring, returns NULL if it is full */
+static struct debug_ring_record *ring_alloc( unsigned int size )
+{
+    struct debug_ring_record *pad_record;
+    unsigned int head, pos, pad, used;
+
+    do
+    {
+        head = *(volatile unsigned int *)&ring_ctl->head;
+        pos = head & (RING_SIZE - 1);
+        pad = pos + size > RING_SIZE ? RING_SIZE - pos : 0;
+        used = head + pad + size - *(volatile unsigned int *)&ring_ctl->tail;
+        if (used > RING_SIZE)
+        {
+            interlocked_xchg_add( &ring_ctl->lost, 1 );
+            return NULL;
+        }
+    } while (interlocked_cmpxchg( (int *)&ring_ctl->head, head + pad + size, head ) != head);
+
+    if (pad)
+    {
+        pad_record = (struct debug_ring_record *)(ring + pos);
+        pad_record->type = DEBUG_RING_PAD;
+        interlocked_xchg( (int *)&pad_record->size, pad );
+        pos = 0;
+    }
+    /* don't wait for the next poll timeout once the buffer is half full; the
+     * pipe is non-blocking, and if it is full a wakeup is already pending */
+    if (used > RING_SIZE / 2 && used - pad - size <= RING_SIZE / 2)
+        while (write( ring_wake[1], "", 1 ) == -1 && errno == EINTR);
+    return (struct debug_ring_record *)(ring + pos);
+}
+
+/* store the current output line in the trace ring */
+static void ring_output( struct debug_info *info )
+{
+    struct debug_ring_record *record;
+    unsigned int channel_len = 0, function_len = 0, size;
+    char *ptr;
+
+    if (info->ring_record.flags & DEBUG_RING_FUNCTION)
+    {
+        channel_len = strlen( info->ring_channel );
+        function_len = strlen( info->ring_function );
+    }
+    size = (sizeof(*record) + channel_len + function_len + info->out_pos + 7) & ~7;
+    if (!(record = ring_alloc( size ))) goto done;
+
+    record->type         = DEBUG_RING_OUTPUT;
+    record->flags        = info->ring_record.flags;
+    record->cls          = info->ring_record.cls;
+    record->channel_len  = channel_len;
+    record->pid          = info->ring_record.pid;
+    record->tid          = info->ring_record.tid;
+    record->ticks        = info->ring_record.ticks;
+    record->function_len = function_len;
+    record->text_len     = info->out_pos;
+    ptr = (char *)(record + 1);
+    memcpy( ptr, info->ring_channel, channel_len );
+    memcpy( ptr + channel_len, info->ring_function, function_len );
+    memcpy( ptr + channel_len + function_len, info->output, info->out_pos );
+    interlocked_xchg( (int *)&record->size, size );
+done:
+    info->ring_record.flags = 0;
+}
+
+/* write data to the trace file, returns FALSE if it failed */
+static BOOL ring_write( const void *data, size_t size )
+{
+    const char *ptr = data;
+    ssize_t ret;
+
+    while (size)
+    {
+        if ((ret = write( ring_fd, ptr, size )) > 0)
+        {
+            ptr += ret;
+            size -= ret;
+        }
+        else if (ret == -1 && errno == EINTR) continue;
+        else
+        {
+            fprintf( stderr, "wine: failed to write the debug trace: %s\n",
+                     ret ? strerror( errno ) : "no progress" );
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/* write the complete records of the trace ring to the file; once writing
+ * failed, the records are left in the ring file and new ones are dropped */
+static void ring_flush(void)
+{
+    struct debug_ring_record *record;
+    unsigned int tail, start, end;
+    int lost;
+
+    pthread_mutex_lock( &ring_mutex );
+    if (ring_error) goto done;
+    if ((lost = interlocked_xchg( &ring_ctl->lost, 0 )))
+    {
+        struct debug_ring_record lost_record;
+
+        memset( &lost_record, 0, sizeof(lost_record) );
+        lost_record.size  = sizeof(lost_record);
+        lost_record.type  = DEBUG_RING_LOST;
+        lost_record.ticks = lost;
+        if (!ring_write( &lost_record, sizeof(lost_record) ))
+        {
+            interlocked_xchg_add( &ring_ctl->lost, lost );
+            ring_error = 1;
+            goto done;
+        }
+    }
+    for (;;)
+    {
+        tail = ring_ctl->tail;
+        start = end = tail & (RING_SIZE - 1);
+        while (end < RING_SIZE && tail + end - start != *(volatile unsigned int *)&ring_ctl->head)
+        {
+            record = (struct debug_ring_record *)(ring + end);
+            if (!*(volatile unsigned int *)&record->size) break;
+            end += record->size;
+        }
+        if (end == start) break;
+
+        if (!ring_write( ring + start, end - start ))
+        {
+            ring_error = 1;
+            break;
+        }
+        memset( ring + start, 0, end - start );
+        interlocked_xchg( (int *)&ring_ctl->tail, tail + end - start );
+    }
+done:
+    pthread_mutex_unlock( &ring_mutex );
+}
+
+/* flush the trace ring at exit, and remove its file if nothing is left in it */
+static void ring_exit(void)
+{
+    ring_flush();
+    if (!ring_error && ring_ctl->tail == ring_ctl->head) unlink( ring_filename );
+}
+
+/* background thread writing out the trace ring */
+static void *ring_writer_thread( void *arg )
+{
+    struct pollfd pfd;
+    char buffer[64];
+
+    pfd.fd = ring_wake[0];
+    pfd.events = POLLIN;
+    for (;;)
+    {
+        if (poll( &pfd, 1, 100 ) > 0) read( ring_wake[0], buffer, sizeof(buffer) );
+        ring_flush();
+    }
+    return NULL;
+}
+
+/* set up the trace ring, backed by <name>.<pid>.ring, and the thread writing it to <name>.<pid> */
+static void init_ring( const char *name )
+{
+    struct debug_ring_file_header header;
+    sigset_t sigset, old_sigset;
+    pthread_t thread;
+    char *filename;
+    void *ptr;
+    int ret, fd;
+
+    if (!(filename = malloc( strlen( name ) + 17 ))) return;
+    sprintf( filename, "%s.%u", name, (unsigned int)getpid() );
+    ring_fd = open( filename, O_WRONLY | O_CREAT | O_TRUNC, 0666 );
+    if (ring_fd == -1) goto failed;
+    fcntl( ring_fd, F_SETFD, FD_CLOEXEC );
+
+    header.magic    = DEBUG_RING_MAGIC;
+    header.version  = DEBUG_RING_VERSION;
+    header.unix_pid = getpid();
+    header.reserved = 0;
+    if (write( ring_fd, &header, sizeof(header) ) != sizeof(header)) goto failed;
+
+    strcat( filename, ".ring" );
+    if ((fd = open( filename, O_RDWR | O_CREAT | O_TRUNC, 0666 )) == -1) goto failed;
+    if (ftruncate( fd, sizeof(*ring_ctl) + RING_SIZE ) == -1)
+    {
+        close( fd );
+        unlink( filename );
+        goto failed;
+    }
+    ptr = mmap( NULL, sizeof(*ring_ctl) + RING_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    close( fd );
+    if (ptr == MAP_FAILED)
+    {
+        unlink( filename );
+        goto failed;
+    }
+    ring_ctl = ptr;
+    ring_ctl->magic = DEBUG_RING_MAGIC;
+    ring_ctl->version = DEBUG_RING_VERSION;
+    ring_ctl->size = RING_SIZE;
+    ring = (char *)(ring_ctl + 1);
+
+    if (pipe( ring_wake ) == -1) goto failed;
+    fcntl( ring_wake[0], F_SETFD, FD_CLOEXEC );
+    fcntl( ring_wake[1], F_SETFD, FD_CLOEXEC );
+    fcntl( ring_wake[1], F_SETFL, O_NONBLOCK );
+
+    /* the writer thread is not a Wine thread, keep signals away from it */
+    sigfillset( &sigset );
+    pthread_sigmask( SIG_SETMASK, &sigset, &old_sigset );
+    ret = pthread_create( &thread, NULL, ring_writer_thread, NULL );
+    pthread_sigmask( SIG_SETMASK, &old_sigset, NULL );
+    if (ret) goto failed;
+    pthread_detach( thread );
+    ring_filename = filename;
+    atexit( ring_exit );
+    return;
+
+failed:
+    fprintf( stderr, "wine: failed to set up the debug trace ring\n" );
+    if (ring_ctl)
+    {
+        munmap( ring_ctl, sizeof(*ring_ctl) + RING_SIZE );
+        unlink( filename );
+        ring_ctl = NULL;
+        ring = NULL;
+    }
+    if (ring_wake[0] != -1)
+    {
+        close( ring_wake[0] );
+        close( ring_wake[1] );
+        ring_wake[0] = ring_wake[1] = -1;
+    }
+    if (ring_fd != -1) close( ring_fd );
+    ring_fd = -1;
+    free( filename );
+}
+
 /* add a new debug option at the end of the option list */
 static void add_option( const char *name, unsigned char set, unsigned char clear )
 {
@@ -160,7 +425,9 @@ static void debug_usage(void)
         "  WINEDEBUG=[class]+xxx,[class]-yyy,...\n\n"
         "Example: WINEDEBUG=+relay,warn-heap\n"
         "    turns on relay traces, disable heap warnings\n"
-        "Available message classes: err, warn, fixme, trace\n";
+        "Available message classes: err, warn, fixme, trace\n\n"
+        "Set WINEDEBUG_RING=file to store the output in binary form in file.<pid>,\n"
+        "and use tools/decode_trace to read it back.\n";
     write( 2, usage, sizeof(usage) - 1 );
     exit(1);
 }
@@ -169,12 +436,15 @@ static void debug_usage(void)
 static void init_options(void)
 {
     char *wine_debug = getenv("WINEDEBUG");
+    char *ring_name = getenv("WINEDEBUG_RING");
     struct stat st1, st2;
 
     nb_debug_options = 0;
 
+    if (ring_name && ring_name[0]) init_ring( ring_name );
+
     /* check for stderr pointing to /dev/null */
-    if (!fstat( 2, &st1 ) && S_ISCHR(st1.st_mode) &&
+    if (!ring && !fstat( 2, &st1 ) && S_ISCHR(st1.st_mode) &&
         !stat( "/dev/null", &st2 ) && S_ISCHR(st2.st_mode) &&
         st1.st_rdev == st2.st_rdev)
     {
@@ -239,7 +509,8 @@ int __cdecl __wine_dbg_output( const char *str )
     if (end)
     {
         ret += append_output( info, str, end + 1 - str );
-        write( 2, info->output, info->out_pos );
+        if (ring) ring_output( info );
+        else write( 2, info->output, info->out_pos );
         info->out_pos = 0;
         str = end + 1;
     }
@@ -262,6 +533,37 @@ int __cdecl __wine_dbg_header( enum __wine_debug_class cls, struct __wine_debug_
     /* only print header if we are at the beginning of the line */
     if (info->out_pos) return 0;
 
+    if (ring)
+    {
+        struct debug_ring_record *record = &info->ring_record;
+
+        /* store the header fields, the decoder formats them */
+        record->flags = DEBUG_RING_HEADER;
+        if (init_done)
+        {
+            if (TRACE_ON(timestamp))
+            {
+                record->flags |= DEBUG_RING_TIMESTAMP;
+                record->ticks = NtGetTickCount();
+            }
+            if (TRACE_ON(pid))
+            {
+                record->flags |= DEBUG_RING_PID;
+                record->pid = GetCurrentProcessId();
+            }
+            record->flags |= DEBUG_RING_TID;
+            record->tid = GetCurrentThreadId();
+        }
+        if (function && cls < ARRAY_SIZE( classes ))
+        {
+            record->flags |= DEBUG_RING_FUNCTION;
+            record->cls = cls;
+            info->ring_channel = channel->name;
+            info->ring_function = function;
+        }
+        return 0;
+    }
+
     if (init_done)
     {
         if (TRACE_ON(timestamp))
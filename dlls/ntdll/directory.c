@@ -2031,6 +2031,204 @@ NTSTATUS WINAPI DECLSPEC_HOTPATCH NtQueryDirectoryFile( HANDLE handle, HANDLE ev
 }
 
 
+/* cache of the names of recently searched directories, for case-insensitive lookups */
+
+#define DIR_CACHE_MAX_DIRS 16
+
+struct dir_cache_name
+{
+    struct dir_cache_name *next;   /* next name in the hash chain */
+    int                    len;    /* length of the Unicode name */
+    const char            *name;   /* Unix name */
+    WCHAR                  nameW[1];
+};
+
+struct dir_cache
+{
+    struct list             entry;      /* entry in the most recently used list */
+    dev_t                   dev;        /* device and inode of the directory */
+    ino_t                   ino;
+    time_t                  mtime;      /* modification time when the cache was built */
+    long                    mtime_nsec;
+    unsigned int            count;      /* number of names */
+    unsigned int            hash_size;  /* number of hash buckets, a power of two */
+    struct dir_cache_name **hash;
+};
+
+static struct list dir_cache_list = LIST_INIT( dir_cache_list );
+static unsigned int dir_cache_count;
+static unsigned int dir_cache_hits, dir_cache_misses;
+
+static inline long get_mtime_nsec( const struct stat *st )
+{
+#if defined(HAVE_STRUCT_STAT_ST_MTIM)
+    return st->st_mtim.tv_nsec;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+    return st->st_mtimespec.tv_nsec;
+#else
+    return 0;
+#endif
+}
+
+/* case-insensitive hash compatible with strncmpiW() */
+static unsigned int hash_dir_cache_name( const WCHAR *name, int len )
+{
+    unsigned int hash = 0;
+
+    while (len--) hash = hash * 31 + tolowerW( *name++ );
+    return hash;
+}
+
+static void free_dir_cache( struct dir_cache *cache )
+{
+    struct dir_cache_name *name, *next;
+    unsigned int i;
+
+    for (i = 0; i < cache->hash_size; i++)
+    {
+        for (name = cache->hash[i]; name; name = next)
+        {
+            next = name->next;
+            RtlFreeHeap( GetProcessHeap(), 0, name );
+        }
+    }
+    RtlFreeHeap( GetProcessHeap(), 0, cache->hash );
+    RtlFreeHeap( GetProcessHeap(), 0, cache );
+}
+
+static BOOL add_dir_cache_name( struct dir_cache *cache, const char *unix_name )
+{
+    WCHAR buffer[MAX_DIR_ENTRY_LEN];
+    struct dir_cache_name *name, **hash;
+    unsigned int i, size, unix_len = strlen( unix_name );
+    int len;
+
+    if ((len = ntdll_umbstowcs( 0, unix_name, unix_len, buffer, MAX_DIR_ENTRY_LEN )) <= 0) return TRUE;
+
+    if (cache->count >= cache->hash_size)
+    {
+        size = cache->hash_size ? cache->hash_size * 2 : 64;
+        if (!(hash = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY, size * sizeof(*hash) )))
+            return FALSE;
+        for (i = 0; i < cache->hash_size; i++)
+        {
+            while ((name = cache->hash[i]))
+            {
+                struct dir_cache_name **bucket = &hash[hash_dir_cache_name( name->nameW, name->len ) & (size - 1)];
+                cache->hash[i] = name->next;
+                name->next = *bucket;
+                *bucket = name;
+            }
+        }
+        RtlFreeHeap( GetProcessHeap(), 0, cache->hash );
+        cache->hash = hash;
+        cache->hash_size = size;
+    }
+
+    if (!(name = RtlAllocateHeap( GetProcessHeap(), 0, offsetof( struct dir_cache_name, nameW[len] ) + unix_len + 1 )))
+        return FALSE;
+    name->len = len;
+    memcpy( name->nameW, buffer, len * sizeof(WCHAR) );
+    name->name = (char *)&name->nameW[len];
+    memcpy( (char *)name->name, unix_name, unix_len + 1 );
+    hash = &cache->hash[hash_dir_cache_name( buffer, len ) & (cache->hash_size - 1)];
+    /* keep the readdir order within a chain, the first match wins like in the directory scan */
+    while (*hash) hash = &(*hash)->next;
+    name->next = NULL;
+    *hash = name;
+    cache->count++;
+    return TRUE;
+}
+
+/***********************************************************************
+ *           get_dir_cache
+ *
+ * Get the up to date name cache of a directory, building it if needed.
+ * dir_section must be held by caller.
+ */
+static struct dir_cache *get_dir_cache( const char *unix_name )
+{
+    struct dir_cache *cache;
+    struct dirent *de;
+    struct stat st;
+    DIR *dir;
+
+    if (stat( unix_name, &st ) == -1) return NULL;
+
+    LIST_FOR_EACH_ENTRY( cache, &dir_cache_list, struct dir_cache, entry )
+    {
+        if (cache->dev != st.st_dev || cache->ino != st.st_ino) continue;
+        list_remove( &cache->entry );
+        if (cache->mtime == st.st_mtime && cache->mtime_nsec == get_mtime_nsec( &st ))
+        {
+            dir_cache_hits++;
+            list_add_head( &dir_cache_list, &cache->entry );
+            return cache;
+        }
+        /* the directory changed, rebuild it */
+        free_dir_cache( cache );
+        dir_cache_count--;
+        break;
+    }
+    dir_cache_misses++;
+
+    /* a directory modified within the timestamp granularity could change again unnoticed */
+    if (st.st_mtime >= time( NULL ) - 1) return NULL;
+
+    if (!(cache = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*cache) ))) return NULL;
+    cache->dev = st.st_dev;
+    cache->ino = st.st_ino;
+    cache->mtime = st.st_mtime;
+    cache->mtime_nsec = get_mtime_nsec( &st );
+
+    if (!(dir = opendir( unix_name )))
+    {
+        free_dir_cache( cache );
+        return NULL;
+    }
+    while ((de = readdir( dir )))
+    {
+        if (!add_dir_cache_name( cache, de->d_name ))
+        {
+            closedir( dir );
+            free_dir_cache( cache );
+            return NULL;
+        }
+    }
+    closedir( dir );
+
+    if (dir_cache_count == DIR_CACHE_MAX_DIRS)
+    {
+        struct dir_cache *last = LIST_ENTRY( list_tail( &dir_cache_list ), struct dir_cache, entry );
+        list_remove( &last->entry );
+        free_dir_cache( last );
+        dir_cache_count--;
+    }
+    list_add_head( &dir_cache_list, &cache->entry );
+    dir_cache_count++;
+
+    TRACE( "cached %u names for %s, %u hits %u misses\n",
+           cache->count, debugstr_a(unix_name), dir_cache_hits, dir_cache_misses );
+    return cache;
+}
+
+/***********************************************************************
+ *           find_dir_cache_name
+ *
+ * Find a name in a directory name cache, ignoring case.
+ * dir_section must be held by caller.
+ */
+static const char *find_dir_cache_name( const struct dir_cache *cache, const WCHAR *nameW, int len )
+{
+    const struct dir_cache_name *name;
+
+    if (!cache->hash_size) return NULL;
+    for (name = cache->hash[hash_dir_cache_name( nameW, len ) & (cache->hash_size - 1)]; name; name = name->next)
+        if (name->len == len && !strncmpiW( name->nameW, nameW, len )) return name->name;
+    return NULL;
+}
+
+
 /***********************************************************************
  *           find_file_in_dir
  *
@@ -2044,6 +2242,8 @@ static NTSTATUS find_file_in_dir( char *unix_name, int pos, const WCHAR *name, i
     WCHAR buffer[MAX_DIR_ENTRY_LEN];
     UNICODE_STRING str;
     BOOLEAN spaces, is_name_8_dot_3;
+    struct dir_cache *cache;
+    const char *cached_name;
     DIR *dir;
     struct dirent *de;
     struct stat st;
@@ -2082,6 +2282,27 @@ static NTSTATUS find_file_in_dir( char *unix_name, int pos, const WCHAR *name, i
 
     if (!is_name_8_dot_3 && !get_dir_case_sensitivity( unix_name )) goto not_found;
 
+    /* then look it up in the name cache of the directory */
+
+    RtlEnterCriticalSection( &dir_section );
+    if ((cache = get_dir_cache( unix_name )))
+    {
+        if ((cached_name = find_dir_cache_name( cache, name, length )))
+        {
+            unix_name[pos - 1] = '/';
+            strcpy( unix_name + pos, cached_name );
+            RtlLeaveCriticalSection( &dir_section );
+            goto success;
+        }
+        /* only mangled 8.3 names can still match a short name */
+        if (!is_name_8_dot_3 || !memchrW( name, '~', length ))
+        {
+            RtlLeaveCriticalSection( &dir_section );
+            goto not_found;
+        }
+    }
+    RtlLeaveCriticalSection( &dir_section );
+
     /* now look for it through the directory */
 
 #ifdef VFAT_IOCTL_READDIR_BOTH
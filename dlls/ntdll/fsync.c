@@ -117,6 +117,7 @@ int do_fsync(void)
 struct fsync
 {
     enum fsync_type type;
+    unsigned int serial;    /* serial of the shm slot */
     void *shm;              /* pointer to shm section */
 };
 
@@ -143,10 +144,16 @@ C_ASSERT(sizeof(struct mutex) == 8);
 
 static char shm_name[29];
 static int shm_fd;
-static void **shm_addrs;
-static int shm_addrs_size;  /* length of the allocated shm_addrs array */
 static long pagesize;
 
+/* Pages of the shm section are mapped lazily, the first time a slot in them
+ * is used. The page table is two-level so that it never moves, which lets
+ * lookups of already mapped pages go without taking any lock. */
+#define FSYNC_SHM_BLOCK_SIZE  1024
+#define FSYNC_SHM_BLOCKS      1024
+
+static void **shm_addrs[FSYNC_SHM_BLOCKS];
+
 static RTL_CRITICAL_SECTION shm_addrs_section;
 static RTL_CRITICAL_SECTION_DEBUG shm_addrs_debug =
 {
@@ -156,39 +163,60 @@ static RTL_CRITICAL_SECTION_DEBUG shm_addrs_debug =
 };
 static RTL_CRITICAL_SECTION shm_addrs_section = { &shm_addrs_debug, -1, 0, 0, 0, 0 };
 
-static void *get_shm( unsigned int idx )
+static void *map_shm_page( unsigned int entry )
 {
-    int entry  = (idx * 8) / pagesize;
-    int offset = (idx * 8) % pagesize;
-    void *ret;
+    void **block, *addr;
 
     RtlEnterCriticalSection(&shm_addrs_section);
 
-    if (entry >= shm_addrs_size)
+    if (!(block = shm_addrs[entry / FSYNC_SHM_BLOCK_SIZE]))
     {
-        shm_addrs_size = entry + 1;
-        if (!(shm_addrs = RtlReAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY,
-                shm_addrs, shm_addrs_size * sizeof(shm_addrs[0]) )))
-            ERR("Failed to grow shm_addrs array to size %d.\n", shm_addrs_size);
+        block = wine_anon_mmap( NULL, FSYNC_SHM_BLOCK_SIZE * sizeof(*block), PROT_READ | PROT_WRITE, 0 );
+        if (block == MAP_FAILED)
+        {
+            ERR("Failed to allocate shm page table block for page %u.\n", entry);
+            RtlLeaveCriticalSection(&shm_addrs_section);
+            return NULL;
+        }
+        __atomic_store_n( &shm_addrs[entry / FSYNC_SHM_BLOCK_SIZE], block, __ATOMIC_RELEASE );
     }
 
-    if (!shm_addrs[entry])
+    if (!(addr = block[entry % FSYNC_SHM_BLOCK_SIZE]))
     {
-        void *addr = mmap( NULL, pagesize, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, entry * pagesize );
+        addr = mmap( NULL, pagesize, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, (off_t)entry * pagesize );
         if (addr == (void *)-1)
-            ERR("Failed to map page %d (offset %#lx).\n", entry, entry * pagesize);
+        {
+            ERR("Failed to map page %u (offset %#lx).\n", entry, entry * pagesize);
+            RtlLeaveCriticalSection(&shm_addrs_section);
+            return NULL;
+        }
+
+        TRACE("Mapping page %u at %p.\n", entry, addr);
+        __atomic_store_n( &block[entry % FSYNC_SHM_BLOCK_SIZE], addr, __ATOMIC_RELEASE );
+    }
+
+    RtlLeaveCriticalSection(&shm_addrs_section);
+    return addr;
+}
 
-        TRACE("Mapping page %d at %p.\n", entry, addr);
+static void *get_shm( unsigned int idx )
+{
+    unsigned int entry  = (idx * sizeof(struct fsync_shm_slot)) / pagesize;
+    unsigned int offset = (idx * sizeof(struct fsync_shm_slot)) % pagesize;
+    void **block, *addr = NULL;
 
-        if (__sync_val_compare_and_swap( &shm_addrs[entry], 0, addr ))
-            munmap( addr, pagesize ); /* someone beat us to it */
+    if (entry >= FSYNC_SHM_BLOCK_SIZE * FSYNC_SHM_BLOCKS)
+    {
+        ERR("shm index %u is out of range.\n", idx);
+        return NULL;
     }
 
-    ret = (void *)((unsigned long)shm_addrs[entry] + offset);
+    if ((block = __atomic_load_n( &shm_addrs[entry / FSYNC_SHM_BLOCK_SIZE], __ATOMIC_ACQUIRE )))
+        addr = __atomic_load_n( &block[entry % FSYNC_SHM_BLOCK_SIZE], __ATOMIC_ACQUIRE );
 
-    RtlLeaveCriticalSection(&shm_addrs_section);
+    if (!addr && !(addr = map_shm_page( entry ))) return NULL;
 
-    return ret;
+    return (char *)addr + offset;
 }
 
 /* We'd like lookup to be fast. To that end, we use a static list indexed by handle.
@@ -207,7 +235,7 @@ static inline UINT_PTR handle_to_index( HANDLE handle, UINT_PTR *entry )
     return idx % FSYNC_LIST_BLOCK_SIZE;
 }
 
-static struct fsync *add_to_list( HANDLE handle, enum fsync_type type, void *shm )
+static struct fsync *add_to_list( HANDLE handle, enum fsync_type type, void *shm, unsigned int serial )
 {
     UINT_PTR entry, idx = handle_to_index( handle, &entry );
 
@@ -230,7 +258,10 @@ static struct fsync *add_to_list( HANDLE handle, enum fsync_type type, void *shm
     }
 
     if (!__sync_val_compare_and_swap((int *)&fsync_list[entry][idx].type, 0, type ))
+    {
+        fsync_list[entry][idx].serial = serial;
         fsync_list[entry][idx].shm = shm;
+    }
 
     return &fsync_list[entry][idx];
 }
@@ -245,6 +276,16 @@ static struct fsync *get_cached_object( HANDLE handle )
     return &fsync_list[entry][idx];
 }
 
+/* The server hands the shm slot of a destroyed object to new objects, giving
+ * it a new serial each time. Check that the slot still belongs to the object
+ * we looked up before trusting its state. */
+static inline BOOL is_valid_object( const struct fsync *obj )
+{
+    const struct fsync_shm_slot *slot = obj->shm;
+
+    return __atomic_load_n( &slot->serial, __ATOMIC_SEQ_CST ) == obj->serial;
+}
+
 /* Gets an object. This is either a proper fsync object (i.e. an event,
  * semaphore, etc. created using create_fsync) or a generic synchronizable
  * server-side object which the server will signal (e.g. a process, thread,
@@ -252,10 +293,18 @@ static struct fsync *get_cached_object( HANDLE handle )
 static NTSTATUS get_object( HANDLE handle, struct fsync **obj )
 {
     NTSTATUS ret = STATUS_SUCCESS;
-    unsigned int shm_idx = 0;
+    unsigned int shm_idx = 0, serial = 0;
     enum fsync_type type;
 
-    if ((*obj = get_cached_object( handle ))) return STATUS_SUCCESS;
+    if ((*obj = get_cached_object( handle )))
+    {
+        if (is_valid_object( *obj )) return STATUS_SUCCESS;
+
+        /* The object was destroyed and its slot reused; drop the stale
+         * mapping and ask the server again. */
+        WARN("Cached shm slot for handle %p is stale.\n", handle);
+        fsync_close( handle );
+    }
 
     if ((INT_PTR)handle < 0)
     {
@@ -270,6 +319,7 @@ static NTSTATUS get_object( HANDLE handle, struct fsync **obj )
         if (!(ret = wine_server_call( req )))
         {
             shm_idx = reply->shm_idx;
+            serial  = reply->shm_serial;
             type    = reply->type;
         }
     }
@@ -284,7 +334,7 @@ static NTSTATUS get_object( HANDLE handle, struct fsync **obj )
 
     TRACE("Got shm index %d for handle %p.\n", shm_idx, handle);
 
-    *obj = add_to_list( handle, type, get_shm( shm_idx ) );
+    *obj = add_to_list( handle, type, get_shm( shm_idx ), serial );
     return ret;
 }
 
@@ -309,7 +359,7 @@ static NTSTATUS create_fsync( enum fsync_type type, HANDLE *handle,
     NTSTATUS ret;
     data_size_t len;
     struct object_attributes *objattr;
-    unsigned int shm_idx;
+    unsigned int shm_idx, serial;
 
     if ((ret = alloc_object_attributes( attr, &objattr, &len ))) return ret;
 
@@ -325,6 +375,7 @@ static NTSTATUS create_fsync( enum fsync_type type, HANDLE *handle,
         {
             *handle = wine_server_ptr_handle( reply->handle );
             shm_idx = reply->shm_idx;
+            serial  = reply->shm_serial;
             type    = reply->type;
         }
     }
@@ -332,7 +383,7 @@ static NTSTATUS create_fsync( enum fsync_type type, HANDLE *handle,
 
     if (!ret || ret == STATUS_OBJECT_NAME_EXISTS)
     {
-        add_to_list( *handle, type, get_shm( shm_idx ));
+        add_to_list( *handle, type, get_shm( shm_idx ), serial );
         TRACE("-> handle %p, shm index %d.\n", *handle, shm_idx);
     }
 
@@ -344,7 +395,7 @@ static NTSTATUS open_fsync( enum fsync_type type, HANDLE *handle,
     ACCESS_MASK access, const OBJECT_ATTRIBUTES *attr )
 {
     NTSTATUS ret;
-    unsigned int shm_idx;
+    unsigned int shm_idx, serial;
 
     SERVER_START_REQ( open_fsync )
     {
@@ -359,13 +410,14 @@ static NTSTATUS open_fsync( enum fsync_type type, HANDLE *handle,
             *handle = wine_server_ptr_handle( reply->handle );
             type = reply->type;
             shm_idx = reply->shm_idx;
+            serial = reply->shm_serial;
         }
     }
     SERVER_END_REQ;
 
     if (!ret)
     {
-        add_to_list( *handle, type, get_shm( shm_idx ) );
+        add_to_list( *handle, type, get_shm( shm_idx ), serial );
 
         TRACE("-> handle %p, shm index %u.\n", *handle, shm_idx);
     }
@@ -411,9 +463,6 @@ void fsync_init(void)
     }
 
     pagesize = sysconf( _SC_PAGESIZE );
-
-    shm_addrs = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY, 128 * sizeof(shm_addrs[0]) );
-    shm_addrs_size = 128;
 }
 
 NTSTATUS fsync_create_semaphore( HANDLE *handle, ACCESS_MASK access,
@@ -851,6 +900,13 @@ static NTSTATUS __fsync_wait_objects( DWORD count, const HANDLE *handles,
                         return STATUS_INVALID_HANDLE;
                     }
 
+                    if (!is_valid_object( obj ))
+                    {
+                        /* The object was destroyed and its slot reused while we slept. */
+                        WARN("Handle %p was destroyed while waiting on it.\n", handles[i]);
+                        return STATUS_INVALID_HANDLE;
+                    }
+
                     switch (obj->type)
                     {
                     case FSYNC_SEMAPHORE:
@@ -1093,6 +1149,12 @@ tryagain:
             {
                 struct fsync *obj = objs[i];
 
+                if (obj && !is_valid_object( obj ))
+                {
+                    WARN("Handle %p was destroyed while waiting on it.\n", handles[i]);
+                    return STATUS_INVALID_HANDLE;
+                }
+
                 if (obj && obj->type == FSYNC_MUTEX)
                 {
                     struct mutex *mutex = obj->shm;
@@ -1223,6 +1285,69 @@ userapc:
     return ret;
 }
 
+/* serial bumped by the server whenever hooks change, see __wine_fsync_get_hooks_serial() */
+static int *hooks_serial;
+
+/* The server publishes the wake and changed bits of each message queue in a
+ * status block, so that the owner thread can poll its queue and, once the
+ * server no longer needs to hear about them, do message waits without any
+ * round trip. */
+static struct fsync_queue_status *get_queue_status(void)
+{
+    struct ntdll_thread_data *thread_data = ntdll_get_thread_data();
+    unsigned int idx = 0, hooks_idx = 0;
+
+    if (thread_data->fsync_queue_status) return thread_data->fsync_queue_status;
+
+    SERVER_START_REQ( get_fsync_queue_status )
+    {
+        if (!wine_server_call( req ))
+        {
+            idx = reply->shm_idx;
+            hooks_idx = reply->hooks_idx;
+        }
+    }
+    SERVER_END_REQ;
+
+    if (hooks_idx && !hooks_serial) hooks_serial = &((struct fsync_shm_slot *)get_shm( hooks_idx ))->low;
+    if (idx) thread_data->fsync_queue_status = get_shm( idx );
+    return thread_data->fsync_queue_status;
+}
+
+/* Entry point for user32 to read the current thread's queue bits. */
+BOOL CDECL __wine_fsync_get_queue_bits( DWORD *wake_bits, DWORD *changed_bits )
+{
+    struct fsync_queue_status *status;
+    unsigned int bits;
+
+    if (!do_fsync() || !(status = get_queue_status())) return FALSE;
+
+    bits = __atomic_load_n( &status->bits, __ATOMIC_SEQ_CST );
+    *wake_bits = bits & 0xffff;
+    *changed_bits = bits >> 16;
+    return TRUE;
+}
+
+/* Entry point for user32 to read the serial that the server bumps whenever hooks change. */
+BOOL CDECL __wine_fsync_get_hooks_serial( DWORD *serial )
+{
+    if (!do_fsync() || !get_queue_status() || !hooks_serial) return FALSE;
+
+    *serial = __atomic_load_n( hooks_serial, __ATOMIC_SEQ_CST );
+    return TRUE;
+}
+
+/* Entry point for user32 to read the FSYNC_QUEUE_* flags of the current thread's queue. */
+BOOL CDECL __wine_fsync_get_queue_flags( DWORD *flags )
+{
+    struct fsync_queue_status *status;
+
+    if (!do_fsync() || !(status = get_queue_status())) return FALSE;
+
+    *flags = __atomic_load_n( &status->flags, __ATOMIC_SEQ_CST );
+    return TRUE;
+}
+
 /* Like esync, we need to let the server know when we are doing a message wait,
  * and when we are done with one, so that all of the code surrounding hung
  * queues works, and we also need this for WaitForInputIdle().
@@ -1247,18 +1372,31 @@ static void server_set_msgwait( int in_msgwait )
 NTSTATUS fsync_wait_objects( DWORD count, const HANDLE *handles, BOOLEAN wait_any,
                              BOOLEAN alertable, const LARGE_INTEGER *timeout )
 {
+    struct fsync_queue_status *status = NULL;
     BOOL msgwait = FALSE;
     struct fsync *obj;
     NTSTATUS ret;
 
     if (!get_object( handles[count - 1], &obj ) && obj->type == FSYNC_QUEUE)
     {
-        msgwait = TRUE;
-        server_set_msgwait( 1 );
+        /* The server only needs to take part while it has a driver fd to poll
+         * for us or has yet to set the process idle event. Otherwise just flag
+         * the wait in shared memory for the hung queue detection. */
+        if ((status = get_queue_status()) &&
+            !(__atomic_load_n( &status->flags, __ATOMIC_SEQ_CST ) & FSYNC_QUEUE_SERVER_WAIT))
+            __atomic_or_fetch( &status->flags, FSYNC_QUEUE_IN_MSGWAIT, __ATOMIC_SEQ_CST );
+        else
+        {
+            status = NULL;
+            msgwait = TRUE;
+            server_set_msgwait( 1 );
+        }
     }
 
     ret = __fsync_wait_objects( count, handles, wait_any, alertable, timeout );
 
+    if (status)
+        __atomic_and_fetch( &status->flags, ~FSYNC_QUEUE_IN_MSGWAIT, __ATOMIC_SEQ_CST );
     if (msgwait)
         server_set_msgwait( 0 );
 
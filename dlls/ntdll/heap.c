@@ -47,6 +47,7 @@
 #include "wine/server.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(heap);
+WINE_DECLARE_DEBUG_CHANNEL(heapstats);
 
 /* Note: the heap data structures are loosely based on what Pietrek describes in his
  * book 'Windows 95 System Programming Secrets', with some adaptations for
@@ -146,6 +147,23 @@ typedef struct tagSUBHEAP
 
 #define SUBHEAP_MAGIC    ((DWORD)('S' | ('U'<<8) | ('B'<<16) | ('H'<<24)))
 
+/* usage counters, always maintained; the LFH keeps its own in the bin shards */
+struct heap_stats
+{
+    SIZE_T           used_size;       /* Size of the allocated blocks */
+    SIZE_T           peak_used_size;  /* Highest value of used_size */
+    SIZE_T           large_count;     /* Number of allocated large blocks */
+    SIZE_T           large_size;      /* Size of the allocated large blocks */
+    ULONGLONG        alloc_count;
+    ULONGLONG        free_count;
+    ULONGLONG        realloc_count;
+    ULONGLONG        freelist_hits;   /* Blocks found in the free lists */
+    ULONGLONG        tree_searches;   /* Blocks searched in the free tree */
+    ULONGLONG        subheap_count;   /* Sub-heaps created to grow the heap */
+    ULONGLONG        large_alloc_count;
+    ULONGLONG        histogram[WINE_HEAP_STATS_BUCKETS]; /* Allocations by requested size */
+};
+
 typedef struct tagHEAP
 {
     DWORD_PTR        unknown1[2];
@@ -164,6 +182,8 @@ typedef struct tagHEAP
     struct list     *freeList;      /* Free lists */
     struct wine_rb_tree freeTree;   /* Free tree */
     unsigned long    freeMask[HEAP_NB_FREE_LISTS / (8 * sizeof(unsigned long))];
+    struct tagHEAP_LFH *lfh;        /* Low-fragmentation front end, if enabled */
+    struct heap_stats stats;        /* Usage counters, protected by critSection */
 } HEAP;
 
 #define HEAP_FREEMASK_BLOCK    (8 * sizeof(unsigned long))
@@ -184,6 +204,84 @@ C_ASSERT( HEAP_NB_FREE_LISTS % HEAP_FREEMASK_BLOCK == 0 );
 #define HEAP_VALIDATE_ALL     0x20000000
 #define HEAP_VALIDATE_PARAMS  0x40000000
 
+/* low-fragmentation heap front end */
+
+#define HEAP_LFH_COMPATIBILITY  2          /* HeapCompatibilityInformation value for the LFH */
+#define LFH_MAX_BLOCK_SIZE      0x4000     /* largest block (including tail extra) served by the LFH */
+#define LFH_SMALL_BLOCK_SIZE    0x100      /* blocks up to this size are binned by ALIGNMENT steps */
+#define LFH_SMALL_BIN_COUNT     (LFH_SMALL_BLOCK_SIZE / ALIGNMENT)
+#define LFH_BIN_COUNT           (LFH_SMALL_BIN_COUNT + 24)  /* 4 bins per power of two up to LFH_MAX_BLOCK_SIZE */
+#define LFH_SHARD_COUNT         4          /* per-thread shards of each bin */
+#define LFH_GROUP_MIN_SIZE      0x4000     /* groups are LFH_GROUP_MIN_SIZE << order bytes */
+#define LFH_GROUP_ORDERS        6
+#define LFH_GROUP_MIN_BLOCKS    16         /* minimum number of blocks in a group */
+#define LFH_MAX_REGIONS         16
+#ifdef _WIN64
+#define LFH_REGION_SIZE         0x10000000
+#else
+#define LFH_REGION_SIZE         0x1000000
+#endif
+
+#define ARENA_LFH_MAGIC         0x48464c
+#define ARENA_LFH_FREE_MAGIC    0x65666c
+#define LFH_GROUP_MAGIC         ((DWORD)('L' | ('F'<<8) | ('H'<<16) | ('G'<<24)))
+
+typedef struct
+{
+    struct tagLFH_GROUP *group;     /* Group containing the block */
+    ARENA_INUSE          arena;     /* size is the requested size; must be the last field */
+} ARENA_LFH;
+
+#define LFH_BLOCK_HEADER_SIZE   ((sizeof(ARENA_LFH) + ALIGNMENT - 1) & ~(ALIGNMENT - 1))
+
+typedef struct tagLFH_SHARD
+{
+    RTL_SRWLOCK          lock;      /* Protects the group list and the groups free lists */
+    struct list          groups;    /* Groups with free blocks */
+    SIZE_T               used_size; /* Usage counters, protected by the lock */
+    ULONGLONG            alloc_count;
+    ULONGLONG            free_count;
+    ULONGLONG            realloc_count;
+} LFH_SHARD;
+
+typedef struct tagLFH_GROUP
+{
+    struct list          entry;     /* Entry in shard or free groups list */
+    LFH_SHARD           *shard;     /* Shard owning the group */
+    DWORD                magic;     /* Magic number */
+    DWORD                order;     /* Group size is LFH_GROUP_MIN_SIZE << order */
+    DWORD                stride;    /* Distance between two blocks, including the header */
+    DWORD                count;     /* Number of blocks in the group */
+    DWORD                free_count; /* Number of free blocks */
+    void                *free_list; /* Singly linked list of free blocks */
+} LFH_GROUP;
+
+#define LFH_GROUP_HEADER_SIZE   ((sizeof(LFH_GROUP) + ALIGNMENT - 1) & ~(ALIGNMENT - 1))
+
+typedef struct tagLFH_BIN
+{
+    DWORD                block_size;  /* Usable size of the blocks */
+    DWORD                group_order; /* Order of the groups for this bin */
+    LFH_SHARD            shards[LFH_SHARD_COUNT];
+} LFH_BIN;
+
+typedef struct tagHEAP_LFH
+{
+    RTL_SRWLOCK          lock;      /* Protects the regions and the free groups */
+    int                  region_count; /* Number of reserved regions */
+    struct
+    {
+        char            *base;      /* Base of the reserved region */
+        SIZE_T           used;      /* Size committed and carved into groups */
+    } regions[LFH_MAX_REGIONS];
+    struct list          free_groups[LFH_GROUP_ORDERS];
+    LFH_BIN              bins[LFH_BIN_COUNT];
+} HEAP_LFH;
+
+C_ASSERT( LFH_BLOCK_HEADER_SIZE == ALIGNMENT || LFH_BLOCK_HEADER_SIZE == 2 * ALIGNMENT );
+C_ASSERT( (LFH_GROUP_MIN_SIZE << (LFH_GROUP_ORDERS - 1)) >=
+          LFH_GROUP_HEADER_SIZE + LFH_GROUP_MIN_BLOCKS * (LFH_MAX_BLOCK_SIZE + LFH_BLOCK_HEADER_SIZE) );
+
 static HEAP *processHeap;  /* main process heap */
 
 static BOOL HEAP_IsRealArena( HEAP *heapPtr, DWORD flags, LPCVOID block, BOOL quiet );
@@ -212,6 +310,22 @@ static inline int ctzl(unsigned long x)
 #endif
 }
 
+/* return the statistics histogram bucket for a given allocation size */
+static inline unsigned int stats_bucket( SIZE_T size )
+{
+    unsigned int bucket = 0;
+    for (size >>= 4; size && bucket < WINE_HEAP_STATS_BUCKETS - 1; size >>= 1) bucket++;
+    return bucket;
+}
+
+/* account for a newly allocated block; must be called with the heap lock held */
+static inline void stats_add_used( HEAP *heap, SIZE_T size )
+{
+    heap->stats.used_size += size;
+    if (heap->stats.used_size > heap->stats.peak_used_size)
+        heap->stats.peak_used_size = heap->stats.used_size;
+}
+
 /* mark a block of memory as free for debugging purposes */
 static inline void mark_block_free( void *ptr, SIZE_T size, DWORD flags )
 {
@@ -815,6 +929,10 @@ static void *allocate_large_block( HEAP *heap, DWORD flags, SIZE_T size )
     arena->magic = ARENA_LARGE_MAGIC;
     mark_block_tail( (char *)(arena + 1) + size, block_size - sizeof(*arena) - size, flags );
     list_add_tail( &heap->large_list, &arena->entry );
+    heap->stats.large_alloc_count++;
+    heap->stats.large_count++;
+    heap->stats.large_size += block_size;
+    stats_add_used( heap, block_size );
     notify_alloc( arena + 1, size, flags & HEAP_ZERO_MEMORY );
     return arena + 1;
 }
@@ -830,6 +948,9 @@ static void free_large_block( HEAP *heap, DWORD flags, void *ptr )
     SIZE_T size = 0;
 
     list_remove( &arena->entry );
+    heap->stats.large_count--;
+    heap->stats.large_size -= arena->block_size;
+    heap->stats.used_size -= arena->block_size;
     NtFreeVirtualMemory( NtCurrentProcess(), &address, &size, MEM_RELEASE );
 }
 
@@ -946,6 +1067,415 @@ static BOOL validate_large_arena( HEAP *heap, const ARENA_LARGE *arena, BOOL qui
 }
 
 
+/***********************************************************************
+ *           lfh_bin_index
+ *
+ * Return the LFH bin for a given block size (including tail extra).
+ */
+static inline SIZE_T lfh_bin_index( SIZE_T size )
+{
+    unsigned int shift = 8;
+
+    if (size <= LFH_SMALL_BLOCK_SIZE) return (size ? size - 1 : 0) / ALIGNMENT;
+    while ((size - 1) >> (shift + 1)) shift++;
+    return LFH_SMALL_BIN_COUNT + (shift - 8) * 4 + ((size - 1) >> (shift - 2)) - 4;
+}
+
+
+/***********************************************************************
+ *           lfh_bin_size
+ *
+ * Return the usable block size of a given LFH bin.
+ */
+static inline DWORD lfh_bin_size( SIZE_T index )
+{
+    if (index < LFH_SMALL_BIN_COUNT) return (index + 1) * ALIGNMENT;
+    index -= LFH_SMALL_BIN_COUNT;
+    return (5 + index % 4) << (6 + index / 4);
+}
+
+
+/***********************************************************************
+ *           lfh_get_shard
+ *
+ * Threads are spread over the bin shards according to their id.
+ */
+static inline LFH_SHARD *lfh_get_shard( LFH_BIN *bin )
+{
+    ULONG tid = HandleToULong( NtCurrentTeb()->ClientId.UniqueThread );
+    return &bin->shards[(tid >> 2) % LFH_SHARD_COUNT];
+}
+
+
+/***********************************************************************
+ *           lfh_find_region
+ *
+ * Return the base of the LFH region containing ptr, or NULL.
+ */
+static char *lfh_find_region( const HEAP_LFH *lfh, const void *ptr )
+{
+    int i, count = lfh->region_count;
+
+    for (i = 0; i < count; i++)
+    {
+        char *base = lfh->regions[i].base;
+        if ((const char *)ptr >= base && (const char *)ptr < base + lfh->regions[i].used) return base;
+    }
+    return NULL;
+}
+
+
+/***********************************************************************
+ *           lfh_alloc_group
+ *
+ * Get the memory for a new group, either from the free groups or from
+ * the LFH regions.
+ */
+static LFH_GROUP *lfh_alloc_group( HEAP *heap, DWORD order )
+{
+    HEAP_LFH *lfh = heap->lfh;
+    LFH_GROUP *group = NULL;
+    SIZE_T size = LFH_GROUP_MIN_SIZE << order;
+    struct list *ptr;
+    void *addr;
+    int i;
+
+    RtlAcquireSRWLockExclusive( &lfh->lock );
+
+    if ((ptr = list_head( &lfh->free_groups[order] )))
+    {
+        list_remove( ptr );
+        group = LIST_ENTRY( ptr, LFH_GROUP, entry );
+        goto done;
+    }
+
+    i = lfh->region_count - 1;
+    if (i < 0 || lfh->regions[i].used + size > LFH_REGION_SIZE)
+    {
+        SIZE_T region_size = LFH_REGION_SIZE;
+
+        if (++i == LFH_MAX_REGIONS) goto done;
+        addr = NULL;
+        if (NtAllocateVirtualMemory( NtCurrentProcess(), &addr, 0, &region_size,
+                                     MEM_RESERVE, get_protection_type( heap->flags ) ))
+        {
+            WARN( "Could not reserve %08lx bytes for LFH of heap %p\n", region_size, heap );
+            goto done;
+        }
+        lfh->regions[i].base = addr;
+        lfh->regions[i].used = 0;
+        interlocked_xchg_add( &lfh->region_count, 1 );
+    }
+
+    addr = lfh->regions[i].base + lfh->regions[i].used;
+    if (NtAllocateVirtualMemory( NtCurrentProcess(), &addr, 0, &size,
+                                 MEM_COMMIT, get_protection_type( heap->flags ) ))
+    {
+        WARN( "Could not commit %08lx bytes at %p for LFH of heap %p\n", size, addr, heap );
+        goto done;
+    }
+    lfh->regions[i].used += size;
+    group = addr;
+
+done:
+    RtlReleaseSRWLockExclusive( &lfh->lock );
+    return group;
+}
+
+
+/***********************************************************************
+ *           lfh_create_group
+ *
+ * Create a new group for a bin shard. Must be called with the shard lock held.
+ */
+static LFH_GROUP *lfh_create_group( HEAP *heap, LFH_BIN *bin, LFH_SHARD *shard )
+{
+    LFH_GROUP *group;
+    char *ptr;
+    DWORD i;
+
+    if (!(group = lfh_alloc_group( heap, bin->group_order ))) return NULL;
+
+    group->shard      = shard;
+    group->magic      = LFH_GROUP_MAGIC;
+    group->order      = bin->group_order;
+    group->stride     = bin->block_size + LFH_BLOCK_HEADER_SIZE;
+    group->count      = ((LFH_GROUP_MIN_SIZE << group->order) - LFH_GROUP_HEADER_SIZE) / group->stride;
+    group->free_count = group->count;
+    group->free_list  = NULL;
+
+    /* build the free list so that the lowest addresses are used first */
+    ptr = (char *)group + LFH_GROUP_HEADER_SIZE + group->count * group->stride + LFH_BLOCK_HEADER_SIZE;
+    for (i = 0; i < group->count; i++)
+    {
+        ARENA_LFH *arena;
+
+        ptr -= group->stride;
+        arena = (ARENA_LFH *)ptr - 1;
+        arena->group = group;
+        arena->arena.size = 0;
+        arena->arena.magic = ARENA_LFH_FREE_MAGIC;
+        arena->arena.unused_bytes = 0;
+        *(void **)ptr = group->free_list;
+        group->free_list = ptr;
+    }
+
+    TRACE( "created LFH group %p with %u blocks of %u bytes for heap %p\n",
+           group, group->count, bin->block_size, heap );
+    return group;
+}
+
+
+/***********************************************************************
+ *           lfh_release_group
+ *
+ * Give a completely free group back to the LFH for reuse by any bin.
+ */
+static void lfh_release_group( HEAP_LFH *lfh, LFH_GROUP *group )
+{
+    group->magic = 0;
+    group->shard = NULL;
+    RtlAcquireSRWLockExclusive( &lfh->lock );
+    list_add_head( &lfh->free_groups[group->order], &group->entry );
+    RtlReleaseSRWLockExclusive( &lfh->lock );
+}
+
+
+/***********************************************************************
+ *           lfh_find_block
+ *
+ * Check whether a pointer belongs to the LFH. If it does, *ret is set
+ * to the block arena, or NULL if the pointer isn't a valid LFH block.
+ */
+static BOOL lfh_find_block( const HEAP *heap, const void *ptr, ARENA_LFH **ret )
+{
+    const LFH_GROUP *group;
+    ARENA_LFH *arena;
+    SIZE_T offset;
+    char *base;
+
+    if (!heap->lfh || !(base = lfh_find_region( heap->lfh, ptr ))) return FALSE;
+
+    *ret = NULL;
+    if ((ULONG_PTR)ptr % ALIGNMENT || (const char *)ptr - base < LFH_GROUP_HEADER_SIZE + LFH_BLOCK_HEADER_SIZE)
+    {
+        WARN( "Heap %p: invalid LFH block pointer %p\n", heap, ptr );
+        return TRUE;
+    }
+    arena = (ARENA_LFH *)ptr - 1;
+    group = arena->group;
+    if ((const char *)group < base || (const char *)group >= (const char *)ptr ||
+        ((const char *)group - base) % LFH_GROUP_MIN_SIZE || group->magic != LFH_GROUP_MAGIC)
+    {
+        WARN( "Heap %p: invalid LFH group %p for block %p\n", heap, group, ptr );
+        return TRUE;
+    }
+    offset = (const char *)ptr - (const char *)group - LFH_GROUP_HEADER_SIZE - LFH_BLOCK_HEADER_SIZE;
+    if (offset % group->stride || offset / group->stride >= group->count)
+        WARN( "Heap %p: pointer %p is not a block of LFH group %p\n", heap, ptr, group );
+    else if (arena->arena.magic == ARENA_LFH_FREE_MAGIC)
+        WARN( "Heap %p: block %p used after free\n", heap, ptr );
+    else if (arena->arena.magic != ARENA_LFH_MAGIC)
+        WARN( "Heap %p: invalid LFH arena magic %08x for %p\n", heap, arena->arena.magic, arena );
+    else
+        *ret = arena;
+    return TRUE;
+}
+
+
+/***********************************************************************
+ *           lfh_allocate
+ *
+ * Allocate a block from the LFH. Returns NULL if the LFH can't provide
+ * it, in which case the regular heap is used instead.
+ */
+static void *lfh_allocate( HEAP *heap, DWORD flags, SIZE_T size )
+{
+    LFH_BIN *bin = &heap->lfh->bins[lfh_bin_index( size + HEAP_TAIL_EXTRA_SIZE )];
+    LFH_SHARD *shard = lfh_get_shard( bin );
+    LFH_GROUP *group;
+    ARENA_LFH *arena;
+    struct list *entry;
+    void *ptr;
+
+    RtlAcquireSRWLockExclusive( &shard->lock );
+
+    if ((entry = list_head( &shard->groups ))) group = LIST_ENTRY( entry, LFH_GROUP, entry );
+    else if ((group = lfh_create_group( heap, bin, shard ))) list_add_head( &shard->groups, &group->entry );
+    else
+    {
+        RtlReleaseSRWLockExclusive( &shard->lock );
+        return NULL;
+    }
+
+    ptr = group->free_list;
+    group->free_list = *(void **)ptr;
+    if (!--group->free_count) list_remove( &group->entry );
+
+    arena = (ARENA_LFH *)ptr - 1;
+    arena->arena.size = size;
+    arena->arena.magic = ARENA_LFH_MAGIC;
+    arena->arena.unused_bytes = 0;
+    shard->alloc_count++;
+    shard->used_size += bin->block_size;
+
+    RtlReleaseSRWLockExclusive( &shard->lock );
+
+    notify_alloc( ptr, size, flags & HEAP_ZERO_MEMORY );
+    initialize_block( ptr, size, 0, flags );
+    return ptr;
+}
+
+
+/***********************************************************************
+ *           lfh_free
+ */
+static BOOL lfh_free( HEAP *heap, ARENA_LFH *arena )
+{
+    LFH_GROUP *group = arena->group;
+    LFH_SHARD *shard = group->shard;
+    void *ptr = arena + 1;
+    BOOL release = FALSE;
+
+    RtlAcquireSRWLockExclusive( &shard->lock );
+
+    /* check again with the lock held, in case of concurrent double free */
+    if (arena->arena.magic != ARENA_LFH_MAGIC)
+    {
+        RtlReleaseSRWLockExclusive( &shard->lock );
+        WARN( "Heap %p: block %p used after free\n", heap, ptr );
+        return FALSE;
+    }
+
+    arena->arena.magic = ARENA_LFH_FREE_MAGIC;
+    *(void **)ptr = group->free_list;
+    group->free_list = ptr;
+    shard->free_count++;
+    shard->used_size -= group->stride - LFH_BLOCK_HEADER_SIZE;
+
+    if (!group->free_count++) list_add_tail( &shard->groups, &group->entry );
+    else if (group->free_count == group->count && list_head( &shard->groups ) != list_tail( &shard->groups ))
+    {
+        /* keep the last group of the shard, but release the other empty ones */
+        list_remove( &group->entry );
+        release = TRUE;
+    }
+
+    RtlReleaseSRWLockExclusive( &shard->lock );
+
+    if (release) lfh_release_group( heap->lfh, group );
+    return TRUE;
+}
+
+
+/***********************************************************************
+ *           lfh_realloc
+ */
+static void *lfh_realloc( HEAP *heap, DWORD flags, ARENA_LFH *arena, SIZE_T size )
+{
+    LFH_SHARD *shard = arena->group->shard;
+    SIZE_T old_size = arena->arena.size;
+    void *ptr = arena + 1, *new_ptr;
+
+    if (size + HEAP_TAIL_EXTRA_SIZE >= size &&
+        size + HEAP_TAIL_EXTRA_SIZE <= arena->group->stride - LFH_BLOCK_HEADER_SIZE)
+    {
+        notify_realloc( ptr, old_size, size );
+        if (size > old_size) initialize_block( (char *)ptr + old_size, size - old_size, 0, flags );
+        arena->arena.size = size;
+        new_ptr = ptr;
+    }
+    else
+    {
+        if (flags & HEAP_REALLOC_IN_PLACE_ONLY) return NULL;
+        if (!(new_ptr = RtlAllocateHeap( heap, flags & HEAP_ZERO_MEMORY, size ))) return NULL;
+        memcpy( new_ptr, ptr, min( old_size, size ));
+        notify_free( ptr );
+        lfh_free( heap, arena );
+    }
+
+    RtlAcquireSRWLockExclusive( &shard->lock );
+    shard->realloc_count++;
+    RtlReleaseSRWLockExclusive( &shard->lock );
+    return new_ptr;
+}
+
+
+/***********************************************************************
+ *           heap_enable_lfh
+ */
+static NTSTATUS heap_enable_lfh( HEAP *heap )
+{
+    HEAP_LFH *lfh = NULL;
+    SIZE_T i, j, size = sizeof(*lfh);
+
+    if (heap->lfh) return STATUS_SUCCESS;
+
+    /* like on Windows, the LFH is not available for serialized, fixed-size or debug heaps */
+    if (!(heap->flags & HEAP_GROWABLE) || RUNNING_ON_VALGRIND ||
+        (heap->flags & (HEAP_NO_SERIALIZE | HEAP_SHARED | HEAP_VALIDATE | HEAP_PAGE_ALLOCS |
+                        HEAP_TAIL_CHECKING_ENABLED | HEAP_FREE_CHECKING_ENABLED)))
+    {
+        WARN( "Heap %p: can't enable LFH with flags %08x\n", heap, heap->flags );
+        return STATUS_UNSUCCESSFUL;
+    }
+
+    if (NtAllocateVirtualMemory( NtCurrentProcess(), (void **)&lfh, 0, &size,
+                                 MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE ))
+        return STATUS_NO_MEMORY;
+
+    RtlInitializeSRWLock( &lfh->lock );
+    for (i = 0; i < LFH_GROUP_ORDERS; i++) list_init( &lfh->free_groups[i] );
+    for (i = 0; i < LFH_BIN_COUNT; i++)
+    {
+        LFH_BIN *bin = &lfh->bins[i];
+        SIZE_T stride;
+
+        bin->block_size = lfh_bin_size( i );
+        stride = bin->block_size + LFH_BLOCK_HEADER_SIZE;
+        bin->group_order = 0;
+        while ((LFH_GROUP_MIN_SIZE << bin->group_order) - LFH_GROUP_HEADER_SIZE < LFH_GROUP_MIN_BLOCKS * stride)
+            bin->group_order++;
+        for (j = 0; j < LFH_SHARD_COUNT; j++)
+        {
+            RtlInitializeSRWLock( &bin->shards[j].lock );
+            list_init( &bin->shards[j].groups );
+        }
+    }
+
+    if (interlocked_cmpxchg_ptr( (void **)&heap->lfh, lfh, NULL ))
+    {
+        size = 0;
+        NtFreeVirtualMemory( NtCurrentProcess(), (void **)&lfh, &size, MEM_RELEASE );
+    }
+    TRACE( "enabled LFH for heap %p\n", heap );
+    return STATUS_SUCCESS;
+}
+
+
+/***********************************************************************
+ *           heap_destroy_lfh
+ */
+static void heap_destroy_lfh( HEAP *heap )
+{
+    HEAP_LFH *lfh = heap->lfh;
+    SIZE_T size;
+    void *addr;
+    int i;
+
+    for (i = 0; i < lfh->region_count; i++)
+    {
+        size = 0;
+        addr = lfh->regions[i].base;
+        NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
+    }
+    size = 0;
+    addr = lfh;
+    NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
+    heap->lfh = NULL;
+}
+
+
 static inline int arena_free_compare( const void *key, const struct wine_rb_entry *entry )
 {
     DWORD arena_size = get_arena_size( entry );
@@ -1132,6 +1662,7 @@ static ARENA_FREE *HEAP_FindFreeBlock( HEAP *heap, SIZE_T size,
         {
             index = (index & ~(HEAP_FREEMASK_BLOCK - 1)) | ctzl( mask );
             arena = LIST_ENTRY( heap->freeList[index].next, ARENA_FREE, entry.list );
+            heap->stats.freelist_hits++;
             subheap = HEAP_FindSubHeap( heap, arena );
             if (!HEAP_Commit( subheap, (ARENA_INUSE *)arena, size )) return NULL;
             *ppSubHeap = subheap;
@@ -1142,6 +1673,7 @@ static ARENA_FREE *HEAP_FindFreeBlock( HEAP *heap, SIZE_T size,
 
     /* Find a suitable block from the free tree */
 
+    heap->stats.tree_searches++;
     if ((ptr = find_free_block( heap->freeTree.root, size + sizeof(ARENA_INUSE) - sizeof(ARENA_FREE) )))
     {
         arena = WINE_RB_ENTRY_VALUE( ptr, ARENA_FREE, entry.tree );
@@ -1181,6 +1713,7 @@ static ARENA_FREE *HEAP_FindFreeBlock( HEAP *heap, SIZE_T size,
 
     TRACE("created new sub-heap %p of %08lx bytes for heap %p\n",
           subheap, subheap->size, heap );
+    heap->stats.subheap_count++;
 
     *ppSubHeap = subheap;
     return (ARENA_FREE *)((char *)subheap->base + subheap->headerSize);
@@ -1753,6 +2286,8 @@ HANDLE WINAPI RtlDestroyHeap( HANDLE heap )
     heapPtr->critSection.DebugInfo->Spare[0] = 0;
     RtlDeleteCriticalSection( &heapPtr->critSection );
 
+    if (heapPtr->lfh) heap_destroy_lfh( heapPtr );
+
     LIST_FOR_EACH_ENTRY_SAFE( arena, arena_next, &heapPtr->large_list, ARENA_LARGE, entry )
     {
         list_remove( &arena->entry );
@@ -1821,11 +2356,26 @@ void * WINAPI DECLSPEC_HOTPATCH RtlAllocateHeap( HANDLE heap, ULONG flags, SIZE_
     }
     if (rounded_size < HEAP_MIN_DATA_SIZE) rounded_size = HEAP_MIN_DATA_SIZE;
 
+    if (heapPtr->lfh && size + HEAP_TAIL_EXTRA_SIZE <= LFH_MAX_BLOCK_SIZE)
+    {
+        void *ret = lfh_allocate( heapPtr, flags, size );
+        if (ret)
+        {
+            TRACE("(%p,%08x,%08lx): returning %p\n", heap, flags, size, ret );
+            return ret;
+        }
+    }
+
     if (!(flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
 
     if (rounded_size >= HEAP_MIN_LARGE_BLOCK_SIZE && (flags & HEAP_GROWABLE))
     {
         void *ret = allocate_large_block( heap, flags, size );
+        if (ret)
+        {
+            heapPtr->stats.alloc_count++;
+            heapPtr->stats.histogram[stats_bucket( size )]++;
+        }
         if (!(flags & HEAP_NO_SERIALIZE)) RtlLeaveCriticalSection( &heapPtr->critSection );
         if (!ret && (flags & HEAP_GENERATE_EXCEPTIONS)) RtlRaiseStatus( STATUS_NO_MEMORY );
         TRACE("(%p,%08x,%08lx): returning %p\n", heap, flags, size, ret );
@@ -1860,6 +2410,9 @@ void * WINAPI DECLSPEC_HOTPATCH RtlAllocateHeap( HANDLE heap, ULONG flags, SIZE_
 
     HEAP_ShrinkBlock( subheap, pInUse, rounded_size );
     pInUse->unused_bytes = (pInUse->size & ARENA_SIZE_MASK) - size;
+    stats_add_used( heapPtr, pInUse->size & ARENA_SIZE_MASK );
+    heapPtr->stats.alloc_count++;
+    heapPtr->stats.histogram[stats_bucket( size )]++;
 
     notify_alloc( pInUse + 1, size, flags & HEAP_ZERO_MEMORY );
     initialize_block( pInUse + 1, size, pInUse->unused_bytes, flags );
@@ -1888,6 +2441,7 @@ void * WINAPI DECLSPEC_HOTPATCH RtlAllocateHeap( HANDLE heap, ULONG flags, SIZE_
 BOOLEAN WINAPI DECLSPEC_HOTPATCH RtlFreeHeap( HANDLE heap, ULONG flags, void *ptr )
 {
     ARENA_INUSE *pInUse;
+    ARENA_LFH *lfh_arena;
     SUBHEAP *subheap;
     HEAP *heapPtr;
 
@@ -1904,6 +2458,19 @@ BOOLEAN WINAPI DECLSPEC_HOTPATCH RtlFreeHeap( HANDLE heap, ULONG flags, void *pt
 
     flags &= HEAP_NO_SERIALIZE;
     flags |= heapPtr->flags;
+
+    if (lfh_find_block( heapPtr, ptr, &lfh_arena ))
+    {
+        if (!lfh_arena || !lfh_free( heapPtr, lfh_arena ))
+        {
+            RtlSetLastWin32ErrorAndNtStatusFromNtStatus( STATUS_INVALID_PARAMETER );
+            TRACE("(%p,%08x,%p): returning FALSE\n", heap, flags, ptr );
+            return FALSE;
+        }
+        TRACE("(%p,%08x,%p): returning TRUE\n", heap, flags, ptr );
+        return TRUE;
+    }
+
     if (!(flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
 
     /* Inform valgrind we are trying to free memory, so it can throw up an error message */
@@ -1913,10 +2480,14 @@ BOOLEAN WINAPI DECLSPEC_HOTPATCH RtlFreeHeap( HANDLE heap, ULONG flags, void *pt
     pInUse  = (ARENA_INUSE *)ptr - 1;
     if (!validate_block_pointer( heapPtr, &subheap, pInUse )) goto error;
 
+    heapPtr->stats.free_count++;
     if (!subheap)
         free_large_block( heapPtr, flags, ptr );
     else
+    {
+        heapPtr->stats.used_size -= pInUse->size & ARENA_SIZE_MASK;
         HEAP_MakeInUseBlockFree( subheap, pInUse );
+    }
 
     if (!(flags & HEAP_NO_SERIALIZE)) RtlLeaveCriticalSection( &heapPtr->critSection );
     TRACE("(%p,%08x,%p): returning TRUE\n", heap, flags, ptr );
@@ -1948,6 +2519,7 @@ error:
 PVOID WINAPI RtlReAllocateHeap( HANDLE heap, ULONG flags, PVOID ptr, SIZE_T size )
 {
     ARENA_INUSE *pArena;
+    ARENA_LFH *lfh_arena;
     HEAP *heapPtr;
     SUBHEAP *subheap;
     SIZE_T oldBlockSize, oldActualSize, rounded_size;
@@ -1965,6 +2537,24 @@ PVOID WINAPI RtlReAllocateHeap( HANDLE heap, ULONG flags, PVOID ptr, SIZE_T size
     flags &= HEAP_GENERATE_EXCEPTIONS | HEAP_NO_SERIALIZE | HEAP_ZERO_MEMORY |
              HEAP_REALLOC_IN_PLACE_ONLY;
     flags |= heapPtr->flags;
+
+    if (lfh_find_block( heapPtr, ptr, &lfh_arena ))
+    {
+        if (!lfh_arena)
+        {
+            RtlSetLastWin32ErrorAndNtStatusFromNtStatus( STATUS_INVALID_PARAMETER );
+            TRACE("(%p,%08x,%p,%08lx): returning NULL\n", heap, flags, ptr, size );
+            return NULL;
+        }
+        if (!(ret = lfh_realloc( heapPtr, flags, lfh_arena, size )))
+        {
+            if (flags & HEAP_GENERATE_EXCEPTIONS) RtlRaiseStatus( STATUS_NO_MEMORY );
+            RtlSetLastWin32ErrorAndNtStatusFromNtStatus( STATUS_NO_MEMORY );
+        }
+        TRACE("(%p,%08x,%p,%08lx): returning %p\n", heap, flags, ptr, size, ret );
+        return ret;
+    }
+
     if (!(flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
 
     rounded_size = ROUND_SIZE(size) + HEAP_TAIL_EXTRA_SIZE;
@@ -1994,6 +2584,7 @@ PVOID WINAPI RtlReAllocateHeap( HANDLE heap, ULONG flags, PVOID ptr, SIZE_T size
             memcpy( ret, pArena + 1, oldActualSize );
             notify_free( pArena + 1 );
             HEAP_MakeInUseBlockFree( subheap, pArena );
+            heapPtr->stats.used_size -= oldBlockSize;
             goto done;
         }
         if ((pNext < (char *)subheap->base + subheap->size) &&
@@ -2046,6 +2637,8 @@ PVOID WINAPI RtlReAllocateHeap( HANDLE heap, ULONG flags, PVOID ptr, SIZE_T size
     }
 
     pArena->unused_bytes = (pArena->size & ARENA_SIZE_MASK) - size;
+    heapPtr->stats.used_size -= oldBlockSize;
+    stats_add_used( heapPtr, pArena->size & ARENA_SIZE_MASK );
 
     /* Clear the extra bytes if needed */
 
@@ -2059,6 +2652,7 @@ PVOID WINAPI RtlReAllocateHeap( HANDLE heap, ULONG flags, PVOID ptr, SIZE_T size
 
     ret = pArena + 1;
 done:
+    heapPtr->stats.realloc_count++;
     if (!(flags & HEAP_NO_SERIALIZE)) RtlLeaveCriticalSection( &heapPtr->critSection );
     TRACE("(%p,%08x,%p,%08lx): returning %p\n", heap, flags, ptr, size, ret );
     return ret;
@@ -2164,6 +2758,7 @@ SIZE_T WINAPI RtlSizeHeap( HANDLE heap, ULONG flags, const void *ptr )
 {
     SIZE_T ret;
     const ARENA_INUSE *pArena;
+    ARENA_LFH *lfh_arena;
     SUBHEAP *subheap;
     HEAP *heapPtr = HEAP_GetPtr( heap );
 
@@ -2174,6 +2769,19 @@ SIZE_T WINAPI RtlSizeHeap( HANDLE heap, ULONG flags, const void *ptr )
     }
     flags &= HEAP_NO_SERIALIZE;
     flags |= heapPtr->flags;
+
+    if (lfh_find_block( heapPtr, ptr, &lfh_arena ))
+    {
+        if (lfh_arena) ret = lfh_arena->arena.size;
+        else
+        {
+            RtlSetLastWin32ErrorAndNtStatusFromNtStatus( STATUS_INVALID_PARAMETER );
+            ret = ~0UL;
+        }
+        TRACE("(%p,%08x,%p): returning %08lx\n", heap, flags, ptr, ret );
+        return ret;
+    }
+
     if (!(flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
 
     pArena = (const ARENA_INUSE *)ptr - 1;
@@ -2215,7 +2823,10 @@ SIZE_T WINAPI RtlSizeHeap( HANDLE heap, ULONG flags, const void *ptr )
 BOOLEAN WINAPI RtlValidateHeap( HANDLE heap, ULONG flags, LPCVOID ptr )
 {
     HEAP *heapPtr = HEAP_GetPtr( heap );
+    ARENA_LFH *lfh_arena;
+
     if (!heapPtr) return FALSE;
+    if (ptr && lfh_find_block( heapPtr, ptr, &lfh_arena )) return lfh_arena != NULL;
     return HEAP_IsRealArena( heapPtr, flags, ptr, QUIET );
 }
 
@@ -2240,7 +2851,7 @@ NTSTATUS WINAPI RtlWalkHeap( HANDLE heap, PVOID entry_ptr )
 
     if (!(heapPtr->flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
 
-    /* FIXME: enumerate large blocks too */
+    /* FIXME: enumerate large blocks and LFH blocks too */
 
     /* set ptr to the next arena to be examined */
 
@@ -2378,13 +2989,122 @@ ULONG WINAPI RtlGetProcessHeaps( ULONG count, HANDLE *heaps )
     return total;
 }
 
+/***********************************************************************
+ *           heap_get_statistics
+ */
+static void heap_get_statistics( HEAP *heap, WINE_HEAP_STATISTICS *info )
+{
+    SUBHEAP *subheap;
+    SIZE_T i, j;
+
+    memset( info, 0, sizeof(*info) );
+
+    if (!(heap->flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heap->critSection );
+
+    LIST_FOR_EACH_ENTRY( subheap, &heap->subheap_list, SUBHEAP, entry )
+        info->CommittedBytes += subheap->commitSize;
+    info->CommittedBytes     += heap->stats.large_size;
+    info->UsedBytes           = heap->stats.used_size;
+    info->PeakUsedBytes       = heap->stats.peak_used_size;
+    info->LargeBlockCount     = heap->stats.large_count;
+    info->LargeBlockBytes     = heap->stats.large_size;
+    info->AllocCount          = heap->stats.alloc_count;
+    info->FreeCount           = heap->stats.free_count;
+    info->ReAllocCount        = heap->stats.realloc_count;
+    info->FreeListHits        = heap->stats.freelist_hits;
+    info->FreeTreeSearches    = heap->stats.tree_searches;
+    info->SubHeapCount        = heap->stats.subheap_count;
+    info->LargeAllocCount     = heap->stats.large_alloc_count;
+    if (heap->critSection.DebugInfo) info->LockContentionCount = heap->critSection.DebugInfo->ContentionCount;
+    memcpy( info->SizeHistogram, heap->stats.histogram, sizeof(info->SizeHistogram) );
+
+    if (!(heap->flags & HEAP_NO_SERIALIZE)) RtlLeaveCriticalSection( &heap->critSection );
+
+    if (!heap->lfh) return;
+
+    RtlAcquireSRWLockShared( &heap->lfh->lock );
+    for (i = 0; i < heap->lfh->region_count; i++) info->CommittedBytes += heap->lfh->regions[i].used;
+    RtlReleaseSRWLockShared( &heap->lfh->lock );
+
+    for (i = 0; i < LFH_BIN_COUNT; i++)
+    {
+        LFH_BIN *bin = &heap->lfh->bins[i];
+        /* LFH allocations are accounted by bin, using the largest size of the bin */
+        unsigned int bucket = stats_bucket( bin->block_size - HEAP_TAIL_EXTRA_SIZE );
+
+        for (j = 0; j < LFH_SHARD_COUNT; j++)
+        {
+            LFH_SHARD *shard = &bin->shards[j];
+
+            RtlAcquireSRWLockShared( &shard->lock );
+            info->UsedBytes += shard->used_size;
+            info->AllocCount += shard->alloc_count;
+            info->FreeCount += shard->free_count;
+            info->LfhAllocCount += shard->alloc_count;
+            info->LfhFreeCount += shard->free_count;
+            info->ReAllocCount += shard->realloc_count;
+            info->SizeHistogram[bucket] += shard->alloc_count;
+            RtlReleaseSRWLockShared( &shard->lock );
+        }
+    }
+}
+
+
+/***********************************************************************
+ *           heap_dump_statistics
+ *
+ * Dump the usage counters of all the process heaps to the heapstats
+ * debug channel, typically at process exit.
+ */
+void heap_dump_statistics(void)
+{
+    WINE_HEAP_STATISTICS info;
+    HANDLE heaps[64];
+    ULONG i, j, count;
+
+    if (!TRACE_ON(heapstats) || !processHeap) return;
+
+    count = min( RtlGetProcessHeaps( ARRAY_SIZE(heaps), heaps ), ARRAY_SIZE(heaps) );
+    for (i = 0; i < count; i++)
+    {
+        HEAP *heap = heaps[i];
+
+        heap_get_statistics( heap, &info );
+        TRACE_(heapstats)( "heap %p%s: committed %lu used %lu peak %lu%s\n", heap,
+                           heap == processHeap ? " (process heap)" : "", info.CommittedBytes,
+                           info.UsedBytes, info.PeakUsedBytes, heap->lfh ? " LFH" : "" );
+        TRACE_(heapstats)( "heap %p: alloc %s free %s realloc %s lfh alloc %s free %s\n", heap,
+                           wine_dbgstr_longlong(info.AllocCount), wine_dbgstr_longlong(info.FreeCount),
+                           wine_dbgstr_longlong(info.ReAllocCount), wine_dbgstr_longlong(info.LfhAllocCount),
+                           wine_dbgstr_longlong(info.LfhFreeCount) );
+        TRACE_(heapstats)( "heap %p: free list hits %s tree searches %s sub-heaps %s lock contention %u\n", heap,
+                           wine_dbgstr_longlong(info.FreeListHits), wine_dbgstr_longlong(info.FreeTreeSearches),
+                           wine_dbgstr_longlong(info.SubHeapCount), info.LockContentionCount );
+        TRACE_(heapstats)( "heap %p: large blocks %s allocated, %lu live using %lu bytes\n", heap,
+                           wine_dbgstr_longlong(info.LargeAllocCount), info.LargeBlockCount, info.LargeBlockBytes );
+        for (j = 0; j < WINE_HEAP_STATS_BUCKETS; j++)
+        {
+            if (!info.SizeHistogram[j]) continue;
+            if (j == WINE_HEAP_STATS_BUCKETS - 1)
+                TRACE_(heapstats)( "heap %p:   size >= %08lx: %s\n", heap, (SIZE_T)8 << j,
+                                   wine_dbgstr_longlong(info.SizeHistogram[j]) );
+            else
+                TRACE_(heapstats)( "heap %p:   size <  %08lx: %s\n", heap, (SIZE_T)16 << j,
+                                   wine_dbgstr_longlong(info.SizeHistogram[j]) );
+        }
+    }
+}
+
+
 /***********************************************************************
  *           RtlQueryHeapInformation    (NTDLL.@)
  */
 NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS info_class,
                                          PVOID info, SIZE_T size_in, PSIZE_T size_out)
 {
-    switch (info_class)
+    HEAP *heapPtr;
+
+    switch ((ULONG)info_class)
     {
     case HeapCompatibilityInformation:
         if (size_out) *size_out = sizeof(ULONG);
@@ -2392,7 +3112,18 @@ NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS inf
         if (size_in < sizeof(ULONG))
             return STATUS_BUFFER_TOO_SMALL;
 
-        *(ULONG *)info = 0; /* standard heap */
+        if (!(heapPtr = HEAP_GetPtr( heap ))) return STATUS_INVALID_HANDLE;
+        *(ULONG *)info = heapPtr->lfh ? HEAP_LFH_COMPATIBILITY : 0; /* LFH or standard heap */
+        return STATUS_SUCCESS;
+
+    case HeapWineStatisticsInformation:
+        if (size_out) *size_out = sizeof(WINE_HEAP_STATISTICS);
+
+        if (size_in < sizeof(WINE_HEAP_STATISTICS))
+            return STATUS_BUFFER_TOO_SMALL;
+
+        if (!(heapPtr = HEAP_GetPtr( heap ))) return STATUS_INVALID_HANDLE;
+        heap_get_statistics( heapPtr, info );
         return STATUS_SUCCESS;
 
     default:
@@ -2406,6 +3137,28 @@ NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS inf
  */
 NTSTATUS WINAPI RtlSetHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS info_class, PVOID info, SIZE_T size)
 {
-    FIXME("%p %d %p %ld stub\n", heap, info_class, info, size);
-    return STATUS_SUCCESS;
+    HEAP *heapPtr;
+
+    switch (info_class)
+    {
+    case HeapCompatibilityInformation:
+        if (size < sizeof(ULONG)) return STATUS_BUFFER_TOO_SMALL;
+        if (!(heapPtr = HEAP_GetPtr( heap ))) return STATUS_INVALID_HANDLE;
+
+        switch (*(ULONG *)info)
+        {
+        case 0:
+            /* the LFH can't be disabled once enabled */
+            return heapPtr->lfh ? STATUS_UNSUCCESSFUL : STATUS_SUCCESS;
+        case HEAP_LFH_COMPATIBILITY:
+            return heap_enable_lfh( heapPtr );
+        default:
+            FIXME("%p: unsupported heap compatibility mode %u\n", heap, *(ULONG *)info);
+            return STATUS_UNSUCCESSFUL;
+        }
+
+    default:
+        FIXME("%p %d %p %ld stub\n", heap, info_class, info, size);
+        return STATUS_SUCCESS;
+    }
 }
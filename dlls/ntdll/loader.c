@@ -127,8 +127,22 @@ typedef struct _wine_modref
     int                   alloc_deps;
     int                   nDeps;
     struct _wine_modref **deps;
+    struct list           base_entry;      /* entry in the base address hash table */
+    struct list           basename_entry;  /* entry in the base name hash table */
+    struct list           fullname_entry;  /* entry in the full name hash table */
+    DWORD                *export_hash;     /* open addressing table of export name indices */
+    DWORD                 export_hash_size;
 } WINE_MODREF;
 
+/* hash tables indexing the modules, kept in sync with the PEB module lists */
+#define MODREF_HASH_SIZE 64
+static struct list modref_base_hash[MODREF_HASH_SIZE];
+static struct list modref_basename_hash[MODREF_HASH_SIZE];
+static struct list modref_fullname_hash[MODREF_HASH_SIZE];
+
+/* modules with fewer exported names than this are binary searched */
+#define EXPORT_HASH_MIN_NAMES 32
+
 /* info about the current builtin dll load */
 /* used to keep track of things across the register_dll constructor call */
 struct builtin_load_info
@@ -492,6 +506,73 @@ static void call_ldr_notifications( ULONG reason, LDR_MODULE *module )
     }
 }
 
+static inline unsigned int hash_module_base( HMODULE hmod )
+{
+    return ((ULONG_PTR)hmod >> 16) % MODREF_HASH_SIZE;
+}
+
+/* hash compatible with strcmpiW() */
+static unsigned int hash_module_basename( const WCHAR *name )
+{
+    unsigned int hash = 0;
+
+    while (*name) hash = hash * 31 + tolowerW( *name++ );
+    return hash % MODREF_HASH_SIZE;
+}
+
+/* hash compatible with RtlEqualUnicodeString() */
+static unsigned int hash_module_fullname( const UNICODE_STRING *name )
+{
+    unsigned int i, hash = 0;
+
+    for (i = 0; i < name->Length / sizeof(WCHAR); i++)
+        hash = hash * 31 + RtlUpcaseUnicodeChar( name->Buffer[i] );
+    return hash % MODREF_HASH_SIZE;
+}
+
+static void init_modref_hash(void)
+{
+    unsigned int i;
+
+    if (modref_base_hash[0].next) return;
+    for (i = 0; i < MODREF_HASH_SIZE; i++)
+    {
+        list_init( &modref_base_hash[i] );
+        list_init( &modref_basename_hash[i] );
+        list_init( &modref_fullname_hash[i] );
+    }
+}
+
+/*************************************************************************
+ *		add_modref_hash
+ *
+ * Add a module to the hash tables used for lookups.
+ * The loader_section must be locked while calling this function.
+ */
+static void add_modref_hash( WINE_MODREF *wm )
+{
+    init_modref_hash();
+    list_add_tail( &modref_base_hash[hash_module_base( wm->ldr.BaseAddress )], &wm->base_entry );
+    list_add_tail( &modref_basename_hash[hash_module_basename( wm->ldr.BaseDllName.Buffer )],
+                   &wm->basename_entry );
+    list_add_tail( &modref_fullname_hash[hash_module_fullname( &wm->ldr.FullDllName )],
+                   &wm->fullname_entry );
+}
+
+/*************************************************************************
+ *		remove_modref_hash
+ *
+ * Remove a module from the lookup hash tables.
+ * The loader_section must be locked while calling this function.
+ */
+static void remove_modref_hash( WINE_MODREF *wm )
+{
+    list_remove( &wm->base_entry );
+    list_remove( &wm->basename_entry );
+    list_remove( &wm->fullname_entry );
+    if (cached_modref == wm) cached_modref = NULL;
+}
+
 /*************************************************************************
  *		get_modref
  *
@@ -500,18 +581,13 @@ static void call_ldr_notifications( ULONG reason, LDR_MODULE *module )
  */
 static WINE_MODREF *get_modref( HMODULE hmod )
 {
-    PLIST_ENTRY mark, entry;
-    PLDR_MODULE mod;
+    WINE_MODREF *wm;
 
     if (cached_modref && cached_modref->ldr.BaseAddress == hmod) return cached_modref;
 
-    mark = &NtCurrentTeb()->Peb->LdrData->InMemoryOrderModuleList;
-    for (entry = mark->Flink; entry != mark; entry = entry->Flink)
-    {
-        mod = CONTAINING_RECORD(entry, LDR_MODULE, InMemoryOrderModuleList);
-        if (mod->BaseAddress == hmod)
-            return cached_modref = CONTAINING_RECORD(mod, WINE_MODREF, ldr);
-    }
+    init_modref_hash();
+    LIST_FOR_EACH_ENTRY( wm, &modref_base_hash[hash_module_base( hmod )], WINE_MODREF, base_entry )
+        if (wm->ldr.BaseAddress == hmod) return cached_modref = wm;
     return NULL;
 }
 
@@ -524,21 +600,15 @@ static WINE_MODREF *get_modref( HMODULE hmod )
  */
 static WINE_MODREF *find_basename_module( LPCWSTR name )
 {
-    PLIST_ENTRY mark, entry;
+    WINE_MODREF *wm;
 
     if (cached_modref && !strcmpiW( name, cached_modref->ldr.BaseDllName.Buffer ))
         return cached_modref;
 
-    mark = &NtCurrentTeb()->Peb->LdrData->InLoadOrderModuleList;
-    for (entry = mark->Flink; entry != mark; entry = entry->Flink)
-    {
-        LDR_MODULE *mod = CONTAINING_RECORD(entry, LDR_MODULE, InLoadOrderModuleList);
-        if (!strcmpiW( name, mod->BaseDllName.Buffer ))
-        {
-            cached_modref = CONTAINING_RECORD(mod, WINE_MODREF, ldr);
-            return cached_modref;
-        }
-    }
+    /* the hash chains keep the load order, so the first match is the same as before */
+    init_modref_hash();
+    LIST_FOR_EACH_ENTRY( wm, &modref_basename_hash[hash_module_basename( name )], WINE_MODREF, basename_entry )
+        if (!strcmpiW( name, wm->ldr.BaseDllName.Buffer )) return cached_modref = wm;
     return NULL;
 }
 
@@ -551,7 +621,7 @@ static WINE_MODREF *find_basename_module( LPCWSTR name )
  */
 static WINE_MODREF *find_fullname_module( const UNICODE_STRING *nt_name )
 {
-    PLIST_ENTRY mark, entry;
+    WINE_MODREF *wm;
     UNICODE_STRING name = *nt_name;
 
     if (name.Length <= 4 * sizeof(WCHAR)) return NULL;
@@ -561,16 +631,9 @@ static WINE_MODREF *find_fullname_module( const UNICODE_STRING *nt_name )
     if (cached_modref && RtlEqualUnicodeString( &name, &cached_modref->ldr.FullDllName, TRUE ))
         return cached_modref;
 
-    mark = &NtCurrentTeb()->Peb->LdrData->InLoadOrderModuleList;
-    for (entry = mark->Flink; entry != mark; entry = entry->Flink)
-    {
-        LDR_MODULE *mod = CONTAINING_RECORD(entry, LDR_MODULE, InLoadOrderModuleList);
-        if (RtlEqualUnicodeString( &name, &mod->FullDllName, TRUE ))
-        {
-            cached_modref = CONTAINING_RECORD(mod, WINE_MODREF, ldr);
-            return cached_modref;
-        }
-    }
+    init_modref_hash();
+    LIST_FOR_EACH_ENTRY( wm, &modref_fullname_hash[hash_module_fullname( &name )], WINE_MODREF, fullname_entry )
+        if (RtlEqualUnicodeString( &name, &wm->ldr.FullDllName, TRUE )) return cached_modref = wm;
     return NULL;
 }
 
@@ -748,6 +811,42 @@ static FARPROC find_ordinal_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY
 }
 
 
+/* FNV-1a hash of an export name */
+static inline DWORD hash_export_name( const char *name )
+{
+    DWORD hash = 2166136261u;
+
+    while (*name) hash = (hash ^ (unsigned char)*name++) * 16777619;
+    return hash;
+}
+
+/*************************************************************************
+ *		build_export_hash
+ *
+ * Build the export name hash table of a module.
+ * The loader_section must be locked while calling this function.
+ */
+static BOOL build_export_hash( WINE_MODREF *wm, const IMAGE_EXPORT_DIRECTORY *exports )
+{
+    const DWORD *names = get_rva( wm->ldr.BaseAddress, exports->AddressOfNames );
+    DWORD i, pos, size = 64;
+    DWORD *table;
+
+    while (size < 2 * exports->NumberOfNames) size *= 2;
+    if (!(table = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY, size * sizeof(*table) )))
+        return FALSE;
+
+    for (i = 0; i < exports->NumberOfNames; i++)
+    {
+        pos = hash_export_name( get_rva( wm->ldr.BaseAddress, names[i] )) & (size - 1);
+        while (table[pos]) pos = (pos + 1) & (size - 1);
+        table[pos] = i + 1;  /* 0 marks an empty slot */
+    }
+    wm->export_hash = table;
+    wm->export_hash_size = size;
+    return TRUE;
+}
+
 /*************************************************************************
  *		find_named_export
  *
@@ -760,6 +859,7 @@ static FARPROC find_named_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *
     const WORD *ordinals = get_rva( module, exports->AddressOfNameOrdinals );
     const DWORD *names = get_rva( module, exports->AddressOfNames );
     int min = 0, max = exports->NumberOfNames - 1;
+    WINE_MODREF *wm;
 
     /* first check the hint */
     if (hint >= 0 && hint <= max)
@@ -769,6 +869,23 @@ static FARPROC find_named_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *
             return find_ordinal_export( module, exports, exp_size, ordinals[hint], load_path );
     }
 
+    /* then try the name hash table of large export directories */
+    if (exports->NumberOfNames >= EXPORT_HASH_MIN_NAMES && (wm = get_modref( module )) &&
+        (wm->export_hash || build_export_hash( wm, exports )))
+    {
+        DWORD mask = wm->export_hash_size - 1;
+        DWORD pos = hash_export_name( name ) & mask;
+
+        while (wm->export_hash[pos])
+        {
+            DWORD index = wm->export_hash[pos] - 1;
+            if (!strcmp( get_rva( module, names[index] ), name ))
+                return find_ordinal_export( module, exports, exp_size, ordinals[index], load_path );
+            pos = (pos + 1) & mask;
+        }
+        return NULL;
+    }
+
     /* then do a binary search */
     while (min <= max)
     {
@@ -1239,6 +1356,7 @@ static WINE_MODREF *alloc_module( HMODULE hModule, const UNICODE_STRING *nt_name
                    &wm->ldr.InLoadOrderModuleList);
     InsertTailList(&NtCurrentTeb()->Peb->LdrData->InMemoryOrderModuleList,
                    &wm->ldr.InMemoryOrderModuleList);
+    add_modref_hash( wm );
     /* wait until init is called for inserting into InInitializationOrderModuleList */
 
     if (!(nt->OptionalHeader.DllCharacteristics & IMAGE_DLLCHARACTERISTICS_NX_COMPAT))
@@ -1989,6 +2107,7 @@ static void load_builtin_callback( void *module, const char *filename )
             /* the module has only be inserted in the load & memory order lists */
             RemoveEntryList(&wm->ldr.InLoadOrderModuleList);
             RemoveEntryList(&wm->ldr.InMemoryOrderModuleList);
+            remove_modref_hash( wm );
             /* FIXME: free the modref */
             builtin_load_info->status = STATUS_DLL_NOT_FOUND;
             return;
@@ -2064,6 +2183,152 @@ static void set_security_cookie( void *module, SIZE_T len )
     }
 }
 
+/*************************************************************************
+ *		get_relocated_pages
+ *
+ * Build a map of the pages modified by the relocation records of a module.
+ */
+static BYTE *get_relocated_pages( void *module, const IMAGE_DATA_DIRECTORY *relocs, SIZE_T len )
+{
+    const IMAGE_BASE_RELOCATION *rel = get_rva( module, relocs->VirtualAddress );
+    const IMAGE_BASE_RELOCATION *end = get_rva( module, relocs->VirtualAddress + relocs->Size );
+    SIZE_T pages = (len + page_size - 1) / page_size;
+    const USHORT *fixup;
+    BYTE *map;
+    DWORD i, count, offset;
+
+    if (!(map = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY, pages ))) return NULL;
+
+    while (rel < end - 1 && rel->SizeOfBlock)
+    {
+        if (rel->VirtualAddress >= len || rel->SizeOfBlock < sizeof(*rel)) goto failed;
+        count = (rel->SizeOfBlock - sizeof(*rel)) / sizeof(USHORT);
+        fixup = (const USHORT *)(rel + 1);
+        for (i = 0; i < count; i++)
+        {
+            if (!(fixup[i] >> 12)) continue;  /* IMAGE_REL_BASED_ABSOLUTE */
+            offset = rel->VirtualAddress + (fixup[i] & 0xfff);
+            if (offset >= len) goto failed;
+            map[offset / page_size] = 1;
+            /* a fixup may straddle the end of its page */
+            if ((offset + sizeof(ULONGLONG) - 1) / page_size != offset / page_size &&
+                offset / page_size + 1 < pages)
+                map[offset / page_size + 1] = 1;
+        }
+        rel = (const IMAGE_BASE_RELOCATION *)((const char *)rel + rel->SizeOfBlock);
+    }
+    return map;
+
+failed:
+    RtlFreeHeap( GetProcessHeap(), 0, map );
+    return NULL;
+}
+
+
+/*************************************************************************
+ *		map_relocated_pages
+ *
+ * Map the relocated pages stored by another process in place of the module pages.
+ * On failure, the pages that were already replaced are marked with 2 in the map.
+ */
+static NTSTATUS map_relocated_pages( void *module, BYTE *map, SIZE_T len, int fd )
+{
+    SIZE_T i, j, k, mapped, pages = (len + page_size - 1) / page_size;
+    NTSTATUS status;
+
+    for (i = 0; i < pages; i = j)
+    {
+        for (j = i + 1; j < pages && map[j] == map[i]; j++) ;
+        if (!map[i]) continue;
+        if ((status = virtual_map_relocated_pages( module, i * page_size, (j - i) * page_size, fd, &mapped )))
+        {
+            for (k = 0; k < i + mapped / page_size; k++) if (map[k]) map[k] = 2;
+            return status;
+        }
+    }
+    return STATUS_SUCCESS;
+}
+
+
+/*************************************************************************
+ *		relocate_remaining_fixups
+ *
+ * Apply the fixups of a relocation block, except those on pages that were
+ * already replaced by their relocated copy.
+ */
+static IMAGE_BASE_RELOCATION *relocate_remaining_fixups( void *module, const BYTE *map, SIZE_T len,
+                                                         IMAGE_BASE_RELOCATION *rel, INT_PTR delta )
+{
+    USHORT *fixup = (USHORT *)(rel + 1);
+    UINT i, count = (rel->SizeOfBlock - sizeof(*rel)) / sizeof(USHORT);
+    char *page = get_rva( module, rel->VirtualAddress );
+    SIZE_T offset;
+
+    for (i = 0; i < count; i++)
+    {
+        offset = rel->VirtualAddress + (fixup[i] & 0xfff);
+        if (offset < len && map[offset / page_size] == 2) continue;
+        if (!LdrProcessRelocationBlock( page, 1, &fixup[i], delta )) return NULL;
+    }
+    return (IMAGE_BASE_RELOCATION *)(fixup + count);
+}
+
+
+/*************************************************************************
+ *		store_relocated_pages
+ *
+ * Store the relocated pages of a module for use by other processes.
+ */
+static SIZE_T store_relocated_pages( void *module, const BYTE *map, SIZE_T len, int fd )
+{
+    SIZE_T i, j, size, total = 0, pages = (len + page_size - 1) / page_size;
+
+    for (i = 0; i < pages; i = j)
+    {
+        for (j = i + 1; j < pages && map[j] == map[i]; j++) ;
+        if (!map[i]) continue;
+        size = (j - i) * page_size;
+        if (pwrite( fd, (char *)module + i * page_size, size, i * page_size ) != size) return 0;
+        total += size;
+    }
+    return total;
+}
+
+
+/*************************************************************************
+ *		get_reloc_cache
+ *
+ * Retrieve the shared relocated pages of a module, or a file to store them.
+ */
+static NTSTATUS get_reloc_cache( void *module, int *fd, int *ready )
+{
+    NTSTATUS status;
+    HANDLE handle = 0;
+    int needs_close;
+
+    SERVER_START_REQ( get_image_reloc_cache )
+    {
+        req->base = wine_server_client_ptr( module );
+        if (!(status = wine_server_call( req )))
+        {
+            handle = wine_server_ptr_handle( reply->handle );
+            *ready = reply->ready;
+        }
+        TRACE( "%s relocated bytes shared between processes\n", wine_dbgstr_longlong( reply->shared ));
+    }
+    SERVER_END_REQ;
+
+    if (status) return status;
+    status = server_get_unix_fd( handle, *ready ? FILE_READ_DATA : FILE_WRITE_DATA, fd, &needs_close, NULL, NULL );
+    if (!status && !needs_close && (*fd = dup( *fd )) == -1) status = STATUS_TOO_MANY_OPENED_FILES;
+    NtClose( handle );
+    return status;
+}
+
+
+/*************************************************************************
+ *		perform_relocations
+ */
 static NTSTATUS perform_relocations( void *module, IMAGE_NT_HEADERS *nt, SIZE_T len )
 {
     char *base;
@@ -2072,6 +2337,9 @@ static NTSTATUS perform_relocations( void *module, IMAGE_NT_HEADERS *nt, SIZE_T
     const IMAGE_SECTION_HEADER *sec;
     INT_PTR delta;
     ULONG protect_old[96], i;
+    BYTE *reloc_map = NULL;
+    int reloc_fd = -1, ready = 0, replaced = 0;
+    NTSTATUS status = STATUS_SUCCESS;
 
     base = (char *)nt->OptionalHeader.ImageBase;
     if (module == base) return STATUS_SUCCESS;  /* nothing to do */
@@ -2100,6 +2368,28 @@ static NTSTATUS perform_relocations( void *module, IMAGE_NT_HEADERS *nt, SIZE_T
 
     sec = (const IMAGE_SECTION_HEADER *)((const char *)&nt->OptionalHeader +
                                          nt->FileHeader.SizeOfOptionalHeader);
+
+    /* the pages of shared sections must not be replaced by private copies */
+    for (i = 0; i < nt->FileHeader.NumberOfSections; i++)
+        if (sec[i].Characteristics & IMAGE_SCN_MEM_SHARED) break;
+
+    if (i == nt->FileHeader.NumberOfSections && (reloc_map = get_relocated_pages( module, relocs, len )))
+    {
+        if (get_reloc_cache( module, &reloc_fd, &ready )) reloc_fd = -1;
+        else if (ready)
+        {
+            TRACE( "mapping shared relocated pages for %p-%p\n", module, (char *)module + len );
+            if (!(status = map_relocated_pages( module, reloc_map, len, reloc_fd ))) goto done;
+
+            /* the cache is only an optimization, relocate the remaining pages ourselves */
+            WARN( "failed to map shared relocated pages for %p, status %#x\n", module, status );
+            close( reloc_fd );
+            reloc_fd = -1;
+            replaced = 1;
+            status = STATUS_SUCCESS;
+        }
+    }
+
     for (i = 0; i < nt->FileHeader.NumberOfSections; i++)
     {
         void *addr = get_rva( module, sec[i].VirtualAddress );
@@ -2120,12 +2410,37 @@ static NTSTATUS perform_relocations( void *module, IMAGE_NT_HEADERS *nt, SIZE_T
         if (rel->VirtualAddress >= len)
         {
             WARN( "invalid address %p in relocation %p\n", get_rva( module, rel->VirtualAddress ), rel );
-            return STATUS_ACCESS_VIOLATION;
+            status = STATUS_ACCESS_VIOLATION;
+            goto done;
+        }
+        if (replaced)
+            rel = relocate_remaining_fixups( module, reloc_map, len, rel, delta );
+        else
+            rel = LdrProcessRelocationBlock( get_rva( module, rel->VirtualAddress ),
+                                             (rel->SizeOfBlock - sizeof(*rel)) / sizeof(USHORT),
+                                             (USHORT *)(rel + 1), delta );
+        if (!rel)
+        {
+            status = STATUS_INVALID_IMAGE_FORMAT;
+            goto done;
+        }
+    }
+
+    /* store the pages before the original protections are restored */
+    if (reloc_fd != -1)
+    {
+        SIZE_T size = store_relocated_pages( module, reloc_map, len, reloc_fd );
+
+        if (size)
+        {
+            SERVER_START_REQ( set_image_reloc_cache_ready )
+            {
+                req->base = wine_server_client_ptr( module );
+                req->size = size;
+                wine_server_call( req );
+            }
+            SERVER_END_REQ;
         }
-        rel = LdrProcessRelocationBlock( get_rva( module, rel->VirtualAddress ),
-                                         (rel->SizeOfBlock - sizeof(*rel)) / sizeof(USHORT),
-                                         (USHORT *)(rel + 1), delta );
-        if (!rel) return STATUS_INVALID_IMAGE_FORMAT;
     }
 
     for (i = 0; i < nt->FileHeader.NumberOfSections; i++)
@@ -2136,7 +2451,10 @@ static NTSTATUS perform_relocations( void *module, IMAGE_NT_HEADERS *nt, SIZE_T
                                 &size, protect_old[i], &protect_old[i] );
     }
 
-    return STATUS_SUCCESS;
+done:
+    if (reloc_fd != -1) close( reloc_fd );
+    RtlFreeHeap( GetProcessHeap(), 0, reloc_map );
+    return status;
 }
 
 #ifdef _WIN64
@@ -2639,6 +2957,7 @@ static NTSTATUS load_native_dll( LPCWSTR load_path, const UNICODE_STRING *nt_nam
             /* the module has only be inserted in the load & memory order lists */
             RemoveEntryList(&wm->ldr.InLoadOrderModuleList);
             RemoveEntryList(&wm->ldr.InMemoryOrderModuleList);
+            remove_modref_hash( wm );
 
             /* FIXME: there are several more dangling references
              * left. Including dlls loaded by this dll before the
@@ -3789,6 +4108,7 @@ void WINAPI LdrShutdownProcess(void)
 
     process_detaching = TRUE;
     process_detach();
+    heap_dump_statistics();
 }
 
 
@@ -3870,6 +4190,7 @@ static void free_modref( WINE_MODREF *wm )
     RemoveEntryList(&wm->ldr.InMemoryOrderModuleList);
     if (wm->ldr.InInitializationOrderModuleList.Flink)
         RemoveEntryList(&wm->ldr.InInitializationOrderModuleList);
+    remove_modref_hash( wm );
 
     TRACE(" unloading %s\n", debugstr_w(wm->ldr.FullDllName.Buffer));
     if (!TRACE_ON(module))
@@ -3892,6 +4213,7 @@ static void free_modref( WINE_MODREF *wm )
     if (cached_modref == wm) cached_modref = NULL;
     RtlFreeUnicodeString( &wm->ldr.FullDllName );
     RtlFreeHeap( GetProcessHeap(), 0, wm->deps );
+    RtlFreeHeap( GetProcessHeap(), 0, wm->export_hash );
     RtlFreeHeap( GetProcessHeap(), 0, wm );
 }
 
@@ -4657,6 +4979,12 @@ void __wine_process_init(void)
     InsertHeadList( &peb->LdrData->InLoadOrderModuleList, &wm->ldr.InLoadOrderModuleList );
     RemoveEntryList( &wm->ldr.InMemoryOrderModuleList );
     InsertHeadList( &peb->LdrData->InMemoryOrderModuleList, &wm->ldr.InMemoryOrderModuleList );
+    list_remove( &wm->basename_entry );
+    list_add_head( &modref_basename_hash[hash_module_basename( wm->ldr.BaseDllName.Buffer )],
+                   &wm->basename_entry );
+    list_remove( &wm->fullname_entry );
+    list_add_head( &modref_fullname_hash[hash_module_fullname( &wm->ldr.FullDllName )],
+                   &wm->fullname_entry );
 
     virtual_alloc_thread_stack( &stack, 0, 0, NULL );
     teb->Tib.StackBase = stack.StackBase;
@@ -1579,3 +1579,6 @@
 @ cdecl wine_unix_to_nt_file_name(ptr ptr)
 
 @ cdecl __wine_esync_set_queue_fd(long)
+@ cdecl __wine_fsync_get_queue_bits(ptr ptr)
+@ cdecl __wine_fsync_get_queue_flags(ptr)
+@ cdecl __wine_fsync_get_hooks_serial(ptr)
@@ -28,6 +28,7 @@
 #include "winnt.h"
 #include "winternl.h"
 #include "wine/debug.h"
+#include "wine/debug_ring.h"
 #include "wine/server.h"
 #include "wine/asm.h"
 
@@ -86,6 +87,7 @@ extern void virtual_init(void) DECLSPEC_HIDDEN;
 extern void virtual_init_threading(void) DECLSPEC_HIDDEN;
 extern void fill_cpu_info(void) DECLSPEC_HIDDEN;
 extern void heap_set_debug_flags( HANDLE handle ) DECLSPEC_HIDDEN;
+extern void heap_dump_statistics(void) DECLSPEC_HIDDEN;
 extern void init_unix_codepage(void) DECLSPEC_HIDDEN;
 extern void init_locale( HMODULE module ) DECLSPEC_HIDDEN;
 extern void init_user_process_params( SIZE_T data_size ) DECLSPEC_HIDDEN;
@@ -119,6 +121,9 @@ extern NTSTATUS validate_open_object_attributes( const OBJECT_ATTRIBUTES *attr )
 extern int wait_select_reply( void *cookie ) DECLSPEC_HIDDEN;
 extern void invoke_apc( const apc_call_t *call, apc_result_t *result ) DECLSPEC_HIDDEN;
 
+/* registry */
+extern void reg_cache_remove_handle( HANDLE handle ) DECLSPEC_HIDDEN;
+
 /* module handling */
 extern LIST_ENTRY tls_links DECLSPEC_HIDDEN;
 extern FARPROC RELAY_GetProcAddress( HMODULE module, const IMAGE_EXPORT_DIRECTORY *exports,
@@ -180,6 +185,8 @@ extern NTSTATUS virtual_map_section( HANDLE handle, PVOID *addr_ptr, unsigned sh
                                      ULONG protect, pe_image_info_t *image_info ) DECLSPEC_HIDDEN;
 extern void virtual_get_system_info( SYSTEM_BASIC_INFORMATION *info ) DECLSPEC_HIDDEN;
 extern NTSTATUS virtual_create_builtin_view( void *base ) DECLSPEC_HIDDEN;
+extern NTSTATUS virtual_map_relocated_pages( void *module, SIZE_T offset, SIZE_T size, int fd,
+                                            SIZE_T *mapped ) DECLSPEC_HIDDEN;
 extern NTSTATUS virtual_alloc_thread_stack( INITIAL_TEB *stack, SIZE_T reserve_size,
                                             SIZE_T commit_size, SIZE_T *pthread_size ) DECLSPEC_HIDDEN;
 extern void virtual_clear_thread_stack( void *stack_end ) DECLSPEC_HIDDEN;
@@ -270,6 +277,9 @@ struct debug_info
 {
     unsigned int str_pos;       /* current position in strings buffer */
     unsigned int out_pos;       /* current position in output buffer */
+    struct debug_ring_record ring_record; /* header of the current line in trace ring mode */
+    const char  *ring_channel;  /* channel name of the current line */
+    const char  *ring_function; /* function name of the current line */
     char         strings[1024]; /* buffer for temporary strings */
     char         output[1024];  /* current output line */
 };
@@ -287,6 +297,7 @@ struct ntdll_thread_data
     int                esync_queue_fd;/* fd to wait on for driver events */
     int                esync_apc_fd;  /* fd to wait on for user APCs */
     int               *fsync_apc_futex;
+    struct fsync_queue_status *fsync_queue_status; /* shared status of the thread's message queue */
 };
 
 C_ASSERT( sizeof(struct ntdll_thread_data) <= sizeof(((TEB *)0)->GdiTebBatch) );
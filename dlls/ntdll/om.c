@@ -369,6 +369,7 @@ NTSTATUS WINAPI NtDuplicateObject( HANDLE source_process, HANDLE source,
             if (reply->closed && reply->self)
             {
                 int fd = server_remove_fd_from_cache( source );
+                reg_cache_remove_handle( source );
                 if (fd != -1) close( fd );
             }
         }
@@ -389,6 +390,8 @@ NTSTATUS close_handle( HANDLE handle )
     NTSTATUS ret;
     int fd = server_remove_fd_from_cache( handle );
 
+    reg_cache_remove_handle( handle );
+
     if (do_fsync())
         fsync_close( handle );
 
@@ -36,6 +36,7 @@
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
 #include "wine/library.h"
+#include "wine/list.h"
 #include "ntdll_misc.h"
 #include "wine/debug.h"
 #include "wine/unicode.h"
@@ -45,6 +46,263 @@ WINE_DEFAULT_DEBUG_CHANNEL(reg);
 /* maximum length of a value name in bytes (without terminating null) */
 #define MAX_VALUE_LENGTH (16383 * sizeof(WCHAR))
 
+/* client-side cache of registry values, keyed by the server id of the key and
+ * the value name. Entries are validated against the generation counter the
+ * server keeps for the key in shared memory. Key handles are mapped to key ids
+ * as values are read through them; a mapping is only used while the shared
+ * generation counter of the handle, which the server increments whenever the
+ * handle is closed, is unchanged, since the handle value may then be reused. */
+
+#define REG_CACHE_BUCKETS   256   /* number of hash buckets */
+#define REG_CACHE_MAX       512   /* max. number of cached values */
+#define REG_CACHE_MAX_DATA  256   /* max. size of cached value data */
+
+struct reg_cache_handle
+{
+    struct list    entry;      /* entry in the handle bucket */
+    HANDLE         handle;     /* key handle */
+    unsigned int   key_id;     /* id of the key the handle refers to */
+    unsigned int   gen_slot;   /* index of the handle generation counter */
+    unsigned int   gen;        /* generation of the handle when it was mapped */
+};
+
+struct reg_cache_entry
+{
+    struct list    entry;      /* entry in the key bucket */
+    struct list    lru;        /* entry in the LRU list */
+    unsigned int   key_id;     /* id of the key */
+    unsigned int   gen_slot;   /* index of the key generation counter */
+    unsigned int   gen;        /* generation of the key when the value was read */
+    NTSTATUS       status;     /* STATUS_SUCCESS or STATUS_OBJECT_NAME_NOT_FOUND */
+    int            type;       /* value type */
+    data_size_t    total;      /* total length of the value data */
+    BOOL           has_data;   /* whether the complete data is cached */
+    UNICODE_STRING name;       /* value name, stored in buffer */
+    BYTE           buffer[1];  /* value name followed by the data */
+};
+
+static RTL_CRITICAL_SECTION reg_cache_section;
+static RTL_CRITICAL_SECTION_DEBUG critsect_debug =
+{
+    0, 0, &reg_cache_section,
+    { &critsect_debug.ProcessLocksList, &critsect_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": reg_cache_section") }
+};
+static RTL_CRITICAL_SECTION reg_cache_section = { &critsect_debug, -1, 0, 0, 0, 0 };
+
+static const registry_shm_t *registry_shm;
+static BOOL registry_shm_failed;
+static struct list reg_cache[REG_CACHE_BUCKETS];
+static struct list reg_cache_handles[REG_CACHE_BUCKETS];
+static struct list reg_cache_lru = LIST_INIT( reg_cache_lru );
+static unsigned int reg_cache_count, reg_cache_handle_count;
+static unsigned int reg_cache_hits, reg_cache_misses;
+
+static inline struct list *get_reg_cache_bucket( unsigned int key_id )
+{
+    return &reg_cache[key_id % REG_CACHE_BUCKETS];
+}
+
+static inline struct list *get_reg_cache_handle_bucket( HANDLE handle )
+{
+    return &reg_cache_handles[((ULONG_PTR)handle >> 2) % REG_CACHE_BUCKETS];
+}
+
+/* map the generation counters; must be called with reg_cache_section held */
+static const registry_shm_t *get_registry_shm(void)
+{
+    HANDLE handle = 0;
+    SIZE_T size = 0;
+    void *ptr = NULL;
+    unsigned int i;
+
+    if (registry_shm || registry_shm_failed) return registry_shm;
+
+    registry_shm_failed = TRUE;
+    SERVER_START_REQ( get_registry_shared_memory )
+    {
+        if (!wine_server_call( req )) handle = wine_server_ptr_handle( reply->handle );
+    }
+    SERVER_END_REQ;
+    if (!handle) return NULL;
+
+    if (!NtMapViewOfSection( handle, NtCurrentProcess(), &ptr, 0, 0, NULL, &size,
+                             ViewShare, 0, PAGE_READONLY ))
+    {
+        for (i = 0; i < REG_CACHE_BUCKETS; i++)
+        {
+            list_init( &reg_cache[i] );
+            list_init( &reg_cache_handles[i] );
+        }
+        registry_shm = ptr;
+        registry_shm_failed = FALSE;
+    }
+    NtClose( handle );
+    return registry_shm;
+}
+
+static void free_reg_cache_entry( struct reg_cache_entry *entry )
+{
+    list_remove( &entry->entry );
+    list_remove( &entry->lru );
+    reg_cache_count--;
+    RtlFreeHeap( GetProcessHeap(), 0, entry );
+}
+
+static void free_reg_cache_handle( struct reg_cache_handle *handle )
+{
+    list_remove( &handle->entry );
+    reg_cache_handle_count--;
+    RtlFreeHeap( GetProcessHeap(), 0, handle );
+}
+
+/* find the mapping of a key handle; must be called with reg_cache_section held */
+static struct reg_cache_handle *find_reg_cache_handle( HANDLE handle )
+{
+    struct reg_cache_handle *entry;
+
+    LIST_FOR_EACH_ENTRY( entry, get_reg_cache_handle_bucket( handle ), struct reg_cache_handle, entry )
+        if (entry->handle == handle) return entry;
+    return NULL;
+}
+
+/***********************************************************************
+ *           get_cached_value
+ *
+ * Look up a value in the cache. size is the amount of data the caller wants;
+ * on a hit the data is copied to the data buffer.
+ */
+static BOOL get_cached_value( HANDLE handle, const UNICODE_STRING *name, int *type,
+                              data_size_t *total, void *data, data_size_t size, NTSTATUS *status )
+{
+    struct reg_cache_handle *key_handle;
+    struct reg_cache_entry *entry;
+    BOOL found = FALSE;
+
+    RtlEnterCriticalSection( &reg_cache_section );
+    if (!get_registry_shm()) goto done;
+    if (!(key_handle = find_reg_cache_handle( handle ))) goto done;
+    if (registry_shm->handle_gen[key_handle->gen_slot] != key_handle->gen)
+    {
+        free_reg_cache_handle( key_handle );
+        goto done;
+    }
+
+    LIST_FOR_EACH_ENTRY( entry, get_reg_cache_bucket( key_handle->key_id ), struct reg_cache_entry, entry )
+    {
+        if (entry->key_id != key_handle->key_id) continue;
+        if (!RtlEqualUnicodeString( &entry->name, name, TRUE )) continue;
+
+        if (registry_shm->gen[entry->gen_slot] != entry->gen)
+        {
+            free_reg_cache_entry( entry );
+            break;
+        }
+        if (!entry->status && size && !entry->has_data) break;
+
+        *status = entry->status;
+        *type   = entry->type;
+        *total  = entry->total;
+        if (!entry->status && size)
+            memcpy( data, entry->buffer + entry->name.Length, min( size, entry->total ));
+        list_remove( &entry->lru );
+        list_add_head( &reg_cache_lru, &entry->lru );
+        found = TRUE;
+        break;
+    }
+
+done:
+    if (found) reg_cache_hits++;
+    else reg_cache_misses++;
+    if (!((reg_cache_hits + reg_cache_misses) % 1024))
+        TRACE( "%u hits, %u misses, %u cached values, %u handles\n", reg_cache_hits, reg_cache_misses,
+               reg_cache_count, reg_cache_handle_count );
+    RtlLeaveCriticalSection( &reg_cache_section );
+    return found;
+}
+
+/***********************************************************************
+ *           cache_value
+ *
+ * Store the result of a get_key_value request. size is the amount of data
+ * returned by the server.
+ */
+static void cache_value( HANDLE handle, const UNICODE_STRING *name, NTSTATUS status,
+                         unsigned int key_id, unsigned int gen_slot, unsigned int gen,
+                         unsigned int handle_slot, unsigned int handle_gen,
+                         int type, data_size_t total, const void *data, data_size_t size )
+{
+    struct reg_cache_handle *key_handle;
+    struct reg_cache_entry *entry;
+    BOOL has_data = (!status && size == total && total <= REG_CACHE_MAX_DATA);
+    SIZE_T len;
+
+    if (gen_slot >= REGISTRY_GEN_SLOTS || handle_slot >= REGISTRY_HANDLE_SLOTS) return;
+
+    RtlEnterCriticalSection( &reg_cache_section );
+    if (!registry_shm) goto done;
+
+    if (!(key_handle = find_reg_cache_handle( handle )))
+    {
+        if (!(key_handle = RtlAllocateHeap( GetProcessHeap(), 0, sizeof(*key_handle) ))) goto done;
+        key_handle->handle = handle;
+        list_add_head( get_reg_cache_handle_bucket( handle ), &key_handle->entry );
+        reg_cache_handle_count++;
+    }
+    key_handle->key_id   = key_id;
+    key_handle->gen_slot = handle_slot;
+    key_handle->gen      = handle_gen;
+
+    LIST_FOR_EACH_ENTRY( entry, get_reg_cache_bucket( key_id ), struct reg_cache_entry, entry )
+    {
+        if (entry->key_id != key_id) continue;
+        if (!RtlEqualUnicodeString( &entry->name, name, TRUE )) continue;
+        free_reg_cache_entry( entry );
+        break;
+    }
+
+    if (reg_cache_count >= REG_CACHE_MAX)
+        free_reg_cache_entry( LIST_ENTRY( list_tail( &reg_cache_lru ), struct reg_cache_entry, lru ));
+
+    len = FIELD_OFFSET( struct reg_cache_entry, buffer[name->Length + (has_data ? total : 0)] );
+    if (!(entry = RtlAllocateHeap( GetProcessHeap(), 0, len ))) goto done;
+    entry->key_id   = key_id;
+    entry->gen_slot = gen_slot;
+    entry->gen      = gen;
+    entry->status   = status;
+    entry->type     = type;
+    entry->total    = total;
+    entry->has_data = has_data;
+    entry->name.Length = entry->name.MaximumLength = name->Length;
+    entry->name.Buffer = (WCHAR *)entry->buffer;
+    memcpy( entry->buffer, name->Buffer, name->Length );
+    if (has_data) memcpy( entry->buffer + name->Length, data, total );
+    list_add_head( get_reg_cache_bucket( key_id ), &entry->entry );
+    list_add_head( &reg_cache_lru, &entry->lru );
+    reg_cache_count++;
+
+done:
+    RtlLeaveCriticalSection( &reg_cache_section );
+}
+
+/***********************************************************************
+ *           reg_cache_remove_handle
+ *
+ * Drop the mapping of a key handle that is being closed. The cached values
+ * are kept, they can be found again through other handles to the same key.
+ */
+void reg_cache_remove_handle( HANDLE handle )
+{
+    struct reg_cache_handle *key_handle;
+
+    if (!reg_cache_handle_count) return;
+
+    RtlEnterCriticalSection( &reg_cache_section );
+    if (registry_shm && (key_handle = find_reg_cache_handle( handle )))
+        free_reg_cache_handle( key_handle );
+    RtlLeaveCriticalSection( &reg_cache_section );
+}
+
 /******************************************************************************
  * NtCreateKey [NTDLL.@]
  * ZwCreateKey [NTDLL.@]
@@ -537,6 +795,8 @@ NTSTATUS WINAPI DECLSPEC_HOTPATCH NtQueryValueKey( HANDLE handle, const UNICODE_
     NTSTATUS ret;
     UCHAR *data_ptr;
     unsigned int fixed_size, min_size;
+    data_size_t data_size, total;
+    int type;
 
     TRACE( "(%p,%s,%d,%p,%d)\n", handle, debugstr_us(name), info_class, info, length );
 
@@ -574,21 +834,33 @@ NTSTATUS WINAPI DECLSPEC_HOTPATCH NtQueryValueKey( HANDLE handle, const UNICODE_
         return STATUS_INVALID_PARAMETER;
     }
 
-    SERVER_START_REQ( get_key_value )
+    data_size = (length > fixed_size && data_ptr) ? length - fixed_size : 0;
+
+    if (!get_cached_value( handle, name, &type, &total, data_ptr, data_size, &ret ))
     {
-        req->hkey = wine_server_obj_handle( handle );
-        wine_server_add_data( req, name->Buffer, name->Length );
-        if (length > fixed_size && data_ptr) wine_server_set_reply( req, data_ptr, length - fixed_size );
-        if (!(ret = wine_server_call( req )))
+        SERVER_START_REQ( get_key_value )
         {
-            copy_key_value_info( info_class, info, length, reply->type,
-                                 name->Length, reply->total );
-            *result_len = fixed_size + (info_class == KeyValueBasicInformation ? 0 : reply->total);
-            if (length < min_size) ret = STATUS_BUFFER_TOO_SMALL;
-            else if (length < *result_len) ret = STATUS_BUFFER_OVERFLOW;
+            req->hkey = wine_server_obj_handle( handle );
+            wine_server_add_data( req, name->Buffer, name->Length );
+            if (data_size) wine_server_set_reply( req, data_ptr, data_size );
+            ret = wine_server_call( req );
+            type  = reply->type;
+            total = reply->total;
+            if (!ret || ret == STATUS_OBJECT_NAME_NOT_FOUND)
+                cache_value( handle, name, ret, reply->key_id, reply->gen_slot, reply->gen,
+                             reply->handle_slot, reply->handle_gen, type, total,
+                             data_ptr, wine_server_reply_size( reply ));
         }
+        SERVER_END_REQ;
+    }
+
+    if (!ret)
+    {
+        copy_key_value_info( info_class, info, length, type, name->Length, total );
+        *result_len = fixed_size + (info_class == KeyValueBasicInformation ? 0 : total);
+        if (length < min_size) ret = STATUS_BUFFER_TOO_SMALL;
+        else if (length < *result_len) ret = STATUS_BUFFER_OVERFLOW;
     }
-    SERVER_END_REQ;
     return ret;
 }
 
@@ -719,14 +719,14 @@ static void test_NtFlushKey(void)
 
 static void test_NtQueryValueKey(void)
 {
-    HANDLE key;
+    HANDLE key, key2;
     NTSTATUS status;
     OBJECT_ATTRIBUTES attr;
-    UNICODE_STRING ValName;
+    UNICODE_STRING ValName, str;
     KEY_VALUE_BASIC_INFORMATION *basic_info;
     KEY_VALUE_PARTIAL_INFORMATION *partial_info, pi;
     KEY_VALUE_FULL_INFORMATION *full_info;
-    DWORD len, expected;
+    DWORD len, expected, data;
 
     pRtlCreateUnicodeStringFromAsciiz(&ValName, "deletetest");
 
@@ -836,6 +836,53 @@ static void test_NtQueryValueKey(void)
     ok(status == STATUS_SUCCESS, "NtQueryValueKey should have returned STATUS_SUCCESS instead of 0x%08x\n", status);
     ok(pi.Type == 0xff00ff00, "Type=%x\n", pi.Type);
     ok(pi.DataLength == 0, "DataLength=%u\n", pi.DataLength);
+
+    /* changes made through another handle are visible to repeated queries */
+    status = pNtOpenKey(&key2, KEY_READ|KEY_SET_VALUE, &attr);
+    ok(status == STATUS_SUCCESS, "NtOpenKey Failed: 0x%08x\n", status);
+    data = 0x1234;
+    status = pNtSetValueKey(key2, &ValName, 0, REG_DWORD, &data, sizeof(data));
+    ok(status == STATUS_SUCCESS, "NtSetValueKey Failed: 0x%08x\n", status);
+    len = FIELD_OFFSET(KEY_VALUE_PARTIAL_INFORMATION, Data[sizeof(DWORD)]);
+    partial_info = HeapAlloc(GetProcessHeap(), 0, len);
+    status = pNtQueryValueKey(key, &ValName, KeyValuePartialInformation, partial_info, len, &len);
+    ok(status == STATUS_SUCCESS, "NtQueryValueKey should have returned STATUS_SUCCESS instead of 0x%08x\n", status);
+    ok(partial_info->Type == REG_DWORD, "Type=%x\n", partial_info->Type);
+    ok(*(DWORD *)partial_info->Data == 0x1234, "incorrect Data returned: 0x%x\n", *(DWORD *)partial_info->Data);
+
+    status = pNtDeleteValueKey(key2, &ValName);
+    ok(status == STATUS_SUCCESS, "NtDeleteValueKey Failed: 0x%08x\n", status);
+    status = pNtQueryValueKey(key, &ValName, KeyValuePartialInformation, partial_info, len, &len);
+    ok(status == STATUS_OBJECT_NAME_NOT_FOUND, "NtQueryValueKey should have returned STATUS_OBJECT_NAME_NOT_FOUND instead of 0x%08x\n", status);
+
+    data = 0x5678;
+    status = pNtSetValueKey(key2, &ValName, 0, REG_DWORD, &data, sizeof(data));
+    ok(status == STATUS_SUCCESS, "NtSetValueKey Failed: 0x%08x\n", status);
+    status = pNtQueryValueKey(key, &ValName, KeyValuePartialInformation, partial_info, len, &len);
+    ok(status == STATUS_SUCCESS, "NtQueryValueKey should have returned STATUS_SUCCESS instead of 0x%08x\n", status);
+    ok(*(DWORD *)partial_info->Data == 0x5678, "incorrect Data returned: 0x%x\n", *(DWORD *)partial_info->Data);
+
+    /* a reused key handle doesn't return the values of the previously opened key */
+    status = pNtQueryValueKey(key2, &ValName, KeyValuePartialInformation, partial_info, len, &len);
+    ok(status == STATUS_SUCCESS, "NtQueryValueKey should have returned STATUS_SUCCESS instead of 0x%08x\n", status);
+    pNtClose(key2);
+    pRtlCreateUnicodeStringFromAsciiz(&str, "cachetest");
+    InitializeObjectAttributes(&attr, &str, 0, key, 0);
+    status = pNtCreateKey(&key2, KEY_ALL_ACCESS, &attr, 0, 0, 0, 0);
+    ok(status == STATUS_SUCCESS, "NtCreateKey Failed: 0x%08x\n", status);
+    status = pNtQueryValueKey(key2, &ValName, KeyValuePartialInformation, partial_info, len, &len);
+    ok(status == STATUS_OBJECT_NAME_NOT_FOUND, "NtQueryValueKey should have returned STATUS_OBJECT_NAME_NOT_FOUND instead of 0x%08x\n", status);
+    data = 0x9abc;
+    status = pNtSetValueKey(key2, &ValName, 0, REG_DWORD, &data, sizeof(data));
+    ok(status == STATUS_SUCCESS, "NtSetValueKey Failed: 0x%08x\n", status);
+    status = pNtQueryValueKey(key, &ValName, KeyValuePartialInformation, partial_info, len, &len);
+    ok(status == STATUS_SUCCESS, "NtQueryValueKey should have returned STATUS_SUCCESS instead of 0x%08x\n", status);
+    ok(*(DWORD *)partial_info->Data == 0x5678, "incorrect Data returned: 0x%x\n", *(DWORD *)partial_info->Data);
+    pNtDeleteKey(key2);
+    pNtClose(key2);
+    pRtlFreeUnicodeString(&str);
+
+    HeapFree(GetProcessHeap(), 0, partial_info);
     pRtlFreeUnicodeString(&ValName);
 
     pNtClose(key);
@@ -309,6 +309,7 @@ TEB *thread_init(void)
     thread_data->esync_queue_fd = -1;
     thread_data->esync_apc_fd = -1;
     thread_data->fsync_apc_futex = NULL;
+    thread_data->fsync_queue_status = NULL;
 
     signal_init_thread( teb );
     virtual_init_threading();
@@ -434,6 +435,7 @@ static void start_thread( struct startup_info *info )
     struct debug_info debug_info;
 
     debug_info.str_pos = debug_info.out_pos = 0;
+    debug_info.ring_record.flags = 0;
     thread_data->debug_info = &debug_info;
     thread_data->pthread_id = pthread_self();
 
@@ -590,6 +592,7 @@ NTSTATUS WINAPI RtlCreateUserThread( HANDLE process, SECURITY_DESCRIPTOR *descr,
     thread_data->esync_queue_fd = -1;
     thread_data->esync_apc_fd = -1;
     thread_data->fsync_apc_futex = NULL;
+    thread_data->fsync_queue_status = NULL;
 
     pthread_attr_init( &attr );
     pthread_attr_setstack( &attr, teb->DeallocationStack,
@@ -2045,6 +2045,46 @@ void virtual_get_system_info( SYSTEM_BASIC_INFORMATION *info )
 }
 
 
+/***********************************************************************
+ *           virtual_map_relocated_pages
+ *
+ * Replace a range of pages of an image view by a private mapping of the
+ * relocated copy stored at the same offset in a file. On failure, the size
+ * of the pages already replaced is returned in *mapped.
+ */
+NTSTATUS virtual_map_relocated_pages( void *module, SIZE_T offset, SIZE_T size, int fd, SIZE_T *mapped )
+{
+    struct file_view *view;
+    char *start = (char *)module + offset, *addr = start, *end = addr + size;
+    NTSTATUS status = STATUS_SUCCESS;
+    sigset_t sigset;
+
+    *mapped = 0;
+
+    server_enter_uninterrupted_section( &csVirtual, &sigset );
+    view = find_view_range( addr, size );
+    if (!view || view->base != module || !(view->protect & SEC_IMAGE) || offset + size > view->size)
+        status = STATUS_INVALID_PARAMETER;
+
+    while (!status && addr < end)
+    {
+        BYTE vprot = get_page_vprot( addr );
+        char *next = addr + page_size;
+        int prot = VIRTUAL_GetUnixProt( vprot );
+
+        while (next < end && get_page_vprot( next ) == vprot) next += page_size;
+        if (force_exec_prot && (vprot & VPROT_READ)) prot |= PROT_EXEC;
+        if (mmap( addr, next - addr, prot, MAP_FIXED | MAP_PRIVATE, fd, addr - (char *)module ) == (void *)-1)
+            status = FILE_GetNtStatus();
+        else
+            *mapped = next - start;
+        addr = next;
+    }
+    server_leave_uninterrupted_section( &csVirtual, &sigset );
+    return status;
+}
+
+
 /***********************************************************************
  *           virtual_create_builtin_view
  */
@@ -198,6 +198,9 @@ typedef struct BlockChainBlock
   BYTE data[MAX_BIG_BLOCK_SIZE];
 } BlockChainBlock;
 
+/* Number of blocks read ahead on sequential access */
+#define READAHEAD_BLOCKS 16
+
 struct BlockChainStream
 {
   StorageImpl* parentStorage;
@@ -206,10 +209,15 @@ struct BlockChainStream
   struct BlockChainRun* indexCache;
   ULONG        indexCacheLen;
   ULONG        indexCacheSize;
+  ULONG        lastRun;         /* run of the last lookup, checked first */
   BlockChainBlock cachedBlocks[2];
   ULONG        blockToEvict;
   ULONG        tailIndex;
   ULONG        numBlocks;
+  BYTE*        readAhead;       /* up to READAHEAD_BLOCKS blocks read on sequential access */
+  ULONG        readAheadIndex;  /* first block held in readAhead */
+  ULONG        readAheadCount;  /* number of blocks held in readAhead */
+  ULONG        lastReadIndex;   /* last block read into cachedBlocks */
 };
 
 /* Returns the number of blocks that comprises this chain.
@@ -3994,6 +4002,99 @@ static ULONG Storage32Impl_AddExtBlockDepot(StorageImpl* This)
   return index;
 }
 
+/************************************************************************
+ * StorageImpl_GetDepotBlock
+ *
+ * Returns the entries of a big block depot block, reading it into the
+ * depot cache if needed. The least recently used block is evicted.
+ */
+static HRESULT StorageImpl_GetDepotBlock(
+  StorageImpl* This,
+  ULONG        depotBlockCount,
+  ULONG**      entries)
+{
+  ULONG entriesPerBlock = This->bigBlockSize / sizeof(ULONG);
+  BYTE depotBuffer[MAX_BIG_BLOCK_SIZE];
+  ULONG depotBlockIndexPos, read, i, victim = 0;
+
+  i = This->depotCacheLast;
+  if (This->depotCache[i].index != depotBlockCount)
+  {
+    for (i = 0; i < DEPOT_CACHE_SIZE; i++)
+    {
+      if (This->depotCache[i].index == depotBlockCount)
+        break;
+      if (This->depotCache[i].lastUsed < This->depotCache[victim].lastUsed)
+        victim = i;
+    }
+  }
+
+  if (i < DEPOT_CACHE_SIZE)
+  {
+    This->depotCacheHits++;
+  }
+  else
+  {
+    if (!This->depotCacheData)
+    {
+      This->depotCacheData = HeapAlloc(GetProcessHeap(), 0, DEPOT_CACHE_SIZE * This->bigBlockSize);
+      if (!This->depotCacheData)
+        return E_OUTOFMEMORY;
+      This->depotCacheBlockSize = This->bigBlockSize;
+    }
+
+    if (depotBlockCount < COUNT_BBDEPOTINHEADER)
+    {
+      depotBlockIndexPos = This->bigBlockDepotStart[depotBlockCount];
+    }
+    else
+    {
+      /*
+       * We have to look in the extended depot.
+       */
+      depotBlockIndexPos = Storage32Impl_GetExtDepotBlock(This, depotBlockCount);
+    }
+
+    StorageImpl_ReadBigBlock(This, depotBlockIndexPos, depotBuffer, &read);
+
+    if (!read)
+      return STG_E_READFAULT;
+
+    i = victim;
+    for (read = 0; read < entriesPerBlock; read++)
+      StorageUtl_ReadDWord(depotBuffer, read*sizeof(ULONG), &This->depotCacheData[i * entriesPerBlock + read]);
+
+    This->depotCache[i].index = depotBlockCount;
+    This->depotCacheMisses++;
+  }
+
+  This->depotCache[i].lastUsed = ++This->depotCacheTick;
+  This->depotCacheLast = i;
+  *entries = &This->depotCacheData[i * entriesPerBlock];
+  return S_OK;
+}
+
+/* Forgets all cached depot blocks. The buffer is kept unless the big block
+ * size changed since it was allocated. */
+static void StorageImpl_InvalidateDepotCache(StorageImpl* This)
+{
+  ULONG i;
+
+  for (i = 0; i < DEPOT_CACHE_SIZE; i++)
+  {
+    This->depotCache[i].index = 0xffffffff;
+    This->depotCache[i].lastUsed = 0;
+  }
+  This->depotCacheTick = 0;
+  This->depotCacheLast = 0;
+
+  if (This->depotCacheData && This->depotCacheBlockSize != This->bigBlockSize)
+  {
+    HeapFree(GetProcessHeap(), 0, This->depotCacheData);
+    This->depotCacheData = NULL;
+  }
+}
+
 /************************************************************************
  * StorageImpl_GetNextBlockInChain
  *
@@ -4026,10 +4127,8 @@ static HRESULT StorageImpl_GetNextBlockInChain(
   ULONG offsetInDepot    = blockIndex * sizeof (ULONG);
   ULONG depotBlockCount  = offsetInDepot / This->bigBlockSize;
   ULONG depotBlockOffset = offsetInDepot % This->bigBlockSize;
-  BYTE depotBuffer[MAX_BIG_BLOCK_SIZE];
-  ULONG read;
-  ULONG depotBlockIndexPos;
-  int index, num_blocks;
+  ULONG *depotBlock;
+  HRESULT hr;
 
   *nextBlockIndex   = BLOCK_SPECIAL;
 
@@ -4040,40 +4139,11 @@ static HRESULT StorageImpl_GetNextBlockInChain(
     return STG_E_READFAULT;
   }
 
-  /*
-   * Cache the currently accessed depot block.
-   */
-  if (depotBlockCount != This->indexBlockDepotCached)
-  {
-    This->indexBlockDepotCached = depotBlockCount;
-
-    if (depotBlockCount < COUNT_BBDEPOTINHEADER)
-    {
-      depotBlockIndexPos = This->bigBlockDepotStart[depotBlockCount];
-    }
-    else
-    {
-      /*
-       * We have to look in the extended depot.
-       */
-      depotBlockIndexPos = Storage32Impl_GetExtDepotBlock(This, depotBlockCount);
-    }
-
-    StorageImpl_ReadBigBlock(This, depotBlockIndexPos, depotBuffer, &read);
-
-    if (!read)
-      return STG_E_READFAULT;
-
-    num_blocks = This->bigBlockSize / 4;
-
-    for (index = 0; index < num_blocks; index++)
-    {
-      StorageUtl_ReadDWord(depotBuffer, index*sizeof(ULONG), nextBlockIndex);
-      This->blockDepotCached[index] = *nextBlockIndex;
-    }
-  }
+  hr = StorageImpl_GetDepotBlock(This, depotBlockCount, &depotBlock);
+  if (FAILED(hr))
+    return hr;
 
-  *nextBlockIndex = This->blockDepotCached[depotBlockOffset/sizeof(ULONG)];
+  *nextBlockIndex = depotBlock[depotBlockOffset/sizeof(ULONG)];
 
   return S_OK;
 }
@@ -4127,6 +4197,7 @@ static void StorageImpl_SetNextBlockInChain(
   ULONG depotBlockCount  = offsetInDepot / This->bigBlockSize;
   ULONG depotBlockOffset = offsetInDepot % This->bigBlockSize;
   ULONG depotBlockIndexPos;
+  ULONG i;
 
   assert(depotBlockCount < This->bigBlockDepotCount);
   assert(blockIndex != nextBlock);
@@ -4155,9 +4226,14 @@ static void StorageImpl_SetNextBlockInChain(
   /*
    * Update the cached block depot, if necessary.
    */
-  if (depotBlockCount == This->indexBlockDepotCached)
+  for (i = 0; i < DEPOT_CACHE_SIZE; i++)
   {
-    This->blockDepotCached[depotBlockOffset/sizeof(ULONG)] = nextBlock;
+    if (This->depotCache[i].index == depotBlockCount)
+    {
+      This->depotCacheData[i * (This->bigBlockSize / sizeof(ULONG)) +
+                           depotBlockOffset/sizeof(ULONG)] = nextBlock;
+      break;
+    }
   }
 }
 
@@ -4692,7 +4768,7 @@ static HRESULT StorageImpl_Refresh(StorageImpl *This, BOOL new_object, BOOL crea
   /*
    * There is no block depot cached yet.
    */
-  This->indexBlockDepotCached = 0xFFFFFFFF;
+  StorageImpl_InvalidateDepotCache(This);
   This->indexExtBlockDepotCached = 0xFFFFFFFF;
 
   /*
@@ -5189,11 +5265,16 @@ static void StorageImpl_Destroy(StorageBaseImpl* iface)
   int i;
   TRACE("(%p)\n", This);
 
+  TRACE("depot cache %u hits %u misses, read-ahead %u hits %u fills, %u coalesced reads %u writes\n",
+        This->depotCacheHits, This->depotCacheMisses, This->readAheadHits, This->readAheadMisses,
+        This->coalescedReads, This->coalescedWrites);
+
   StorageImpl_Flush(iface);
 
   StorageImpl_Invalidate(iface);
 
   HeapFree(GetProcessHeap(), 0, This->extBigBlockDepotLocations);
+  HeapFree(GetProcessHeap(), 0, This->depotCacheData);
 
   BlockChainStream_Destroy(This->smallBlockRootChain);
   BlockChainStream_Destroy(This->rootBlockChain);
@@ -7180,14 +7261,25 @@ static HRESULT BlockChainStream_UpdateIndexCache(BlockChainStream* This)
   return S_OK;
 }
 
-/* Locate the nth block in this stream. */
-static ULONG BlockChainStream_GetSectorOfOffset(BlockChainStream *This, ULONG offset)
+/* Locate the run containing the nth block in this stream. */
+static struct BlockChainRun *BlockChainStream_GetRunOfOffset(BlockChainStream *This, ULONG offset)
 {
   ULONG min_offset = 0, max_offset = This->numBlocks-1;
   ULONG min_run = 0, max_run = This->indexCacheLen-1;
+  struct BlockChainRun *run;
 
   if (offset >= This->numBlocks)
-    return BLOCK_END_OF_CHAIN;
+    return NULL;
+
+  /* Sequential access usually stays in the same run or moves to the next one. */
+  if (This->lastRun < This->indexCacheLen)
+  {
+    run = &This->indexCache[This->lastRun];
+    if (offset >= run->firstOffset && offset <= run->lastOffset)
+      return run;
+    if (This->lastRun + 1 < This->indexCacheLen && offset == run->lastOffset + 1)
+      return &This->indexCache[++This->lastRun];
+  }
 
   while (min_run < max_run)
   {
@@ -7207,7 +7299,92 @@ static ULONG BlockChainStream_GetSectorOfOffset(BlockChainStream *This, ULONG of
       min_run = max_run = run_to_check;
   }
 
-  return This->indexCache[min_run].firstSector + offset - This->indexCache[min_run].firstOffset;
+  This->lastRun = min_run;
+  return &This->indexCache[min_run];
+}
+
+/* Locate the nth block in this stream. */
+static ULONG BlockChainStream_GetSectorOfOffset(BlockChainStream *This, ULONG offset)
+{
+  struct BlockChainRun *run = BlockChainStream_GetRunOfOffset(This, offset);
+
+  if (!run)
+    return BLOCK_END_OF_CHAIN;
+
+  return run->firstSector + offset - run->firstOffset;
+}
+
+/* Returns how many blocks, starting with the given one and up to max_blocks,
+ * lie in consecutive sectors and can be accessed directly in the file. Blocks
+ * held in cachedBlocks end the range, as they may contain newer data. */
+static ULONG BlockChainStream_GetContiguousBlocks(BlockChainStream *This, ULONG index, ULONG max_blocks)
+{
+  struct BlockChainRun *run = BlockChainStream_GetRunOfOffset(This, index);
+  ULONG count, i;
+
+  if (!run)
+    return 0;
+
+  count = min(run->lastOffset - index + 1, max_blocks);
+  for (i=0; i<2; i++)
+  {
+    if (This->cachedBlocks[i].index > index && This->cachedBlocks[i].index - index < count)
+      count = This->cachedBlocks[i].index - index;
+  }
+  return count;
+}
+
+/* Reads the contents of a cached block, from the read-ahead window if
+ * possible. Reading the block following the previous one refills the
+ * window with the blocks after it. */
+static HRESULT BlockChainStream_ReadBlock(BlockChainStream *This, BlockChainBlock *block)
+{
+  StorageImpl *storage = This->parentStorage;
+  ULARGE_INTEGER offset;
+  ULONG read, count;
+  BOOL sequential = (block->index == This->lastReadIndex + 1);
+
+  This->lastReadIndex = block->index;
+
+  if (block->index - This->readAheadIndex < This->readAheadCount)
+  {
+    memcpy(block->data, This->readAhead + (block->index - This->readAheadIndex) * storage->bigBlockSize,
+           storage->bigBlockSize);
+    storage->readAheadHits++;
+    return S_OK;
+  }
+
+  This->readAheadCount = 0;
+  if (sequential && storage->base.lockingrole != SWMR_Reader &&
+      (count = BlockChainStream_GetContiguousBlocks(This, block->index, READAHEAD_BLOCKS)) > 1)
+  {
+    if (!This->readAhead)
+      This->readAhead = HeapAlloc(GetProcessHeap(), 0, READAHEAD_BLOCKS * storage->bigBlockSize);
+
+    offset.QuadPart = StorageImpl_GetBigBlockOffset(storage, block->sector);
+    if (This->readAhead &&
+        SUCCEEDED(StorageImpl_ReadAt(storage, offset, This->readAhead, count * storage->bigBlockSize, &read)) &&
+        read >= storage->bigBlockSize)
+    {
+      /* Only keep complete blocks; the file may end before the last one. */
+      This->readAheadIndex = block->index;
+      This->readAheadCount = read / storage->bigBlockSize;
+      memcpy(block->data, This->readAhead, storage->bigBlockSize);
+      storage->readAheadMisses++;
+      return S_OK;
+    }
+  }
+
+  if (FAILED(StorageImpl_ReadBigBlock(storage, block->sector, block->data, &read)) && !read)
+    return STG_E_READFAULT;
+  return S_OK;
+}
+
+/* Drops the blocks in the given range from the read-ahead window. */
+static void BlockChainStream_InvalidateReadAhead(BlockChainStream *This, ULONG index, ULONG count)
+{
+  if (index < This->readAheadIndex + This->readAheadCount && This->readAheadIndex < index + count)
+    This->readAheadCount = 0;
 }
 
 static HRESULT BlockChainStream_GetBlockAtOffset(BlockChainStream *This,
@@ -7279,6 +7456,12 @@ BlockChainStream* BlockChainStream_Construct(
   newStream->cachedBlocks[1].index = 0xffffffff;
   newStream->cachedBlocks[1].dirty = FALSE;
   newStream->blockToEvict          = 0;
+  newStream->lastRun               = 0;
+  newStream->readAhead             = NULL;
+  newStream->readAheadIndex        = 0;
+  newStream->readAheadCount        = 0;
+  /* so that reading the first block counts as sequential */
+  newStream->lastReadIndex         = 0xffffffff;
 
   if (FAILED(BlockChainStream_UpdateIndexCache(newStream)))
   {
@@ -7313,6 +7496,7 @@ void BlockChainStream_Destroy(BlockChainStream* This)
   {
     BlockChainStream_Flush(This);
     HeapFree(GetProcessHeap(), 0, This->indexCache);
+    HeapFree(GetProcessHeap(), 0, This->readAhead);
   }
   HeapFree(GetProcessHeap(), 0, This);
 }
@@ -7406,6 +7590,7 @@ static BOOL BlockChainStream_Shrink(BlockChainStream* This,
       This->cachedBlocks[i].dirty = FALSE;
     }
   }
+  BlockChainStream_InvalidateReadAhead(This, numBlocks, ~0u - numBlocks);
 
   return TRUE;
 }
@@ -7654,7 +7839,18 @@ HRESULT BlockChainStream_ReadAt(BlockChainStream* This,
 
     if (!cachedBlock)
     {
-      /* Not in cache, and we're going to read past the end of the block. */
+      /* Not in cache, and we're going to read past the end of the block.
+       * Read the following whole blocks too while they are contiguous. */
+      ULONG blocks = BlockChainStream_GetContiguousBlocks(This, blockNoInSequence,
+          ((ULONGLONG)offsetInBlock + size - 1) / This->parentStorage->bigBlockSize);
+
+      if (blocks > 1)
+      {
+        bytesToReadInBuffer = blocks * This->parentStorage->bigBlockSize - offsetInBlock;
+        blockNoInSequence += blocks - 1;
+        This->parentStorage->coalescedReads++;
+      }
+
       ulOffset.QuadPart = StorageImpl_GetBigBlockOffset(This->parentStorage, blockIndex) +
                                offsetInBlock;
 
@@ -7668,9 +7864,9 @@ HRESULT BlockChainStream_ReadAt(BlockChainStream* This,
     {
       if (!cachedBlock->read)
       {
-        ULONG read;
-        if (FAILED(StorageImpl_ReadBigBlock(This->parentStorage, cachedBlock->sector, cachedBlock->data, &read)) && !read)
-          return STG_E_READFAULT;
+        hr = BlockChainStream_ReadBlock(This, cachedBlock);
+        if (FAILED(hr))
+          return hr;
 
         cachedBlock->read = TRUE;
       }
@@ -7738,7 +7934,22 @@ HRESULT BlockChainStream_WriteAt(BlockChainStream* This,
 
     if (!cachedBlock)
     {
-      /* Not in cache, and we're going to write past the end of the block. */
+      /* Not in cache, and we're going to write past the end of the block.
+       * Write the following whole blocks too while they are contiguous. */
+      ULONG blocks = BlockChainStream_GetContiguousBlocks(This, blockNoInSequence,
+          ((ULONGLONG)offsetInBlock + size - 1) / This->parentStorage->bigBlockSize);
+
+      if (blocks > 1)
+      {
+        bytesToWrite = blocks * This->parentStorage->bigBlockSize - offsetInBlock;
+        This->parentStorage->coalescedWrites++;
+      }
+      else
+        blocks = 1;
+
+      BlockChainStream_InvalidateReadAhead(This, blockNoInSequence, blocks);
+      blockNoInSequence += blocks - 1;
+
       ulOffset.QuadPart = StorageImpl_GetBigBlockOffset(This->parentStorage, blockIndex) +
                                offsetInBlock;
 
@@ -7752,15 +7963,16 @@ HRESULT BlockChainStream_WriteAt(BlockChainStream* This,
     {
       if (!cachedBlock->read && bytesToWrite != This->parentStorage->bigBlockSize)
       {
-        ULONG read;
-        if (FAILED(StorageImpl_ReadBigBlock(This->parentStorage, cachedBlock->sector, cachedBlock->data, &read)) && !read)
-          return STG_E_READFAULT;
+        hr = BlockChainStream_ReadBlock(This, cachedBlock);
+        if (FAILED(hr))
+          return hr;
       }
 
       memcpy(cachedBlock->data+offsetInBlock, bufferWalker, bytesToWrite);
       bytesWrittenAt = bytesToWrite;
       cachedBlock->read = TRUE;
       cachedBlock->dirty = TRUE;
+      BlockChainStream_InvalidateReadAhead(This, blockNoInSequence, 1);
     }
 
     blockNoInSequence++;
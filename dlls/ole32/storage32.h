@@ -360,7 +360,16 @@ void StorageBaseImpl_AddStream(StorageBaseImpl * stg, StgStreamImpl * strm) DECL
 void StorageBaseImpl_RemoveStream(StorageBaseImpl * stg, StgStreamImpl * strm) DECLSPEC_HIDDEN;
 
 /* Number of BlockChainStream objects to cache in a StorageImpl */
-#define BLOCKCHAIN_CACHE_SIZE 4
+#define BLOCKCHAIN_CACHE_SIZE 8
+
+/* Number of big block depot blocks to cache in a StorageImpl */
+#define DEPOT_CACHE_SIZE 32
+
+struct DepotCacheEntry
+{
+  ULONG index;    /* index of the depot block, 0xffffffff if unused */
+  ULONG lastUsed; /* value of depotCacheTick when last accessed */
+};
 
 /****************************************************************************
  * StorageImpl definitions.
@@ -393,8 +402,13 @@ struct StorageImpl
   ULONG extBlockDepotCached[MAX_BIG_BLOCK_SIZE / 4];
   ULONG indexExtBlockDepotCached;
 
-  ULONG blockDepotCached[MAX_BIG_BLOCK_SIZE / 4];
-  ULONG indexBlockDepotCached;
+  /* Most recently used depot blocks; depotCacheData holds bigBlockSize / 4
+   * entries in host byte order for each of them. */
+  struct DepotCacheEntry depotCache[DEPOT_CACHE_SIZE];
+  ULONG *depotCacheData;
+  ULONG depotCacheBlockSize; /* bigBlockSize depotCacheData was allocated for */
+  ULONG depotCacheTick;
+  ULONG depotCacheLast;
   ULONG prevFreeBlock;
 
   /* All small blocks before this one are known to be in use. */
@@ -416,6 +430,14 @@ struct StorageImpl
   ILockBytes* lockBytes;
 
   ULONG locked_bytes[8];
+
+  /* Cache statistics, traced when the storage is destroyed. */
+  ULONG depotCacheHits;
+  ULONG depotCacheMisses;
+  ULONG readAheadHits;
+  ULONG readAheadMisses;
+  ULONG coalescedReads;
+  ULONG coalescedWrites;
 };
 
 /****************************************************************************
@@ -3919,6 +3919,123 @@ static void test_custom_lockbytes(void)
     DeleteTestLockBytes(lockbytes);
 }
 
+static void check_stream_data(IStream *stm, const BYTE *expected, ULONG size, ULONG chunk, int line)
+{
+    BYTE buffer[1024];
+    LARGE_INTEGER pos;
+    ULONG offset, count, read;
+    HRESULT r;
+
+    pos.QuadPart = 0;
+    r = IStream_Seek(stm, pos, STREAM_SEEK_SET, NULL);
+    ok_(__FILE__, line)(r == S_OK, "IStream->Seek failed %x\n", r);
+
+    for (offset = 0; offset < size; offset += read)
+    {
+        count = min(chunk, size - offset);
+        r = IStream_Read(stm, buffer, count, &read);
+        ok_(__FILE__, line)(r == S_OK, "IStream->Read failed %x\n", r);
+        ok_(__FILE__, line)(read == count, "read %u bytes at %u, expected %u\n", read, offset, count);
+        if (read != count) break;
+        if (memcmp(buffer, expected + offset, count))
+        {
+            ok_(__FILE__, line)(0, "unexpected data in the %u bytes at %u\n", count, offset);
+            break;
+        }
+    }
+
+    r = IStream_Read(stm, buffer, sizeof(buffer), &read);
+    ok_(__FILE__, line)(r == S_OK, "IStream->Read failed %x\n", r);
+    ok_(__FILE__, line)(!read, "read %u bytes past the end\n", read);
+}
+
+static void test_block_chain_io(void)
+{
+    static const WCHAR stmname[] = { 'C','O','N','T','E','N','T','S',0 };
+    static const ULONG write_sizes[] = { 1, 511, 513, 1000, 3, 4096, 777, 2048, 5, 1531 };
+    static BYTE expected[40000];
+    BYTE buffer[4096];
+    IStorage *stg;
+    IStream *stm;
+    LARGE_INTEGER pos;
+    ULARGE_INTEGER size;
+    ULONG offset, count, read, i;
+    HRESULT r;
+
+    for (i = 0; i < sizeof(expected); i++)
+        expected[i] = (i * 7 + i / 251) & 0xff;
+
+    DeleteFileA(filenameA);
+
+    r = StgCreateDocfile(filename, STGM_CREATE | STGM_READWRITE | STGM_SHARE_EXCLUSIVE, 0, &stg);
+    ok(r == S_OK, "StgCreateDocfile failed %x\n", r);
+
+    r = IStorage_CreateStream(stg, stmname, STGM_SHARE_EXCLUSIVE | STGM_READWRITE, 0, 0, &stm);
+    ok(r == S_OK, "IStorage->CreateStream failed %x\n", r);
+
+    /* unaligned partial writes, each followed by a sequential read of what
+     * was written so far */
+    for (offset = 0, i = 0; offset < sizeof(expected); offset += count, i++)
+    {
+        count = min(write_sizes[i % ARRAY_SIZE(write_sizes)], sizeof(expected) - offset);
+        r = IStream_Write(stm, expected + offset, count, NULL);
+        ok(r == S_OK, "IStream->Write failed %x\n", r);
+
+        pos.QuadPart = offset + count > 3000 ? offset + count - 3000 : 0;
+        r = IStream_Seek(stm, pos, STREAM_SEEK_SET, NULL);
+        ok(r == S_OK, "IStream->Seek failed %x\n", r);
+        r = IStream_Read(stm, buffer, offset + count - pos.u.LowPart, &read);
+        ok(r == S_OK, "IStream->Read failed %x\n", r);
+        ok(read == offset + count - pos.u.LowPart, "read %u bytes at %u\n", read, pos.u.LowPart);
+        ok(!memcmp(buffer, expected + pos.u.LowPart, read), "unexpected data at %u\n", pos.u.LowPart);
+    }
+
+    check_stream_data(stm, expected, sizeof(expected), 333, __LINE__);
+    check_stream_data(stm, expected, sizeof(expected), 1024, __LINE__);
+
+    /* shrink the stream, then regrow it and rewrite the new part */
+    size.QuadPart = 5000;
+    r = IStream_SetSize(stm, size);
+    ok(r == S_OK, "IStream->SetSize failed %x\n", r);
+
+    check_stream_data(stm, expected, 5000, 333, __LINE__);
+
+    size.QuadPart = 30000;
+    r = IStream_SetSize(stm, size);
+    ok(r == S_OK, "IStream->SetSize failed %x\n", r);
+
+    for (i = 5000; i < 30000; i++)
+        expected[i] = ~expected[i];
+
+    pos.QuadPart = 5000;
+    r = IStream_Seek(stm, pos, STREAM_SEEK_SET, NULL);
+    ok(r == S_OK, "IStream->Seek failed %x\n", r);
+    for (offset = 5000, i = 0; offset < 30000; offset += count, i++)
+    {
+        count = min(write_sizes[i % ARRAY_SIZE(write_sizes)], 30000 - offset);
+        r = IStream_Write(stm, expected + offset, count, NULL);
+        ok(r == S_OK, "IStream->Write failed %x\n", r);
+    }
+
+    check_stream_data(stm, expected, 30000, 333, __LINE__);
+
+    IStream_Release(stm);
+    IStorage_Release(stg);
+
+    r = StgOpenStorage(filename, NULL, STGM_READ | STGM_SHARE_EXCLUSIVE, NULL, 0, &stg);
+    ok(r == S_OK, "StgOpenStorage failed %x\n", r);
+
+    r = IStorage_OpenStream(stg, stmname, NULL, STGM_READ | STGM_SHARE_EXCLUSIVE, 0, &stm);
+    ok(r == S_OK, "IStorage->OpenStream failed %x\n", r);
+
+    check_stream_data(stm, expected, 30000, 1000, __LINE__);
+
+    IStream_Release(stm);
+    IStorage_Release(stg);
+
+    DeleteFileA(filenameA);
+}
+
 START_TEST(storage32)
 {
     CHAR temp[MAX_PATH];
@@ -3968,4 +4085,5 @@ START_TEST(storage32)
     test_transacted_shared();
     test_overwrite();
     test_custom_lockbytes();
+    test_block_chain_io();
 }
@@ -249,22 +249,39 @@ void WINAPI mouse_event( DWORD dwFlags, DWORD dx, DWORD dy,
  */
 BOOL WINAPI DECLSPEC_HOTPATCH GetCursorPos( POINT *pt )
 {
+    const desktop_shm_t *shared = get_desktop_shared_memory();
+    unsigned int seq;
     BOOL ret;
     DWORD last_change;
     UINT dpi;
 
     if (!pt) return FALSE;
 
-    SERVER_START_REQ( set_cursor )
+    if (shared)
     {
-        if ((ret = !wine_server_call( req )))
+        do
+        {
+            seq = __atomic_load_n( &shared->seq, __ATOMIC_ACQUIRE );
+            pt->x = shared->cursor_x;
+            pt->y = shared->cursor_y;
+            last_change = shared->cursor_last_change;
+            __atomic_thread_fence( __ATOMIC_ACQUIRE );
+        } while ((seq & 1) || seq != shared->seq);
+        ret = TRUE;
+    }
+    else
+    {
+        SERVER_START_REQ( set_cursor )
         {
-            pt->x = reply->new_x;
-            pt->y = reply->new_y;
-            last_change = reply->last_change;
+            if ((ret = !wine_server_call( req )))
+            {
+                pt->x = reply->new_x;
+                pt->y = reply->new_y;
+                last_change = reply->last_change;
+            }
         }
+        SERVER_END_REQ;
     }
-    SERVER_END_REQ;
 
     /* query new position from graphics driver if we haven't updated recently */
     if (ret && GetTickCount() - last_change > 100) ret = USER_Driver->pGetCursorPos( pt );
@@ -392,16 +409,32 @@ static void check_for_events( UINT flags )
  */
 SHORT WINAPI DECLSPEC_HOTPATCH GetAsyncKeyState( INT key )
 {
-    struct user_key_state_info *key_state_info = get_user_thread_info()->key_state;
+    struct user_key_state_info *key_state_info;
     INT counter = global_key_state_counter;
-    BYTE prev_key_state;
+    const desktop_shm_t *shared;
+    BYTE prev_key_state, state;
+    unsigned int seq;
     SHORT ret;
 
     if (key < 0 || key >= 256) return 0;
 
     check_for_events( QS_INPUT );
 
-    if (key_state_info && !(key_state_info->state[key] & 0xc0) &&
+    if ((shared = get_desktop_shared_memory()))
+    {
+        do
+        {
+            seq = __atomic_load_n( &shared->seq, __ATOMIC_ACQUIRE );
+            state = shared->keystate[key];
+            __atomic_thread_fence( __ATOMIC_ACQUIRE );
+        } while ((seq & 1) || seq != shared->seq);
+
+        /* the server has to clear the pressed since last call flag */
+        if (!(state & 0x40)) return (state & 0x80) ? 0x8000 : 0;
+    }
+
+    key_state_info = get_user_thread_info()->key_state;
+    if (!shared && key_state_info && !(key_state_info->state[key] & 0xc0) &&
         key_state_info->counter == counter && GetTickCount() - key_state_info->time < 50)
     {
         /* use cached value */
@@ -451,7 +484,7 @@ SHORT WINAPI DECLSPEC_HOTPATCH GetAsyncKeyState( INT key )
  */
 DWORD WINAPI GetQueueStatus( UINT flags )
 {
-    DWORD ret;
+    DWORD ret, wake_bits, changed_bits;
 
     if (flags & ~(QS_ALLINPUT | QS_ALLPOSTMESSAGE | QS_SMRESULT))
     {
@@ -461,6 +494,10 @@ DWORD WINAPI GetQueueStatus( UINT flags )
 
     check_for_events( flags );
 
+    /* nothing to clear, the shared queue status is all we need */
+    if (__wine_fsync_get_queue_bits( &wake_bits, &changed_bits ) && !(changed_bits & flags))
+        return MAKELONG( 0, wake_bits & flags );
+
     SERVER_START_REQ( get_queue_status )
     {
         req->clear_bits = flags;
@@ -477,10 +514,13 @@ DWORD WINAPI GetQueueStatus( UINT flags )
  */
 BOOL WINAPI GetInputState(void)
 {
-    DWORD ret;
+    DWORD ret, wake_bits, changed_bits;
 
     check_for_events( QS_INPUT );
 
+    if (__wine_fsync_get_queue_bits( &wake_bits, &changed_bits ))
+        return wake_bits & (QS_KEY | QS_MOUSEBUTTON);
+
     SERVER_START_REQ( get_queue_status )
     {
         req->clear_bits = 0;
@@ -2757,6 +2757,29 @@ static inline void call_sendmsg_callback( SENDASYNCPROC callback, HWND hwnd, UIN
 }
 
 
+/***********************************************************************
+ *           is_queue_empty
+ *
+ * Check the shared queue status to see if a get_message request is sure
+ * to come back empty, in which case it can be skipped.
+ */
+static BOOL is_queue_empty( HWND hwnd, UINT changed_mask )
+{
+    struct user_thread_info *thread_info = get_user_thread_info();
+    DWORD wake_bits, changed_bits, hooks_serial;
+
+    /* the server would need to update the queue masks or the idle event */
+    if (changed_mask || hwnd == HWND_BROADCAST || hwnd == HWND_TOPMOST) return FALSE;
+    /* the server uses get_message requests to detect hung queues */
+    if (GetTickCount() - thread_info->last_get_msg >= 1000) return FALSE;
+    /* active_hooks is refreshed by get_message replies */
+    if (!__wine_fsync_get_hooks_serial( &hooks_serial ) || hooks_serial != thread_info->hooks_serial)
+        return FALSE;
+    if (!__wine_fsync_get_queue_bits( &wake_bits, &changed_bits )) return FALSE;
+    return !wake_bits && !changed_bits;
+}
+
+
 /***********************************************************************
  *           peek_message
  *
@@ -2774,6 +2797,8 @@ static int peek_message( MSG *msg, HWND hwnd, UINT first, UINT last, UINT flags,
     void *buffer;
     size_t buffer_size = 256;
 
+    if (is_queue_empty( hwnd, changed_mask )) return 0;
+
     if (!(buffer = HeapAlloc( GetProcessHeap(), 0, buffer_size ))) return -1;
 
     if (!first && !last) last = ~0;
@@ -2784,6 +2809,8 @@ static int peek_message( MSG *msg, HWND hwnd, UINT first, UINT last, UINT flags,
         NTSTATUS res;
         size_t size = 0;
         const message_data_t *msg_data = buffer;
+        DWORD hooks_serial;
+        BOOL hooks_serial_valid = __wine_fsync_get_hooks_serial( &hooks_serial );
 
         thread_info->msg_source = prev_source;
 
@@ -2810,11 +2837,14 @@ static int peek_message( MSG *msg, HWND hwnd, UINT first, UINT last, UINT flags,
                 info.msg.pt.y    = reply->y;
                 hw_id            = 0;
                 thread_info->active_hooks = reply->active_hooks;
+                if (hooks_serial_valid) thread_info->hooks_serial = hooks_serial;
             }
             else buffer_size = reply->total;
         }
         SERVER_END_REQ;
 
+        thread_info->last_get_msg = GetTickCount();
+
         if (res)
         {
             HeapFree( GetProcessHeap(), 0, buffer );
@@ -3090,13 +3120,19 @@ static DWORD wait_objects( DWORD count, const HANDLE *handles, DWORD timeout,
                            DWORD wake_mask, DWORD changed_mask, DWORD flags )
 {
     struct user_thread_info *thread_info = get_user_thread_info();
-    DWORD ret;
+    DWORD ret, queue_flags;
+    BOOL shared_status;
 
     assert( count );  /* we must have at least the server queue */
 
     flush_window_surfaces( TRUE );
 
-    if (thread_info->wake_mask != wake_mask || thread_info->changed_mask != changed_mask)
+    /* with the shared queue status, the server tells us when a wait on the
+     * queue reset the masks, and they can otherwise be left in place */
+    shared_status = __wine_fsync_get_queue_flags( &queue_flags );
+
+    if (thread_info->wake_mask != wake_mask || thread_info->changed_mask != changed_mask ||
+        (shared_status && (queue_flags & FSYNC_QUEUE_MASKS_RESET)))
     {
         SERVER_START_REQ( set_queue_mask )
         {
@@ -3112,7 +3148,7 @@ static DWORD wait_objects( DWORD count, const HANDLE *handles, DWORD timeout,
 
     ret = wow_handlers.wait_message( count, handles, timeout, changed_mask, flags );
 
-    if (ret != WAIT_TIMEOUT) thread_info->wake_mask = thread_info->changed_mask = 0;
+    if (ret != WAIT_TIMEOUT && !shared_status) thread_info->wake_mask = thread_info->changed_mask = 0;
     return ret;
 }
 
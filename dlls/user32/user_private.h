@@ -191,12 +191,19 @@ struct user_thread_info
     struct user_key_state_info   *key_state;              /* Cache of global key state */
     HWND                          top_window;             /* Desktop window */
     HWND                          msg_window;             /* HWND_MESSAGE parent window */
+    DWORD                         last_get_msg;           /* Time of last get_message request */
+    DWORD                         hooks_serial;           /* Hook change serial at last get_message */
     RAWINPUT                     *rawinput;
 };
 
 C_ASSERT( sizeof(struct user_thread_info) <= sizeof(((TEB *)0)->Win32ClientInfo) );
 
 extern INT global_key_state_counter DECLSPEC_HIDDEN;
+extern BOOL CDECL __wine_fsync_get_queue_bits( DWORD *wake_bits, DWORD *changed_bits );
+extern BOOL CDECL __wine_fsync_get_queue_flags( DWORD *flags );
+extern BOOL CDECL __wine_fsync_get_hooks_serial( DWORD *serial );
+extern const volatile struct desktop_shm *get_desktop_shared_memory(void) DECLSPEC_HIDDEN;
+extern void unmap_desktop_shared_memory(void) DECLSPEC_HIDDEN;
 extern BOOL (WINAPI *imm_register_window)(HWND) DECLSPEC_HIDDEN;
 extern void (WINAPI *imm_unregister_window)(HWND) DECLSPEC_HIDDEN;
 extern void (WINAPI *imm_activate_window)(HWND) DECLSPEC_HIDDEN;
@@ -206,6 +213,7 @@ struct user_key_state_info
     UINT                          time;                   /* Time of last key state refresh */
     INT                           counter;                /* Counter to invalidate the key state */
     BYTE                          state[256];             /* State for each key */
+    const volatile struct desktop_shm *shared;            /* Desktop shared memory */
 };
 
 struct hook_extra_info
@@ -430,11 +430,62 @@ BOOL WINAPI SetThreadDesktop( HDESK handle )
         thread_info->top_window = 0;
         thread_info->msg_window = 0;
         if (key_state_info) key_state_info->time = 0;
+        unmap_desktop_shared_memory();
     }
     return ret;
 }
 
 
+/***********************************************************************
+ *           get_desktop_shared_memory
+ *
+ * Map the block of desktop state that the server shares with us.
+ */
+const desktop_shm_t *get_desktop_shared_memory(void)
+{
+    struct user_thread_info *thread_info = get_user_thread_info();
+    struct user_key_state_info *key_state_info = thread_info->key_state;
+    HANDLE handle = 0;
+    SIZE_T size = 0;
+    void *ptr = NULL;
+
+    if (key_state_info && key_state_info->shared) return key_state_info->shared;
+
+    if (!key_state_info)
+    {
+        if (!(key_state_info = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*key_state_info) )))
+            return NULL;
+        thread_info->key_state = key_state_info;
+    }
+
+    SERVER_START_REQ( get_desktop_shared_memory )
+    {
+        if (!wine_server_call( req )) handle = wine_server_ptr_handle( reply->handle );
+    }
+    SERVER_END_REQ;
+    if (!handle) return NULL;
+
+    if (!NtMapViewOfSection( handle, GetCurrentProcess(), &ptr, 0, 0, NULL, &size,
+                             ViewUnmap, 0, PAGE_READONLY ))
+        key_state_info->shared = ptr;
+    NtClose( handle );
+    return key_state_info->shared;
+}
+
+
+/***********************************************************************
+ *           unmap_desktop_shared_memory
+ */
+void unmap_desktop_shared_memory(void)
+{
+    struct user_key_state_info *key_state_info = get_user_thread_info()->key_state;
+
+    if (!key_state_info || !key_state_info->shared) return;
+    NtUnmapViewOfSection( GetCurrentProcess(), (void *)key_state_info->shared );
+    key_state_info->shared = NULL;
+}
+
+
 /******************************************************************************
  *              EnumDesktopsA   (USER32.@)
  */
@@ -57,6 +57,10 @@ static RTL_CRITICAL_SECTION vcomp_section = { &critsect_debug, -1, 0, 0, 0, 0 };
 #define VCOMP_DYNAMIC_FLAGS_GUIDED      0x03
 #define VCOMP_DYNAMIC_FLAGS_INCREMENT   0x40
 
+/* number of pause loops a thread spins in a barrier before sleeping */
+#define VCOMP_BARRIER_MIN_SPIN          64
+#define VCOMP_BARRIER_MAX_SPIN          16384
+
 struct vcomp_thread_data
 {
     struct vcomp_team_data  *team;
@@ -94,27 +98,40 @@ struct vcomp_team_data
     __ms_va_list            valist;
 
     /* barrier */
-    unsigned int            barrier;
-    int                     barrier_count;
+    LONG                    barrier;
+    LONG                    barrier_count;
+    LONG                    barrier_waiters;
+    LONG                    barrier_spin;
+};
+
+/* description of a dynamic loop, see vcomp_task_data */
+struct vcomp_dynamic_loop
+{
+    unsigned int            first;
+    unsigned int            last;
+    unsigned int            iterations;
+    int                     step;
+    unsigned int            chunksize;
 };
 
 struct vcomp_task_data
 {
+    SRWLOCK                 lock;
+
     /* single */
-    unsigned int            single;
+    LONG                    single;
 
     /* section */
     unsigned int            section;
     int                     num_sections;
     int                     section_index;
 
-    /* dynamic */
+    /* dynamic, the loop generation and the number of dispatched iterations are updated
+     * atomically together. Loops alternate between two descriptors, so that threads still
+     * looking at the previous loop never see the descriptor being initialized. */
     unsigned int            dynamic;
-    unsigned int            dynamic_first;
-    unsigned int            dynamic_last;
-    unsigned int            dynamic_iterations;
-    int                     dynamic_step;
-    unsigned int            dynamic_chunksize;
+    LONGLONG                dynamic_state;
+    struct vcomp_dynamic_loop dynamic_loops[2];
 };
 
 #if defined(__i386__)
@@ -366,6 +383,15 @@ static short interlocked_xchg_add16(short *dest, short incr)
 
 #endif  /* __GNUC__ */
 
+static inline void vcomp_pause(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+    __asm__ __volatile__( "rep;nop" : : : "memory" );
+#else
+    __asm__ __volatile__( "" : : : "memory" );
+#endif
+}
+
 static inline struct vcomp_thread_data *vcomp_get_thread_data(void)
 {
     return (struct vcomp_thread_data *)TlsGetValue(vcomp_context_tls);
@@ -392,9 +418,11 @@ static struct vcomp_thread_data *vcomp_init_thread_data(void)
         ExitProcess(1);
     }
 
+    InitializeSRWLock(&data->task.lock);
     data->task.single           = 0;
     data->task.section          = 0;
     data->task.dynamic          = 0;
+    data->task.dynamic_state    = 0;
 
     thread_data = &data->thread;
     thread_data->team           = NULL;
@@ -1041,26 +1069,43 @@ void CDECL _vcomp_flush(void)
 void CDECL _vcomp_barrier(void)
 {
     struct vcomp_team_data *team_data = vcomp_init_thread_data()->team;
+    LONG barrier, spin, i;
 
     TRACE("()\n");
 
     if (!team_data)
         return;
 
-    EnterCriticalSection(&vcomp_section);
-    if (++team_data->barrier_count >= team_data->num_threads)
+    barrier = *(volatile LONG *)&team_data->barrier;
+    if (InterlockedIncrement(&team_data->barrier_count) >= team_data->num_threads)
     {
-        team_data->barrier++;
+        /* reset the count before releasing the other threads into the next barrier */
         team_data->barrier_count = 0;
-        WakeAllConditionVariable(&team_data->cond);
+        InterlockedIncrement(&team_data->barrier);
+        if (team_data->barrier_waiters)
+            RtlWakeAddressAll(&team_data->barrier);
+        return;
     }
-    else
+
+    /* spin first, adapting the spin count to how long the team usually waits */
+    spin = team_data->barrier_spin;
+    for (i = 0; i < spin; i++)
     {
-        unsigned int barrier = team_data->barrier;
-        while (team_data->barrier == barrier)
-            SleepConditionVariableCS(&team_data->cond, &vcomp_section, INFINITE);
+        if (*(volatile LONG *)&team_data->barrier != barrier)
+        {
+            if (spin < VCOMP_BARRIER_MAX_SPIN)
+                team_data->barrier_spin = spin * 2;
+            return;
+        }
+        vcomp_pause();
     }
-    LeaveCriticalSection(&vcomp_section);
+    if (spin > VCOMP_BARRIER_MIN_SPIN)
+        team_data->barrier_spin = spin / 2;
+
+    InterlockedIncrement(&team_data->barrier_waiters);
+    while (*(volatile LONG *)&team_data->barrier == barrier)
+        RtlWaitOnAddress(&team_data->barrier, &barrier, sizeof(barrier), NULL);
+    InterlockedDecrement(&team_data->barrier_waiters);
 }
 
 void CDECL _vcomp_set_num_threads(int num_threads)
@@ -1086,20 +1131,21 @@ int CDECL _vcomp_single_begin(int flags)
 {
     struct vcomp_thread_data *thread_data = vcomp_init_thread_data();
     struct vcomp_task_data *task_data = thread_data->task;
-    int ret = FALSE;
+    LONG single;
 
     TRACE("(%x): semi-stub\n", flags);
 
-    EnterCriticalSection(&vcomp_section);
+    /* the first thread reaching the block moves the task to it */
     thread_data->single++;
-    if ((int)(thread_data->single - task_data->single) > 0)
+    do
     {
-        task_data->single = thread_data->single;
-        ret = TRUE;
+        single = *(volatile LONG *)&task_data->single;
+        if ((int)(thread_data->single - single) <= 0)
+            return FALSE;
     }
-    LeaveCriticalSection(&vcomp_section);
+    while (InterlockedCompareExchange(&task_data->single, thread_data->single, single) != single);
 
-    return ret;
+    return TRUE;
 }
 
 void CDECL _vcomp_single_end(void)
@@ -1115,7 +1161,7 @@ void CDECL _vcomp_sections_init(int n)
 
     TRACE("(%d)\n", n);
 
-    EnterCriticalSection(&vcomp_section);
+    AcquireSRWLockExclusive(&task_data->lock);
     thread_data->section++;
     if ((int)(thread_data->section - task_data->section) > 0)
     {
@@ -1123,7 +1169,7 @@ void CDECL _vcomp_sections_init(int n)
         task_data->num_sections  = n;
         task_data->section_index = 0;
     }
-    LeaveCriticalSection(&vcomp_section);
+    ReleaseSRWLockExclusive(&task_data->lock);
 }
 
 int CDECL _vcomp_sections_next(void)
@@ -1134,13 +1180,13 @@ int CDECL _vcomp_sections_next(void)
 
     TRACE("()\n");
 
-    EnterCriticalSection(&vcomp_section);
+    AcquireSRWLockExclusive(&task_data->lock);
     if (thread_data->section == task_data->section &&
         task_data->section_index != task_data->num_sections)
     {
         i = task_data->section_index++;
     }
-    LeaveCriticalSection(&vcomp_section);
+    ReleaseSRWLockExclusive(&task_data->lock);
     return i;
 }
 
@@ -1326,19 +1372,26 @@ void CDECL _vcomp_for_dynamic_init(unsigned int flags, unsigned int first, unsig
             type = VCOMP_DYNAMIC_FLAGS_GUIDED;
         }
 
-        EnterCriticalSection(&vcomp_section);
+        AcquireSRWLockExclusive(&task_data->lock);
         thread_data->dynamic++;
         thread_data->dynamic_type = type;
         if ((int)(thread_data->dynamic - task_data->dynamic) > 0)
         {
-            task_data->dynamic              = thread_data->dynamic;
-            task_data->dynamic_first        = first;
-            task_data->dynamic_last         = last;
-            task_data->dynamic_iterations   = iterations;
-            task_data->dynamic_step         = step;
-            task_data->dynamic_chunksize    = chunksize;
+            struct vcomp_dynamic_loop *loop = &task_data->dynamic_loops[thread_data->dynamic & 1];
+            LONGLONG state;
+
+            loop->first         = first;
+            loop->last          = last;
+            loop->iterations    = iterations;
+            loop->step          = step;
+            loop->chunksize     = chunksize;
+            task_data->dynamic  = thread_data->dynamic;
+            /* publish the loop, no iterations dispatched yet */
+            do state = task_data->dynamic_state;
+            while (InterlockedCompareExchange64(&task_data->dynamic_state,
+                                                (LONGLONG)thread_data->dynamic << 32, state) != state);
         }
-        LeaveCriticalSection(&vcomp_section);
+        ReleaseSRWLockExclusive(&task_data->lock);
     }
 }
 
@@ -1361,26 +1414,43 @@ int CDECL _vcomp_for_dynamic_next(unsigned int *begin, unsigned int *end)
     else if (thread_data->dynamic_type == VCOMP_DYNAMIC_FLAGS_CHUNKED ||
              thread_data->dynamic_type == VCOMP_DYNAMIC_FLAGS_GUIDED)
     {
-        unsigned int iterations = 0;
-        EnterCriticalSection(&vcomp_section);
-        if (thread_data->dynamic == task_data->dynamic &&
-            task_data->dynamic_iterations != 0)
+        const struct vcomp_dynamic_loop *loop = &task_data->dynamic_loops[thread_data->dynamic & 1];
+        unsigned int iterations, remaining, index, first, last;
+        int step;
+        LONGLONG state;
+
+        /* claim the next chunk of the loop with a single compare and swap; the
+         * loop parameters are copied before it, since once the loop is done
+         * other threads may start reusing its slot for a later loop */
+        do
         {
-            iterations = min(task_data->dynamic_iterations, task_data->dynamic_chunksize);
+            state = InterlockedCompareExchange64(&task_data->dynamic_state, 0, 0);
+            if ((unsigned int)(state >> 32) != thread_data->dynamic)
+                return 0;
+            index = (unsigned int)state;
+            if (index >= loop->iterations)
+                return 0;
+
+            first      = loop->first;
+            last       = loop->last;
+            step       = loop->step;
+            remaining  = loop->iterations - index;
+            iterations = min(remaining, loop->chunksize);
             if (thread_data->dynamic_type == VCOMP_DYNAMIC_FLAGS_GUIDED &&
-                task_data->dynamic_iterations > num_threads * task_data->dynamic_chunksize)
+                remaining > num_threads * loop->chunksize)
             {
-                iterations = (task_data->dynamic_iterations + num_threads - 1) / num_threads;
+                iterations = (remaining + num_threads - 1) / num_threads;
             }
-            *begin = task_data->dynamic_first;
-            *end   = task_data->dynamic_first + (iterations - 1) * task_data->dynamic_step;
-            task_data->dynamic_iterations -= iterations;
-            task_data->dynamic_first      += iterations * task_data->dynamic_step;
-            if (!task_data->dynamic_iterations)
-                *end = task_data->dynamic_last;
+            if (!iterations)
+                return 0;
         }
-        LeaveCriticalSection(&vcomp_section);
-        return iterations != 0;
+        while (InterlockedCompareExchange64(&task_data->dynamic_state, state + iterations, state) != state);
+
+        *begin = first + index * step;
+        *end   = *begin + (iterations - 1) * step;
+        if (iterations == remaining)
+            *end = last;
+        return 1;
     }
 
     return 0;
@@ -1461,10 +1531,14 @@ void WINAPIV _vcomp_fork(BOOL ifval, int nargs, void *wrapper, ...)
     __ms_va_start(team_data.valist, wrapper);
     team_data.barrier           = 0;
     team_data.barrier_count     = 0;
+    team_data.barrier_waiters   = 0;
+    team_data.barrier_spin      = VCOMP_BARRIER_MIN_SPIN;
 
+    InitializeSRWLock(&task_data.lock);
     task_data.single            = 0;
     task_data.section           = 0;
     task_data.dynamic           = 0;
+    task_data.dynamic_state     = 0;
 
     thread_data.team            = &team_data;
     thread_data.task            = &task_data;
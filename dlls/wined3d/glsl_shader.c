@@ -127,6 +127,55 @@ struct constant_heap
     unsigned int size;
 };
 
+#define WINED3D_GLSL_BINARY_CACHE_MAGIC         0x42475744 /* "DWGB" */
+#define WINED3D_GLSL_BINARY_CACHE_VERSION       1
+#define WINED3D_GLSL_BINARY_CACHE_MAX_FILE_SIZE 0x40000000
+
+struct glsl_binary_cache_header
+{
+    DWORD magic;
+    DWORD version;
+    DWORD count;
+    DWORD reserved;
+};
+
+struct glsl_binary_cache_record
+{
+    UINT64 hash;
+    DWORD format;
+    DWORD size;
+    DWORD link_time;
+    DWORD reserved;
+};
+
+/* A linked program, keyed by a hash of the driver strings and the GLSL
+ * source of the attached shaders. */
+struct glsl_program_binary
+{
+    struct wine_rb_entry entry;
+    struct list lru_entry;
+    UINT64 hash;
+    GLenum format;
+    GLsizei size;
+    unsigned int link_time; /* in microseconds */
+    BYTE data[1];
+};
+
+struct glsl_program_binary_cache
+{
+    struct wine_rb_tree binaries;
+    struct list lru;
+    SIZE_T size;
+    SIZE_T max_size;
+    UINT64 driver_hash;
+    BOOL enabled;
+    BOOL dirty;
+    unsigned int hits;
+    unsigned int misses;
+    UINT64 time_saved; /* in microseconds */
+    char path[MAX_PATH];
+};
+
 /* GLSL shader private data */
 struct shader_glsl_priv
 {
@@ -144,6 +193,8 @@ struct shader_glsl_priv
     struct wine_rb_tree ffp_fragment_shaders;
     BOOL ffp_proj_control;
     BOOL legacy_lighting;
+
+    struct glsl_program_binary_cache binary_cache;
 };
 
 struct glsl_vs_program
@@ -10019,6 +10070,384 @@ static void shader_glsl_init_ps_uniform_locations(const struct wined3d_gl_info *
     string_buffer_release(&priv->string_buffers, name);
 }
 
+static inline UINT64 glsl_binary_hash(UINT64 hash, const void *data, SIZE_T size)
+{
+    const BYTE *p = data;
+
+    while (size--)
+    {
+        hash ^= *p++;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static int glsl_program_binary_compare(const void *key, const struct wine_rb_entry *entry)
+{
+    const struct glsl_program_binary *binary = WINE_RB_ENTRY_VALUE(entry, const struct glsl_program_binary, entry);
+    UINT64 hash = *(const UINT64 *)key;
+
+    if (hash > binary->hash) return 1;
+    if (hash < binary->hash) return -1;
+    return 0;
+}
+
+static UINT64 glsl_binary_cache_time(void)
+{
+    LARGE_INTEGER counter, freq;
+
+    if (!QueryPerformanceCounter(&counter) || !QueryPerformanceFrequency(&freq) || !freq.QuadPart)
+        return 0;
+    return counter.QuadPart / freq.QuadPart * 1000000
+            + counter.QuadPart % freq.QuadPart * 1000000 / freq.QuadPart;
+}
+
+static void glsl_binary_cache_remove(struct glsl_program_binary_cache *cache, struct glsl_program_binary *binary)
+{
+    wine_rb_remove(&cache->binaries, &binary->entry);
+    list_remove(&binary->lru_entry);
+    cache->size -= binary->size;
+    heap_free(binary);
+}
+
+static struct glsl_program_binary *glsl_binary_cache_add(struct glsl_program_binary_cache *cache,
+        UINT64 hash, GLenum format, GLsizei size, unsigned int link_time)
+{
+    struct glsl_program_binary *binary;
+    struct wine_rb_entry *entry;
+    struct list *tail;
+
+    if (size <= 0 || size > cache->max_size)
+        return NULL;
+
+    if ((entry = wine_rb_get(&cache->binaries, &hash)))
+        glsl_binary_cache_remove(cache, WINE_RB_ENTRY_VALUE(entry, struct glsl_program_binary, entry));
+
+    while (cache->size + size > cache->max_size && (tail = list_tail(&cache->lru)))
+        glsl_binary_cache_remove(cache, LIST_ENTRY(tail, struct glsl_program_binary, lru_entry));
+
+    if (!(binary = heap_alloc(FIELD_OFFSET(struct glsl_program_binary, data[size]))))
+        return NULL;
+    binary->hash = hash;
+    binary->format = format;
+    binary->size = size;
+    binary->link_time = link_time;
+    wine_rb_put(&cache->binaries, &hash, &binary->entry);
+    list_add_head(&cache->lru, &binary->lru_entry);
+    cache->size += size;
+
+    return binary;
+}
+
+static void glsl_binary_cache_load(struct glsl_program_binary_cache *cache)
+{
+    const struct glsl_binary_cache_record *record;
+    struct glsl_binary_cache_header header;
+    struct glsl_program_binary *binary;
+    LARGE_INTEGER file_size;
+    SIZE_T pos, size, padded;
+    unsigned int i;
+    BYTE *data = NULL;
+    HANDLE file;
+    DWORD read;
+
+    if ((file = CreateFileA(cache->path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+            OPEN_EXISTING, 0, NULL)) == INVALID_HANDLE_VALUE)
+        return;
+
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart < sizeof(header)
+            || file_size.QuadPart > WINED3D_GLSL_BINARY_CACHE_MAX_FILE_SIZE
+            || !(data = heap_alloc(file_size.QuadPart))
+            || !ReadFile(file, data, file_size.QuadPart, &read, NULL) || read != file_size.QuadPart)
+        goto done;
+
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != WINED3D_GLSL_BINARY_CACHE_MAGIC || header.version != WINED3D_GLSL_BINARY_CACHE_VERSION)
+    {
+        WARN("Ignoring program binary cache %s with version %#x.\n", debugstr_a(cache->path), header.version);
+        goto done;
+    }
+
+    /* Records are stored most recently used first. Binaries already in the
+     * cache are more recent than the ones in the file, and are kept. */
+    pos = sizeof(header);
+    size = read;
+    for (i = 0; i < header.count; ++i)
+    {
+        if (size - pos < sizeof(*record))
+            break;
+        record = (const struct glsl_binary_cache_record *)(data + pos);
+        pos += sizeof(*record);
+        padded = ((SIZE_T)record->size + 7) & ~(SIZE_T)7;
+        if (!record->size || padded > size - pos)
+            break;
+        if (cache->size + record->size > cache->max_size)
+            break;
+        if (!wine_rb_get(&cache->binaries, &record->hash)
+                && (binary = glsl_binary_cache_add(cache, record->hash, record->format,
+                record->size, record->link_time)))
+        {
+            memcpy(binary->data, record + 1, record->size);
+            /* keep the stored order */
+            list_remove(&binary->lru_entry);
+            list_add_tail(&cache->lru, &binary->lru_entry);
+        }
+        pos += padded;
+    }
+
+    TRACE("Read %u program binaries from %s, the cache now holds %lu bytes.\n",
+            i, debugstr_a(cache->path), (unsigned long)cache->size);
+
+done:
+    heap_free(data);
+    CloseHandle(file);
+}
+
+static void glsl_binary_cache_save(struct glsl_program_binary_cache *cache)
+{
+    static const BYTE padding[8];
+    struct glsl_binary_cache_record record;
+    struct glsl_binary_cache_header header;
+    struct glsl_program_binary *binary;
+    char tmp_path[MAX_PATH + 18];
+    BOOL ret = TRUE;
+    HANDLE file;
+    DWORD written;
+
+    /* Other devices, in this process or in others, may have saved programs
+     * since the cache was loaded; keep them rather than overwriting them. */
+    glsl_binary_cache_load(cache);
+
+    sprintf(tmp_path, "%s.%x.%x", cache->path, GetCurrentProcessId(), GetCurrentThreadId());
+    if ((file = CreateFileA(tmp_path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL)) == INVALID_HANDLE_VALUE)
+    {
+        WARN("Failed to create %s, error %u.\n", debugstr_a(tmp_path), GetLastError());
+        return;
+    }
+
+    header.magic = WINED3D_GLSL_BINARY_CACHE_MAGIC;
+    header.version = WINED3D_GLSL_BINARY_CACHE_VERSION;
+    header.count = list_count(&cache->lru);
+    header.reserved = 0;
+    ret = WriteFile(file, &header, sizeof(header), &written, NULL);
+
+    LIST_FOR_EACH_ENTRY(binary, &cache->lru, struct glsl_program_binary, lru_entry)
+    {
+        if (!ret)
+            break;
+        record.hash = binary->hash;
+        record.format = binary->format;
+        record.size = binary->size;
+        record.link_time = binary->link_time;
+        record.reserved = 0;
+        ret = WriteFile(file, &record, sizeof(record), &written, NULL)
+                && WriteFile(file, binary->data, binary->size, &written, NULL)
+                && WriteFile(file, padding, -binary->size & 7, &written, NULL);
+    }
+    CloseHandle(file);
+
+    /* Replace the file atomically; another process may be reading it. */
+    if (!ret || !MoveFileExA(tmp_path, cache->path, MOVEFILE_REPLACE_EXISTING))
+    {
+        WARN("Failed to write program binary cache %s, error %u.\n", debugstr_a(cache->path), GetLastError());
+        DeleteFileA(tmp_path);
+        return;
+    }
+    cache->dirty = FALSE;
+}
+
+static void glsl_binary_cache_init(struct glsl_program_binary_cache *cache)
+{
+    char *p;
+    DWORD len;
+
+    wine_rb_init(&cache->binaries, glsl_program_binary_compare);
+    list_init(&cache->lru);
+    cache->max_size = wined3d_settings.shader_cache_size;
+    if (!cache->max_size)
+        return;
+
+    if (wined3d_settings.shader_cache_path)
+    {
+        lstrcpynA(cache->path, wined3d_settings.shader_cache_path, sizeof(cache->path));
+    }
+    else
+    {
+        len = GetEnvironmentVariableA("LOCALAPPDATA", cache->path, sizeof(cache->path));
+        if (!len || len + sizeof("\\wined3d\\glsl_programs.bin") > sizeof(cache->path))
+            return;
+        strcat(cache->path, "\\wined3d");
+        CreateDirectoryA(cache->path, NULL);
+        strcat(cache->path, "\\glsl_programs.bin");
+    }
+    if ((p = strrchr(cache->path, '\\')) && !p[1])
+        return;
+
+    cache->enabled = TRUE;
+    glsl_binary_cache_load(cache);
+}
+
+static void glsl_binary_cache_cleanup(struct glsl_program_binary_cache *cache)
+{
+    struct glsl_program_binary *binary, *next;
+
+    if (cache->enabled)
+    {
+        TRACE("Program binary cache: %u hits, %u misses, %s us of link time saved.\n",
+                cache->hits, cache->misses, wine_dbgstr_longlong(cache->time_saved));
+        if (cache->dirty)
+            glsl_binary_cache_save(cache);
+    }
+
+    LIST_FOR_EACH_ENTRY_SAFE(binary, next, &cache->lru, struct glsl_program_binary, lru_entry)
+        heap_free(binary);
+}
+
+/* Context activation is done by the caller. */
+static BOOL glsl_binary_cache_check_driver(const struct wined3d_gl_info *gl_info,
+        struct glsl_program_binary_cache *cache)
+{
+    static const GLenum strings[] = {GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION};
+    const char *str;
+    unsigned int i;
+    GLint count = 0;
+
+    if (cache->driver_hash)
+        return TRUE;
+
+    if (gl_info->supported[ARB_GET_PROGRAM_BINARY])
+        gl_info->gl_ops.gl.p_glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &count);
+    if (!count)
+    {
+        TRACE("No program binary formats supported, disabling the program binary cache.\n");
+        cache->enabled = FALSE;
+        return FALSE;
+    }
+
+    cache->driver_hash = glsl_binary_hash(0xcbf29ce484222325ull,
+            &wined3d_settings.max_gl_version, sizeof(wined3d_settings.max_gl_version));
+    for (i = 0; i < ARRAY_SIZE(strings); ++i)
+    {
+        if ((str = (const char *)gl_info->gl_ops.gl.p_glGetString(strings[i])))
+            cache->driver_hash = glsl_binary_hash(cache->driver_hash, str, strlen(str) + 1);
+    }
+    return TRUE;
+}
+
+/* Context activation is done by the caller. */
+static BOOL shader_glsl_get_program_hash(const struct wined3d_gl_info *gl_info,
+        struct shader_glsl_priv *priv, GLuint program_id, UINT64 *hash)
+{
+    struct glsl_program_binary_cache *cache = &priv->binary_cache;
+    UINT64 shader_hashes[8], tmp;
+    GLuint shaders[ARRAY_SIZE(shader_hashes)];
+    GLint length, count = 0;
+    unsigned int i, j;
+    char *source;
+
+    if (!cache->enabled || !glsl_binary_cache_check_driver(gl_info, cache))
+        return FALSE;
+
+    GL_EXTCALL(glGetAttachedShaders(program_id, ARRAY_SIZE(shaders), &count, shaders));
+    if (!count || count > ARRAY_SIZE(shaders))
+        return FALSE;
+
+    for (i = 0; i < count; ++i)
+    {
+        length = 0;
+        GL_EXTCALL(glGetShaderiv(shaders[i], GL_SHADER_SOURCE_LENGTH, &length));
+        if (!length || !(source = heap_alloc(length)))
+            return FALSE;
+        GL_EXTCALL(glGetShaderSource(shaders[i], length, NULL, source));
+        shader_hashes[i] = glsl_binary_hash(0xcbf29ce484222325ull, source, length);
+        heap_free(source);
+
+        /* The order of attached shaders is implementation defined. */
+        for (j = i; j && shader_hashes[j - 1] > shader_hashes[j]; --j)
+        {
+            tmp = shader_hashes[j];
+            shader_hashes[j] = shader_hashes[j - 1];
+            shader_hashes[j - 1] = tmp;
+        }
+    }
+
+    *hash = glsl_binary_hash(cache->driver_hash, shader_hashes, count * sizeof(*shader_hashes));
+    return TRUE;
+}
+
+/* Context activation is done by the caller. */
+static void shader_glsl_link_program(const struct wined3d_gl_info *gl_info,
+        struct shader_glsl_priv *priv, GLuint program_id, BOOL cacheable)
+{
+    struct glsl_program_binary_cache *cache = &priv->binary_cache;
+    struct glsl_program_binary *binary;
+    struct wine_rb_entry *entry;
+    UINT64 hash, start, time;
+    GLint status, size;
+    GLsizei length;
+    GLenum format;
+
+    if (!cacheable || !shader_glsl_get_program_hash(gl_info, priv, program_id, &hash))
+    {
+        TRACE("Linking GLSL shader program %u.\n", program_id);
+        GL_EXTCALL(glLinkProgram(program_id));
+        shader_glsl_validate_link(gl_info, program_id);
+        return;
+    }
+
+    start = glsl_binary_cache_time();
+    if ((entry = wine_rb_get(&cache->binaries, &hash)))
+    {
+        binary = WINE_RB_ENTRY_VALUE(entry, struct glsl_program_binary, entry);
+
+        TRACE("Loading GLSL shader program %u from binary %s.\n", program_id, wine_dbgstr_longlong(hash));
+        GL_EXTCALL(glProgramBinary(program_id, binary->format, binary->data, binary->size));
+        GL_EXTCALL(glGetProgramiv(program_id, GL_LINK_STATUS, &status));
+        if (status)
+        {
+            time = glsl_binary_cache_time() - start;
+            if (binary->link_time > time)
+                cache->time_saved += binary->link_time - time;
+            ++cache->hits;
+            list_remove(&binary->lru_entry);
+            list_add_head(&cache->lru, &binary->lru_entry);
+            return;
+        }
+
+        /* The driver rejected the binary, e.g. after an update. */
+        WARN("Failed to load program binary %s.\n", wine_dbgstr_longlong(hash));
+        glsl_binary_cache_remove(cache, binary);
+        cache->dirty = TRUE;
+        start = glsl_binary_cache_time();
+    }
+    ++cache->misses;
+
+    TRACE("Linking GLSL shader program %u.\n", program_id);
+    GL_EXTCALL(glProgramParameteri(program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+    GL_EXTCALL(glLinkProgram(program_id));
+    GL_EXTCALL(glGetProgramiv(program_id, GL_LINK_STATUS, &status));
+    time = glsl_binary_cache_time() - start;
+    shader_glsl_validate_link(gl_info, program_id);
+    checkGLcall("link program");
+    if (!status)
+        return;
+
+    size = 0;
+    GL_EXTCALL(glGetProgramiv(program_id, GL_PROGRAM_BINARY_LENGTH, &size));
+    if (!(binary = glsl_binary_cache_add(cache, hash, 0, size, min(time, ~0u))))
+        return;
+    length = 0;
+    GL_EXTCALL(glGetProgramBinary(program_id, size, &length, &format, binary->data));
+    checkGLcall("glGetProgramBinary");
+    if (length != binary->size)
+    {
+        glsl_binary_cache_remove(cache, binary);
+        return;
+    }
+    binary->format = format;
+    cache->dirty = TRUE;
+}
+
 static HRESULT shader_glsl_compile_compute_shader(struct shader_glsl_priv *priv,
         const struct wined3d_context_gl *context_gl, struct wined3d_shader *shader)
 {
@@ -10082,9 +10511,7 @@ static HRESULT shader_glsl_compile_compute_shader(struct shader_glsl_priv *priv,
 
     list_add_head(&shader->linked_programs, &entry->cs.shader_entry);
 
-    TRACE("Linking GLSL shader program %u.\n", program_id);
-    GL_EXTCALL(glLinkProgram(program_id));
-    shader_glsl_validate_link(gl_info, program_id);
+    shader_glsl_link_program(gl_info, priv, program_id, TRUE);
 
     GL_EXTCALL(glUseProgram(program_id));
     checkGLcall("glUseProgram");
@@ -10411,10 +10838,9 @@ static void set_glsl_shader_program(const struct wined3d_context_gl *context_gl,
         list_add_head(ps_list, &entry->ps.shader_entry);
     }
 
-    /* Link the program */
-    TRACE("Linking GLSL shader program %u.\n", program_id);
-    GL_EXTCALL(glLinkProgram(program_id));
-    shader_glsl_validate_link(gl_info, program_id);
+    /* Link the program. Stream output declarations are not part of the
+     * generated source, so those programs can't be looked up by it. */
+    shader_glsl_link_program(gl_info, priv, program_id, !gshader || !gshader->u.gs.so_desc.element_count);
 
     shader_glsl_init_vs_uniform_locations(gl_info, priv, program_id, &entry->vs,
             vshader ? vshader->limits->constant_float : 0);
@@ -11004,6 +11430,7 @@ static HRESULT shader_glsl_alloc(struct wined3d_device *device, const struct win
     }
 
     wine_rb_init(&priv->program_lookup, glsl_program_key_compare);
+    glsl_binary_cache_init(&priv->binary_cache);
 
     priv->next_constant_version = 1;
     priv->vertex_pipe = vertex_pipe;
@@ -11035,6 +11462,7 @@ static void shader_glsl_free(struct wined3d_device *device, struct wined3d_conte
     struct shader_glsl_priv *priv = device->shader_priv;
 
     wine_rb_destroy(&priv->program_lookup, NULL, NULL);
+    glsl_binary_cache_cleanup(&priv->binary_cache);
     constant_heap_free(&priv->pconst_heap);
     constant_heap_free(&priv->vconst_heap);
     heap_free(priv->stack);
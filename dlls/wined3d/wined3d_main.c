@@ -119,6 +119,8 @@ struct wined3d_settings wined3d_settings =
     ~0u,            /* No CS shader model limit by default. */
     WINED3D_RENDERER_AUTO,
     WINED3D_SHADER_BACKEND_AUTO,
+    64 * 1024 * 1024, /* 64 MiB GLSL program binary cache. */
+    NULL,           /* Program binary cache in the local application data directory. */
 };
 
 struct wined3d * CDECL wined3d_create(DWORD flags)
@@ -374,6 +376,20 @@ static BOOL wined3d_dll_init(HINSTANCE hInstDLL)
             TRACE("Limiting PS shader model to %u.\n", wined3d_settings.max_sm_ps);
         if (!get_config_key_dword(hkey, appkey, "MaxShaderModelCS", &wined3d_settings.max_sm_cs))
             TRACE("Limiting CS shader model to %u.\n", wined3d_settings.max_sm_cs);
+        if (!get_config_key_dword(hkey, appkey, "ShaderCacheSize", &tmpvalue))
+        {
+            TRACE("Limiting the shader cache to %u MiB.\n", tmpvalue);
+            wined3d_settings.shader_cache_size = (SIZE_T)min(tmpvalue, 512) * 1024 * 1024;
+        }
+        if (!get_config_key(hkey, appkey, "ShaderCachePath", buffer, size))
+        {
+            size_t len = strlen(buffer) + 1;
+
+            if (!(wined3d_settings.shader_cache_path = heap_alloc(len)))
+                ERR("Failed to allocate shader cache path memory.\n");
+            else
+                memcpy(wined3d_settings.shader_cache_path, buffer, len);
+        }
         if (!get_config_key(hkey, appkey, "renderer", buffer, size)
                 || !get_config_key(hkey, appkey, "DirectDrawRenderer", buffer, size))
         {
@@ -433,6 +449,7 @@ static BOOL wined3d_dll_destroy(HINSTANCE hInstDLL)
     heap_free(hook_table.hooks);
 
     heap_free(wined3d_settings.logo);
+    heap_free(wined3d_settings.shader_cache_path);
     UnregisterClassA(WINED3D_OPENGL_WINDOW_CLASS_NAME, hInstDLL);
 
     DeleteCriticalSection(&wined3d_wndproc_cs);
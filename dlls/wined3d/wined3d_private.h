@@ -426,6 +426,8 @@ struct wined3d_settings
     unsigned int max_sm_cs;
     enum wined3d_renderer renderer;
     enum wined3d_shader_backend shader_backend;
+    SIZE_T shader_cache_size;
+    char *shader_cache_path;
 };
 
 extern struct wined3d_settings wined3d_settings DECLSPEC_HIDDEN;
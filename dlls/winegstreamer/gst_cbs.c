@@ -272,3 +272,16 @@ gboolean query_sink_wrapper(GstPad *pad, GstObject *parent, GstQuery *query)
 
     return cbdata.u.query_sink_data.ret;
 }
+
+GstMemory *alloc_sample_wrapper(GstAllocator *allocator, gsize size, GstAllocationParams *params)
+{
+    struct cb_data cbdata = { ALLOC_SAMPLE };
+
+    cbdata.u.alloc_sample_data.allocator = allocator;
+    cbdata.u.alloc_sample_data.size = size;
+    cbdata.u.alloc_sample_data.params = params;
+
+    call_cb(&cbdata);
+
+    return cbdata.u.alloc_sample_data.ret;
+}
@@ -84,6 +84,8 @@ struct gstdemux_source
     GstPad *flip_sink, *flip_src;
     GstPad *their_src;
     GstPad *my_sink;
+    GstAllocator *allocator;
+    unsigned int zero_copy_frames, copied_frames;
     AM_MEDIA_TYPE mt;
     HANDLE caps_event;
     GstSegment *segment;
@@ -430,6 +432,18 @@ static gboolean query_sink(GstPad *pad, GstObject *parent, GstQuery *query)
             gst_query_set_accept_caps_result(query, res);
             return TRUE; /* FIXME */
         }
+        case GST_QUERY_ALLOCATION:
+        {
+            struct gstdemux_source *pin = gst_pad_get_element_private(pad);
+            struct gstdemux *filter = impl_from_strmbase_filter(pin->pin.pin.filter);
+            GstAllocationParams params;
+
+            gst_allocation_params_init(&params);
+            if (filter->props.cbAlign > 1)
+                params.align = filter->props.cbAlign - 1;
+            gst_query_add_allocation_param(query, pin->allocator, &params);
+            return TRUE;
+        }
         default:
             return gst_pad_query_default (pad, parent, query);
     }
@@ -597,6 +611,201 @@ static void release_sample(void *data)
     TRACE("Releasing %p returns %u\n", data, ret);
 }
 
+/* We answer allocation queries on our sink pads with an allocator whose
+ * memory lives inside IMediaSample buffers taken from the downstream
+ * allocator, so that decoders write their output directly into the samples
+ * we eventually deliver. If no sample is available without waiting, or it
+ * is too small or misaligned, we hand out system memory instead and copy
+ * the frame in got_data_sink() as before. */
+
+#define SAMPLE_MEMORY_TYPE "WineMediaSample"
+
+typedef struct
+{
+    GstAllocator parent;
+    struct gstdemux_source *pin;
+    LONG lent_samples;
+} WineSampleAllocator;
+
+typedef struct
+{
+    GstAllocatorClass parent_class;
+} WineSampleAllocatorClass;
+
+struct sample_memory
+{
+    GstMemory mem;
+    IMediaSample *sample;
+    BYTE *data;
+};
+
+G_DEFINE_TYPE(WineSampleAllocator, wine_sample_allocator, GST_TYPE_ALLOCATOR)
+
+static GstMemory *alloc_sample(GstAllocator *allocator, gsize size, GstAllocationParams *params)
+{
+    WineSampleAllocator *sample_allocator = (WineSampleAllocator *)allocator;
+    gsize maxsize = size + params->prefix + params->padding;
+    struct gstdemux_source *pin = sample_allocator->pin;
+    struct sample_memory *mem;
+    ALLOCATOR_PROPERTIES props;
+    IMediaSample *sample;
+    LONG max_lent;
+    BYTE *data;
+
+    TRACE("allocator %p, size %lu, prefix %lu, padding %lu, align %#lx.\n", allocator,
+            (unsigned long)size, (unsigned long)params->prefix, (unsigned long)params->padding,
+            (unsigned long)params->align);
+
+    if (!pin || !pin->pin.pin.peer || !pin->pin.pAllocator
+            || FAILED(IMemAllocator_GetProperties(pin->pin.pAllocator, &props)))
+        goto fallback;
+
+    /* The allocator is shared with the reader and the other streams, and
+     * decoders may keep reference frames for a long time; never let one
+     * stream take more than its share. Decoders may allocate from several
+     * threads, so reserve our share before taking the sample. */
+    max_lent = props.cBuffers / (2 * impl_from_strmbase_filter(pin->pin.pin.filter)->cStreams);
+    if (InterlockedIncrement(&sample_allocator->lent_samples) > max_lent)
+        goto unreserve;
+
+    if (FAILED(IMemAllocator_GetBuffer(pin->pin.pAllocator, &sample, NULL, NULL, AM_GBF_NOWAIT)))
+        goto unreserve;
+
+    IMediaSample_GetPointer(sample, &data);
+    if (IMediaSample_GetSize(sample) < maxsize || ((ULONG_PTR)data & params->align))
+    {
+        TRACE("Sample %p (size %u, data %p) is not suitable.\n", sample, IMediaSample_GetSize(sample), data);
+        IMediaSample_Release(sample);
+        goto unreserve;
+    }
+
+    if (params->prefix && (params->flags & GST_MEMORY_FLAG_ZERO_PREFIXED))
+        memset(data, 0, params->prefix);
+    if (params->padding && (params->flags & GST_MEMORY_FLAG_ZERO_PADDED))
+        memset(data + params->prefix + size, 0, params->padding);
+
+    mem = g_slice_new(struct sample_memory);
+    gst_memory_init(&mem->mem, params->flags, allocator, NULL, maxsize, params->align, params->prefix, size);
+    mem->sample = sample;
+    mem->data = data;
+    return &mem->mem;
+
+unreserve:
+    InterlockedDecrement(&sample_allocator->lent_samples);
+fallback:
+    return gst_allocator_alloc(NULL, size, params);
+}
+
+/* May be called from any thread; the sample itself is released through the
+ * callback thread. */
+static void sample_allocator_free(GstAllocator *allocator, GstMemory *memory)
+{
+    struct sample_memory *mem = (struct sample_memory *)memory;
+
+    if (!memory->parent)
+    {
+        InterlockedDecrement(&((WineSampleAllocator *)allocator)->lent_samples);
+        release_sample_wrapper(mem->sample);
+    }
+    g_slice_free(struct sample_memory, mem);
+}
+
+static gpointer sample_memory_map(GstMemory *memory, gsize maxsize, GstMapFlags flags)
+{
+    return ((struct sample_memory *)memory)->data;
+}
+
+static void sample_memory_unmap(GstMemory *memory)
+{
+}
+
+static GstMemory *sample_memory_share(GstMemory *memory, gssize offset, gssize size)
+{
+    struct sample_memory *mem = (struct sample_memory *)memory, *sub;
+    GstMemory *parent = memory->parent ? memory->parent : memory;
+
+    if (size == -1)
+        size = memory->size - offset;
+
+    sub = g_slice_new(struct sample_memory);
+    gst_memory_init(&sub->mem, GST_MINI_OBJECT_FLAGS(parent) | GST_MINI_OBJECT_FLAG_LOCK_READONLY,
+            memory->allocator, parent, memory->maxsize, memory->align, memory->offset + offset, size);
+    sub->sample = mem->sample;
+    sub->data = mem->data;
+    return &sub->mem;
+}
+
+static void wine_sample_allocator_class_init(WineSampleAllocatorClass *klass)
+{
+    GstAllocatorClass *allocator_class = GST_ALLOCATOR_CLASS(klass);
+
+    allocator_class->alloc = alloc_sample_wrapper;
+    allocator_class->free = sample_allocator_free;
+}
+
+static void wine_sample_allocator_init(WineSampleAllocator *sample_allocator)
+{
+    GstAllocator *allocator = GST_ALLOCATOR(sample_allocator);
+
+    allocator->mem_type = SAMPLE_MEMORY_TYPE;
+    allocator->mem_map = sample_memory_map;
+    allocator->mem_unmap = sample_memory_unmap;
+    allocator->mem_share = sample_memory_share;
+}
+
+/* If the decoder wrote the whole frame into a sample we lent it, and nothing
+ * else refers to that memory, take the sample over and deliver it as is. */
+static IMediaSample *get_zero_copy_sample(struct gstdemux_source *pin, GstBuffer *buf)
+{
+    IMediaSample *sample;
+    GstVideoMeta *meta;
+    GstMemory *memory;
+    HRESULT hr;
+
+    if (gst_buffer_n_memory(buf) != 1)
+        return NULL;
+    memory = gst_buffer_peek_memory(buf, 0);
+    if (memory->allocator != pin->allocator || memory->parent || memory->offset)
+        return NULL;
+    if (!gst_buffer_is_writable(buf) || !gst_buffer_is_all_memory_writable(buf))
+        return NULL;
+
+    /* The sample must have the layout DirectShow expects for the media type,
+     * which is what GStreamer uses unless a video meta says otherwise. */
+    if ((meta = gst_buffer_get_video_meta(buf)))
+    {
+        GstCaps *caps = gst_pad_get_current_caps(pin->my_sink);
+        GstVideoInfo vinfo;
+        BOOL compatible;
+        unsigned int i;
+
+        compatible = caps && gst_video_info_from_caps(&vinfo, caps)
+                && meta->n_planes == GST_VIDEO_INFO_N_PLANES(&vinfo);
+        for (i = 0; compatible && i < meta->n_planes; ++i)
+            compatible = meta->offset[i] == vinfo.offset[i] && meta->stride[i] == vinfo.stride[i];
+        if (caps)
+            gst_caps_unref(caps);
+        if (!compatible)
+        {
+            TRACE("Incompatible plane layout, copying.\n");
+            return NULL;
+        }
+    }
+
+    sample = ((struct sample_memory *)memory)->sample;
+    if (FAILED(hr = IMediaSample_SetActualDataLength(sample, memory->size)))
+    {
+        WARN("Failed to set data length, hr %#x.\n", hr);
+        return NULL;
+    }
+    IMediaSample_AddRef(sample);
+
+    /* Detach the memory, so that a buffer pool cannot recycle it while the
+     * sample is still in use downstream. */
+    gst_buffer_remove_all_memory(buf);
+    return sample;
+}
+
 static DWORD CALLBACK push_data(LPVOID iface)
 {
     LONGLONG maxlen, curlen;
@@ -703,32 +912,39 @@ static GstFlowReturn got_data_sink(GstPad *pad, GstObject *parent, GstBuffer *bu
         return GST_FLOW_OK;
     }
 
-    hr = BaseOutputPinImpl_GetDeliveryBuffer(&pin->pin, &sample, NULL, NULL, 0);
+    if ((sample = get_zero_copy_sample(pin, buf)))
+        ++pin->zero_copy_frames;
+    else
+    {
+        hr = BaseOutputPinImpl_GetDeliveryBuffer(&pin->pin, &sample, NULL, NULL, 0);
 
-    if (hr == VFW_E_NOT_CONNECTED) {
-        gst_buffer_unref(buf);
-        return GST_FLOW_NOT_LINKED;
-    }
+        if (hr == VFW_E_NOT_CONNECTED) {
+            gst_buffer_unref(buf);
+            return GST_FLOW_NOT_LINKED;
+        }
 
-    if (FAILED(hr)) {
-        gst_buffer_unref(buf);
-        ERR("Could not get a delivery buffer (%x), returning GST_FLOW_FLUSHING\n", hr);
-        return GST_FLOW_FLUSHING;
-    }
+        if (FAILED(hr)) {
+            gst_buffer_unref(buf);
+            ERR("Could not get a delivery buffer (%x), returning GST_FLOW_FLUSHING\n", hr);
+            return GST_FLOW_FLUSHING;
+        }
 
-    gst_buffer_map(buf, &info, GST_MAP_READ);
+        gst_buffer_map(buf, &info, GST_MAP_READ);
 
-    hr = IMediaSample_SetActualDataLength(sample, info.size);
-    if(FAILED(hr)){
-        WARN("SetActualDataLength failed: %08x\n", hr);
-        return GST_FLOW_FLUSHING;
-    }
+        hr = IMediaSample_SetActualDataLength(sample, info.size);
+        if(FAILED(hr)){
+            WARN("SetActualDataLength failed: %08x\n", hr);
+            return GST_FLOW_FLUSHING;
+        }
 
-    IMediaSample_GetPointer(sample, &ptr);
+        IMediaSample_GetPointer(sample, &ptr);
 
-    memcpy(ptr, info.data, info.size);
+        memcpy(ptr, info.data, info.size);
 
-    gst_buffer_unmap(buf, &info);
+        gst_buffer_unmap(buf, &info);
+
+        ++pin->copied_frames;
+    }
 
     if (GST_BUFFER_PTS_IS_VALID(buf)) {
         REFERENCE_TIME rtStart = gst_segment_to_running_time(pin->segment, GST_FORMAT_TIME, buf->pts);
@@ -1326,6 +1542,7 @@ static HRESULT gstdemux_cleanup_stream(struct strmbase_filter *iface)
 {
     struct gstdemux *filter = impl_from_strmbase_filter(iface);
     GstStateChangeReturn ret;
+    unsigned int i;
 
     if (!filter->container)
         return S_OK;
@@ -1339,6 +1556,15 @@ static HRESULT gstdemux_cleanup_stream(struct strmbase_filter *iface)
     gst_element_get_state(filter->container, NULL, NULL, GST_CLOCK_TIME_NONE);
     filter->ignore_flush = FALSE;
 
+    for (i = 0; i < filter->cStreams; ++i)
+    {
+        struct gstdemux_source *pin = filter->ppPins[i];
+
+        TRACE("Pin %p delivered %u frames without copying, %u copied.\n",
+                pin, pin->zero_copy_frames, pin->copied_frames);
+        pin->zero_copy_frames = pin->copied_frames = 0;
+    }
+
     return S_OK;
 }
 
@@ -1923,6 +2149,8 @@ static void free_source_pin(struct gstdemux_source *pin)
         gst_object_unref(pin->their_src);
     }
     gst_object_unref(pin->my_sink);
+    ((WineSampleAllocator *)pin->allocator)->pin = NULL;
+    gst_object_unref(pin->allocator);
     CloseHandle(pin->caps_event);
     FreeMediaType(&pin->mt);
     gst_segment_free(pin->segment);
@@ -1969,6 +2197,8 @@ static struct gstdemux_source *create_pin(struct gstdemux *filter, const WCHAR *
     gst_pad_set_chain_function(pin->my_sink, got_data_sink_wrapper);
     gst_pad_set_event_function(pin->my_sink, event_sink_wrapper);
     gst_pad_set_query_function(pin->my_sink, query_sink_wrapper);
+    pin->allocator = gst_object_ref_sink(g_object_new(wine_sample_allocator_get_type(), NULL));
+    ((WineSampleAllocator *)pin->allocator)->pin = pin;
 
     filter->ppPins[filter->cStreams++] = pin;
     return pin;
@@ -2111,6 +2341,12 @@ void CALLBACK perform_cb(TP_CALLBACK_INSTANCE *instance, void *user)
                     data->query);
             break;
         }
+    case ALLOC_SAMPLE:
+        {
+            struct alloc_sample_data *data = &cbdata->u.alloc_sample_data;
+            cbdata->u.alloc_sample_data.ret = alloc_sample(data->allocator, data->size, data->params);
+            break;
+        }
     }
 
     pthread_mutex_lock(&cbdata->lock);
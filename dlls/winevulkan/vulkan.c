@@ -328,10 +328,107 @@ static void wine_vk_device_free(struct VkDevice_T *device)
     heap_free(device);
 }
 
+/* Per-thread bump allocator for the temporary host structures the thunks
+ * need for struct conversion. Every allocation made by a thunk is released
+ * before it returns, so the arena is rewound once nothing is live anymore.
+ * Requests which don't fit while earlier allocations are still live fall
+ * back to the heap; the arena grows to the high-water mark on the next
+ * rewind.
+ */
+#define CONVERSION_ARENA_MIN_SIZE 4096
+
+struct conversion_arena
+{
+    BYTE *buffer;
+    SIZE_T size;        /* size of the buffer */
+    SIZE_T used;        /* bytes handed out since the last rewind */
+    SIZE_T wanted;      /* largest amount needed since the buffer was allocated */
+    unsigned int live;  /* number of allocations not yet freed */
+};
+
+static DWORD conversion_arena_tls = TLS_OUT_OF_INDEXES;
+
+static struct conversion_arena *get_conversion_arena(void)
+{
+    struct conversion_arena *arena;
+
+    if (conversion_arena_tls == TLS_OUT_OF_INDEXES) return NULL;
+    if ((arena = TlsGetValue(conversion_arena_tls))) return arena;
+
+    if (!(arena = heap_alloc_zero(sizeof(*arena)))) return NULL;
+    TlsSetValue(conversion_arena_tls, arena);
+    return arena;
+}
+
+static void free_conversion_arena(void)
+{
+    struct conversion_arena *arena;
+
+    if (conversion_arena_tls == TLS_OUT_OF_INDEXES) return;
+    if (!(arena = TlsGetValue(conversion_arena_tls))) return;
+
+    if (arena->live) WARN("Freeing arena with %u live allocations.\n", arena->live);
+    TlsSetValue(conversion_arena_tls, NULL);
+    heap_free(arena->buffer);
+    heap_free(arena);
+}
+
+void *wine_vk_conversion_alloc(SIZE_T size)
+{
+    struct conversion_arena *arena;
+    SIZE_T needed;
+    void *ptr;
+
+    if (!(arena = get_conversion_arena())) return heap_alloc(size);
+
+    /* Keep host structures 64-bit aligned, and give zero-sized requests a
+     * distinct pointer so that they can be told apart on free. */
+    size = (max(size, 1) + 15) & ~(SIZE_T)15;
+
+    if (!arena->live) arena->used = 0;
+    needed = arena->used + size;
+    if (needed > arena->wanted) arena->wanted = max(needed, CONVERSION_ARENA_MIN_SIZE);
+
+    if (!arena->live && arena->wanted > arena->size)
+    {
+        SIZE_T new_size = max(arena->wanted, arena->size * 2);
+
+        TRACE("Growing conversion arena %p to %lu bytes.\n", arena, new_size);
+        heap_free(arena->buffer);
+        if ((arena->buffer = heap_alloc(new_size))) arena->size = new_size;
+        else arena->size = 0;
+    }
+
+    if (needed > arena->size) return heap_alloc(size);
+
+    ptr = arena->buffer + arena->used;
+    arena->used = needed;
+    arena->live++;
+    return ptr;
+}
+
+void wine_vk_conversion_free(void *ptr)
+{
+    struct conversion_arena *arena = NULL;
+
+    if (!ptr) return;
+
+    if (conversion_arena_tls != TLS_OUT_OF_INDEXES)
+        arena = TlsGetValue(conversion_arena_tls);
+    if (arena && (BYTE *)ptr >= arena->buffer && (BYTE *)ptr < arena->buffer + arena->size)
+    {
+        arena->live--;
+        return;
+    }
+    heap_free(ptr);
+}
+
 static BOOL wine_vk_init(void)
 {
     HDC hdc;
 
+    conversion_arena_tls = TlsAlloc();
+
     hdc = GetDC(0);
     vk_funcs = __wine_get_vulkan_driver(hdc, WINE_VULKAN_DRIVER_VERSION);
     ReleaseDC(0, hdc);
@@ -1328,8 +1425,17 @@ BOOL WINAPI DllMain(HINSTANCE hinst, DWORD reason, void *reserved)
     switch (reason)
     {
         case DLL_PROCESS_ATTACH:
-            DisableThreadLibraryCalls(hinst);
             return wine_vk_init();
+
+        case DLL_THREAD_DETACH:
+            free_conversion_arena();
+            break;
+
+        case DLL_PROCESS_DETACH:
+            if (reserved) break;
+            free_conversion_arena();
+            if (conversion_arena_tls != TLS_OUT_OF_INDEXES) TlsFree(conversion_arena_tls);
+            break;
     }
     return TRUE;
 }
@@ -182,4 +182,8 @@ const VkExtensionProperties* wine_vk_device_extension_faked_idx(unsigned int idx
 BOOL wine_vk_device_extension_supported(const char *name) DECLSPEC_HIDDEN;
 BOOL wine_vk_instance_extension_supported(const char *name) DECLSPEC_HIDDEN;
 
+/* Temporary storage for converted structures, released before the thunk returns. */
+void *wine_vk_conversion_alloc(SIZE_T size) DECLSPEC_HIDDEN;
+void wine_vk_conversion_free(void *ptr) DECLSPEC_HIDDEN;
+
 #endif /* __WINE_VULKAN_PRIVATE_H */
@@ -84,7 +84,7 @@ static inline VkCommandBufferInheritanceInfo_host *convert_VkCommandBufferInheri
 
     if (!in) return NULL;
 
-    out = heap_alloc(count * sizeof(*out));
+    out = wine_vk_conversion_alloc(count * sizeof(*out));
     for (i = 0; i < count; i++)
     {
         out[i].sType = in[i].sType;
@@ -104,7 +104,7 @@ static inline void free_VkCommandBufferInheritanceInfo_array(VkCommandBufferInhe
 {
     if (!in) return;
 
-    heap_free(in);
+    wine_vk_conversion_free(in);
 }
 
 static inline void convert_VkCommandBufferBeginInfo_win_to_host(const VkCommandBufferBeginInfo *in, VkCommandBufferBeginInfo_host *out)
@@ -129,7 +129,7 @@ static inline VkBindAccelerationStructureMemoryInfoNV_host *convert_VkBindAccele
 
     if (!in) return NULL;
 
-    out = heap_alloc(count * sizeof(*out));
+    out = wine_vk_conversion_alloc(count * sizeof(*out));
     for (i = 0; i < count; i++)
     {
         out[i].sType = in[i].sType;
@@ -148,7 +148,7 @@ static inline void free_VkBindAccelerationStructureMemoryInfoNV_array(VkBindAcce
 {
     if (!in) return;
 
-    heap_free(in);
+    wine_vk_conversion_free(in);
 }
 
 static inline VkBindBufferMemoryInfo_host *convert_VkBindBufferMemoryInfo_array_win_to_host(const VkBindBufferMemoryInfo *in, uint32_t count)
@@ -158,7 +158,7 @@ static inline VkBindBufferMemoryInfo_host *convert_VkBindBufferMemoryInfo_array_
 
     if (!in) return NULL;
 
-    out = heap_alloc(count * sizeof(*out));
+    out = wine_vk_conversion_alloc(count * sizeof(*out));
     for (i = 0; i < count; i++)
     {
         out[i].sType = in[i].sType;
@@ -175,7 +175,7 @@ static inline void free_VkBindBufferMemoryInfo_array(VkBindBufferMemoryInfo_host
 {
     if (!in) return;
 
-    heap_free(in);
+    wine_vk_conversion_free(in);
 }
 
 static inline VkBindImageMemoryInfo_host *convert_VkBindImageMemoryInfo_array_win_to_host(const VkBindImageMemoryInfo *in, uint32_t count)
@@ -185,7 +185,7 @@ static inline VkBindImageMemoryInfo_host *convert_VkBindImageMemoryInfo_array_wi
 
     if (!in) return NULL;
 
-    out = heap_alloc(count * sizeof(*out));
+    out = wine_vk_conversion_alloc(count * sizeof(*out));
     for (i = 0; i < count; i++)
     {
         out[i].sType = in[i].sType;
@@ -202,7 +202,7 @@ static inline void free_VkBindImageMemoryInfo_array(VkBindImageMemoryInfo_host *
 {
     if (!in) return;
 
-    heap_free(in);
+    wine_vk_conversion_free(in);
 }
 
 static inline void convert_VkConditionalRenderingBeginInfoEXT_win_to_host(const VkConditionalRenderingBeginInfoEXT *in, VkConditionalRenderingBeginInfoEXT_host *out)
@@ -275,7 +275,7 @@ static inline VkGeometryNV_host *convert_VkGeometryNV_array_win_to_host(const Vk
 
     if (!in) return NULL;
 
-    out = heap_alloc(count * sizeof(*out));
+    out = wine_vk_conversion_alloc(count * sizeof(*out));
     for (i = 0; i < count; i++)
     {
         out[i].sType = in[i].sType;
@@ -292,7 +292,7 @@ static inline void free_VkGeometryNV_array(VkGeometryNV_host *in, uint32_t count
 {
     if (!in) return;
 
-    heap_free(in);
+    wine_vk_conversion_free(in);
 }
 
 static inline void convert_VkAccelerationStructureInfoNV_win_to_host(const VkAccelerationStructureInfoNV *in, VkAccelerationStructureInfoNV_host *out)
@@ -320,7 +320,7 @@ static inline VkBufferCopy_host *convert_VkBufferCopy_array_win_to_host(const Vk
 
     if (!in) return NULL;
 
-    out = heap_alloc(count * sizeof(*out));
+    out = wine_vk_conversion_alloc(count * sizeof(*out));
     for (i = 0; i < count; i++)
     {
         out[i].srcOffset = in[i].srcOffset;
@@ -335,7 +335,7 @@ static inline void free_VkBufferCopy_array(VkBufferCopy_host *in, uint32_t count
 {
     if (!in) return;
 
-    heap_free(in);
+    wine_vk_conversion_free(in);
 }
 
 static inline VkBufferImageCopy_host *convert_VkBufferImageCopy_array_win_to_host(const VkBufferImageCopy *in, uint32_t count)
@@ -345,7 +345,7 @@ static inline VkBufferImageCopy_host *convert_VkBufferImageCopy_array_win_to_hos
 
     if (!in) return NULL;
 
-    out = heap_alloc(count * sizeof(*out));
+    out = wine_vk_conversion_alloc(count * sizeof(*out));
     for (i = 0; i < count; i++)
     {
         out[i].bufferOffset = in[i].bufferOffset;
@@ -363,7 +363,7 @@ static inline void free_VkBufferImageCopy_array(VkBufferImageCopy_host *in, uint
 {
     if (!in) return;
 
-    heap_free(in);
+    wine_vk_conversion_free(in);
 }
 
 static inline VkDescriptorImageInfo_host *convert_VkDescriptorImageInfo_array_win_to_host(const VkDescriptorImageInfo *in, uint32_t count)
@@ -373,7 +373,7 @@ static inline VkDescriptorImageInfo_host *convert_VkDescriptorImageInfo_array_wi
 
     if (!in) return NULL;
 
-    out = heap_alloc(count * sizeof(*out));
+    out = wine_vk_conversion_alloc(count * sizeof(*out));
     for (i = 0; i < count; i++)
     {
         out[i].sampler = in[i].sampler;
@@ -388,7 +388,7 @@ static inline void free_VkDescriptorImageInfo_array(VkDescriptorImageInfo_host *
 {
     if (!in) return;
 
-    heap_free(in);
+    wine_vk_conversion_free(in);
 }
 
 static inline VkDescriptorBufferInfo_host *convert_VkDescriptorBufferInfo_array_win_to_host(const VkDescriptorBufferInfo *in, uint32_t count)
@@ -398,7 +398,7 @@ static inline VkDescriptorBufferInfo_host *convert_VkDescriptorBufferInfo_array_
 
     if (!in) return NULL;
 
-    out = heap_alloc(count * sizeof(*out));
+    out = wine_vk_conversion_alloc(count * sizeof(*out));
     for (i = 0; i < count; i++)
     {
         out[i].buffer = in[i].buffer;
@@ -413,7 +413,7 @@ static inline void free_VkDescriptorBufferInfo_array(VkDescriptorBufferInfo_host
 {
     if (!in) return;
 
-    heap_free(in);
+    wine_vk_conversion_free(in);
 }
 
 static inline VkWriteDescriptorSet_host *convert_VkWriteDescriptorSet_array_win_to_host(const VkWriteDescriptorSet *in, uint32_t count)
@@ -423,7 +423,7 @@ static inline VkWriteDescriptorSet_host *convert_VkWriteDescriptorSet_array_win_
 
     if (!in) return NULL;
 
-    out = heap_alloc(count * sizeof(*out));
+    out = wine_vk_conversion_alloc(count * sizeof(*out));
     for (i = 0; i < count; i++)
     {
         out[i].sType = in[i].sType;
@@ -452,7 +452,7 @@ static inline void free_VkWriteDescriptorSet_array(VkWriteDescriptorSet_host *in
         free_VkDescriptorImageInfo_array((VkDescriptorImageInfo_host *)in[i].pImageInfo, in[i].descriptorCount);
         free_VkDescriptorBufferInfo_array((VkDescriptorBufferInfo_host *)in[i].pBufferInfo, in[i].descriptorCount);
     }
-    heap_free(in);
+    wine_vk_conversion_free(in);
 }
 
 static inline void convert_VkPerformanceMarkerInfoINTEL_win_to_host(const VkPerformanceMarkerInfoINTEL *in, VkPerformanceMarkerInfoINTEL_host *out)
@@ -532,7 +532,7 @@ static inline VkComputePipelineCreateInfo_host *convert_VkComputePipelineCreateI
 
     if (!in) return NULL;
 
-    out = heap_alloc(count * sizeof(*out));
+    out = wine_vk_conversion_alloc(count * sizeof(*out));
     for (i = 0; i < count; i++)
     {
         out[i].sType = in[i].sType;
@@ -551,7 +551,7 @@ static inline void free_VkComputePipelineCreateInfo_array(VkComputePipelineCreat
 {
     if (!in) return;
 
-    heap_free(in);
+    wine_vk_conversion_free(in);
 }
 
 static inline void convert_VkDescriptorUpdateTemplateCreateInfo_win_to_host(const VkDescriptorUpdateTemplateCreateInfo *in, VkDescriptorUpdateTemplateCreateInfo_host *out)
@@ -592,7 +592,7 @@ static inline VkPipelineShaderStageCreateInfo_host *convert_VkPipelineShaderStag
 
     if (!in) return NULL;
 
-    out = heap_alloc(count * sizeof(*out));
+    out = wine_vk_conversion_alloc(count * sizeof(*out));
     for (i = 0; i < count; i++)
     {
         out[i].sType = in[i].sType;
@@ -611,7 +611,7 @@ static inline void free_VkPipelineShaderStageCreateInfo_array(VkPipelineShaderSt
 {
     if (!in) return;
 
-    heap_free(in);
+    wine_vk_conversion_free(in);
 }
 
 static inline VkGraphicsPipelineCreateInfo_host *convert_VkGraphicsPipelineCreateInfo_array_win_to_host(const VkGraphicsPipelineCreateInfo *in, uint32_t count)
@@ -621,7 +621,7 @@ static inline VkGraphicsPipelineCreateInfo_host *convert_VkGraphicsPipelineCreat
 
     if (!in) return NULL;
 
-    out = heap_alloc(count * sizeof(*out));
+    out = wine_vk_conversion_alloc(count * sizeof(*out));
     for (i = 0; i < count; i++)
     {
         out[i].sType = in[i].sType;
@@ -658,7 +658,7 @@ static inline void free_VkGraphicsPipelineCreateInfo_array(VkGraphicsPipelineCre
     {
         free_VkPipelineShaderStageCreateInfo_array((VkPipelineShaderStageCreateInfo_host *)in[i].pStages, in[i].stageCount);
     }
-    heap_free(in);
+    wine_vk_conversion_free(in);
 }
 
 static inline void convert_VkImageViewCreateInfo_win_to_host(const VkImageViewCreateInfo *in, VkImageViewCreateInfo_host *out)
@@ -682,7 +682,7 @@ static inline VkRayTracingPipelineCreateInfoNV_host *convert_VkRayTracingPipelin
 
     if (!in) return NULL;
 
-    out = heap_alloc(count * sizeof(*out));
+    out = wine_vk_conversion_alloc(count * sizeof(*out));
     for (i = 0; i < count; i++)
     {
         out[i].sType = in[i].sType;
@@ -711,7 +711,7 @@ static inline void free_VkRayTracingPipelineCreateInfoNV_array(VkRayTracingPipel
     {
         free_VkPipelineShaderStageCreateInfo_array((VkPipelineShaderStageCreateInfo_host *)in[i].pStages, in[i].stageCount);
     }
-    heap_free(in);
+    wine_vk_conversion_free(in);
 }
 
 static inline VkMappedMemoryRange_host *convert_VkMappedMemoryRange_array_win_to_host(const VkMappedMemoryRange *in, uint32_t count)
@@ -721,7 +721,7 @@ static inline VkMappedMemoryRange_host *convert_VkMappedMemoryRange_array_win_to
 
     if (!in) return NULL;
 
-    out = heap_alloc(count * sizeof(*out));
+    out = wine_vk_conversion_alloc(count * sizeof(*out));
     for (i = 0; i < count; i++)
     {
         out[i].sType = in[i].sType;
@@ -738,7 +738,7 @@ static inline void free_VkMappedMemoryRange_array(VkMappedMemoryRange_host *in,
 {
     if (!in) return;
 
-    heap_free(in);
+    wine_vk_conversion_free(in);
 }
 
 static inline void convert_VkAccelerationStructureMemoryRequirementsInfoNV_win_to_host(const VkAccelerationStructureMemoryRequirementsInfoNV *in, VkAccelerationStructureMemoryRequirementsInfoNV_host *out)
@@ -1088,7 +1088,7 @@ static inline VkSparseMemoryBind_host *convert_VkSparseMemoryBind_array_win_to_h
 
     if (!in) return NULL;
 
-    out = heap_alloc(count * sizeof(*out));
+    out = wine_vk_conversion_alloc(count * sizeof(*out));
     for (i = 0; i < count; i++)
     {
         out[i].resourceOffset = in[i].resourceOffset;
@@ -1105,7 +1105,7 @@ static inline void free_VkSparseMemoryBind_array(VkSparseMemoryBind_host *in, ui
 {
     if (!in) return;
 
-    heap_free(in);
+    wine_vk_conversion_free(in);
 }
 
 static inline VkSparseBufferMemoryBindInfo_host *convert_VkSparseBufferMemoryBindInfo_array_win_to_host(const VkSparseBufferMemoryBindInfo *in, uint32_t count)
@@ -1115,7 +1115,7 @@ static inline VkSparseBufferMemoryBindInfo_host *convert_VkSparseBufferMemoryBin
 
     if (!in) return NULL;
 
-    out = heap_alloc(count * sizeof(*out));
+    out = wine_vk_conversion_alloc(count * sizeof(*out));
     for (i = 0; i < count; i++)
     {
         out[i].buffer = in[i].buffer;
@@ -1136,7 +1136,7 @@ static inline void free_VkSparseBufferMemoryBindInfo_array(VkSparseBufferMemoryB
     {
         free_VkSparseMemoryBind_array((VkSparseMemoryBind_host *)in[i].pBinds, in[i].bindCount);
     }
-    heap_free(in);
+    wine_vk_conversion_free(in);
 }
 
 static inline VkSparseImageOpaqueMemoryBindInfo_host *convert_VkSparseImageOpaqueMemoryBindInfo_array_win_to_host(const VkSparseImageOpaqueMemoryBindInfo *in, uint32_t count)
@@ -1146,7 +1146,7 @@ static inline VkSparseImageOpaqueMemoryBindInfo_host *convert_VkSparseImageOpaqu
 
     if (!in) return NULL;
 
-    out = heap_alloc(count * sizeof(*out));
+    out = wine_vk_conversion_alloc(count * sizeof(*out));
     for (i = 0; i < count; i++)
     {
         out[i].image = in[i].image;
@@ -1167,7 +1167,7 @@ static inline void free_VkSparseImageOpaqueMemoryBindInfo_array(VkSparseImageOpa
     {
         free_VkSparseMemoryBind_array((VkSparseMemoryBind_host *)in[i].pBinds, in[i].bindCount);
     }
-    heap_free(in);
+    wine_vk_conversion_free(in);
 }
 
 static inline VkSparseImageMemoryBind_host *convert_VkSparseImageMemoryBind_array_win_to_host(const VkSparseImageMemoryBind *in, uint32_t count)
@@ -1177,7 +1177,7 @@ static inline VkSparseImageMemoryBind_host *convert_VkSparseImageMemoryBind_arra
 
     if (!in) return NULL;
 
-    out = heap_alloc(count * sizeof(*out));
+    out = wine_vk_conversion_alloc(count * sizeof(*out));
     for (i = 0; i < count; i++)
     {
         out[i].subresource = in[i].subresource;
@@ -1195,7 +1195,7 @@ static inline void free_VkSparseImageMemoryBind_array(VkSparseImageMemoryBind_ho
 {
     if (!in) return;
 
-    heap_free(in);
+    wine_vk_conversion_free(in);
 }
 
 static inline VkSparseImageMemoryBindInfo_host *convert_VkSparseImageMemoryBindInfo_array_win_to_host(const VkSparseImageMemoryBindInfo *in, uint32_t count)
@@ -1205,7 +1205,7 @@ static inline VkSparseImageMemoryBindInfo_host *convert_VkSparseImageMemoryBindI
 
     if (!in) return NULL;
 
-    out = heap_alloc(count * sizeof(*out));
+    out = wine_vk_conversion_alloc(count * sizeof(*out));
     for (i = 0; i < count; i++)
     {
         out[i].image = in[i].image;
@@ -1226,7 +1226,7 @@ static inline void free_VkSparseImageMemoryBindInfo_array(VkSparseImageMemoryBin
     {
         free_VkSparseImageMemoryBind_array((VkSparseImageMemoryBind_host *)in[i].pBinds, in[i].bindCount);
     }
-    heap_free(in);
+    wine_vk_conversion_free(in);
 }
 
 static inline VkBindSparseInfo_host *convert_VkBindSparseInfo_array_win_to_host(const VkBindSparseInfo *in, uint32_t count)
@@ -1236,7 +1236,7 @@ static inline VkBindSparseInfo_host *convert_VkBindSparseInfo_array_win_to_host(
 
     if (!in) return NULL;
 
-    out = heap_alloc(count * sizeof(*out));
+    out = wine_vk_conversion_alloc(count * sizeof(*out));
     for (i = 0; i < count; i++)
     {
         out[i].sType = in[i].sType;
@@ -1268,7 +1268,7 @@ static inline void free_VkBindSparseInfo_array(VkBindSparseInfo_host *in, uint32
         free_VkSparseImageOpaqueMemoryBindInfo_array((VkSparseImageOpaqueMemoryBindInfo_host *)in[i].pImageOpaqueBinds, in[i].imageOpaqueBindCount);
         free_VkSparseImageMemoryBindInfo_array((VkSparseImageMemoryBindInfo_host *)in[i].pImageBinds, in[i].imageBindCount);
     }
-    heap_free(in);
+    wine_vk_conversion_free(in);
 }
 
 static inline void convert_VkSemaphoreSignalInfoKHR_win_to_host(const VkSemaphoreSignalInfoKHR *in, VkSemaphoreSignalInfoKHR_host *out)
@@ -1288,7 +1288,7 @@ static inline VkCopyDescriptorSet_host *convert_VkCopyDescriptorSet_array_win_to
 
     if (!in) return NULL;
 
-    out = heap_alloc(count * sizeof(*out));
+    out = wine_vk_conversion_alloc(count * sizeof(*out));
     for (i = 0; i < count; i++)
     {
         out[i].sType = in[i].sType;
@@ -1309,7 +1309,7 @@ static inline void free_VkCopyDescriptorSet_array(VkCopyDescriptorSet_host *in,
 {
     if (!in) return;
 
-    heap_free(in);
+    wine_vk_conversion_free(in);
 }
 
 #endif /* USE_STRUCT_CONVERSION */
@@ -2316,7 +2316,7 @@ VkBufferMemoryBarrier_host *convert_VkBufferMemoryBarrier_array_win_to_host(cons
 
     if (!in) return NULL;
 
-    out = heap_alloc(count * sizeof(*out));
+    out = wine_vk_conversion_alloc(count * sizeof(*out));
     for (i = 0; i < count; i++)
     {
         out[i].sType = in[i].sType;
@@ -2337,7 +2337,7 @@ void free_VkBufferMemoryBarrier_array(VkBufferMemoryBarrier_host *in, uint32_t c
 {
     if (!in) return;
 
-    heap_free(in);
+    wine_vk_conversion_free(in);
 }
 
 VkImageMemoryBarrier_host *convert_VkImageMemoryBarrier_array_win_to_host(const VkImageMemoryBarrier *in, uint32_t count)
@@ -2347,7 +2347,7 @@ VkImageMemoryBarrier_host *convert_VkImageMemoryBarrier_array_win_to_host(const
 
     if (!in) return NULL;
 
-    out = heap_alloc(count * sizeof(*out));
+    out = wine_vk_conversion_alloc(count * sizeof(*out));
     for (i = 0; i < count; i++)
     {
         out[i].sType = in[i].sType;
@@ -2369,7 +2369,7 @@ void free_VkImageMemoryBarrier_array(VkImageMemoryBarrier_host *in, uint32_t cou
 {
     if (!in) return;
 
-    heap_free(in);
+    wine_vk_conversion_free(in);
 }
 
 VkResult WINAPI wine_vkAcquireNextImage2KHR(VkDevice device, const VkAcquireNextImageInfoKHR *pAcquireInfo, uint32_t *pImageIndex)
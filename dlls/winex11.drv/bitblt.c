@@ -1557,13 +1557,23 @@ DWORD get_pixmap_image( Pixmap pixmap, int width, int height, const XVisualInfo
 }
 
 
+#define MAX_DAMAGE_RECTS  8     /* rects we upload separately before merging the cheapest ones */
+#define DAMAGE_MERGE_COST 4096  /* undamaged pixels we rather upload than issue another request */
+#define FLUSH_PERIOD      50    /* time in ms since drawing started for forcing a surface flush */
+
 struct x11drv_window_surface
 {
     struct window_surface header;
     Window                window;
     GC                    gc;
     XImage               *image;
-    RECT                  bounds;
+    RECT                  bounds;  /* damage from the current drawing operation */
+    RECT                  damage[MAX_DAMAGE_RECTS];
+    unsigned int          damage_count;
+    DWORD                 damage_ticks;
+    int                   lock_count;
+    unsigned int          flush_count;
+    ULONGLONG             bytes_uploaded;
     BOOL                  byteswap;
     BOOL                  is_argb;
     DWORD                 alpha_bits;
@@ -1814,6 +1824,65 @@ failed:
 }
 #endif /* HAVE_LIBXXSHM */
 
+static inline int get_rect_area( const RECT *rect )
+{
+    return (rect->right - rect->left) * (rect->bottom - rect->top);
+}
+
+/* number of undamaged pixels that would be uploaded if both rects were merged */
+static int get_merge_cost( const RECT *a, const RECT *b )
+{
+    RECT un, in;
+
+    UnionRect( &un, a, b );
+    IntersectRect( &in, a, b );
+    return get_rect_area( &un ) - get_rect_area( a ) - get_rect_area( b ) + get_rect_area( &in );
+}
+
+/***********************************************************************
+ *           add_damage_rect
+ *
+ * Add a rectangle to the surface damage, merging it with the existing ones
+ * when that is cheaper than uploading it separately or the list is full.
+ */
+static void add_damage_rect( struct x11drv_window_surface *surface, const RECT *rect )
+{
+    unsigned int i, best;
+    int cost, best_cost;
+    RECT rc;
+
+    SetRect( &rc, 0, 0, surface->header.rect.right - surface->header.rect.left,
+             surface->header.rect.bottom - surface->header.rect.top );
+    if (!IntersectRect( &rc, &rc, rect )) return;
+    if (!surface->damage_count) surface->damage_ticks = GetTickCount();
+
+    for (;;)
+    {
+        best = surface->damage_count;
+        best_cost = INT_MAX;
+        for (i = 0; i < surface->damage_count; i++)
+        {
+            if ((cost = get_merge_cost( &surface->damage[i], &rc )) >= best_cost) continue;
+            best = i;
+            best_cost = cost;
+        }
+        if (best == surface->damage_count) break;
+        if (best_cost > DAMAGE_MERGE_COST && surface->damage_count < MAX_DAMAGE_RECTS) break;
+
+        /* the merged rect may now be worth merging with another one */
+        UnionRect( &rc, &rc, &surface->damage[best] );
+        surface->damage[best] = surface->damage[--surface->damage_count];
+    }
+    surface->damage[surface->damage_count++] = rc;
+}
+
+/* move the bounds of the last drawing operations to the damage list */
+static void collect_surface_bounds( struct x11drv_window_surface *surface )
+{
+    add_damage_rect( surface, &surface->bounds );
+    reset_bounds( &surface->bounds );
+}
+
 /***********************************************************************
  *           x11drv_surface_lock
  */
@@ -1822,16 +1891,27 @@ static void x11drv_surface_lock( struct window_surface *window_surface )
     struct x11drv_window_surface *surface = get_x11_surface( window_surface );
 
     EnterCriticalSection( &surface->crit );
+    surface->lock_count++;
 }
 
 /***********************************************************************
  *           x11drv_surface_unlock
+ *
+ * The bounds are collected after every drawing operation, so gdi32 always
+ * finds them empty and its own periodic flush never triggers; do it here.
  */
 static void x11drv_surface_unlock( struct window_surface *window_surface )
 {
     struct x11drv_window_surface *surface = get_x11_surface( window_surface );
+    BOOL flush = FALSE;
 
+    if (!--surface->lock_count)
+    {
+        collect_surface_bounds( surface );
+        flush = surface->damage_count && GetTickCount() - surface->damage_ticks > FLUSH_PERIOD;
+    }
     LeaveCriticalSection( &surface->crit );
+    if (flush) window_surface->funcs->flush( window_surface );
 }
 
 /***********************************************************************
@@ -1886,70 +1966,151 @@ static void x11drv_surface_set_region( struct window_surface *window_surface, HR
     window_surface->funcs->unlock( window_surface );
 }
 
+/***********************************************************************
+ *           copy_surface_rect
+ *
+ * Copy the damaged columns of the surface bits to the image, with byte
+ * swapping and/or pixel mapping.
+ */
+static void copy_surface_rect( struct x11drv_window_surface *surface, const RECT *rect, const int *mapping )
+{
+    int bpp = surface->info.bmiHeader.biBitCount;
+    int stride = surface->image->bytes_per_line;
+    int start = rect->left * bpp / 8, end = (rect->right * bpp + 7) / 8;
+    int x, y, height = rect->bottom - rect->top;
+    const unsigned char *src = (const unsigned char *)surface->bits + rect->top * stride;
+    unsigned char *dst = (unsigned char *)surface->image->data + rect->top * stride;
+
+    if (!surface->byteswap && !mapping)  /* simply copy */
+    {
+        for (y = 0; y < height; y++, src += stride, dst += stride)
+            memcpy( dst + start, src + start, end - start );
+        return;
+    }
+
+    switch (bpp)
+    {
+    case 1:
+        for (y = 0; y < height; y++, src += stride, dst += stride)
+            for (x = start; x < end; x++) dst[x] = bit_swap[src[x]];
+        break;
+    case 4:
+        for (y = 0; y < height; y++, src += stride, dst += stride)
+        {
+            if (mapping)
+            {
+                if (surface->byteswap)
+                    for (x = start; x < end; x++)
+                        dst[x] = (mapping[src[x] & 0x0f] << 4) | mapping[src[x] >> 4];
+                else
+                    for (x = start; x < end; x++)
+                        dst[x] = mapping[src[x] & 0x0f] | (mapping[src[x] >> 4] << 4);
+            }
+            else
+                for (x = start; x < end; x++)
+                    dst[x] = (src[x] << 4) | (src[x] >> 4);
+        }
+        break;
+    case 8:
+        for (y = 0; y < height; y++, src += stride, dst += stride)
+            for (x = start; x < end; x++) dst[x] = mapping[src[x]];
+        break;
+    case 16:
+        for (y = 0; y < height; y++, src += stride, dst += stride)
+            for (x = rect->left; x < rect->right; x++)
+                ((USHORT *)dst)[x] = RtlUshortByteSwap( ((const USHORT *)src)[x] );
+        break;
+    case 24:
+        for (y = 0; y < height; y++, src += stride, dst += stride)
+        {
+            for (x = rect->left; x < rect->right; x++)
+            {
+                unsigned char tmp = src[3 * x];
+                dst[3 * x]     = src[3 * x + 2];
+                dst[3 * x + 1] = src[3 * x + 1];
+                dst[3 * x + 2] = tmp;
+            }
+        }
+        break;
+    case 32:
+        for (y = 0; y < height; y++, src += stride, dst += stride)
+            for (x = rect->left; x < rect->right; x++)
+                ((ULONG *)dst)[x] = RtlUlongByteSwap( ((const ULONG *)src)[x] | surface->alpha_bits );
+        break;
+    }
+}
+
 /***********************************************************************
  *           x11drv_surface_flush
  */
 static void x11drv_surface_flush( struct window_surface *window_surface )
 {
     struct x11drv_window_surface *surface = get_x11_surface( window_surface );
-    unsigned char *src = surface->bits;
-    unsigned char *dst = (unsigned char *)surface->image->data;
-    struct bitblt_coords coords;
+    int map[256], *mapping = NULL;
+    unsigned int i, bytes = 0;
+    const RECT *rect;
 
     window_surface->funcs->lock( window_surface );
-    coords.x = 0;
-    coords.y = 0;
-    coords.width  = surface->header.rect.right - surface->header.rect.left;
-    coords.height = surface->header.rect.bottom - surface->header.rect.top;
-    SetRect( &coords.visrect, 0, 0, coords.width, coords.height );
-    if (IntersectRect( &coords.visrect, &coords.visrect, &surface->bounds ))
+    collect_surface_bounds( surface );
+    if (surface->damage_count)
     {
-        TRACE( "flushing %p %dx%d bounds %s bits %p\n",
-               surface, coords.width, coords.height,
-               wine_dbgstr_rect( &surface->bounds ), surface->bits );
+        TRACE( "flushing %p %dx%d %u rects bits %p\n", surface,
+               surface->header.rect.right - surface->header.rect.left,
+               surface->header.rect.bottom - surface->header.rect.top,
+               surface->damage_count, surface->bits );
 
         if (surface->is_argb || surface->color_key != CLR_INVALID) update_surface_region( surface );
 
-        if (src != dst)
-        {
-            int map[256], *mapping = get_window_surface_mapping( surface->image->bits_per_pixel, map );
-            int width_bytes = surface->image->bytes_per_line;
-
-            src += coords.visrect.top * width_bytes;
-            dst += coords.visrect.top * width_bytes;
-            copy_image_byteswap( &surface->info, src, dst, width_bytes, width_bytes,
-                                 coords.visrect.bottom - coords.visrect.top,
-                                 surface->byteswap, mapping, ~0u, surface->alpha_bits );
-        }
-        else if (surface->alpha_bits)
+        if (surface->bits != surface->image->data)
+            mapping = get_window_surface_mapping( surface->image->bits_per_pixel, map );
+
+        for (i = 0; i < surface->damage_count; i++)
         {
-            int x, y, stride = surface->image->bytes_per_line / sizeof(ULONG);
-            ULONG *ptr = (ULONG *)dst + coords.visrect.top * stride;
+            rect = &surface->damage[i];
+            TRACE( "  %s\n", wine_dbgstr_rect( rect ));
+
+            if (surface->bits != surface->image->data)
+                copy_surface_rect( surface, rect, mapping );
+            else if (surface->alpha_bits)
+            {
+                int x, y, stride = surface->image->bytes_per_line / sizeof(ULONG);
+                ULONG *ptr = (ULONG *)surface->image->data + rect->top * stride;
 
-            for (y = coords.visrect.top; y < coords.visrect.bottom; y++, ptr += stride)
-                for (x = coords.visrect.left; x < coords.visrect.right; x++)
-                    ptr[x] |= surface->alpha_bits;
+                for (y = rect->top; y < rect->bottom; y++, ptr += stride)
+                    for (x = rect->left; x < rect->right; x++)
+                        ptr[x] |= surface->alpha_bits;
+            }
         }
 
+        for (i = 0; i < surface->damage_count; i++)
+        {
+            rect = &surface->damage[i];
 #ifdef HAVE_LIBXXSHM
-        if (surface->shminfo.shmid != -1)
-            XShmPutImage( gdi_display, surface->window, surface->gc, surface->image,
-                          coords.visrect.left, coords.visrect.top,
-                          surface->header.rect.left + coords.visrect.left,
-                          surface->header.rect.top + coords.visrect.top,
-                          coords.visrect.right - coords.visrect.left,
-                          coords.visrect.bottom - coords.visrect.top, False );
-        else
+            if (surface->shminfo.shmid != -1)
+                XShmPutImage( gdi_display, surface->window, surface->gc, surface->image,
+                              rect->left, rect->top,
+                              surface->header.rect.left + rect->left,
+                              surface->header.rect.top + rect->top,
+                              rect->right - rect->left, rect->bottom - rect->top, False );
+            else
 #endif
-        XPutImage( gdi_display, surface->window, surface->gc, surface->image,
-                   coords.visrect.left, coords.visrect.top,
-                   surface->header.rect.left + coords.visrect.left,
-                   surface->header.rect.top + coords.visrect.top,
-                   coords.visrect.right - coords.visrect.left,
-                   coords.visrect.bottom - coords.visrect.top );
+            XPutImage( gdi_display, surface->window, surface->gc, surface->image,
+                       rect->left, rect->top,
+                       surface->header.rect.left + rect->left,
+                       surface->header.rect.top + rect->top,
+                       rect->right - rect->left, rect->bottom - rect->top );
+            bytes += (rect->bottom - rect->top) *
+                     (((rect->right * surface->image->bits_per_pixel + 7) / 8) -
+                      (rect->left * surface->image->bits_per_pixel / 8));
+        }
         XFlush( gdi_display );
+
+        surface->flush_count++;
+        surface->bytes_uploaded += bytes;
+        TRACE( "uploaded %u bytes, %s bytes in %u flushes\n",
+               bytes, wine_dbgstr_longlong( surface->bytes_uploaded ), surface->flush_count );
+        surface->damage_count = 0;
     }
-    reset_bounds( &surface->bounds );
     window_surface->funcs->unlock( window_surface );
 }
 
@@ -1960,7 +2121,8 @@ static void x11drv_surface_destroy( struct window_surface *window_surface )
 {
     struct x11drv_window_surface *surface = get_x11_surface( window_surface );
 
-    TRACE( "freeing %p bits %p\n", surface, surface->bits );
+    TRACE( "freeing %p bits %p, uploaded %s bytes in %u flushes\n", surface, surface->bits,
+           wine_dbgstr_longlong( surface->bytes_uploaded ), surface->flush_count );
     if (surface->gc) XFreeGC( gdi_display, surface->gc );
     if (surface->image)
     {
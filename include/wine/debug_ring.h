@@ -0,0 +1,83 @@
+/*
+ * Binary debug trace format
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef __WINE_WINE_DEBUG_RING_H
+#define __WINE_WINE_DEBUG_RING_H
+
+/* When WINEDEBUG_RING is set, ntdll stores debug output as binary records in
+ * a ring buffer that a background thread appends to <WINEDEBUG_RING>.<pid>.
+ * The file starts with a debug_ring_file_header, followed by records in the
+ * native byte order; tools/decode_trace renders them in the usual format.
+ *
+ * The ring buffer is a shared mapping of <WINEDEBUG_RING>.<pid>.ring, which
+ * starts with a debug_ring_control block, so that the records that were not
+ * written out yet survive a crash. The file is removed on a clean exit, and
+ * tools/decode_trace picks up the records left in it otherwise. */
+
+#define DEBUG_RING_MAGIC   0x474e5244  /* "DRNG" */
+#define DEBUG_RING_VERSION 2
+
+struct debug_ring_file_header
+{
+    unsigned int   magic;         /* DEBUG_RING_MAGIC */
+    unsigned int   version;       /* DEBUG_RING_VERSION */
+    unsigned int   unix_pid;      /* Unix pid of the traced process */
+    unsigned int   reserved;
+};
+
+struct debug_ring_control
+{
+    unsigned int   magic;         /* DEBUG_RING_MAGIC */
+    unsigned int   version;       /* DEBUG_RING_VERSION */
+    unsigned int   size;          /* size of the ring buffer, a power of two */
+    unsigned int   head;          /* position where the next record is reserved */
+    unsigned int   tail;          /* position of the first record not written out yet */
+    int            lost;          /* records dropped since the last flush */
+    unsigned int   reserved[2];
+    /* followed by the ring buffer */
+};
+
+enum debug_ring_type
+{
+    DEBUG_RING_PAD,               /* padding up to the end of the ring buffer */
+    DEBUG_RING_OUTPUT,            /* one or more lines of output */
+    DEBUG_RING_LOST               /* records dropped because the buffer was full */
+};
+
+#define DEBUG_RING_HEADER    0x01 /* the output starts with a header */
+#define DEBUG_RING_FUNCTION  0x02 /* header includes class, channel and function */
+#define DEBUG_RING_TIMESTAMP 0x04 /* header includes the timestamp */
+#define DEBUG_RING_PID       0x08 /* header includes the process id */
+#define DEBUG_RING_TID       0x10 /* header includes the thread id */
+
+struct debug_ring_record
+{
+    unsigned int   size;          /* total record size, multiple of 8; 0 while being written */
+    unsigned char  type;          /* enum debug_ring_type */
+    unsigned char  flags;         /* DEBUG_RING_* flags */
+    unsigned char  cls;           /* debug class */
+    unsigned char  channel_len;   /* length of the channel name */
+    unsigned int   pid;           /* process id */
+    unsigned int   tid;           /* thread id */
+    unsigned int   ticks;         /* timestamp in ms, or count of lost records */
+    unsigned short function_len;  /* length of the function name */
+    unsigned short text_len;      /* length of the output text */
+    /* followed by the channel name, function name and text, not null-terminated */
+};
+
+#endif  /* __WINE_WINE_DEBUG_RING_H */
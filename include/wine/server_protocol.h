@@ -372,6 +372,27 @@ typedef union
 } message_data_t;
 
 
+typedef volatile struct desktop_shm
+{
+    unsigned int   seq;
+    int            cursor_x;
+    int            cursor_y;
+    unsigned int   cursor_last_change;
+    unsigned char  keystate[256];
+} desktop_shm_t;
+
+/* registry generation counters shared read-only with the clients; each key
+ * hashes to one counter, which the server increments whenever the key changes,
+ * and each key handle to one that is incremented whenever the handle is closed */
+#define REGISTRY_GEN_SLOTS    4096
+#define REGISTRY_HANDLE_SLOTS 1024
+typedef volatile struct registry_shm
+{
+    unsigned int   gen[REGISTRY_GEN_SLOTS];
+    unsigned int   handle_gen[REGISTRY_HANDLE_SLOTS];
+} registry_shm_t;
+
+
 typedef struct
 {
     WCHAR          ch;
@@ -885,6 +906,7 @@ struct init_process_done_request
     mod_handle_t module;
     client_ptr_t ldt_copy;
     client_ptr_t entry;
+    /* VARARG(usd,bytes); */
 };
 struct init_process_done_reply
 {
@@ -2432,6 +2454,36 @@ struct add_mapping_committed_range_reply
 
 
 
+struct get_image_reloc_cache_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+    client_ptr_t base;
+};
+struct get_image_reloc_cache_reply
+{
+    struct reply_header __header;
+    mem_size_t   shared;
+    obj_handle_t handle;
+    int          ready;
+};
+
+
+
+struct set_image_reloc_cache_ready_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+    client_ptr_t base;
+    mem_size_t   size;
+};
+struct set_image_reloc_cache_ready_reply
+{
+    struct reply_header __header;
+};
+
+
+
 struct is_same_mapping_request
 {
     struct request_header __header;
@@ -2737,7 +2789,27 @@ struct get_key_value_reply
     struct reply_header __header;
     int          type;
     data_size_t  total;
+    unsigned int key_id;
+    unsigned int gen_slot;
+    unsigned int gen;
+    unsigned int handle_slot;
+    unsigned int handle_gen;
     /* VARARG(data,bytes); */
+    char __pad_36[4];
+};
+
+
+
+struct get_registry_shared_memory_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+};
+struct get_registry_shared_memory_reply
+{
+    struct reply_header __header;
+    obj_handle_t handle;
+    char __pad_12[4];
 };
 
 
@@ -5657,6 +5729,20 @@ struct set_cursor_reply
 
 
 
+struct get_desktop_shared_memory_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+};
+struct get_desktop_shared_memory_reply
+{
+    struct reply_header __header;
+    obj_handle_t   handle;
+    char __pad_12[4];
+};
+
+
+
 struct update_rawinput_devices_request
 {
     struct request_header __header;
@@ -5944,6 +6030,27 @@ enum fsync_type
     FSYNC_QUEUE,
 };
 
+/* shm layout of the slot of each object; the serial is set by the server when
+ * it allocates the slot, so that clients can tell when a slot they looked up
+ * was freed and handed to another object */
+struct fsync_shm_slot
+{
+    int          low;
+    int          high;
+    unsigned int serial;
+    int          reserved;
+};
+
+
+struct fsync_queue_status
+{
+    int bits;
+    int flags;
+};
+#define FSYNC_QUEUE_IN_MSGWAIT   0x01
+#define FSYNC_QUEUE_SERVER_WAIT  0x02
+#define FSYNC_QUEUE_MASKS_RESET  0x04
+
 
 struct create_fsync_request
 {
@@ -5961,7 +6068,7 @@ struct create_fsync_reply
     obj_handle_t handle;
     int type;
     unsigned int shm_idx;
-    char __pad_20[4];
+    unsigned int shm_serial;
 };
 
 
@@ -5981,7 +6088,7 @@ struct open_fsync_reply
     obj_handle_t handle;
     int          type;
     unsigned int shm_idx;
-    char __pad_20[4];
+    unsigned int shm_serial;
 };
 
 
@@ -5995,6 +6102,8 @@ struct get_fsync_idx_reply
     struct reply_header __header;
     int          type;
     unsigned int shm_idx;
+    unsigned int shm_serial;
+    char __pad_20[4];
 };
 
 struct fsync_msgwait_request
@@ -6020,6 +6129,19 @@ struct get_fsync_apc_idx_reply
 };
 
 
+struct get_fsync_queue_status_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+};
+struct get_fsync_queue_status_reply
+{
+    struct reply_header __header;
+    unsigned int shm_idx;
+    unsigned int hooks_idx;
+};
+
+
 enum request
 {
     REQ_new_process,
@@ -6114,6 +6236,8 @@ enum request
     REQ_unmap_view,
     REQ_get_mapping_committed_range,
     REQ_add_mapping_committed_range,
+    REQ_get_image_reloc_cache,
+    REQ_set_image_reloc_cache_ready,
     REQ_is_same_mapping,
     REQ_create_snapshot,
     REQ_next_process,
@@ -6133,6 +6257,7 @@ enum request
     REQ_enum_key,
     REQ_set_key_value,
     REQ_get_key_value,
+    REQ_get_registry_shared_memory,
     REQ_enum_key_value,
     REQ_delete_key_value,
     REQ_load_registry,
@@ -6307,6 +6432,7 @@ enum request
     REQ_alloc_user_handle,
     REQ_free_user_handle,
     REQ_set_cursor,
+    REQ_get_desktop_shared_memory,
     REQ_update_rawinput_devices,
     REQ_get_rawinput_devices,
     REQ_get_suspend_context,
@@ -6331,6 +6457,7 @@ enum request
     REQ_get_fsync_idx,
     REQ_fsync_msgwait,
     REQ_get_fsync_apc_idx,
+    REQ_get_fsync_queue_status,
     REQ_NB_REQUESTS
 };
 
@@ -6430,6 +6557,8 @@ union generic_request
     struct unmap_view_request unmap_view_request;
     struct get_mapping_committed_range_request get_mapping_committed_range_request;
     struct add_mapping_committed_range_request add_mapping_committed_range_request;
+    struct get_image_reloc_cache_request get_image_reloc_cache_request;
+    struct set_image_reloc_cache_ready_request set_image_reloc_cache_ready_request;
     struct is_same_mapping_request is_same_mapping_request;
     struct create_snapshot_request create_snapshot_request;
     struct next_process_request next_process_request;
@@ -6449,6 +6578,7 @@ union generic_request
     struct enum_key_request enum_key_request;
     struct set_key_value_request set_key_value_request;
     struct get_key_value_request get_key_value_request;
+    struct get_registry_shared_memory_request get_registry_shared_memory_request;
     struct enum_key_value_request enum_key_value_request;
     struct delete_key_value_request delete_key_value_request;
     struct load_registry_request load_registry_request;
@@ -6623,6 +6753,7 @@ union generic_request
     struct alloc_user_handle_request alloc_user_handle_request;
     struct free_user_handle_request free_user_handle_request;
     struct set_cursor_request set_cursor_request;
+    struct get_desktop_shared_memory_request get_desktop_shared_memory_request;
     struct update_rawinput_devices_request update_rawinput_devices_request;
     struct get_rawinput_devices_request get_rawinput_devices_request;
     struct get_suspend_context_request get_suspend_context_request;
@@ -6647,6 +6778,7 @@ union generic_request
     struct get_fsync_idx_request get_fsync_idx_request;
     struct fsync_msgwait_request fsync_msgwait_request;
     struct get_fsync_apc_idx_request get_fsync_apc_idx_request;
+    struct get_fsync_queue_status_request get_fsync_queue_status_request;
 };
 union generic_reply
 {
@@ -6744,6 +6876,8 @@ union generic_reply
     struct unmap_view_reply unmap_view_reply;
     struct get_mapping_committed_range_reply get_mapping_committed_range_reply;
     struct add_mapping_committed_range_reply add_mapping_committed_range_reply;
+    struct get_image_reloc_cache_reply get_image_reloc_cache_reply;
+    struct set_image_reloc_cache_ready_reply set_image_reloc_cache_ready_reply;
     struct is_same_mapping_reply is_same_mapping_reply;
     struct create_snapshot_reply create_snapshot_reply;
     struct next_process_reply next_process_reply;
@@ -6763,6 +6897,7 @@ union generic_reply
     struct enum_key_reply enum_key_reply;
     struct set_key_value_reply set_key_value_reply;
     struct get_key_value_reply get_key_value_reply;
+    struct get_registry_shared_memory_reply get_registry_shared_memory_reply;
     struct enum_key_value_reply enum_key_value_reply;
     struct delete_key_value_reply delete_key_value_reply;
     struct load_registry_reply load_registry_reply;
@@ -6937,6 +7072,7 @@ union generic_reply
     struct alloc_user_handle_reply alloc_user_handle_reply;
     struct free_user_handle_reply free_user_handle_reply;
     struct set_cursor_reply set_cursor_reply;
+    struct get_desktop_shared_memory_reply get_desktop_shared_memory_reply;
     struct update_rawinput_devices_reply update_rawinput_devices_reply;
     struct get_rawinput_devices_reply get_rawinput_devices_reply;
     struct get_suspend_context_reply get_suspend_context_reply;
@@ -6961,8 +7097,9 @@ union generic_reply
     struct get_fsync_idx_reply get_fsync_idx_reply;
     struct fsync_msgwait_reply fsync_msgwait_reply;
     struct get_fsync_apc_idx_reply get_fsync_apc_idx_reply;
+    struct get_fsync_queue_status_reply get_fsync_queue_status_reply;
 };
 
-#define SERVER_PROTOCOL_VERSION 621
+#define SERVER_PROTOCOL_VERSION 629
 
 #endif /* __WINE_WINE_SERVER_PROTOCOL_H */
@@ -1284,6 +1284,31 @@ typedef struct _RTL_HEAP_DEFINITION {
     ULONG Unknown[11];
 } RTL_HEAP_DEFINITION, *PRTL_HEAP_DEFINITION;
 
+/* Wine extension: heap usage counters returned by RtlQueryHeapInformation */
+#define HeapWineStatisticsInformation ((HEAP_INFORMATION_CLASS)0x80000100)
+
+#define WINE_HEAP_STATS_BUCKETS 24
+
+typedef struct _WINE_HEAP_STATISTICS {
+    SIZE_T    CommittedBytes;     /* memory committed for the heap, including large blocks and LFH */
+    SIZE_T    UsedBytes;          /* size of the currently allocated blocks */
+    SIZE_T    PeakUsedBytes;      /* highest value of UsedBytes */
+    SIZE_T    LargeBlockCount;    /* number of currently allocated large blocks */
+    SIZE_T    LargeBlockBytes;    /* size of the currently allocated large blocks */
+    ULONGLONG AllocCount;         /* number of allocations, including LFH and large blocks */
+    ULONGLONG FreeCount;          /* number of frees, including LFH and large blocks */
+    ULONGLONG ReAllocCount;       /* number of reallocations */
+    ULONGLONG FreeListHits;       /* blocks found in the size-indexed free lists */
+    ULONGLONG FreeTreeSearches;   /* blocks that required a free tree search */
+    ULONGLONG SubHeapCount;       /* number of sub-heaps created to grow the heap */
+    ULONGLONG LargeAllocCount;    /* number of large block allocations */
+    ULONGLONG LfhAllocCount;      /* allocations served by the low-fragmentation heap */
+    ULONGLONG LfhFreeCount;       /* frees handled by the low-fragmentation heap */
+    ULONG     LockContentionCount; /* times a thread had to wait for the heap lock */
+    ULONG     Reserved;
+    ULONGLONG SizeHistogram[WINE_HEAP_STATS_BUCKETS]; /* allocations by size, bucket n holds sizes below 16 << n */
+} WINE_HEAP_STATISTICS, *PWINE_HEAP_STATISTICS;
+
 typedef struct _RTL_RWLOCK {
     RTL_CRITICAL_SECTION rtlCS;
 
@@ -256,6 +256,9 @@ static void console_input_events_destroy( struct object *obj )
     struct console_input_events *evts = (struct console_input_events *)obj;
     assert( obj->ops == &console_input_events_ops );
     free( evts->events );
+
+    if (do_fsync())
+        fsync_free_shm( evts->fsync_idx );
 }
 
 /* the renderer events list is signaled when it's not empty */
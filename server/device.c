@@ -834,6 +834,9 @@ static void device_manager_destroy( struct object *obj )
         assert( !irp->file && !irp->async );
         release_object( irp );
     }
+
+    if (do_fsync())
+        fsync_free_shm( manager->fsync_idx );
 }
 
 static struct device_manager *create_device_manager(void)
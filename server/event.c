@@ -290,6 +290,9 @@ static void event_destroy( struct object *obj )
 
     if (do_esync())
         close( event->esync_fd );
+
+    if (do_fsync())
+        fsync_free_shm( event->fsync_idx );
 }
 
 struct keyed_event *create_keyed_event( struct object *root, const struct unicode_str *name,
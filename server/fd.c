@@ -379,14 +379,23 @@ static file_pos_t max_unix_offset = OFF_T_MAX;
 
 struct timeout_user
 {
-    struct list           entry;      /* entry in sorted timeout list */
+    struct list           entry;      /* entry in the expired list */
+    int                   index;      /* index in the timeout heap, -1 once expired */
     abstime_t             when;       /* timeout expiry */
     timeout_callback      callback;   /* callback function */
     void                 *private;    /* callback private data */
 };
 
-static struct list abs_timeout_list = LIST_INIT(abs_timeout_list); /* sorted absolute timeouts list */
-static struct list rel_timeout_list = LIST_INIT(rel_timeout_list); /* sorted relative timeouts list */
+/* binary min-heap of timeouts, ordered by expiry time */
+struct timeout_heap
+{
+    struct timeout_user **users;
+    int                   count;
+    int                   size;
+};
+
+static struct timeout_heap abs_timeouts;  /* absolute timeouts */
+static struct timeout_heap rel_timeouts;  /* relative timeouts, stored as negative times */
 timeout_t current_time;
 timeout_t monotonic_time;
 
@@ -399,43 +408,116 @@ static inline void set_current_time(void)
     monotonic_time = monotonic_counter();
 }
 
+/* expiry time of a timeout, in the clock of its heap */
+static inline timeout_t get_timeout_expiry( const struct timeout_user *user )
+{
+    return user->when > 0 ? user->when : -user->when;
+}
+
+static inline struct timeout_heap *get_timeout_heap( const struct timeout_user *user )
+{
+    return user->when > 0 ? &abs_timeouts : &rel_timeouts;
+}
+
+static inline void set_heap_user( struct timeout_heap *heap, int index, struct timeout_user *user )
+{
+    heap->users[index] = user;
+    user->index = index;
+}
+
+/* move a timeout towards the top of the heap until its parent expires first */
+static void timeout_heap_sift_up( struct timeout_heap *heap, int index )
+{
+    struct timeout_user *user = heap->users[index];
+    timeout_t expiry = get_timeout_expiry( user );
+
+    while (index > 0)
+    {
+        int parent = (index - 1) / 2;
+        if (get_timeout_expiry( heap->users[parent] ) <= expiry) break;
+        set_heap_user( heap, index, heap->users[parent] );
+        index = parent;
+    }
+    set_heap_user( heap, index, user );
+}
+
+/* move a timeout towards the bottom of the heap until its children expire after it */
+static void timeout_heap_sift_down( struct timeout_heap *heap, int index )
+{
+    struct timeout_user *user = heap->users[index];
+    timeout_t expiry = get_timeout_expiry( user );
+
+    for (;;)
+    {
+        int child = 2 * index + 1;
+        if (child >= heap->count) break;
+        if (child + 1 < heap->count &&
+            get_timeout_expiry( heap->users[child + 1] ) < get_timeout_expiry( heap->users[child] ))
+            child++;
+        if (expiry <= get_timeout_expiry( heap->users[child] )) break;
+        set_heap_user( heap, index, heap->users[child] );
+        index = child;
+    }
+    set_heap_user( heap, index, user );
+}
+
+static int timeout_heap_add( struct timeout_heap *heap, struct timeout_user *user )
+{
+    if (heap->count == heap->size)
+    {
+        int new_size = max( 64, heap->size * 2 );
+        struct timeout_user **new_users = realloc( heap->users, new_size * sizeof(*new_users) );
+
+        if (!new_users)
+        {
+            set_error( STATUS_NO_MEMORY );
+            return 0;
+        }
+        heap->users = new_users;
+        heap->size = new_size;
+    }
+    set_heap_user( heap, heap->count++, user );
+    timeout_heap_sift_up( heap, user->index );
+    return 1;
+}
+
+static void timeout_heap_remove( struct timeout_heap *heap, struct timeout_user *user )
+{
+    int index = user->index;
+    struct timeout_user *last = heap->users[--heap->count];
+
+    user->index = -1;
+    if (last == user) return;
+    set_heap_user( heap, index, last );
+    if (index > 0 && get_timeout_expiry( heap->users[(index - 1) / 2] ) > get_timeout_expiry( last ))
+        timeout_heap_sift_up( heap, index );
+    else
+        timeout_heap_sift_down( heap, index );
+}
+
 /* add a timeout user */
 struct timeout_user *add_timeout_user( timeout_t when, timeout_callback func, void *private )
 {
     struct timeout_user *user;
-    struct list *ptr;
 
     if (!(user = mem_alloc( sizeof(*user) ))) return NULL;
     user->when     = timeout_to_abstime( when );
     user->callback = func;
     user->private  = private;
 
-    /* Now insert it in the linked list */
-
-    if (user->when > 0)
-    {
-        LIST_FOR_EACH( ptr, &abs_timeout_list )
-        {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
-            if (timeout->when >= user->when) break;
-        }
-    }
-    else
+    if (!timeout_heap_add( get_timeout_heap( user ), user ))
     {
-        LIST_FOR_EACH( ptr, &rel_timeout_list )
-        {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
-            if (timeout->when <= user->when) break;
-        }
+        free( user );
+        return NULL;
     }
-    list_add_before( ptr, &user->entry );
     return user;
 }
 
 /* remove a timeout user */
 void remove_timeout_user( struct timeout_user *user )
 {
-    list_remove( &user->entry );
+    if (user->index != -1) timeout_heap_remove( get_timeout_heap( user ), user );
+    else list_remove( &user->entry );  /* expired but its callback has not been called yet */
     free( user );
 }
 
@@ -881,35 +963,25 @@ static void remove_poll_user( struct fd *fd, int user )
 /* process pending timeouts and return the time until the next timeout, in milliseconds */
 static int get_next_timeout(void)
 {
-    if (!list_empty( &abs_timeout_list ) || !list_empty( &rel_timeout_list ))
+    if (abs_timeouts.count || rel_timeouts.count)
     {
         struct list expired_list, *ptr;
         int ret = -1;
 
-        /* first remove all expired timers from the list */
+        /* first remove all expired timers from the heaps */
 
         list_init( &expired_list );
-        while ((ptr = list_head( &abs_timeout_list )) != NULL)
+        while (abs_timeouts.count && abs_timeouts.users[0]->when <= current_time)
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
-
-            if (timeout->when <= current_time)
-            {
-                list_remove( &timeout->entry );
-                list_add_tail( &expired_list, &timeout->entry );
-            }
-            else break;
+            struct timeout_user *timeout = abs_timeouts.users[0];
+            timeout_heap_remove( &abs_timeouts, timeout );
+            list_add_tail( &expired_list, &timeout->entry );
         }
-        while ((ptr = list_head( &rel_timeout_list )) != NULL)
+        while (rel_timeouts.count && -rel_timeouts.users[0]->when <= monotonic_time)
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
-
-            if (-timeout->when <= monotonic_time)
-            {
-                list_remove( &timeout->entry );
-                list_add_tail( &expired_list, &timeout->entry );
-            }
-            else break;
+            struct timeout_user *timeout = rel_timeouts.users[0];
+            timeout_heap_remove( &rel_timeouts, timeout );
+            list_add_tail( &expired_list, &timeout->entry );
         }
 
         /* now call the callback for all the removed timers */
@@ -922,17 +994,17 @@ static int get_next_timeout(void)
             free( timeout );
         }
 
-        if ((ptr = list_head( &abs_timeout_list )) != NULL)
+        if (abs_timeouts.count)
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
+            struct timeout_user *timeout = abs_timeouts.users[0];
             int diff = (timeout->when - current_time + 9999) / 10000;
             if (diff < 0) diff = 0;
             ret = diff;
         }
 
-        if ((ptr = list_head( &rel_timeout_list )) != NULL)
+        if (rel_timeouts.count)
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
+            struct timeout_user *timeout = rel_timeouts.users[0];
             int diff = (-timeout->when - monotonic_time + 9999) / 10000;
             if (diff < 0) diff = 0;
             if (ret == -1 || diff < ret) ret = diff;
@@ -1550,6 +1622,9 @@ static void fd_destroy( struct object *obj )
 
     if (do_esync())
         close( fd->esync_fd );
+
+    if (do_fsync())
+        fsync_free_shm( fd->fsync_idx );
 }
 
 /* check if the desired access is possible without violating */
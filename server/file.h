@@ -166,6 +166,7 @@ extern struct file *get_mapping_file( struct process *process, client_ptr_t base
                                       unsigned int access, unsigned int sharing );
 extern void free_mapped_views( struct process *process );
 extern int get_page_size(void);
+extern struct object *create_server_mapping( mem_size_t size, void **ptr );
 
 int get_user_shared_data_fd( const void *usd_init, data_size_t usd_size );
 
@@ -42,6 +42,7 @@
 #include "windef.h"
 #include "winternl.h"
 
+#include "file.h"
 #include "handle.h"
 #include "request.h"
 #include "fsync.h"
@@ -201,21 +202,24 @@ static void fsync_destroy( struct object *obj )
     struct fsync *fsync = (struct fsync *)obj;
     if (fsync->type == FSYNC_MUTEX)
         list_remove( &fsync->mutex_entry );
+    fsync_free_shm( fsync->shm_idx );
 }
 
 static void *get_shm( unsigned int idx )
 {
-    int entry  = (idx * 8) / pagesize;
-    int offset = (idx * 8) % pagesize;
+    int entry  = (idx * sizeof(struct fsync_shm_slot)) / pagesize;
+    int offset = (idx * sizeof(struct fsync_shm_slot)) % pagesize;
 
     if (entry >= shm_addrs_size)
     {
-        if (!(shm_addrs = realloc( shm_addrs, (entry + 1) * sizeof(shm_addrs[0]) )))
-            fprintf( stderr, "fsync: couldn't expand shm_addrs array to size %d\n", entry + 1 );
+        int new_size = max( shm_addrs_size * 2, entry + 1 );
 
-        memset( &shm_addrs[shm_addrs_size], 0, (entry + 1 - shm_addrs_size) * sizeof(shm_addrs[0]) );
+        if (!(shm_addrs = realloc( shm_addrs, new_size * sizeof(shm_addrs[0]) )))
+            fprintf( stderr, "fsync: couldn't expand shm_addrs array to size %d\n", new_size );
 
-        shm_addrs_size = entry + 1;
+        memset( &shm_addrs[shm_addrs_size], 0, (new_size - shm_addrs_size) * sizeof(shm_addrs[0]) );
+
+        shm_addrs_size = new_size;
     }
 
     if (!shm_addrs[entry])
@@ -237,38 +241,88 @@ static void *get_shm( unsigned int idx )
     return (void *)((unsigned long)shm_addrs[entry] + offset);
 }
 
-/* FIXME: This is rather inefficient... */
-static unsigned int shm_idx_counter = 1;
+/* Slots of destroyed objects are handed out again to new objects. A client
+ * can still be asleep on the futex of an object that was just destroyed (e.g.
+ * if another thread closed the last handle), or have a stale handle to slot
+ * mapping cached, and it must not act on the state of an unrelated object
+ * that reused the slot. Each allocation therefore gives the slot a new
+ * serial, which clients compare against the one they were given with the
+ * index. As a second line of defence, freed slots are reused in FIFO order
+ * and only once they have been free for SHM_REUSE_DELAY, which covers a
+ * client that checked the serial just before the slot was freed. */
+#define SHM_REUSE_DELAY  (2 * TICKS_PER_SEC)
+
+struct shm_free_slot
+{
+    unsigned int idx;   /* index of the free slot */
+    timeout_t    time;  /* when it was freed */
+};
+
+static unsigned int shm_idx_counter = 1;   /* first never used slot */
+static unsigned int shm_serial_counter;    /* serial of the last allocated slot */
+static struct shm_free_slot *shm_free_slots;   /* ring buffer of free slots */
+static unsigned int shm_free_size;   /* size of the ring buffer */
+static unsigned int shm_free_head;   /* oldest free slot */
+static unsigned int shm_free_count;  /* number of free slots */
+
+static unsigned int get_free_shm_idx(void)
+{
+    struct shm_free_slot *slot;
+
+    if (!shm_free_count) return 0;
+    slot = &shm_free_slots[shm_free_head];
+    if (current_time - slot->time < SHM_REUSE_DELAY) return 0;
+
+    shm_free_head = (shm_free_head + 1) % shm_free_size;
+    shm_free_count--;
+    return slot->idx;
+}
+
+static int grow_shm( unsigned int shm_idx )
+{
+    off_t new_size = shm_size;
+
+    if ((off_t)shm_idx * sizeof(struct fsync_shm_slot) < shm_size) return 1;
+
+    /* grow geometrically, so that a process creating lots of objects
+     * doesn't cost us an ftruncate() for every page of slots */
+    while ((off_t)shm_idx * sizeof(struct fsync_shm_slot) >= new_size) new_size *= 2;
+
+    if (ftruncate( shm_fd, new_size ) == -1)
+    {
+        fprintf( stderr, "fsync: couldn't expand %s to size %jd: ",
+            shm_name, new_size );
+        perror( "ftruncate" );
+        return 0;
+    }
+    shm_size = new_size;
+    return 1;
+}
 
 unsigned int fsync_alloc_shm( int low, int high )
 {
 #ifdef __linux__
-    int shm_idx;
-    int *shm;
+    unsigned int shm_idx;
+    struct fsync_shm_slot *shm;
 
     /* this is arguably a bit of a hack, but we need some way to prevent
      * allocating shm for the master socket */
     if (!is_fsync_initialized)
         return 0;
 
-    shm_idx = shm_idx_counter++;
-
-    while (shm_idx * 8 >= shm_size)
+    if (!(shm_idx = get_free_shm_idx()))
     {
-        /* Better expand the shm section. */
-        shm_size += pagesize;
-        if (ftruncate( shm_fd, shm_size ) == -1)
-        {
-            fprintf( stderr, "fsync: couldn't expand %s to size %jd: ",
-                shm_name, shm_size );
-            perror( "ftruncate" );
-        }
+        if (!grow_shm( shm_idx_counter )) return 0;
+        shm_idx = shm_idx_counter++;
     }
 
+    if (!++shm_serial_counter) shm_serial_counter++;
+
     shm = get_shm( shm_idx );
     assert(shm);
-    shm[0] = low;
-    shm[1] = high;
+    __atomic_store_n( &shm->high, high, __ATOMIC_SEQ_CST );
+    __atomic_store_n( &shm->low, low, __ATOMIC_SEQ_CST );
+    __atomic_store_n( &shm->serial, shm_serial_counter, __ATOMIC_SEQ_CST );
 
     return shm_idx;
 #else
@@ -276,6 +330,47 @@ unsigned int fsync_alloc_shm( int low, int high )
 #endif
 }
 
+static unsigned int get_shm_serial( unsigned int shm_idx )
+{
+    struct fsync_shm_slot *shm;
+
+    if (!shm_idx) return 0;
+
+    shm = get_shm( shm_idx );
+    return __atomic_load_n( &shm->serial, __ATOMIC_SEQ_CST );
+}
+
+void fsync_free_shm( unsigned int shm_idx )
+{
+    struct shm_free_slot *slot;
+    struct fsync_shm_slot *shm;
+
+    if (!shm_idx) return;
+
+    shm = get_shm( shm_idx );
+    __atomic_store_n( &shm->serial, 0, __ATOMIC_SEQ_CST );
+
+    if (shm_free_count == shm_free_size)
+    {
+        unsigned int i, new_size = max( shm_free_size * 2, 256 );
+        struct shm_free_slot *new_slots;
+
+        /* if we can't grow the list we simply leak the slot */
+        if (!(new_slots = malloc( new_size * sizeof(*new_slots) ))) return;
+        for (i = 0; i < shm_free_count; i++)
+            new_slots[i] = shm_free_slots[(shm_free_head + i) % shm_free_size];
+        free( shm_free_slots );
+        shm_free_slots = new_slots;
+        shm_free_size = new_size;
+        shm_free_head = 0;
+    }
+
+    slot = &shm_free_slots[(shm_free_head + shm_free_count) % shm_free_size];
+    slot->idx = shm_idx;
+    slot->time = current_time;
+    shm_free_count++;
+}
+
 static int type_matches( enum fsync_type type1, enum fsync_type type2 )
 {
     return (type1 == type2) ||
@@ -388,6 +483,65 @@ void fsync_clear( struct object *obj )
         fsync_clear_futex( obj->ops->get_fsync_idx( obj, &type ) );
 }
 
+/* Publish the queue bits so that the client can check them without a
+ * server round trip. */
+void fsync_set_queue_bits( unsigned int shm_idx, unsigned int wake_bits, unsigned int changed_bits )
+{
+    struct fsync_queue_status *status;
+
+    if (!shm_idx)
+        return;
+
+    status = get_shm( shm_idx );
+    __atomic_store_n( &status->bits, (changed_bits << 16) | (wake_bits & 0xffff), __ATOMIC_SEQ_CST );
+}
+
+void fsync_set_queue_flags( unsigned int shm_idx, int set, int clear )
+{
+    struct fsync_queue_status *status;
+
+    if (!shm_idx)
+        return;
+
+    status = get_shm( shm_idx );
+    if (clear) __atomic_and_fetch( &status->flags, ~clear, __ATOMIC_SEQ_CST );
+    if (set) __atomic_or_fetch( &status->flags, set, __ATOMIC_SEQ_CST );
+}
+
+int fsync_get_queue_flags( unsigned int shm_idx )
+{
+    struct fsync_queue_status *status;
+
+    if (!shm_idx)
+        return 0;
+
+    status = get_shm( shm_idx );
+    return __atomic_load_n( &status->flags, __ATOMIC_SEQ_CST );
+}
+
+/* Hooks can be set and removed by any thread. Clients that skip get_message
+ * requests don't get the new active hooks with the reply, so every change
+ * bumps a serial that they check instead. It lives in the low word of a
+ * global slot, which is only allocated once a client asks for it. */
+static unsigned int hooks_serial_idx;
+
+unsigned int fsync_get_hooks_serial_idx(void)
+{
+    if (!hooks_serial_idx) hooks_serial_idx = fsync_alloc_shm( 0, 0 );
+    return hooks_serial_idx;
+}
+
+void fsync_bump_hooks_serial(void)
+{
+    struct fsync_shm_slot *slot;
+
+    if (!hooks_serial_idx)
+        return;
+
+    slot = get_shm( hooks_serial_idx );
+    __atomic_add_fetch( &slot->low, 1, __ATOMIC_SEQ_CST );
+}
+
 void fsync_set_event( struct fsync *fsync )
 {
     struct fsync_event *event = get_shm( fsync->shm_idx );
@@ -457,6 +611,7 @@ DECL_HANDLER(create_fsync)
                                                           req->access, objattr->attributes );
 
         reply->shm_idx = fsync->shm_idx;
+        reply->shm_serial = get_shm_serial( fsync->shm_idx );
         reply->type = fsync->type;
         release_object( fsync );
     }
@@ -488,6 +643,7 @@ DECL_HANDLER(open_fsync)
 
         reply->type = fsync->type;
         reply->shm_idx = fsync->shm_idx;
+        reply->shm_serial = get_shm_serial( fsync->shm_idx );
         release_object( fsync );
     }
 }
@@ -504,6 +660,7 @@ DECL_HANDLER(get_fsync_idx)
     if (obj->ops->get_fsync_idx)
     {
         reply->shm_idx = obj->ops->get_fsync_idx( obj, &type );
+        reply->shm_serial = get_shm_serial( reply->shm_idx );
         reply->type = type;
     }
     else
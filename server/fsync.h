@@ -21,10 +21,16 @@
 extern int do_fsync(void);
 extern void fsync_init(void);
 extern unsigned int fsync_alloc_shm( int low, int high );
+extern void fsync_free_shm( unsigned int shm_idx );
 extern void fsync_wake_futex( unsigned int shm_idx );
 extern void fsync_clear_futex( unsigned int shm_idx );
 extern void fsync_wake_up( struct object *obj );
 extern void fsync_clear( struct object *obj );
+extern void fsync_set_queue_bits( unsigned int shm_idx, unsigned int wake_bits, unsigned int changed_bits );
+extern void fsync_set_queue_flags( unsigned int shm_idx, int set, int clear );
+extern int fsync_get_queue_flags( unsigned int shm_idx );
+extern unsigned int fsync_get_hooks_serial_idx(void);
+extern void fsync_bump_hooks_serial(void);
 
 struct fsync;
 
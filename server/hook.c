@@ -37,6 +37,7 @@
 #include "process.h"
 #include "request.h"
 #include "user.h"
+#include "fsync.h"
 
 struct hook_table;
 
@@ -116,6 +117,12 @@ static struct hook_table *alloc_hook_table(void)
     return table;
 }
 
+/* let clients know that the active hooks may have changed */
+void hooks_changed(void)
+{
+    if (do_fsync()) fsync_bump_hooks_serial();
+}
+
 static struct hook_table *get_global_hooks( struct thread *thread )
 {
     struct hook_table *table;
@@ -152,6 +159,7 @@ static struct hook *add_hook( struct desktop *desktop, struct thread *thread, in
     hook->index  = index;
     list_add_head( &table->hooks[index], &hook->chain );
     if (thread) thread->desktop_users++;
+    hooks_changed();
     return hook;
 }
 
@@ -170,6 +178,7 @@ static void free_hook( struct hook *hook )
     release_object( hook->owner );
     list_remove( &hook->chain );
     free( hook );
+    hooks_changed();
 }
 
 /* find a hook from its index and proc */
@@ -297,7 +306,10 @@ static void hook_table_destroy( struct object *obj )
 static void remove_hook( struct hook *hook )
 {
     if (hook->table->counts[hook->index])
+    {
         hook->proc = 0; /* chain is in use, just mark it and return */
+        hooks_changed();
+    }
     else
         free_hook( hook );
 }
@@ -124,6 +124,49 @@ static const struct object_ops shared_map_ops =
 
 static struct list shared_map_list = LIST_INIT( shared_map_list );
 
+/* file holding the relocated pages of a PE image mapped at a given base address */
+struct reloc_map
+{
+    struct object   obj;             /* object header */
+    struct fd      *fd;              /* file descriptor of the mapped PE file */
+    client_ptr_t    base;            /* base address the pages are relocated to */
+    struct file    *file;            /* temp file holding the relocated pages at their image offset */
+    mem_size_t      size;            /* size of the relocated pages */
+    int             ready;           /* whether the pages have been stored in the file */
+    struct list     entry;           /* entry in global reloc maps list */
+};
+
+static void reloc_map_dump( struct object *obj, int verbose );
+static void reloc_map_destroy( struct object *obj );
+
+static const struct object_ops reloc_map_ops =
+{
+    sizeof(struct reloc_map),  /* size */
+    reloc_map_dump,            /* dump */
+    no_get_type,               /* get_type */
+    no_add_queue,              /* add_queue */
+    NULL,                      /* remove_queue */
+    NULL,                      /* signaled */
+    NULL,                      /* get_esync_fd */
+    NULL,                      /* get_fsync_idx */
+    NULL,                      /* satisfied */
+    no_signal,                 /* signal */
+    no_get_fd,                 /* get_fd */
+    no_map_access,             /* map_access */
+    default_get_sd,            /* get_sd */
+    default_set_sd,            /* set_sd */
+    no_lookup_name,            /* lookup_name */
+    no_link_name,              /* link_name */
+    NULL,                      /* unlink_name */
+    no_open_file,              /* open_file */
+    no_kernel_obj_list,        /* get_kernel_obj_list */
+    no_close_handle,           /* close_handle */
+    reloc_map_destroy          /* destroy */
+};
+
+static struct list reloc_map_list = LIST_INIT( reloc_map_list );
+static mem_size_t reloc_shared_size;  /* relocated bytes currently shared instead of duplicated */
+
 /* memory view mapped in client address space */
 struct memory_view
 {
@@ -131,6 +174,8 @@ struct memory_view
     struct fd      *fd;              /* fd for mapped file */
     struct ranges  *committed;       /* list of committed ranges in this mapping */
     struct shared_map *shared;       /* temp file for shared PE mapping */
+    struct reloc_map *reloc;         /* relocated pages of the PE mapping */
+    int             reloc_shared;    /* whether the view uses relocated pages stored by another view */
     unsigned int    flags;           /* SEC_* flags */
     client_ptr_t    base;            /* view base address (in process addr space) */
     mem_size_t      size;            /* view size */
@@ -227,6 +272,24 @@ static void shared_map_destroy( struct object *obj )
     list_remove( &shared->entry );
 }
 
+static void reloc_map_dump( struct object *obj, int verbose )
+{
+    struct reloc_map *reloc = (struct reloc_map *)obj;
+    fprintf( stderr, "Relocated mapping fd=%p base=%x%08x size=%x%08x%s\n", reloc->fd,
+             (unsigned int)(reloc->base >> 32), (unsigned int)reloc->base,
+             (unsigned int)(reloc->size >> 32), (unsigned int)reloc->size,
+             reloc->ready ? "" : " (not ready)" );
+}
+
+static void reloc_map_destroy( struct object *obj )
+{
+    struct reloc_map *reloc = (struct reloc_map *)obj;
+
+    release_object( reloc->fd );
+    release_object( reloc->file );
+    list_remove( &reloc->entry );
+}
+
 /* extend a file beyond the current end of file */
 static int grow_file( int unix_fd, file_pos_t new_size )
 {
@@ -323,6 +386,11 @@ static void free_memory_view( struct memory_view *view )
     if (view->fd) release_object( view->fd );
     if (view->committed) release_object( view->committed );
     if (view->shared) release_object( view->shared );
+    if (view->reloc)
+    {
+        if (view->reloc_shared) reloc_shared_size -= view->reloc->size;
+        release_object( view->reloc );
+    }
     list_remove( &view->entry );
     free( view );
 }
@@ -347,6 +415,40 @@ static struct shared_map *get_shared_file( struct fd *fd )
     return NULL;
 }
 
+/* find the relocated pages of a PE file for a given base address */
+static struct reloc_map *get_reloc_map( struct fd *fd, client_ptr_t base )
+{
+    struct reloc_map *ptr;
+
+    LIST_FOR_EACH_ENTRY( ptr, &reloc_map_list, struct reloc_map, entry )
+        if (ptr->base == base && is_same_file_fd( ptr->fd, fd ))
+            return (struct reloc_map *)grab_object( ptr );
+    return NULL;
+}
+
+/* create the temp file for the relocated pages of a view */
+static struct reloc_map *create_reloc_map( struct memory_view *view )
+{
+    struct reloc_map *reloc;
+    struct file *file;
+    int fd;
+
+    if ((fd = create_temp_file( view->size )) == -1) return NULL;
+    if (!(file = create_file_for_fd( fd, FILE_GENERIC_READ|FILE_GENERIC_WRITE, 0 ))) return NULL;
+    if (!(reloc = alloc_object( &reloc_map_ops )))
+    {
+        release_object( file );
+        return NULL;
+    }
+    reloc->fd    = (struct fd *)grab_object( view->fd );
+    reloc->base  = view->base;
+    reloc->file  = file;
+    reloc->size  = 0;
+    reloc->ready = 0;
+    list_add_head( &reloc_map_list, &reloc->entry );
+    return reloc;
+}
+
 /* return the size of the memory mapping and file range of a given section */
 static inline void get_section_sizes( const IMAGE_SECTION_HEADER *sec, size_t *map_size,
                                       off_t *file_start, size_t *file_size )
@@ -884,6 +986,25 @@ static struct object *create_mapping( struct object *root, const struct unicode_
     return NULL;
 }
 
+/* create an anonymous mapping that stays mapped in the server, for data
+ * that the server publishes to its clients */
+struct object *create_server_mapping( mem_size_t size, void **ptr )
+{
+    struct mapping *mapping;
+
+    if (!(mapping = (struct mapping *)create_mapping( NULL, NULL, 0, size, SEC_COMMIT, 0, 0, NULL )))
+        return NULL;
+
+    *ptr = mmap( NULL, mapping->size, PROT_READ | PROT_WRITE, MAP_SHARED, get_unix_fd( mapping->fd ), 0 );
+    if (*ptr == MAP_FAILED)
+    {
+        file_set_error();
+        release_object( mapping );
+        return NULL;
+    }
+    return &mapping->obj;
+}
+
 struct mapping *get_mapping_obj( struct process *process, obj_handle_t handle, unsigned int access )
 {
     return (struct mapping *)get_handle_obj( process, handle, access, &mapping_ops );
@@ -1124,6 +1245,8 @@ DECL_HANDLER(map_view)
         view->fd        = !is_fd_removable( mapping->fd ) ? (struct fd *)grab_object( mapping->fd ) : NULL;
         view->committed = mapping->committed ? (struct ranges *)grab_object( mapping->committed ) : NULL;
         view->shared    = mapping->shared ? (struct shared_map *)grab_object( mapping->shared ) : NULL;
+        view->reloc     = NULL;
+        view->reloc_shared = 0;
         list_add_tail( &current->process->views, &view->entry );
     }
 
@@ -1155,6 +1278,65 @@ DECL_HANDLER(add_mapping_committed_range)
     if (view) add_committed_range( view, req->offset, req->offset + req->size );
 }
 
+/* get the relocated pages for a PE image view that is not at its preferred base */
+DECL_HANDLER(get_image_reloc_cache)
+{
+    struct memory_view *view = find_mapped_view( current->process, req->base );
+    struct reloc_map *reloc;
+    unsigned int access = FILE_READ_DATA;
+
+    reply->shared = reloc_shared_size;
+    if (!view) return;
+    if (!(view->flags & SEC_IMAGE) || !view->fd || view->shared || view->reloc)
+    {
+        set_error( STATUS_NOT_SUPPORTED );
+        return;
+    }
+
+    if ((reloc = get_reloc_map( view->fd, view->base )))
+    {
+        /* another process is still storing the pages */
+        if (!reloc->ready)
+        {
+            release_object( reloc );
+            set_error( STATUS_DEVICE_BUSY );
+            return;
+        }
+        view->reloc_shared = 1;
+        reloc_shared_size += reloc->size;
+        reply->ready = 1;
+        if (debug_level)
+            fprintf( stderr, "%04x: sharing %u relocated bytes at %x%08x, %u bytes shared in total\n",
+                     current->id, (unsigned int)reloc->size,
+                     (unsigned int)(reloc->base >> 32), (unsigned int)reloc->base,
+                     (unsigned int)reloc_shared_size );
+    }
+    else
+    {
+        /* the caller relocates the image and stores the pages */
+        if (!(reloc = create_reloc_map( view ))) return;
+        access |= FILE_WRITE_DATA;
+    }
+    view->reloc = reloc;
+    reply->handle = alloc_handle( current->process, reloc->file, access, 0 );
+    reply->shared = reloc_shared_size;
+}
+
+/* mark the relocated pages of a PE image view as stored */
+DECL_HANDLER(set_image_reloc_cache_ready)
+{
+    struct memory_view *view = find_mapped_view( current->process, req->base );
+
+    if (!view) return;
+    if (!view->reloc || view->reloc_shared || view->reloc->ready || req->size > view->size)
+    {
+        set_error( STATUS_INVALID_PARAMETER );
+        return;
+    }
+    view->reloc->size  = req->size;
+    view->reloc->ready = 1;
+}
+
 /* check if two memory maps are for the same file */
 DECL_HANDLER(is_same_mapping)
 {
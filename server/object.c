@@ -46,9 +46,13 @@
 struct namespace
 {
     unsigned int        hash_size;       /* size of hash table */
-    struct list         names[1];        /* array of hash entry lists */
+    unsigned int        count;           /* number of names in the hash table */
+    struct list        *names;           /* array of hash entry lists */
 };
 
+/* average chain length that triggers growing a namespace hash table */
+#define NAMESPACE_MAX_LOAD 4
+
 
 #ifdef DEBUG_OBJECTS
 static struct list object_list = LIST_INIT(object_list);
@@ -127,19 +131,75 @@ void *memdup( const void *data, size_t len )
 
 /*****************************************************************/
 
-static int get_name_hash( const struct namespace *namespace, const WCHAR *name, data_size_t len )
+/* case-insensitive FNV-1a hash of a name */
+static unsigned int hash_name( const WCHAR *name, data_size_t len )
 {
-    WCHAR hash = 0;
+    unsigned int hash = 2166136261u;
+
     len /= sizeof(WCHAR);
-    while (len--) hash ^= tolowerW(*name++);
-    return hash % namespace->hash_size;
+    while (len--)
+    {
+        WCHAR ch = tolowerW( *name++ );
+        hash = (hash ^ (ch & 0xff)) * 16777619;
+        hash = (hash ^ (ch >> 8)) * 16777619;
+    }
+    return hash;
+}
+
+static int get_name_hash( const struct namespace *namespace, const WCHAR *name, data_size_t len )
+{
+    return hash_name( name, len ) % namespace->hash_size;
+}
+
+/* dump the chain length statistics of a namespace */
+static void dump_namespace_stats( const struct namespace *namespace )
+{
+    unsigned int i, len, used = 0, longest = 0;
+
+    for (i = 0; i < namespace->hash_size; i++)
+    {
+        if (!(len = list_count( &namespace->names[i] ))) continue;
+        used++;
+        if (len > longest) longest = len;
+    }
+    fprintf( stderr, "namespace %p: %u names in %u/%u buckets, longest chain %u\n",
+             namespace, namespace->count, used, namespace->hash_size, longest );
+}
+
+/* grow the hash table of a namespace once its chains get too long */
+static void grow_namespace( struct namespace *namespace )
+{
+    unsigned int i, new_size = namespace->hash_size * 2 + 1;
+    struct list *names;
+
+    if (!(names = malloc( new_size * sizeof(*names) ))) return;  /* keep the current table */
+    for (i = 0; i < new_size; i++) list_init( &names[i] );
+    for (i = 0; i < namespace->hash_size; i++)
+    {
+        struct list *ptr;
+        /* move the entries from the tail to preserve the order within a chain */
+        while ((ptr = list_tail( &namespace->names[i] )))
+        {
+            struct object_name *name = LIST_ENTRY( ptr, struct object_name, entry );
+            list_remove( &name->entry );
+            list_add_head( &names[hash_name( name->name, name->len ) % new_size], &name->entry );
+        }
+    }
+    free( namespace->names );
+    namespace->names = names;
+    namespace->hash_size = new_size;
+    if (debug_level) dump_namespace_stats( namespace );
 }
 
 void namespace_add( struct namespace *namespace, struct object_name *ptr )
 {
-    int hash = get_name_hash( namespace, ptr->name, ptr->len );
+    int hash;
 
+    if (namespace->count >= namespace->hash_size * NAMESPACE_MAX_LOAD) grow_namespace( namespace );
+    hash = get_name_hash( namespace, ptr->name, ptr->len );
     list_add_head( &namespace->names[hash], &ptr->entry );
+    ptr->namespace = namespace;
+    namespace->count++;
 }
 
 /* allocate a name for an object */
@@ -151,6 +211,7 @@ static struct object_name *alloc_name( const struct unicode_str *name )
     {
         ptr->len = name->len;
         ptr->parent = NULL;
+        ptr->namespace = NULL;
         memcpy( ptr->name, name->str, name->len );
     }
     return ptr;
@@ -484,15 +545,27 @@ struct namespace *create_namespace( unsigned int hash_size )
     struct namespace *namespace;
     unsigned int i;
 
-    namespace = mem_alloc( sizeof(*namespace) + (hash_size - 1) * sizeof(namespace->names[0]) );
-    if (namespace)
+    if (!(namespace = mem_alloc( sizeof(*namespace) ))) return NULL;
+    if (!(namespace->names = mem_alloc( hash_size * sizeof(namespace->names[0]) )))
     {
-        namespace->hash_size      = hash_size;
-        for (i = 0; i < hash_size; i++) list_init( &namespace->names[i] );
+        free( namespace );
+        return NULL;
     }
+    namespace->hash_size = hash_size;
+    namespace->count     = 0;
+    for (i = 0; i < hash_size; i++) list_init( &namespace->names[i] );
     return namespace;
 }
 
+/* free a namespace */
+void free_namespace( struct namespace *namespace )
+{
+    if (!namespace) return;
+    if (debug_level && namespace->count) dump_namespace_stats( namespace );
+    free( namespace->names );
+    free( namespace );
+}
+
 /* functions for unimplemented/default object operations */
 
 struct object_type *no_get_type( struct object *obj )
@@ -684,6 +757,7 @@ int no_link_name( struct object *obj, struct object_name *name, struct object *p
 void default_unlink_name( struct object *obj, struct object_name *name )
 {
     list_remove( &name->entry );
+    if (name->namespace) name->namespace->count--;
 }
 
 struct object *no_open_file( struct object *obj, unsigned int access, unsigned int sharing,
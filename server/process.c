@@ -656,6 +656,9 @@ static void process_destroy( struct object *obj )
 
     if (do_esync())
         close( process->esync_fd );
+
+    if (do_fsync())
+        fsync_free_shm( process->fsync_idx );
 }
 
 /* dump a process on stdout for debugging purposes */
@@ -146,6 +146,7 @@ struct msg_queue
     int                    esync_in_msgwait; /* our thread is currently waiting on us */
     unsigned int           fsync_idx;
     int                    fsync_in_msgwait; /* our thread is currently waiting on us */
+    unsigned int           fsync_status_idx; /* shm index of the client-visible queue status */
 };
 
 struct hotkey
@@ -315,6 +316,7 @@ static struct msg_queue *create_msg_queue( struct thread *thread, struct thread_
         queue->esync_fd        = -1;
         queue->fsync_idx       = 0;
         queue->fsync_in_msgwait = 0;
+        queue->fsync_status_idx = 0;
         list_init( &queue->send_result );
         list_init( &queue->callback_result );
         list_init( &queue->pending_timers );
@@ -322,7 +324,10 @@ static struct msg_queue *create_msg_queue( struct thread *thread, struct thread_
         for (i = 0; i < NB_MSG_KINDS; i++) list_init( &queue->msg_list[i] );
 
         if (do_fsync())
+        {
             queue->fsync_idx = fsync_alloc_shm( 0, 0 );
+            queue->fsync_status_idx = fsync_alloc_shm( 0, FSYNC_QUEUE_SERVER_WAIT );
+        }
 
         if (do_esync())
             queue->esync_fd = esync_create_fd( 0, 0 );
@@ -387,6 +392,22 @@ static struct message *alloc_hardware_message( lparam_t info, struct hw_msg_sour
     return msg;
 }
 
+/* publish the desktop cursor and async key state to the shared memory block */
+static void update_desktop_shared( struct desktop *desktop )
+{
+    desktop_shm_t *shared = desktop->shared;
+
+    if (!shared) return;
+
+    __atomic_store_n( &shared->seq, shared->seq + 1, __ATOMIC_RELAXED );
+    __atomic_thread_fence( __ATOMIC_SEQ_CST );
+    shared->cursor_x = desktop->cursor.x;
+    shared->cursor_y = desktop->cursor.y;
+    shared->cursor_last_change = desktop->cursor.last_change;
+    memcpy( (void *)shared->keystate, desktop->keystate, sizeof(desktop->keystate) );
+    __atomic_store_n( &shared->seq, shared->seq + 1, __ATOMIC_RELEASE );
+}
+
 static int update_desktop_cursor_pos( struct desktop *desktop, int x, int y )
 {
     int updated;
@@ -397,6 +418,7 @@ static int update_desktop_cursor_pos( struct desktop *desktop, int x, int y )
     desktop->cursor.x = x;
     desktop->cursor.y = y;
     desktop->cursor.last_change = get_tick_count();
+    update_desktop_shared( desktop );
 
     return updated;
 }
@@ -490,11 +512,19 @@ static inline int is_signaled( struct msg_queue *queue )
     return ((queue->wake_bits & queue->wake_mask) || (queue->changed_bits & queue->changed_mask));
 }
 
+/* publish the queue bits to the client-visible status block */
+static inline void update_queue_status( struct msg_queue *queue )
+{
+    if (do_fsync())
+        fsync_set_queue_bits( queue->fsync_status_idx, queue->wake_bits, queue->changed_bits );
+}
+
 /* set some queue bits */
 static inline void set_queue_bits( struct msg_queue *queue, unsigned int bits )
 {
     queue->wake_bits |= bits;
     queue->changed_bits |= bits;
+    update_queue_status( queue );
     if (is_signaled( queue )) wake_up( &queue->obj, 0 );
 }
 
@@ -503,6 +533,7 @@ static inline void clear_queue_bits( struct msg_queue *queue, unsigned int bits
 {
     queue->wake_bits &= ~bits;
     queue->changed_bits &= ~bits;
+    update_queue_status( queue );
 
     if (do_fsync() && !is_signaled( queue ))
         fsync_clear( &queue->obj );
@@ -962,6 +993,9 @@ static int is_queue_hung( struct msg_queue *queue )
     if (do_fsync() && queue->fsync_in_msgwait)
         return 0;   /* thread is waiting on queue in absentia -> not hung */
 
+    if (do_fsync() && (fsync_get_queue_flags( queue->fsync_status_idx ) & FSYNC_QUEUE_IN_MSGWAIT))
+        return 0;   /* thread is waiting on queue without telling us -> not hung */
+
     if (do_esync() && queue->esync_in_msgwait)
         return 0;   /* thread is waiting on queue in absentia -> not hung */
 
@@ -1039,6 +1073,7 @@ static void msg_queue_satisfied( struct object *obj, struct wait_queue_entry *en
     struct msg_queue *queue = (struct msg_queue *)obj;
     queue->wake_mask = 0;
     queue->changed_mask = 0;
+    if (do_fsync()) fsync_set_queue_flags( queue->fsync_status_idx, FSYNC_QUEUE_MASKS_RESET, 0 );
 }
 
 static void msg_queue_destroy( struct object *obj )
@@ -1080,6 +1115,12 @@ static void msg_queue_destroy( struct object *obj )
 
     if (do_esync())
         close( queue->esync_fd );
+
+    if (do_fsync())
+    {
+        fsync_free_shm( queue->fsync_idx );
+        fsync_free_shm( queue->fsync_status_idx );
+    }
 }
 
 static void msg_queue_poll_event( struct fd *fd, int event )
@@ -1560,6 +1601,7 @@ static void queue_hardware_message( struct desktop *desktop, struct message *msg
     unsigned int msg_code;
 
     update_input_key_state( desktop, desktop->keystate, msg );
+    update_desktop_shared( desktop );
     last_input_time = get_tick_count();
     if (msg->msg != WM_MOUSEMOVE) always_queue = 1;
 
@@ -1757,6 +1799,7 @@ static int queue_mouse_message( struct desktop *desktop, user_handle_t win, cons
     };
 
     desktop->cursor.last_change = get_tick_count();
+    update_desktop_shared( desktop );
     flags = input->mouse.flags;
     time  = input->mouse.time;
     if (!time) time = desktop->cursor.last_change;
@@ -2385,7 +2428,11 @@ DECL_HANDLER(set_queue_fd)
     if ((unix_fd = get_file_unix_fd( file )) != -1)
     {
         if ((unix_fd = dup( unix_fd )) != -1)
+        {
             queue->fd = create_anonymous_fd( &msg_queue_fd_ops, unix_fd, &queue->obj, 0 );
+            /* we have to poll the fd on behalf of the client from now on */
+            if (do_fsync()) fsync_set_queue_flags( queue->fsync_status_idx, FSYNC_QUEUE_SERVER_WAIT, 0 );
+        }
         else
             file_set_error();
     }
@@ -2402,6 +2449,7 @@ DECL_HANDLER(set_queue_mask)
     {
         queue->wake_mask    = req->wake_mask;
         queue->changed_mask = req->changed_mask;
+        if (do_fsync()) fsync_set_queue_flags( queue->fsync_status_idx, 0, FSYNC_QUEUE_MASKS_RESET );
         reply->wake_bits    = queue->wake_bits;
         reply->changed_bits = queue->changed_bits;
         if (is_signaled( queue ))
@@ -2423,6 +2471,7 @@ DECL_HANDLER(get_queue_status)
         reply->wake_bits    = queue->wake_bits;
         reply->changed_bits = queue->changed_bits;
         queue->changed_bits &= ~req->clear_bits;
+        update_queue_status( queue );
 
         if (do_fsync() && !is_signaled( queue ))
             fsync_clear( &queue->obj );
@@ -2614,6 +2663,7 @@ DECL_HANDLER(get_message)
     }
     if (filter & QS_INPUT) queue->changed_bits &= ~QS_INPUT;
     if (filter & QS_PAINT) queue->changed_bits &= ~QS_PAINT;
+    update_queue_status( queue );
 
     /* then check for posted messages */
     if ((filter & QS_POSTMESSAGE) &&
@@ -2668,6 +2718,7 @@ DECL_HANDLER(get_message)
     if (get_win == -1 && current->process->idle_event) set_event( current->process->idle_event );
     queue->wake_mask = req->wake_mask;
     queue->changed_mask = req->changed_mask;
+    if (do_fsync()) fsync_set_queue_flags( queue->fsync_status_idx, 0, FSYNC_QUEUE_MASKS_RESET );
     set_error( STATUS_PENDING );  /* FIXME */
 }
 
@@ -3043,7 +3094,11 @@ DECL_HANDLER(get_key_state)
         if (req->key >= 0)
         {
             reply->state = desktop->keystate[req->key & 0xff];
-            desktop->keystate[req->key & 0xff] &= ~0x40;
+            if (desktop->keystate[req->key & 0xff] & 0x40)
+            {
+                desktop->keystate[req->key & 0xff] &= ~0x40;
+                update_desktop_shared( desktop );
+            }
         }
         set_reply_data( desktop->keystate, size );
         release_object( desktop );
@@ -3085,6 +3140,7 @@ DECL_HANDLER(set_key_state)
     {
         if (!(desktop = get_thread_desktop( current, 0 ))) return;
         memcpy( desktop->keystate, get_req_data(), size );
+        update_desktop_shared( desktop );
         release_object( desktop );
     }
     else
@@ -3094,6 +3150,7 @@ DECL_HANDLER(set_key_state)
         if (req->async && (desktop = get_thread_desktop( thread, 0 )))
         {
             memcpy( desktop->keystate, get_req_data(), size );
+            update_desktop_shared( desktop );
             release_object( desktop );
         }
         release_object( thread );
@@ -3369,7 +3426,27 @@ DECL_HANDLER(fsync_msgwait)
     if (current->process->idle_event && !(queue->wake_mask & QS_SMRESULT))
         set_event( current->process->idle_event );
 
+    /* once the idle event is set (it is never reset) and as long as there is no
+     * driver fd to poll, the client can do its message waits on its own */
+    if (req->in_msgwait && !queue->fd && !(queue->wake_mask & QS_SMRESULT))
+        fsync_set_queue_flags( queue->fsync_status_idx, 0, FSYNC_QUEUE_SERVER_WAIT );
+
     /* and start/stop waiting on the driver */
     if (queue->fd)
         set_fd_events( queue->fd, req->in_msgwait ? POLLIN : 0 );
 }
+
+
+DECL_HANDLER(get_fsync_queue_status)
+{
+    struct msg_queue *queue = get_current_queue();
+
+    if (!do_fsync())
+    {
+        set_error( STATUS_NOT_IMPLEMENTED );
+        return;
+    }
+
+    if (queue) reply->shm_idx = queue->fsync_status_idx;
+    reply->hooks_idx = fsync_get_hooks_serial_idx();
+}
@@ -36,6 +36,9 @@
 #include <stdlib.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#ifdef HAVE_SYS_MMAN_H
+# include <sys/mman.h>
+#endif
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
@@ -77,6 +80,7 @@ struct key
     unsigned int      flags;       /* flags */
     timeout_t         modif;       /* last modification time */
     struct list       notify_list; /* list of notifications */
+    unsigned int      id;          /* unique id, identifies the key in the client-side caches */
 };
 
 /* key flags */
@@ -116,6 +120,16 @@ static const WCHAR wow6432node[] = {'W','o','w','6','4','3','2','N','o','d','e'}
 static const WCHAR symlink_value[] = {'S','y','m','b','o','l','i','c','L','i','n','k','V','a','l','u','e'};
 static const struct unicode_str symlink_str = { symlink_value, sizeof(symlink_value) };
 
+static struct object *registry_shm_mapping;  /* mapping holding the generation counters */
+static registry_shm_t *registry_shm;         /* generation counters shared with the clients */
+static unsigned int next_key_id;             /* id of the last allocated key */
+
+/* index of the shared generation counter of a key handle */
+static inline unsigned int get_handle_gen_slot( struct process *process, obj_handle_t handle )
+{
+    return ((handle >> 2) + process->id * 37) % REGISTRY_HANDLE_SLOTS;
+}
+
 static void set_periodic_save_timer(void);
 static struct key_value *find_value( const struct key *key, const struct unicode_str *name, int *index );
 
@@ -124,6 +138,8 @@ struct save_branch_info
 {
     struct key  *key;
     const char  *path;
+    char        *hive_path;      /* path of the binary snapshot */
+    int          hive_valid;     /* snapshot matches the current text file */
 };
 
 #define MAX_SAVE_BRANCH_INFO 3
@@ -402,6 +418,8 @@ static int key_close_handle( struct object *obj, struct process *process, obj_ha
     struct key * key = (struct key *) obj;
     struct notify *notify = find_notify( key, process, handle );
     if (notify) do_notification( key, notify, 1 );
+    /* the handle value may be reused for another key */
+    if (registry_shm) registry_shm->handle_gen[get_handle_gen_slot( process, handle )]++;
     return 1;  /* ok to close */
 }
 
@@ -494,6 +512,7 @@ static struct key *alloc_key( const struct unicode_str *name, timeout_t modif )
         key->values      = NULL;
         key->modif       = modif;
         key->parent      = NULL;
+        if (!(key->id = ++next_key_id)) key->id = ++next_key_id;
         list_init( &key->notify_list );
         if (name->len && !(key->name = memdup( name->str, name->len )))
         {
@@ -539,11 +558,33 @@ static void check_notify( struct key *key, unsigned int change, int not_subtree
     }
 }
 
+/* index of the shared generation counter of a key */
+static inline unsigned int get_key_gen_slot( const struct key *key )
+{
+    return key->id % REGISTRY_GEN_SLOTS;
+}
+
+/* invalidate the client-side caches of the values of a key */
+static inline void bump_key_gen( const struct key *key )
+{
+    if (registry_shm) registry_shm->gen[get_key_gen_slot( key )]++;
+}
+
+/* invalidate all the client-side value caches */
+static void bump_all_key_gens(void)
+{
+    unsigned int i;
+
+    if (!registry_shm) return;
+    for (i = 0; i < REGISTRY_GEN_SLOTS; i++) registry_shm->gen[i]++;
+}
+
 /* update key modification time */
 static void touch_key( struct key *key, unsigned int change )
 {
     struct key *k;
 
+    bump_key_gen( key );
     key->modif = current_time;
     make_dirty( key );
 
@@ -621,6 +662,7 @@ static void free_subkey( struct key *parent, int index )
     parent->last_subkey--;
     key->flags |= KEY_DELETED;
     key->parent = NULL;
+    bump_key_gen( key );
     if (is_wow6432node( key->name, key->namelen )) parent->flags &= ~KEY_WOW64;
     release_object( key );
 
@@ -1716,28 +1758,464 @@ static void load_registry( struct key *key, obj_handle_t handle )
     }
 }
 
+/*
+ * Binary hive files
+ *
+ * The text file of each saved branch remains the authoritative copy of the
+ * registry and is still written by the periodic saves. In addition, when the
+ * server exits, it writes a binary snapshot of the branch (<file>.hive) that
+ * can be loaded at the next startup without going through the text parser.
+ * The snapshot starts with a header identifying the text file it was written
+ * against, and is ignored as soon as the text file changes, be it through a
+ * periodic save, a crash before the snapshot was written, or a manual edit.
+ *
+ * The snapshot contains a sequence of records, one per key, each describing
+ * the full state of the key (class, flags and all its values). Key paths are
+ * relative to the branch key, parents come before their subkeys.
+ */
+
+#define HIVE_MAGIC     0x45564948  /* "HIVE" */
+#define HIVE_VERSION   2
+
+struct hive_header
+{
+    unsigned int   magic;        /* HIVE_MAGIC */
+    unsigned int   version;      /* HIVE_VERSION */
+    unsigned int   arch;         /* prefix type */
+    unsigned int   reserved;
+    file_pos_t     text_size;    /* size of the text file */
+    file_pos_t     text_ino;     /* inode of the text file */
+    timeout_t      text_mtime;   /* modification time of the text file */
+};
+
+#define HIVE_KEY_SYMLINK  0x0001
+
+struct hive_record
+{
+    unsigned int   size;         /* size of the record including this header, 8-byte aligned */
+    unsigned int   checksum;     /* checksum of the record after this field */
+    unsigned short reserved;
+    unsigned short flags;        /* HIVE_KEY_* flags */
+    data_size_t    pathlen;      /* length of the key path in bytes */
+    data_size_t    classlen;     /* length of the key class in bytes */
+    unsigned int   nb_values;    /* number of values */
+    timeout_t      modif;        /* key modification time */
+    /* followed by the key path, the class and the values */
+};
+
+struct hive_value
+{
+    unsigned int   type;         /* value type */
+    data_size_t    namelen;      /* length of the value name in bytes */
+    data_size_t    len;          /* length of the value data */
+    /* followed by the name and the data, next value is 4-byte aligned */
+};
+
+/* growable buffer of binary hive records */
+struct hive_buffer
+{
+    char        *data;         /* buffer data */
+    size_t       size;         /* size of the records in the buffer */
+    size_t       alloc;        /* allocated size */
+};
+
+static unsigned int hive_checksum( const void *ptr, size_t size )
+{
+    const unsigned char *p = ptr;
+    unsigned int hash = 0x811c9dc5;
+
+    while (size--) hash = (hash ^ *p++) * 0x01000193;
+    return hash;
+}
+
+static void *hive_buffer_reserve( struct hive_buffer *buf, size_t len )
+{
+    void *ptr;
+
+    if (buf->size + len > buf->alloc)
+    {
+        size_t alloc = buf->alloc * 2;
+        char *data;
+
+        if (alloc < buf->size + len) alloc = buf->size + len + 4096;
+        if (!(data = realloc( buf->data, alloc ))) return NULL;
+        buf->data  = data;
+        buf->alloc = alloc;
+    }
+    ptr = buf->data + buf->size;
+    buf->size += len;
+    return ptr;
+}
+
+/* get the length of the path of a key relative to a branch */
+static data_size_t get_hive_path_len( const struct key *key, const struct key *base )
+{
+    data_size_t len = 0;
+
+    for ( ; key != base; key = key->parent)
+    {
+        len += key->namelen;
+        if (key->parent != base) len += sizeof(WCHAR);
+    }
+    return len;
+}
+
+/* store the path of a key relative to a branch */
+static void get_hive_path( const struct key *key, const struct key *base, WCHAR *path, data_size_t len )
+{
+    WCHAR *p = path + len / sizeof(WCHAR);
+
+    for ( ; key != base; key = key->parent)
+    {
+        p -= key->namelen / sizeof(WCHAR);
+        memcpy( p, key->name, key->namelen );
+        if (key->parent != base) *--p = '\\';
+    }
+}
+
+/* append a record describing a key to a buffer */
+static int add_hive_record( struct hive_buffer *buf, const struct key *key, const struct key *base )
+{
+    struct hive_record *rec;
+    struct hive_value *val;
+    data_size_t pathlen = get_hive_path_len( key, base );
+    size_t size, pos;
+    char *ptr;
+    int i;
+
+    size = sizeof(*rec) + pathlen + key->classlen;
+    for (i = 0; i <= key->last_value; i++)
+        size = ((size + 3) & ~3) + sizeof(*val) + key->values[i].namelen + key->values[i].len;
+    size = (size + 7) & ~7;
+    if (!(ptr = hive_buffer_reserve( buf, size ))) return 0;
+    memset( ptr, 0, size );
+
+    rec = (struct hive_record *)ptr;
+    rec->size      = size;
+    rec->pathlen   = pathlen;
+    rec->classlen  = key->classlen;
+    rec->nb_values = key->last_value + 1;
+    rec->modif     = key->modif;
+    if (key->flags & KEY_SYMLINK) rec->flags |= HIVE_KEY_SYMLINK;
+    get_hive_path( key, base, (WCHAR *)(rec + 1), pathlen );
+    pos = sizeof(*rec) + pathlen;
+    if (key->classlen) memcpy( ptr + pos, key->class, key->classlen );
+    pos += key->classlen;
+
+    for (i = 0; i <= key->last_value; i++)
+    {
+        const struct key_value *value = &key->values[i];
+
+        pos = (pos + 3) & ~3;
+        val = (struct hive_value *)(ptr + pos);
+        val->type    = value->type;
+        val->namelen = value->namelen;
+        val->len     = value->len;
+        pos += sizeof(*val);
+        if (value->namelen) memcpy( ptr + pos, value->name, value->namelen );
+        pos += value->namelen;
+        if (value->len) memcpy( ptr + pos, value->data, value->len );
+        pos += value->len;
+    }
+    rec->checksum = hive_checksum( &rec->reserved, size - FIELD_OFFSET( struct hive_record, reserved ));
+    return 1;
+}
+
+/* check that a record is complete and consistent; return its size or 0 */
+static size_t check_hive_record( const char *ptr, size_t avail )
+{
+    const struct hive_record *rec = (const struct hive_record *)ptr;
+    const struct hive_value *val;
+    size_t pos;
+    unsigned int i;
+
+    if (avail < sizeof(*rec)) return 0;
+    if (rec->size < sizeof(*rec) || rec->size > avail || rec->size % 8) return 0;
+    if (rec->checksum != hive_checksum( &rec->reserved, rec->size - FIELD_OFFSET( struct hive_record, reserved )))
+        return 0;
+    if (rec->pathlen % sizeof(WCHAR) || rec->pathlen > rec->size - sizeof(*rec)) return 0;
+    pos = sizeof(*rec) + rec->pathlen;
+    if (rec->classlen % sizeof(WCHAR) || rec->classlen > rec->size - pos) return 0;
+    pos += rec->classlen;
+
+    for (i = 0; i < rec->nb_values; i++)
+    {
+        pos = (pos + 3) & ~3;
+        if (pos + sizeof(*val) > rec->size) return 0;
+        val = (const struct hive_value *)(ptr + pos);
+        pos += sizeof(*val);
+        if (val->namelen % sizeof(WCHAR) || val->namelen > rec->size - pos) return 0;
+        pos += val->namelen;
+        if (val->len > rec->size - pos) return 0;
+        pos += val->len;
+    }
+    return rec->size;
+}
+
+/* find or create a key from its path relative to a branch, without following symlinks */
+static struct key *get_hive_key( struct key *base, const struct unicode_str *path, timeout_t modif )
+{
+    struct key *key = base, *subkey;
+    struct unicode_str token;
+    int index;
+
+    token.str = NULL;
+    if (!get_path_token( path, &token )) return NULL;
+    while (token.len)
+    {
+        if (!(subkey = find_subkey( key, &token, &index )))
+        {
+            if (!(subkey = alloc_subkey( key, &token, index, modif ))) return NULL;
+        }
+        key = subkey;
+        get_path_token( path, &token );
+    }
+    return (struct key *)grab_object( key );
+}
+
+/* apply a record that has been checked by check_hive_record; like the text
+ * parser, this builds the tree directly, without notifications, dirty flags
+ * or generation changes */
+static void apply_hive_record( struct key *base, const char *ptr )
+{
+    const struct hive_record *rec = (const struct hive_record *)ptr;
+    const struct hive_value *val;
+    struct key_value *value;
+    struct unicode_str path, name;
+    struct key *key;
+    size_t pos;
+    unsigned int i;
+    int index;
+
+    path.str = (const WCHAR *)(rec + 1);
+    path.len = rec->pathlen;
+    pos = sizeof(*rec) + rec->pathlen;
+
+    if (!(key = get_hive_key( base, &path, rec->modif ))) return;
+    key->modif = rec->modif;
+    if (rec->flags & HIVE_KEY_SYMLINK) key->flags |= KEY_SYMLINK;
+
+    free( key->class );
+    key->class    = NULL;
+    key->classlen = 0;
+    if (rec->classlen && (key->class = memdup( ptr + pos, rec->classlen ))) key->classlen = rec->classlen;
+    pos += rec->classlen;
+
+    while (key->last_value >= 0)
+    {
+        free( key->values[key->last_value].name );
+        free( key->values[key->last_value].data );
+        key->last_value--;
+    }
+
+    for (i = 0; i < rec->nb_values; i++)
+    {
+        pos = (pos + 3) & ~3;
+        val = (const struct hive_value *)(ptr + pos);
+        pos += sizeof(*val);
+        name.str = (const WCHAR *)(ptr + pos);
+        name.len = val->namelen;
+        pos += val->namelen;
+
+        if (!(value = find_value( key, &name, &index )) &&
+            !(value = insert_value( key, &name, index ))) break;
+        free( value->data );
+        value->data = val->len ? memdup( ptr + pos, val->len ) : NULL;
+        value->len  = value->data ? val->len : 0;
+        value->type = val->type;
+        pos += val->len;
+    }
+    release_object( key );
+}
+
+/* get the identity of the text file of a branch */
+static int get_text_stamp( const char *path, struct hive_header *header )
+{
+    struct stat st;
+
+    if (stat( path, &st ) == -1) return 0;
+    memset( header, 0, sizeof(*header) );
+    header->version    = HIVE_VERSION;
+    header->arch       = prefix_type;
+    header->text_size  = st.st_size;
+    header->text_ino   = st.st_ino;
+    header->text_mtime = (timeout_t)st.st_mtime * TICKS_PER_SEC;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    header->text_mtime += st.st_mtim.tv_nsec / 100;
+#endif
+    return 1;
+}
+
+/* check that a hive file applies to the given text file */
+static int check_hive_header( const struct hive_header *header, const struct hive_header *stamp )
+{
+    if (header->magic != HIVE_MAGIC || header->version != HIVE_VERSION) return 0;
+    if (header->text_size != stamp->text_size || header->text_ino != stamp->text_ino ||
+        header->text_mtime != stamp->text_mtime) return 0;
+    if (header->arch != PREFIX_32BIT && header->arch != PREFIX_64BIT) return 0;
+    return prefix_type == PREFIX_UNKNOWN || header->arch == prefix_type;
+}
+
+/* map a hive file in memory */
+static char *map_hive_file( const char *path, size_t *size )
+{
+    struct stat st;
+    void *ptr;
+    int fd;
+
+    if ((fd = open( path, O_RDONLY )) == -1) return NULL;
+    if (fstat( fd, &st ) == -1 || st.st_size < sizeof(struct hive_header) || st.st_size != (size_t)st.st_size)
+    {
+        close( fd );
+        return NULL;
+    }
+    ptr = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+    if (ptr == MAP_FAILED) return NULL;
+    *size = st.st_size;
+    return ptr;
+}
+
+/* load the binary snapshot of a branch, if it is up to date */
+static int load_hive( struct save_branch_info *info, const struct hive_header *stamp )
+{
+    const struct hive_header *header;
+    size_t pos, len, size;
+    char *ptr;
+
+    if (!(ptr = map_hive_file( info->hive_path, &size ))) return 0;
+    header = (const struct hive_header *)ptr;
+    if (!check_hive_header( header, stamp )) goto error;
+
+    /* validate the whole file before touching the registry */
+    for (pos = sizeof(*header); pos < size; pos += len)
+        if (!(len = check_hive_record( ptr + pos, size - pos ))) goto error;
+
+    prefix_type = header->arch;
+    for (pos = sizeof(*header); pos < size; pos += len)
+    {
+        len = ((const struct hive_record *)(ptr + pos))->size;
+        apply_hive_record( info->key, ptr + pos );
+    }
+    munmap( ptr, size );
+    return 1;
+
+error:
+    if (debug_level) fprintf( stderr, "%s: ignoring outdated or invalid snapshot\n", info->hive_path );
+    munmap( ptr, size );
+    return 0;
+}
+
+/* create a file through a temp file in the same directory */
+static FILE *create_hive_file( const char *path, char **tmp )
+{
+    char *p;
+    int fd, count = 0;
+    FILE *f;
+
+    if (!(*tmp = malloc( strlen(path) + 20 ))) return NULL;
+    strcpy( *tmp, path );
+    if ((p = strrchr( *tmp, '/' ))) p++;
+    else p = *tmp;
+    for (;;)
+    {
+        sprintf( p, "hive%lx%04x.tmp", (long) getpid(), count++ );
+        if ((fd = open( *tmp, O_CREAT | O_EXCL | O_WRONLY, 0666 )) != -1) break;
+        if (errno != EEXIST) goto error;
+    }
+    if ((f = fdopen( fd, "w" ))) return f;
+    close( fd );
+    unlink( *tmp );
+error:
+    free( *tmp );
+    *tmp = NULL;
+    return NULL;
+}
+
+/* rename a completed temp file to its final name */
+static int commit_hive_file( FILE *f, char *tmp, const char *path, int ret )
+{
+    ret = !fclose( f ) && ret;
+    if (ret) ret = !rename( tmp, path );
+    if (!ret) unlink( tmp );
+    free( tmp );
+    return ret;
+}
+
+/* write the records of a key and its subkeys to a snapshot file */
+static int save_hive_keys( struct hive_buffer *buf, const struct key *key, const struct key *base, FILE *f )
+{
+    int i;
+
+    if (key->flags & KEY_VOLATILE) return 1;
+    buf->size = 0;
+    if (!add_hive_record( buf, key, base )) return 0;
+    if (fwrite( buf->data, buf->size, 1, f ) != 1) return 0;
+    for (i = 0; i <= key->last_subkey; i++)
+        if (!save_hive_keys( buf, key->subkeys[i], base, f )) return 0;
+    return 1;
+}
+
+/* write the snapshot of a branch, after the text file has been saved */
+static int save_hive( struct save_branch_info *info )
+{
+    struct hive_header header;
+    struct hive_buffer buf = { NULL, 0, 0 };
+    char *tmp;
+    FILE *f;
+    int ret;
+
+    /* nothing to do if the branch has never been saved */
+    if (!get_text_stamp( info->path, &header )) return errno == ENOENT;
+
+    header.magic = HIVE_MAGIC;
+    if (!(f = create_hive_file( info->hive_path, &tmp ))) return 0;
+    ret = fwrite( &header, sizeof(header), 1, f ) == 1 && save_hive_keys( &buf, info->key, info->key, f );
+    free( buf.data );
+    if (!commit_hive_file( f, tmp, info->hive_path, ret )) return 0;
+    info->hive_valid = 1;
+    return 1;
+}
+
 /* load one of the initial registry files */
 static int load_init_registry_from_file( const char *filename, struct key *key )
 {
-    FILE *f;
+    struct save_branch_info *info;
+    struct hive_header stamp;
+    FILE *f = NULL;
+    int loaded = 0;
+
+    assert( save_branch_count < MAX_SAVE_BRANCH_INFO );
+
+    info = &save_branch_info[save_branch_count];
+    memset( info, 0, sizeof(*info) );
+    info->path = filename;
+    info->key  = key;
+    if (!(info->hive_path = malloc( strlen(filename) + sizeof(".hive") ))) fatal_error( "out of memory\n" );
+    sprintf( info->hive_path, "%s.hive", filename );
 
-    if ((f = fopen( filename, "r" )))
+    if (get_text_stamp( filename, &stamp ) && load_hive( info, &stamp ))
+    {
+        info->hive_valid = 1;
+        loaded = 1;
+    }
+    else if ((f = fopen( filename, "r" )))
     {
         load_keys( key, filename, f, 0 );
         fclose( f );
         if (get_error() == STATUS_NOT_REGISTRY_FILE)
         {
             fprintf( stderr, "%s is not a valid registry file\n", filename );
+            free( info->hive_path );
             return 1;
         }
+        loaded = 1;
     }
 
-    assert( save_branch_count < MAX_SAVE_BRANCH_INFO );
-
-    save_branch_info[save_branch_count].path = filename;
-    save_branch_info[save_branch_count++].key = (struct key *)grab_object( key );
+    save_branch_count++;
+    grab_object( key );
     make_object_static( &key->obj );
-    return (f != NULL);
+    return loaded;
 }
 
 static WCHAR *format_user_registry_path( const SID *sid, struct unicode_str *path )
@@ -1927,8 +2405,10 @@ static void save_registry( struct key *key, obj_handle_t handle )
 }
 
 /* save a registry branch to a file */
-static int save_branch( struct key *key, const char *path )
+static int save_branch( struct save_branch_info *info )
 {
+    struct key *key = info->key;
+    const char *path = info->path;
     struct stat st;
     char *p, *tmp = NULL;
     int fd, count = 0, ret = 0;
@@ -1940,6 +2420,9 @@ static int save_branch( struct key *key, const char *path )
         return 1;
     }
 
+    /* the snapshot no longer matches the text file */
+    info->hive_valid = 0;
+
     /* test the file type */
 
     if ((fd = open( path, O_WRONLY )) != -1)
@@ -2008,7 +2491,7 @@ static void periodic_save( void *arg )
     if (fchdir( config_dir_fd ) == -1) return;
     save_timeout_user = NULL;
     for (i = 0; i < save_branch_count; i++)
-        save_branch( save_branch_info[i].key, save_branch_info[i].path );
+        save_branch( &save_branch_info[i] );
     if (fchdir( server_dir_fd ) == -1) fatal_error( "chdir to server dir: %s\n", strerror( errno ));
     set_periodic_save_timer();
 }
@@ -2028,12 +2511,14 @@ void flush_registry(void)
     if (fchdir( config_dir_fd ) == -1) return;
     for (i = 0; i < save_branch_count; i++)
     {
-        if (!save_branch( save_branch_info[i].key, save_branch_info[i].path ))
+        if (!save_branch( &save_branch_info[i] ))
         {
             fprintf( stderr, "wineserver: could not save registry branch to %s",
                      save_branch_info[i].path );
             perror( " " );
         }
+        else if (!save_branch_info[i].hive_valid && !save_hive( &save_branch_info[i] ) && debug_level)
+            fprintf( stderr, "%s: could not save registry snapshot\n", save_branch_info[i].path );
     }
     if (fchdir( server_dir_fd ) == -1) fatal_error( "chdir to server dir: %s\n", strerror( errno ));
 }
@@ -2173,11 +2658,31 @@ DECL_HANDLER(get_key_value)
     reply->total = 0;
     if ((key = get_hkey_obj( req->hkey, KEY_QUERY_VALUE )))
     {
+        reply->key_id      = key->id;
+        reply->gen_slot    = get_key_gen_slot( key );
+        reply->gen         = registry_shm ? registry_shm->gen[reply->gen_slot] : 0;
+        reply->handle_slot = get_handle_gen_slot( current->process, req->hkey );
+        reply->handle_gen  = registry_shm ? registry_shm->handle_gen[reply->handle_slot] : 0;
         get_value( key, &name, &reply->type, &reply->total );
         release_object( key );
     }
 }
 
+/* get a handle to the registry generation counters */
+DECL_HANDLER(get_registry_shared_memory)
+{
+    if (!registry_shm_mapping)
+    {
+        void *ptr;
+
+        if (!(registry_shm_mapping = create_server_mapping( sizeof(*registry_shm), &ptr ))) return;
+        make_object_static( registry_shm_mapping );
+        registry_shm = ptr;
+    }
+    reply->handle = alloc_handle( current->process, registry_shm_mapping,
+                                  SECTION_QUERY | SECTION_MAP_READ, 0 );
+}
+
 /* enumerate the value of a registry key */
 DECL_HANDLER(enum_key_value)
 {
@@ -2232,6 +2737,7 @@ DECL_HANDLER(load_registry)
         if ((key = create_key( parent, &name, NULL, 0, KEY_WOW64_64KEY, 0, sd, &dummy )))
         {
             load_registry( key, req->file );
+            bump_all_key_gens();
             release_object( key );
         }
         release_object( parent );
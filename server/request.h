@@ -211,6 +211,8 @@ DECL_HANDLER(map_view);
 DECL_HANDLER(unmap_view);
 DECL_HANDLER(get_mapping_committed_range);
 DECL_HANDLER(add_mapping_committed_range);
+DECL_HANDLER(get_image_reloc_cache);
+DECL_HANDLER(set_image_reloc_cache_ready);
 DECL_HANDLER(is_same_mapping);
 DECL_HANDLER(create_snapshot);
 DECL_HANDLER(next_process);
@@ -230,6 +232,7 @@ DECL_HANDLER(flush_key);
 DECL_HANDLER(enum_key);
 DECL_HANDLER(set_key_value);
 DECL_HANDLER(get_key_value);
+DECL_HANDLER(get_registry_shared_memory);
 DECL_HANDLER(enum_key_value);
 DECL_HANDLER(delete_key_value);
 DECL_HANDLER(load_registry);
@@ -404,6 +407,7 @@ DECL_HANDLER(set_window_layered_info);
 DECL_HANDLER(alloc_user_handle);
 DECL_HANDLER(free_user_handle);
 DECL_HANDLER(set_cursor);
+DECL_HANDLER(get_desktop_shared_memory);
 DECL_HANDLER(update_rawinput_devices);
 DECL_HANDLER(get_rawinput_devices);
 DECL_HANDLER(get_suspend_context);
@@ -428,6 +432,7 @@ DECL_HANDLER(open_fsync);
 DECL_HANDLER(get_fsync_idx);
 DECL_HANDLER(fsync_msgwait);
 DECL_HANDLER(get_fsync_apc_idx);
+DECL_HANDLER(get_fsync_queue_status);
 
 #ifdef WANT_REQUEST_HANDLERS
 
@@ -526,6 +531,8 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_unmap_view,
     (req_handler)req_get_mapping_committed_range,
     (req_handler)req_add_mapping_committed_range,
+    (req_handler)req_get_image_reloc_cache,
+    (req_handler)req_set_image_reloc_cache_ready,
     (req_handler)req_is_same_mapping,
     (req_handler)req_create_snapshot,
     (req_handler)req_next_process,
@@ -545,6 +552,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_enum_key,
     (req_handler)req_set_key_value,
     (req_handler)req_get_key_value,
+    (req_handler)req_get_registry_shared_memory,
     (req_handler)req_enum_key_value,
     (req_handler)req_delete_key_value,
     (req_handler)req_load_registry,
@@ -719,6 +727,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_alloc_user_handle,
     (req_handler)req_free_user_handle,
     (req_handler)req_set_cursor,
+    (req_handler)req_get_desktop_shared_memory,
     (req_handler)req_update_rawinput_devices,
     (req_handler)req_get_rawinput_devices,
     (req_handler)req_get_suspend_context,
@@ -743,6 +752,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_get_fsync_idx,
     (req_handler)req_fsync_msgwait,
     (req_handler)req_get_fsync_apc_idx,
+    (req_handler)req_get_fsync_queue_status,
 };
 
 C_ASSERT( sizeof(affinity_t) == 8 );
@@ -1359,6 +1369,15 @@ C_ASSERT( FIELD_OFFSET(struct add_mapping_committed_range_request, base) == 16 )
 C_ASSERT( FIELD_OFFSET(struct add_mapping_committed_range_request, offset) == 24 );
 C_ASSERT( FIELD_OFFSET(struct add_mapping_committed_range_request, size) == 32 );
 C_ASSERT( sizeof(struct add_mapping_committed_range_request) == 40 );
+C_ASSERT( FIELD_OFFSET(struct get_image_reloc_cache_request, base) == 16 );
+C_ASSERT( sizeof(struct get_image_reloc_cache_request) == 24 );
+C_ASSERT( FIELD_OFFSET(struct get_image_reloc_cache_reply, shared) == 8 );
+C_ASSERT( FIELD_OFFSET(struct get_image_reloc_cache_reply, handle) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_image_reloc_cache_reply, ready) == 20 );
+C_ASSERT( sizeof(struct get_image_reloc_cache_reply) == 24 );
+C_ASSERT( FIELD_OFFSET(struct set_image_reloc_cache_ready_request, base) == 16 );
+C_ASSERT( FIELD_OFFSET(struct set_image_reloc_cache_ready_request, size) == 24 );
+C_ASSERT( sizeof(struct set_image_reloc_cache_ready_request) == 32 );
 C_ASSERT( FIELD_OFFSET(struct is_same_mapping_request, base1) == 16 );
 C_ASSERT( FIELD_OFFSET(struct is_same_mapping_request, base2) == 24 );
 C_ASSERT( sizeof(struct is_same_mapping_request) == 32 );
@@ -1459,7 +1478,15 @@ C_ASSERT( FIELD_OFFSET(struct get_key_value_request, hkey) == 12 );
 C_ASSERT( sizeof(struct get_key_value_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_key_value_reply, type) == 8 );
 C_ASSERT( FIELD_OFFSET(struct get_key_value_reply, total) == 12 );
-C_ASSERT( sizeof(struct get_key_value_reply) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_key_value_reply, key_id) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_key_value_reply, gen_slot) == 20 );
+C_ASSERT( FIELD_OFFSET(struct get_key_value_reply, gen) == 24 );
+C_ASSERT( FIELD_OFFSET(struct get_key_value_reply, handle_slot) == 28 );
+C_ASSERT( FIELD_OFFSET(struct get_key_value_reply, handle_gen) == 32 );
+C_ASSERT( sizeof(struct get_key_value_reply) == 40 );
+C_ASSERT( sizeof(struct get_registry_shared_memory_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_registry_shared_memory_reply, handle) == 8 );
+C_ASSERT( sizeof(struct get_registry_shared_memory_reply) == 16 );
 C_ASSERT( FIELD_OFFSET(struct enum_key_value_request, hkey) == 12 );
 C_ASSERT( FIELD_OFFSET(struct enum_key_value_request, index) == 16 );
 C_ASSERT( FIELD_OFFSET(struct enum_key_value_request, info_class) == 20 );
@@ -2441,6 +2468,9 @@ C_ASSERT( FIELD_OFFSET(struct set_cursor_reply, new_y) == 28 );
 C_ASSERT( FIELD_OFFSET(struct set_cursor_reply, new_clip) == 32 );
 C_ASSERT( FIELD_OFFSET(struct set_cursor_reply, last_change) == 48 );
 C_ASSERT( sizeof(struct set_cursor_reply) == 56 );
+C_ASSERT( sizeof(struct get_desktop_shared_memory_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_desktop_shared_memory_reply, handle) == 8 );
+C_ASSERT( sizeof(struct get_desktop_shared_memory_reply) == 16 );
 C_ASSERT( sizeof(struct update_rawinput_devices_request) == 16 );
 C_ASSERT( sizeof(struct get_rawinput_devices_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_rawinput_devices_reply, device_count) == 8 );
@@ -2517,6 +2547,7 @@ C_ASSERT( sizeof(struct create_fsync_request) == 32 );
 C_ASSERT( FIELD_OFFSET(struct create_fsync_reply, handle) == 8 );
 C_ASSERT( FIELD_OFFSET(struct create_fsync_reply, type) == 12 );
 C_ASSERT( FIELD_OFFSET(struct create_fsync_reply, shm_idx) == 16 );
+C_ASSERT( FIELD_OFFSET(struct create_fsync_reply, shm_serial) == 20 );
 C_ASSERT( sizeof(struct create_fsync_reply) == 24 );
 C_ASSERT( FIELD_OFFSET(struct open_fsync_request, access) == 12 );
 C_ASSERT( FIELD_OFFSET(struct open_fsync_request, attributes) == 16 );
@@ -2526,17 +2557,23 @@ C_ASSERT( sizeof(struct open_fsync_request) == 32 );
 C_ASSERT( FIELD_OFFSET(struct open_fsync_reply, handle) == 8 );
 C_ASSERT( FIELD_OFFSET(struct open_fsync_reply, type) == 12 );
 C_ASSERT( FIELD_OFFSET(struct open_fsync_reply, shm_idx) == 16 );
+C_ASSERT( FIELD_OFFSET(struct open_fsync_reply, shm_serial) == 20 );
 C_ASSERT( sizeof(struct open_fsync_reply) == 24 );
 C_ASSERT( FIELD_OFFSET(struct get_fsync_idx_request, handle) == 12 );
 C_ASSERT( sizeof(struct get_fsync_idx_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_fsync_idx_reply, type) == 8 );
 C_ASSERT( FIELD_OFFSET(struct get_fsync_idx_reply, shm_idx) == 12 );
-C_ASSERT( sizeof(struct get_fsync_idx_reply) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_fsync_idx_reply, shm_serial) == 16 );
+C_ASSERT( sizeof(struct get_fsync_idx_reply) == 24 );
 C_ASSERT( FIELD_OFFSET(struct fsync_msgwait_request, in_msgwait) == 12 );
 C_ASSERT( sizeof(struct fsync_msgwait_request) == 16 );
 C_ASSERT( sizeof(struct get_fsync_apc_idx_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_fsync_apc_idx_reply, shm_idx) == 8 );
 C_ASSERT( sizeof(struct get_fsync_apc_idx_reply) == 16 );
+C_ASSERT( sizeof(struct get_fsync_queue_status_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_fsync_queue_status_reply, shm_idx) == 8 );
+C_ASSERT( FIELD_OFFSET(struct get_fsync_queue_status_reply, hooks_idx) == 12 );
+C_ASSERT( sizeof(struct get_fsync_queue_status_reply) == 16 );
 
 #endif  /* WANT_REQUEST_HANDLERS */
 
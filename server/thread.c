@@ -389,6 +389,12 @@ static void destroy_thread( struct object *obj )
 
     if (do_esync())
         close( thread->esync_fd );
+
+    if (do_fsync())
+    {
+        fsync_free_shm( thread->fsync_idx );
+        fsync_free_shm( thread->fsync_apc_idx );
+    }
 }
 
 /* dump a thread on stdout for debugging purposes */
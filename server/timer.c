@@ -259,6 +259,9 @@ static void timer_destroy( struct object *obj )
 
     if (timer->timeout) remove_timeout_user( timer->timeout );
     if (timer->thread) release_object( timer->thread );
+
+    if (do_fsync())
+        fsync_free_shm( timer->fsync_idx );
 }
 
 /* create a timer */
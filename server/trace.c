@@ -1316,6 +1316,7 @@ static void dump_init_process_done_request( const struct init_process_done_reque
     dump_uint64( ", module=", &req->module );
     dump_uint64( ", ldt_copy=", &req->ldt_copy );
     dump_uint64( ", entry=", &req->entry );
+    dump_varargs_bytes( ", usd=", cur_size );
 }
 
 static void dump_init_process_done_reply( const struct init_process_done_reply *req )
@@ -2360,6 +2361,24 @@ static void dump_add_mapping_committed_range_request( const struct add_mapping_c
     dump_uint64( ", size=", &req->size );
 }
 
+static void dump_get_image_reloc_cache_request( const struct get_image_reloc_cache_request *req )
+{
+    dump_uint64( " base=", &req->base );
+}
+
+static void dump_get_image_reloc_cache_reply( const struct get_image_reloc_cache_reply *req )
+{
+    dump_uint64( " shared=", &req->shared );
+    fprintf( stderr, ", handle=%04x", req->handle );
+    fprintf( stderr, ", ready=%d", req->ready );
+}
+
+static void dump_set_image_reloc_cache_ready_request( const struct set_image_reloc_cache_ready_request *req )
+{
+    dump_uint64( " base=", &req->base );
+    dump_uint64( ", size=", &req->size );
+}
+
 static void dump_is_same_mapping_request( const struct is_same_mapping_request *req )
 {
     dump_uint64( " base1=", &req->base1 );
@@ -2564,9 +2583,23 @@ static void dump_get_key_value_reply( const struct get_key_value_reply *req )
 {
     fprintf( stderr, " type=%d", req->type );
     fprintf( stderr, ", total=%u", req->total );
+    fprintf( stderr, ", key_id=%08x", req->key_id );
+    fprintf( stderr, ", gen_slot=%08x", req->gen_slot );
+    fprintf( stderr, ", gen=%08x", req->gen );
+    fprintf( stderr, ", handle_slot=%08x", req->handle_slot );
+    fprintf( stderr, ", handle_gen=%08x", req->handle_gen );
     dump_varargs_bytes( ", data=", cur_size );
 }
 
+static void dump_get_registry_shared_memory_request( const struct get_registry_shared_memory_request *req )
+{
+}
+
+static void dump_get_registry_shared_memory_reply( const struct get_registry_shared_memory_reply *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
 static void dump_enum_key_value_request( const struct enum_key_value_request *req )
 {
     fprintf( stderr, " hkey=%04x", req->hkey );
@@ -4529,6 +4562,15 @@ static void dump_set_cursor_reply( const struct set_cursor_reply *req )
     fprintf( stderr, ", last_change=%08x", req->last_change );
 }
 
+static void dump_get_desktop_shared_memory_request( const struct get_desktop_shared_memory_request *req )
+{
+}
+
+static void dump_get_desktop_shared_memory_reply( const struct get_desktop_shared_memory_reply *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
 static void dump_update_rawinput_devices_request( const struct update_rawinput_devices_request *req )
 {
     dump_varargs_rawinput_devices( " devices=", cur_size );
@@ -4700,6 +4742,7 @@ static void dump_create_fsync_reply( const struct create_fsync_reply *req )
     fprintf( stderr, " handle=%04x", req->handle );
     fprintf( stderr, ", type=%d", req->type );
     fprintf( stderr, ", shm_idx=%08x", req->shm_idx );
+    fprintf( stderr, ", shm_serial=%08x", req->shm_serial );
 }
 
 static void dump_open_fsync_request( const struct open_fsync_request *req )
@@ -4716,6 +4759,7 @@ static void dump_open_fsync_reply( const struct open_fsync_reply *req )
     fprintf( stderr, " handle=%04x", req->handle );
     fprintf( stderr, ", type=%d", req->type );
     fprintf( stderr, ", shm_idx=%08x", req->shm_idx );
+    fprintf( stderr, ", shm_serial=%08x", req->shm_serial );
 }
 
 static void dump_get_fsync_idx_request( const struct get_fsync_idx_request *req )
@@ -4727,6 +4771,7 @@ static void dump_get_fsync_idx_reply( const struct get_fsync_idx_reply *req )
 {
     fprintf( stderr, " type=%d", req->type );
     fprintf( stderr, ", shm_idx=%08x", req->shm_idx );
+    fprintf( stderr, ", shm_serial=%08x", req->shm_serial );
 }
 
 static void dump_fsync_msgwait_request( const struct fsync_msgwait_request *req )
@@ -4743,6 +4788,16 @@ static void dump_get_fsync_apc_idx_reply( const struct get_fsync_apc_idx_reply *
     fprintf( stderr, " shm_idx=%08x", req->shm_idx );
 }
 
+static void dump_get_fsync_queue_status_request( const struct get_fsync_queue_status_request *req )
+{
+}
+
+static void dump_get_fsync_queue_status_reply( const struct get_fsync_queue_status_reply *req )
+{
+    fprintf( stderr, " shm_idx=%08x", req->shm_idx );
+    fprintf( stderr, ", hooks_idx=%08x", req->hooks_idx );
+}
+
 static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_new_process_request,
     (dump_func)dump_exec_process_request,
@@ -4836,6 +4891,8 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_unmap_view_request,
     (dump_func)dump_get_mapping_committed_range_request,
     (dump_func)dump_add_mapping_committed_range_request,
+    (dump_func)dump_get_image_reloc_cache_request,
+    (dump_func)dump_set_image_reloc_cache_ready_request,
     (dump_func)dump_is_same_mapping_request,
     (dump_func)dump_create_snapshot_request,
     (dump_func)dump_next_process_request,
@@ -4855,6 +4912,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_enum_key_request,
     (dump_func)dump_set_key_value_request,
     (dump_func)dump_get_key_value_request,
+    (dump_func)dump_get_registry_shared_memory_request,
     (dump_func)dump_enum_key_value_request,
     (dump_func)dump_delete_key_value_request,
     (dump_func)dump_load_registry_request,
@@ -5029,6 +5087,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_alloc_user_handle_request,
     (dump_func)dump_free_user_handle_request,
     (dump_func)dump_set_cursor_request,
+    (dump_func)dump_get_desktop_shared_memory_request,
     (dump_func)dump_update_rawinput_devices_request,
     (dump_func)dump_get_rawinput_devices_request,
     (dump_func)dump_get_suspend_context_request,
@@ -5053,6 +5112,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_get_fsync_idx_request,
     (dump_func)dump_fsync_msgwait_request,
     (dump_func)dump_get_fsync_apc_idx_request,
+    (dump_func)dump_get_fsync_queue_status_request,
 };
 
 static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
@@ -5148,6 +5208,8 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     NULL,
     (dump_func)dump_get_mapping_committed_range_reply,
     NULL,
+    (dump_func)dump_get_image_reloc_cache_reply,
+    NULL,
     NULL,
     (dump_func)dump_create_snapshot_reply,
     (dump_func)dump_next_process_reply,
@@ -5167,6 +5229,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_enum_key_reply,
     NULL,
     (dump_func)dump_get_key_value_reply,
+    (dump_func)dump_get_registry_shared_memory_reply,
     (dump_func)dump_enum_key_value_reply,
     NULL,
     NULL,
@@ -5341,6 +5404,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_alloc_user_handle_reply,
     NULL,
     (dump_func)dump_set_cursor_reply,
+    (dump_func)dump_get_desktop_shared_memory_reply,
     NULL,
     (dump_func)dump_get_rawinput_devices_reply,
     (dump_func)dump_get_suspend_context_reply,
@@ -5365,6 +5429,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_get_fsync_idx_reply,
     NULL,
     (dump_func)dump_get_fsync_apc_idx_reply,
+    (dump_func)dump_get_fsync_queue_status_reply,
 };
 
 static const char * const req_names[REQ_NB_REQUESTS] = {
@@ -5460,6 +5525,8 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "unmap_view",
     "get_mapping_committed_range",
     "add_mapping_committed_range",
+    "get_image_reloc_cache",
+    "set_image_reloc_cache_ready",
     "is_same_mapping",
     "create_snapshot",
     "next_process",
@@ -5479,6 +5546,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "enum_key",
     "set_key_value",
     "get_key_value",
+    "get_registry_shared_memory",
     "enum_key_value",
     "delete_key_value",
     "load_registry",
@@ -5653,6 +5721,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "alloc_user_handle",
     "free_user_handle",
     "set_cursor",
+    "get_desktop_shared_memory",
     "update_rawinput_devices",
     "get_rawinput_devices",
     "get_suspend_context",
@@ -5677,6 +5746,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "get_fsync_idx",
     "fsync_msgwait",
     "get_fsync_apc_idx",
+    "get_fsync_queue_status",
 };
 
 static const struct
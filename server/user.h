@@ -77,6 +77,8 @@ struct desktop
     unsigned int         users;            /* processes and threads using this desktop */
     struct global_cursor cursor;           /* global cursor information */
     unsigned char        keystate[256];    /* asynchronous key state */
+    struct object       *shared_mapping;   /* mapping for the shared memory block */
+    desktop_shm_t       *shared;           /* state shared with the clients */
 };
 
 /* user handles functions */
@@ -97,6 +99,7 @@ extern void cleanup_clipboard_thread( struct thread *thread );
 /* hook functions */
 
 extern void remove_thread_hooks( struct thread *thread );
+extern void hooks_changed(void);
 extern unsigned int get_active_hooks(void);
 extern struct thread *get_first_global_hook( int id );
 
@@ -23,6 +23,9 @@
 
 #include <stdio.h>
 #include <stdarg.h>
+#ifdef HAVE_SYS_MMAN_H
+# include <sys/mman.h>
+#endif
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
@@ -186,7 +189,7 @@ static void winstation_destroy( struct object *obj )
     list_remove( &winstation->entry );
     if (winstation->clipboard) release_object( winstation->clipboard );
     if (winstation->atom_table) release_object( winstation->atom_table );
-    free( winstation->desktop_names );
+    free_namespace( winstation->desktop_names );
 }
 
 static unsigned int winstation_map_access( struct object *obj, unsigned int access )
@@ -236,6 +239,12 @@ static struct desktop *create_desktop( const struct unicode_str *name, unsigned
             memset( desktop->keystate, 0, sizeof(desktop->keystate) );
             list_add_tail( &winstation->desktops, &desktop->entry );
             list_init( &desktop->hotkeys );
+            if (!(desktop->shared_mapping = create_server_mapping( sizeof(*desktop->shared),
+                                                                   (void **)&desktop->shared )))
+            {
+                desktop->shared = NULL;
+                clear_error();  /* clients will fall back to server calls */
+            }
         }
         else clear_error();
     }
@@ -297,6 +306,11 @@ static void desktop_destroy( struct object *obj )
     if (desktop->close_timeout) remove_timeout_user( desktop->close_timeout );
     list_remove( &desktop->entry );
     release_object( desktop->winstation );
+    if (desktop->shared_mapping)
+    {
+        munmap( (void *)desktop->shared, sizeof(*desktop->shared) );
+        release_object( desktop->shared_mapping );
+    }
 }
 
 static unsigned int desktop_map_access( struct object *obj, unsigned int access )
@@ -640,6 +654,7 @@ DECL_HANDLER(set_thread_desktop)
         set_process_default_desktop( current->process, new_desktop, req->handle );
 
     if (old_desktop != new_desktop && current->queue) detach_thread_input( current );
+    if (old_desktop != new_desktop) hooks_changed();  /* the global hooks are per desktop */
 
     if (old_desktop) release_object( old_desktop );
     release_object( new_desktop );
@@ -756,3 +771,17 @@ DECL_HANDLER(enum_desktop)
     release_object( winstation );
     set_error( STATUS_NO_MORE_ENTRIES );
 }
+
+
+/* get a handle to the shared memory of the current thread desktop */
+DECL_HANDLER(get_desktop_shared_memory)
+{
+    struct desktop *desktop;
+
+    if (!(desktop = get_thread_desktop( current, 0 ))) return;
+    if (desktop->shared_mapping)
+        reply->handle = alloc_handle( current->process, desktop->shared_mapping,
+                                      SECTION_QUERY | SECTION_MAP_READ, 0 );
+    else set_error( STATUS_NOT_SUPPORTED );
+    release_object( desktop );
+}
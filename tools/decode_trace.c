@@ -0,0 +1,201 @@
+/*
+ * Render binary debug traces written through WINEDEBUG_RING as text.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "config.h"
+#include "wine/port.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "wine/debug_ring.h"
+
+static const char * const debug_classes[] = { "fixme", "err", "warn", "trace" };
+
+static const char *progname;
+
+static void usage(void)
+{
+    fprintf( stderr, "Usage: %s [file...]\n", progname );
+    fprintf( stderr, "Render the binary debug traces written with WINEDEBUG_RING=file as text.\n" );
+    fprintf( stderr, "The records left in file.ring by a process that crashed are rendered as well.\n" );
+    exit( 1 );
+}
+
+static void print_record( const struct debug_ring_record *record, const char *data )
+{
+    const char *channel = data, *function = data + record->channel_len;
+    const char *text = function + record->function_len;
+
+    if (record->flags & DEBUG_RING_HEADER)
+    {
+        if (record->flags & DEBUG_RING_TIMESTAMP)
+            printf( "%3u.%03u:", record->ticks / 1000, record->ticks % 1000 );
+        if (record->flags & DEBUG_RING_PID) printf( "%04x:", record->pid );
+        if (record->flags & DEBUG_RING_TID) printf( "%04x:", record->tid );
+        if ((record->flags & DEBUG_RING_FUNCTION) &&
+            record->cls < sizeof(debug_classes) / sizeof(debug_classes[0]))
+            printf( "%s:%.*s:%.*s ", debug_classes[record->cls], record->channel_len, channel,
+                    record->function_len, function );
+    }
+    fwrite( text, 1, record->text_len, stdout );
+}
+
+static int decode_file( FILE *file, const char *name )
+{
+    struct debug_ring_file_header header;
+    struct debug_ring_record record;
+    char *data = NULL;
+    size_t size, data_size = 0;
+
+    if (fread( &header, sizeof(header), 1, file ) != 1 || header.magic != DEBUG_RING_MAGIC)
+    {
+        fprintf( stderr, "%s: %s is not a debug trace file\n", progname, name );
+        return 0;
+    }
+    if (header.version != DEBUG_RING_VERSION)
+    {
+        fprintf( stderr, "%s: %s has unsupported version %u\n", progname, name, header.version );
+        return 0;
+    }
+
+    while (fread( &record, 8, 1, file ) == 1)
+    {
+        if (record.size < 8 || record.size & 7) goto corrupt;
+        size = record.size - 8;
+        if (size > data_size)
+        {
+            data_size = size;
+            if (!(data = realloc( data, data_size ))) goto corrupt;
+        }
+        if (size && fread( data, size, 1, file ) != 1) goto truncated;
+        if (record.type == DEBUG_RING_PAD) continue;
+
+        if (record.size < sizeof(record)) goto corrupt;
+        memcpy( &record.pid, data, sizeof(record) - 8 );
+        size -= sizeof(record) - 8;
+
+        switch (record.type)
+        {
+        case DEBUG_RING_OUTPUT:
+            if (record.channel_len + record.function_len + record.text_len > size) goto corrupt;
+            print_record( &record, data + sizeof(record) - 8 );
+            break;
+        case DEBUG_RING_LOST:
+            fprintf( stderr, "%s: %s: %u records lost\n", progname, name, record.ticks );
+            break;
+        default:
+            goto corrupt;
+        }
+    }
+    free( data );
+    return 1;
+
+truncated:
+    fprintf( stderr, "%s: %s: truncated record\n", progname, name );
+    free( data );
+    return 0;
+corrupt:
+    fprintf( stderr, "%s: %s: corrupt record\n", progname, name );
+    free( data );
+    return 0;
+}
+
+/* print the records left in the ring file of a process that didn't exit cleanly */
+static int decode_ring( const char *name )
+{
+    struct debug_ring_control ctl;
+    struct debug_ring_record record;
+    char *ring_name, *ring = NULL;
+    unsigned int pos, offset;
+    FILE *file;
+    int ret = 0;
+
+    if (!(ring_name = malloc( strlen( name ) + sizeof(".ring") ))) return 0;
+    sprintf( ring_name, "%s.ring", name );
+    if (!(file = fopen( ring_name, "rb" )))
+    {
+        free( ring_name );
+        return 1;
+    }
+
+    if (fread( &ctl, sizeof(ctl), 1, file ) != 1 || ctl.magic != DEBUG_RING_MAGIC ||
+        ctl.version != DEBUG_RING_VERSION || ctl.size < sizeof(record) ||
+        (ctl.size & (ctl.size - 1)) || ctl.head - ctl.tail > ctl.size)
+    {
+        fprintf( stderr, "%s: %s is not a debug ring file\n", progname, ring_name );
+        goto done;
+    }
+    if (!(ring = malloc( ctl.size )) || fread( ring, ctl.size, 1, file ) != 1) goto truncated;
+
+    fprintf( stderr, "%s: %s: recovering records not written out by the process\n", progname, ring_name );
+    if (ctl.lost) fprintf( stderr, "%s: %s: %d records lost\n", progname, ring_name, ctl.lost );
+
+    for (pos = ctl.tail; pos != ctl.head; pos += record.size)
+    {
+        offset = pos & (ctl.size - 1);
+        if (ctl.size - offset < 8) goto corrupt;
+        memcpy( &record, ring + offset, 8 );
+        if (!record.size) break;  /* the process died while writing it */
+        if (record.size & 7 || record.size > ctl.size - offset || record.size > ctl.head - pos) goto corrupt;
+        if (record.type == DEBUG_RING_PAD) continue;
+
+        if (record.size < sizeof(record) || record.type != DEBUG_RING_OUTPUT) goto corrupt;
+        memcpy( &record, ring + offset, sizeof(record) );
+        if (record.channel_len + record.function_len + record.text_len > record.size - sizeof(record))
+            goto corrupt;
+        print_record( &record, ring + offset + sizeof(record) );
+    }
+    ret = 1;
+    goto done;
+
+truncated:
+    fprintf( stderr, "%s: %s: truncated ring file\n", progname, ring_name );
+    goto done;
+corrupt:
+    fprintf( stderr, "%s: %s: corrupt record\n", progname, ring_name );
+done:
+    free( ring );
+    free( ring_name );
+    fclose( file );
+    return ret;
+}
+
+int main( int argc, char **argv )
+{
+    FILE *file;
+    int i, ret = 0;
+
+    progname = argv[0];
+    if (argc < 2) return !decode_file( stdin, "stdin" );
+
+    for (i = 1; i < argc; i++)
+    {
+        if (argv[i][0] == '-') usage();
+        if (!(file = fopen( argv[i], "rb" )))
+        {
+            perror( argv[i] );
+            ret = 1;
+            continue;
+        }
+        if (!decode_file( file, argv[i] )) ret = 1;
+        fclose( file );
+        if (!decode_ring( argv[i] )) ret = 1;
+    }
+    return ret;
+}
@@ -0,0 +1,160 @@
+/*
+ * Measure the processor time taken by the DirectSound software mixer.
+ *
+ * This is a Windows program, it is not built with the other tools. Build it
+ * with a cross compiler or with winegcc, for instance:
+ *
+ *   winegcc -o dsound_bench dsound_bench.c -ldsound -luser32
+ *
+ * It plays a number of looping secondary buffers at sample rates that differ
+ * from the primary buffer rate, so that all of them go through the resampler,
+ * and reports the processor time used by the process while they play.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define COBJMACROS
+#include <windows.h>
+#include <mmsystem.h>
+#include <dsound.h>
+
+#ifndef ARRAY_SIZE
+#define ARRAY_SIZE(x) (sizeof(x) / sizeof((x)[0]))
+#endif
+
+#define MAX_BUFFERS 256
+
+static const int rates[] = {8000, 11025, 22050, 32000, 44100, 48000, 96000};
+
+static ULONGLONG get_process_cpu_time(void)
+{
+    FILETIME creation, exit, kernel, user;
+
+    GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user);
+    return (((ULONGLONG)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime) +
+           (((ULONGLONG)user.dwHighDateTime << 32) | user.dwLowDateTime);
+}
+
+static void init_format(WAVEFORMATEX *wfx, int rate, int channels)
+{
+    wfx->wFormatTag = WAVE_FORMAT_PCM;
+    wfx->nChannels = channels;
+    wfx->nSamplesPerSec = rate;
+    wfx->wBitsPerSample = 16;
+    wfx->nBlockAlign = wfx->nChannels * wfx->wBitsPerSample / 8;
+    wfx->nAvgBytesPerSec = wfx->nSamplesPerSec * wfx->nBlockAlign;
+    wfx->cbSize = 0;
+}
+
+static IDirectSoundBuffer *create_buffer(IDirectSound8 *dso, unsigned int index)
+{
+    IDirectSoundBuffer *buffer;
+    DSBUFFERDESC bufdesc;
+    WAVEFORMATEX wfx;
+    DWORD size, i;
+    SHORT *data;
+
+    init_format(&wfx, rates[index % ARRAY_SIZE(rates)], index % 3 ? 2 : 1);
+    memset(&bufdesc, 0, sizeof(bufdesc));
+    bufdesc.dwSize = sizeof(bufdesc);
+    bufdesc.dwFlags = DSBCAPS_GETCURRENTPOSITION2 | DSBCAPS_CTRLVOLUME | DSBCAPS_CTRLPAN;
+    bufdesc.dwBufferBytes = wfx.nAvgBytesPerSec / 2;
+    bufdesc.lpwfxFormat = &wfx;
+    if (FAILED(IDirectSound8_CreateSoundBuffer(dso, &bufdesc, &buffer, NULL)))
+        return NULL;
+
+    if (FAILED(IDirectSoundBuffer_Lock(buffer, 0, 0, (void **)&data, &size, NULL, NULL, DSBLOCK_ENTIREBUFFER)))
+    {
+        IDirectSoundBuffer_Release(buffer);
+        return NULL;
+    }
+    for (i = 0; i < size / sizeof(*data); i++)
+        data[i] = (SHORT)((i * (index + 1) * 97) & 0x3fff) - 0x2000;
+    IDirectSoundBuffer_Unlock(buffer, data, size, NULL, 0);
+
+    IDirectSoundBuffer_SetVolume(buffer, -(LONG)(index * 10));
+    IDirectSoundBuffer_SetPan(buffer, ((LONG)(index % 3) - 1) * 1000);
+    return buffer;
+}
+
+int main(int argc, char **argv)
+{
+    IDirectSoundBuffer *primary, *secondaries[MAX_BUFFERS];
+    unsigned int count = 64, duration = 2000, i;
+    DWORD start_time, elapsed;
+    ULONGLONG start, cpu;
+    DSBUFFERDESC bufdesc;
+    IDirectSound8 *dso;
+    WAVEFORMATEX wfx;
+    HRESULT hr;
+
+    if (argc > 1) count = min(max(atoi(argv[1]), 1), MAX_BUFFERS);
+    if (argc > 2) duration = max(atoi(argv[2]), 100);
+
+    if (FAILED(hr = DirectSoundCreate8(NULL, &dso, NULL)))
+    {
+        fprintf(stderr, "DirectSoundCreate8 failed, hr %#x.\n", (unsigned int)hr);
+        return 1;
+    }
+    IDirectSound8_SetCooperativeLevel(dso, GetDesktopWindow(), DSSCL_PRIORITY);
+
+    /* keep the primary buffer in a fixed format */
+    memset(&bufdesc, 0, sizeof(bufdesc));
+    bufdesc.dwSize = sizeof(bufdesc);
+    bufdesc.dwFlags = DSBCAPS_PRIMARYBUFFER;
+    if (FAILED(hr = IDirectSound8_CreateSoundBuffer(dso, &bufdesc, &primary, NULL)))
+    {
+        fprintf(stderr, "Failed to create the primary buffer, hr %#x.\n", (unsigned int)hr);
+        IDirectSound8_Release(dso);
+        return 1;
+    }
+    init_format(&wfx, 44100, 2);
+    IDirectSoundBuffer_SetFormat(primary, &wfx);
+
+    for (i = 0; i < count; i++)
+    {
+        if (!(secondaries[i] = create_buffer(dso, i)))
+        {
+            fprintf(stderr, "Failed to create buffer %u.\n", i);
+            count = i;
+            break;
+        }
+    }
+    for (i = 0; i < count; i++)
+        IDirectSoundBuffer_Play(secondaries[i], 0, 0, DSBPLAY_LOOPING);
+
+    start = get_process_cpu_time();
+    start_time = GetTickCount();
+    Sleep(duration);
+    cpu = get_process_cpu_time() - start;
+    elapsed = GetTickCount() - start_time;
+
+    for (i = 0; i < count; i++)
+    {
+        IDirectSoundBuffer_Stop(secondaries[i]);
+        IDirectSoundBuffer_Release(secondaries[i]);
+    }
+    IDirectSoundBuffer_Release(primary);
+    IDirectSound8_Release(dso);
+
+    printf("mixing %u buffers used %u ms of processor time in %u ms (%.1f%%)\n", count,
+           (unsigned int)(cpu / 10000), (unsigned int)elapsed, elapsed ? cpu / 100.0 / elapsed : 0.0);
+    return 0;
+}